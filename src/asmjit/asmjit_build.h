@@ -934,6 +934,12 @@ typedef unsigned __int64 uint64_t;
 # else
 #  define ASMJIT_FAVOR_SIZE
 # endif
+
+# if ASMJIT_CC_MSC || (ASMJIT_CC_INTEL && !ASMJIT_CC_INTEL_COMPAT_MODE)
+#  define ASMJIT_THREAD_LOCAL __declspec(thread)
+# else
+#  define ASMJIT_THREAD_LOCAL __thread
+# endif
 #endif // ASMJIT_EXPORTS
 
 // ============================================================================
@@ -12,9 +12,12 @@
 #include "./base/arch.h"
 #include "./base/assembler.h"
 #include "./base/codebuilder.h"
+#include "./base/codecache.h"
+#include "./base/codecfg.h"
 #include "./base/codecompiler.h"
 #include "./base/codeemitter.h"
 #include "./base/codeholder.h"
+#include "./base/codetemplate.h"
 #include "./base/constpool.h"
 #include "./base/cpuinfo.h"
 #include "./base/func.h"
@@ -23,9 +26,11 @@
 #include "./base/logging.h"
 #include "./base/operand.h"
 #include "./base/osutils.h"
+#include "./base/perflistener.h"
 #include "./base/runtime.h"
 #include "./base/simdtypes.h"
 #include "./base/string.h"
+#include "./base/unwind.h"
 #include "./base/utils.h"
 #include "./base/vmem.h"
 #include "./base/zone.h"
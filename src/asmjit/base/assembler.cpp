@@ -66,6 +66,33 @@ Error Assembler::onDetach(CodeHolder* code) noexcept {
   return Base::onDetach(code);
 }
 
+// ============================================================================
+// [asmjit::Assembler - Sections]
+// ============================================================================
+
+Error Assembler::section(SectionEntry* section) {
+  if (_lastError) return _lastError;
+  ASMJIT_ASSERT(_code != nullptr);
+
+  uint32_t sectionId = section->getId();
+  if (ASMJIT_UNLIKELY(sectionId >= _code->getSectionsCount() || _code->_sections[sectionId] != section))
+    return setLastError(DebugUtils::errored(kErrorInvalidArgument));
+
+#if !defined(ASMJIT_DISABLE_LOGGING)
+  if (_globalOptions & kOptionLoggingEnabled)
+    _code->_logger->logf(".section %s\n", section->getName());
+#endif // !ASMJIT_DISABLE_LOGGING
+
+  sync();
+  _section = section;
+
+  uint8_t* p = section->_buffer._data;
+  _bufferData = p;
+  _bufferEnd  = p + section->_buffer._capacity;
+  _bufferPtr  = p + section->_buffer._length;
+  return kErrorOk;
+}
+
 // ============================================================================
 // [asmjit::Assembler - Code-Generation]
 // ============================================================================
@@ -220,6 +247,8 @@ Error Assembler::bind(const Label& label) {
   LabelLink* link = le->_links;
   LabelLink* prev = nullptr;
 
+  uint32_t sectionId = _section->getId();
+
   while (link) {
     intptr_t offset = link->offset;
     uint32_t relocId = link->relocId;
@@ -227,8 +256,29 @@ Error Assembler::bind(const Label& label) {
     if (relocId != RelocEntry::kInvalidId) {
       // Adjust relocation data.
       RelocEntry* re = _code->_relocations[relocId];
+      re->_targetSectionId = sectionId;
       re->_data += static_cast<uint64_t>(pos);
     }
+    else if (link->sectionId != sectionId) {
+      // The displacement is in another section, its final value is only
+      // known after the sections are laid out, so use a relocation instead.
+      uint8_t* linkData = _code->_sections[link->sectionId]->_buffer._data;
+      uint32_t size = linkData[offset];
+
+      RelocEntry* re;
+      Error reErr = _code->newRelocEntry(&re, RelocEntry::kTypeRelToRel, size);
+
+      if (ASMJIT_UNLIKELY(reErr)) {
+        err = reErr;
+      }
+      else {
+        re->_sourceSectionId = link->sectionId;
+        re->_targetSectionId = sectionId;
+        re->_sourceOffset = static_cast<uint64_t>(offset);
+        re->_data = static_cast<uint64_t>(static_cast<int64_t>(pos) + link->rel);
+        ::memset(linkData + offset, 0, size);
+      }
+    }
     else {
       // Not using relocId, this means that we are overwriting a real
       // displacement in the CodeBuffer.
@@ -253,7 +303,7 @@ Error Assembler::bind(const Label& label) {
   }
 
   // Set as bound.
-  le->_sectionId = _section->getId();
+  le->_sectionId = sectionId;
   le->_offset = pos;
   le->_links = nullptr;
   resetInlineComment();
@@ -336,6 +386,33 @@ Error Assembler::embedConstPool(const Label& label, const ConstPool& pool) {
   if (!isLabelValid(label))
     return DebugUtils::errored(kErrorInvalidLabel);
 
+  // Embed to the constant pool section if the `CodeHolder` has one, and
+  // switch back to the current section afterwards.
+  uint32_t poolSectionId = _code->getConstPoolSectionId();
+  if (poolSectionId != SectionEntry::kInvalidId && poolSectionId != _section->getId()) {
+    SectionEntry* current = _section;
+    SectionEntry* poolSection = _code->getSectionEntry(poolSectionId);
+
+    // The pool can only be aligned in the image if the section is aligned.
+    uint32_t alignment = static_cast<uint32_t>(pool.getAlignment());
+    if (poolSection->getAlignment() < alignment)
+      poolSection->setAlignment(alignment);
+
+    ASMJIT_PROPAGATE(section(poolSection));
+    Error err = embedConstPool(label, pool);
+
+    // Switch back even if embedding failed, `section()` is a no-op then.
+    if (ASMJIT_UNLIKELY(err)) {
+      sync();
+      _section = current;
+      _bufferData = current->_buffer._data;
+      _bufferEnd  = _bufferData + current->_buffer._capacity;
+      _bufferPtr  = _bufferData + current->_buffer._length;
+      return err;
+    }
+    return section(current);
+  }
+
   ASMJIT_PROPAGATE(align(kAlignData, static_cast<uint32_t>(pool.getAlignment())));
   ASMJIT_PROPAGATE(bind(label));
 
@@ -437,6 +514,7 @@ Error Assembler::_emitFailed(
   resetOptions();
   resetExtraReg();
   resetInlineComment();
+  resetHole();
   return setLastError(err, sb.getData());
 }
 #endif
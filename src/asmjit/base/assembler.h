@@ -89,6 +89,14 @@ public:
   //! Get pointer in the CodeBuffer of the current section.
   ASMJIT_INLINE uint8_t* getBufferPtr() const noexcept { return _bufferPtr; }
 
+  //! Get the current section.
+  ASMJIT_INLINE SectionEntry* getSection() const noexcept { return _section; }
+  //! Switch to the end of `section`, see \ref CodeHolder::newSection().
+  //!
+  //! Labels can be referenced across sections, such references are resolved
+  //! by \ref CodeHolder::relocate() (only 32-bit displacements can be used).
+  ASMJIT_API Error section(SectionEntry* section);
+
   // --------------------------------------------------------------------------
   // [Code-Generation]
   // --------------------------------------------------------------------------
@@ -125,6 +133,7 @@ protected:
 
     resetOptions();
     resetInlineComment();
+    resetHole();
     return setLastError(err);
   }
 #endif
@@ -31,6 +31,7 @@ CodeBuilder::CodeBuilder() noexcept
     _cbHeap(&_cbBaseZone),
     _cbPasses(),
     _cbLabels(),
+    _cbCfg(),
     _firstNode(nullptr),
     _lastNode(nullptr),
     _cursor(nullptr),
@@ -49,6 +50,7 @@ Error CodeBuilder::onAttach(CodeHolder* code) noexcept {
 Error CodeBuilder::onDetach(CodeHolder* code) noexcept {
   _cbPasses.reset();
   _cbLabels.reset();
+  _cbCfg.reset();
   _cbHeap.reset(&_cbBaseZone);
 
   _cbBaseZone.reset(false);
@@ -118,8 +120,8 @@ CBLabel* CodeBuilder::newLabelNode() noexcept {
   return node;
 }
 
-CBAlign* CodeBuilder::newAlignNode(uint32_t mode, uint32_t alignment) noexcept {
-  return newNodeT<CBAlign>(mode, alignment);
+CBAlign* CodeBuilder::newAlignNode(uint32_t mode, uint32_t alignment, uint32_t maxSkip) noexcept {
+  return newNodeT<CBAlign>(mode, alignment, maxSkip);
 }
 
 CBData* CodeBuilder::newDataNode(const void* data, uint32_t size) noexcept {
@@ -306,6 +308,7 @@ CBNode* CodeBuilder::addNode(CBNode* node) noexcept {
   }
 
   _cursor = node;
+  _cbCfg.invalidate();
   return node;
 }
 
@@ -328,6 +331,7 @@ CBNode* CodeBuilder::addAfter(CBNode* node, CBNode* ref) noexcept {
   else
     _lastNode = node;
 
+  _cbCfg.invalidate();
   return node;
 }
 
@@ -349,36 +353,39 @@ CBNode* CodeBuilder::addBefore(CBNode* node, CBNode* ref) noexcept {
   else
     _firstNode = node;
 
+  _cbCfg.invalidate();
   return node;
 }
 
-static ASMJIT_INLINE void CodeBuilder_nodeRemoved(CodeBuilder* self, CBNode* node_) noexcept {
-  if (node_->isJmpOrJcc()) {
-    CBJump* node = static_cast<CBJump*>(node_);
-    CBLabel* label = node->getTarget();
+static ASMJIT_INLINE void CodeBuilder_unlinkJump(CBJump* node) noexcept {
+  CBLabel* label = node->getTarget();
 
-    if (label) {
-      // Disconnect.
-      CBJump** pPrev = &label->_from;
-      for (;;) {
-        ASMJIT_ASSERT(*pPrev != nullptr);
+  if (label) {
+    // Disconnect.
+    CBJump** pPrev = &label->_from;
+    for (;;) {
+      ASMJIT_ASSERT(*pPrev != nullptr);
 
-        CBJump* current = *pPrev;
-        if (!current) break;
+      CBJump* current = *pPrev;
+      if (!current) break;
 
-        if (current == node) {
-          *pPrev = node->_jumpNext;
-          break;
-        }
-
-        pPrev = &current->_jumpNext;
+      if (current == node) {
+        *pPrev = node->_jumpNext;
+        break;
       }
 
-      label->subNumRefs();
+      pPrev = &current->_jumpNext;
     }
+
+    label->subNumRefs();
   }
 }
 
+static ASMJIT_INLINE void CodeBuilder_nodeRemoved(CBNode* node_) noexcept {
+  if (node_->isJmpOrJcc())
+    CodeBuilder_unlinkJump(static_cast<CBJump*>(node_));
+}
+
 CBNode* CodeBuilder::removeNode(CBNode* node) noexcept {
   CBNode* prev = node->_prev;
   CBNode* next = node->_next;
@@ -398,8 +405,9 @@ CBNode* CodeBuilder::removeNode(CBNode* node) noexcept {
 
   if (_cursor == node)
     _cursor = prev;
-  CodeBuilder_nodeRemoved(this, node);
+  CodeBuilder_nodeRemoved(node);
 
+  _cbCfg.invalidate();
   return node;
 }
 
@@ -432,12 +440,89 @@ void CodeBuilder::removeNodes(CBNode* first, CBNode* last) noexcept {
 
     if (_cursor == node)
       _cursor = prev;
-    CodeBuilder_nodeRemoved(this, node);
+    CodeBuilder_nodeRemoved(node);
 
     if (node == last)
       break;
     node = next;
   }
+
+  _cbCfg.invalidate();
+}
+
+void CodeBuilder::moveNodes(CBNode* first, CBNode* last, CBNode* ref) noexcept {
+  ASMJIT_ASSERT(first != nullptr);
+  ASMJIT_ASSERT(last != nullptr);
+  ASMJIT_ASSERT(ref != nullptr);
+
+  if (ref == first->_prev)
+    return;
+
+  // Unlink.
+  CBNode* prev = first->_prev;
+  CBNode* next = last->_next;
+
+  if (_firstNode == first)
+    _firstNode = next;
+  else
+    prev->_next = next;
+
+  if (_lastNode == last)
+    _lastNode = prev;
+  else
+    next->_prev = prev;
+
+  // Link after `ref`.
+  next = ref->_next;
+
+  first->_prev = ref;
+  last->_next = next;
+
+  ref->_next = first;
+  if (next)
+    next->_prev = last;
+  else
+    _lastNode = last;
+
+  _cbCfg.invalidate();
+}
+
+Error CodeBuilder::setJumpTarget(CBInst* node, const Label& label) noexcept {
+  ASMJIT_ASSERT(node->getOpCount() != 0);
+
+  if (node->isJmpOrJcc()) {
+    CBJump* jump = static_cast<CBJump*>(node);
+    CBLabel* target;
+    ASMJIT_PROPAGATE(getCBLabel(&target, label));
+
+    CodeBuilder_unlinkJump(jump);
+    jump->_target = target;
+    jump->_jumpNext = target->_from;
+    target->_from = jump;
+    target->addNumRefs();
+  }
+
+  node->getOpArray()[0].copyFrom(label);
+  _cbCfg.invalidate();
+  return kErrorOk;
+}
+
+Error CodeBuilder::setLabelLikely(const Label& label) noexcept {
+  CBLabel* node;
+  ASMJIT_PROPAGATE(getCBLabel(&node, label));
+
+  node->andNotFlags(CBNode::kFlagIsUnlikely);
+  node->orFlags(CBNode::kFlagIsLikely);
+  return kErrorOk;
+}
+
+Error CodeBuilder::setLabelUnlikely(const Label& label) noexcept {
+  CBLabel* node;
+  ASMJIT_PROPAGATE(getCBLabel(&node, label));
+
+  node->andNotFlags(CBNode::kFlagIsLikely);
+  node->orFlags(CBNode::kFlagIsUnlikely);
+  return kErrorOk;
 }
 
 CBNode* CodeBuilder::setCursor(CBNode* node) noexcept {
@@ -446,6 +531,47 @@ CBNode* CodeBuilder::setCursor(CBNode* node) noexcept {
   return old;
 }
 
+// ============================================================================
+// [asmjit::CodeBuilder - CFG]
+// ============================================================================
+
+Error CodeBuilder::getCfg(CBCfg** pOut) noexcept {
+  if (!_cbCfg.isValid()) {
+    Error err = _cbCfg.build(this);
+    if (ASMJIT_UNLIKELY(err)) {
+      _cbCfg.reset();
+      *pOut = nullptr;
+      return err;
+    }
+  }
+
+  *pOut = &_cbCfg;
+  return kErrorOk;
+}
+
+Error CodeBuilder::getBlockLabel(CBBlock* block, Label& out) noexcept {
+  for (CBNode* node = block->getFirst(); ; node = node->getNext()) {
+    uint32_t type = node->getType();
+    if (type == CBNode::kNodeLabel || type == CBNode::kNodeFunc) {
+      out = node->as<CBLabel>()->getLabel();
+      return kErrorOk;
+    }
+
+    if (node == block->getLast() || (type != CBNode::kNodeComment && type != CBNode::kNodeAlign))
+      break;
+  }
+
+  CBLabel* node = newLabelNode();
+  if (ASMJIT_UNLIKELY(!node))
+    return DebugUtils::errored(kErrorNoHeapMemory);
+
+  addBefore(node, block->getFirst());
+  block->_first = node;
+
+  out = node->getLabel();
+  return kErrorOk;
+}
+
 // ============================================================================
 // [asmjit::CodeBuilder - Passes]
 // ============================================================================
@@ -503,65 +629,81 @@ ASMJIT_FAVOR_SIZE Error CodeBuilder::deletePass(CBPass* pass) noexcept {
 
 Error CodeBuilder::serialize(CodeEmitter* dst) {
   Error err = kErrorOk;
-  CBNode* node_ = getFirstNode();
+  CBNode* node = getFirstNode();
 
   do {
-    dst->setInlineComment(node_->getInlineComment());
+    err = serializeNode(dst, node);
+    if (err) break;
+    node = node->getNext();
+  } while (node);
 
-    switch (node_->getType()) {
-      case CBNode::kNodeAlign: {
-        CBAlign* node = static_cast<CBAlign*>(node_);
-        err = dst->align(node->getMode(), node->getAlignment());
-        break;
-      }
+  return err;
+}
 
-      case CBNode::kNodeData: {
-        CBData* node = static_cast<CBData*>(node_);
-        err = dst->embed(node->getData(), node->getSize());
-        break;
-      }
+Error CodeBuilder::serializeNode(CodeEmitter* dst, CBNode* node_) {
+  Error err = kErrorOk;
+  dst->setInlineComment(node_->getInlineComment());
 
-      case CBNode::kNodeFunc:
-      case CBNode::kNodeLabel: {
-        CBLabel* node = static_cast<CBLabel*>(node_);
-        err = dst->bind(node->getLabel());
-        break;
-      }
+  switch (node_->getType()) {
+    case CBNode::kNodeAlign: {
+      CBAlign* node = static_cast<CBAlign*>(node_);
 
-      case CBNode::kNodeLabelData: {
-        CBLabelData* node = static_cast<CBLabelData*>(node_);
-        err = dst->embedLabel(node->getLabel());
+      // The padding is only known to an assembler, others get the directive.
+      uint32_t maxSkip = node->getMaxSkip();
+      if (maxSkip && dst->isAssembler() && node->getAlignment() > 1 &&
+          Utils::alignDiff<size_t>(static_cast<Assembler*>(dst)->getOffset(), node->getAlignment()) > maxSkip)
         break;
-      }
 
-      case CBNode::kNodeConstPool: {
-        CBConstPool* node = static_cast<CBConstPool*>(node_);
-        err = dst->embedConstPool(node->getLabel(), node->getConstPool());
-        break;
-      }
+      err = dst->align(node->getMode(), node->getAlignment());
+      break;
+    }
 
-      case CBNode::kNodeInst:
-      case CBNode::kNodeFuncCall: {
-        CBInst* node = node_->as<CBInst>();
-        dst->setOptions(node->getOptions());
-        dst->setExtraReg(node->getExtraReg());
-        err = dst->emitOpArray(node->getInstId(), node->getOpArray(), node->getOpCount());
-        break;
-      }
+    case CBNode::kNodeData: {
+      CBData* node = static_cast<CBData*>(node_);
+      err = dst->embed(node->getData(), node->getSize());
+      break;
+    }
 
-      case CBNode::kNodeComment: {
-        CBComment* node = static_cast<CBComment*>(node_);
-        err = dst->comment(node->getInlineComment());
-        break;
-      }
+    case CBNode::kNodeFunc:
+    case CBNode::kNodeLabel: {
+      CBLabel* node = static_cast<CBLabel*>(node_);
+      err = dst->bind(node->getLabel());
+      break;
+    }
 
-      default:
-        break;
+    case CBNode::kNodeLabelData: {
+      CBLabelData* node = static_cast<CBLabelData*>(node_);
+      err = dst->embedLabel(node->getLabel());
+      break;
     }
 
-    if (err) break;
-    node_ = node_->getNext();
-  } while (node_);
+    case CBNode::kNodeConstPool: {
+      CBConstPool* node = static_cast<CBConstPool*>(node_);
+      err = dst->embedConstPool(node->getLabel(), node->getConstPool());
+      break;
+    }
+
+    case CBNode::kNodeInst:
+    case CBNode::kNodeFuncCall: {
+      CBInst* node = node_->as<CBInst>();
+      // Reserved options are provided by `dst` itself.
+      dst->setOptions(node->getOptions() & ~CodeEmitter::kOptionReservedMask);
+      dst->setExtraReg(node->getExtraReg());
+      if (node->hasHole())
+        dst->setHole(node->getHoleType(), node->getHoleId());
+      err = dst->emitOpArray(node->getInstId(), node->getOpArray(), node->getOpCount());
+      break;
+    }
+
+    case CBNode::kNodeComment: {
+      CBComment* node = static_cast<CBComment*>(node_);
+      err = dst->comment(node->getInlineComment());
+      break;
+    }
+
+    default:
+      break;
+  }
 
   return err;
 }
@@ -13,6 +13,7 @@
 
 // [Dependencies]
 #include "../base/assembler.h"
+#include "../base/codecfg.h"
 #include "../base/codeholder.h"
 #include "../base/constpool.h"
 #include "../base/inst.h"
@@ -117,7 +118,7 @@ public:
   //! Create a new \ref CBLabel node.
   ASMJIT_API CBLabel* newLabelNode() noexcept;
   //! Create a new \ref CBAlign node.
-  ASMJIT_API CBAlign* newAlignNode(uint32_t mode, uint32_t alignment) noexcept;
+  ASMJIT_API CBAlign* newAlignNode(uint32_t mode, uint32_t alignment, uint32_t maxSkip = 0) noexcept;
   //! Create a new \ref CBData node.
   ASMJIT_API CBData* newDataNode(const void* data, uint32_t size) noexcept;
   //! Create a new \ref CBConstPool node.
@@ -152,6 +153,17 @@ public:
   ASMJIT_API CBNode* removeNode(CBNode* node) noexcept;
   //! Remove multiple nodes.
   ASMJIT_API void removeNodes(CBNode* first, CBNode* last) noexcept;
+  //! Move nodes from `first` to `last` after `ref`, which must not be one of
+  //! them. Unlike `removeNode()` it keeps jumps connected to their targets.
+  ASMJIT_API void moveNodes(CBNode* first, CBNode* last, CBNode* ref) noexcept;
+
+  //! Change the target of the jump `node` to `label`.
+  ASMJIT_API Error setJumpTarget(CBInst* node, const Label& label) noexcept;
+
+  //! Mark code at `label` as likely to be executed (hot), see \ref CBNode::kFlagIsLikely.
+  ASMJIT_API Error setLabelLikely(const Label& label) noexcept;
+  //! Mark code at `label` as unlikely to be executed (cold), see \ref CBNode::kFlagIsUnlikely.
+  ASMJIT_API Error setLabelUnlikely(const Label& label) noexcept;
 
   //! Get current node.
   //!
@@ -163,6 +175,23 @@ public:
   //! Set the current node to `node` and return the previous one.
   ASMJIT_API CBNode* setCursor(CBNode* node) noexcept;
 
+  // --------------------------------------------------------------------------
+  // [CFG]
+  // --------------------------------------------------------------------------
+
+  //! Get the control-flow graph of all nodes, see \ref CBCfg.
+  //!
+  //! The graph is built on the first call and then reused until a node is
+  //! added or removed. The returned graph is owned by `CodeBuilder`.
+  ASMJIT_API Error getCfg(CBCfg** pOut) noexcept;
+  //! Invalidate the control-flow graph, a pass that changes a jump or its
+  //! target without adding or removing a node must call it.
+  ASMJIT_INLINE void invalidateCfg() noexcept { _cbCfg.invalidate(); }
+
+  //! Get a label bound at the beginning of `block`, a new label is bound there
+  //! if it has none. The block is updated, but the graph is invalidated.
+  ASMJIT_API Error getBlockLabel(CBBlock* block, Label& out) noexcept;
+
   // --------------------------------------------------------------------------
   // [Passes]
   // --------------------------------------------------------------------------
@@ -193,6 +222,10 @@ public:
   // --------------------------------------------------------------------------
 
   ASMJIT_API virtual Error serialize(CodeEmitter* dst);
+  //! Serialize a single `node` to `dst`, used by `serialize()` and by passes
+  //! that need to know the size of the code (nodes that don't emit anything
+  //! are ignored).
+  ASMJIT_API Error serializeNode(CodeEmitter* dst, CBNode* node);
 
   // --------------------------------------------------------------------------
   // [Members]
@@ -205,6 +238,7 @@ public:
 
   ZoneVector<CBPass*> _cbPasses;         //!< Array of `CBPass` objects.
   ZoneVector<CBLabel*> _cbLabels;        //!< Maps label indexes to `CBLabel` nodes.
+  CBCfg _cbCfg;                          //!< Control-flow graph, built by `getCfg()`.
 
   CBNode* _firstNode;                    //!< First node of the current section.
   CBNode* _lastNode;                     //!< Last node of the current section.
@@ -332,7 +366,12 @@ public:
     kFlagIsSpecial = 0x0100,
 
     //! Whether the instruction is an FPU instruction.
-    kFlagIsFp = 0x0200
+    kFlagIsFp = 0x0200,
+
+    //! If the `CBLabel` starts code that is likely to be executed (hot).
+    kFlagIsLikely = 0x0400,
+    //! If the `CBLabel` starts code that is unlikely to be executed (cold).
+    kFlagIsUnlikely = 0x0800
   };
 
   // --------------------------------------------------------------------------
@@ -401,6 +440,10 @@ public:
   ASMJIT_INLINE bool isJmpOrJcc() const noexcept { return hasFlag(kFlagIsJmp | kFlagIsJcc); }
   //! Whether the `CBInst` node is a return.
   ASMJIT_INLINE bool isRet() const noexcept { return hasFlag(kFlagIsRet); }
+  //! Whether the `CBLabel` node starts code that is likely to be executed.
+  ASMJIT_INLINE bool isLikely() const noexcept { return hasFlag(kFlagIsLikely); }
+  //! Whether the `CBLabel` node starts code that is unlikely to be executed.
+  ASMJIT_INLINE bool isUnlikely() const noexcept { return hasFlag(kFlagIsUnlikely); }
 
   //! Get whether the node is `CBInst` and the instruction is special.
   ASMJIT_INLINE bool isSpecial() const noexcept { return hasFlag(kFlagIsSpecial); }
@@ -475,6 +518,9 @@ public:
     _opCount = static_cast<uint8_t>(opCount);
     _opArray = opArray;
 
+    _holeType = 0;
+    _holeId = 0;
+
     _updateMemOp();
   }
 
@@ -549,6 +595,18 @@ public:
   //! Reset memory operand index to `0xFF` (no operand).
   ASMJIT_INLINE void resetMemOpIndex() noexcept { _memOpIndex = 0xFF; }
 
+  //! Get if the instruction has a hole, see \ref CodeEmitter::setHole().
+  ASMJIT_INLINE bool hasHole() const noexcept { return _holeType != 0; }
+  //! Get the type of the hole, see \ref HoleEntry::Type.
+  ASMJIT_INLINE uint32_t getHoleType() const noexcept { return _holeType; }
+  //! Get the id of the hole.
+  ASMJIT_INLINE uint32_t getHoleId() const noexcept { return _holeId; }
+  //! Set the hole of the instruction.
+  ASMJIT_INLINE void setHole(uint32_t type, uint32_t id) noexcept {
+    _holeType = static_cast<uint8_t>(type);
+    _holeId = id;
+  }
+
   // --------------------------------------------------------------------------
   // [Utils]
   // --------------------------------------------------------------------------
@@ -573,7 +631,9 @@ Update:
 
   Inst::Detail _instDetail;              //!< Instruction id, options, and extra register.
   uint8_t _memOpIndex;                   //!< \internal
-  uint8_t _reserved[7];                  //!< \internal
+  uint8_t _holeType;                     //!< Hole type, see \ref HoleEntry::Type.
+  uint16_t _reserved;                    //!< \internal
+  uint32_t _holeId;                      //!< Hole id.
   Operand* _opArray;                     //!< Instruction operands.
 };
 
@@ -684,7 +744,9 @@ public:
 
 //! Align directive (CodeBuilder).
 //!
-//! Wraps `.align` directive.
+//! Wraps `.align` directive. If `maxSkip` is not zero, the directive is
+//! ignored when aligning would need more than `maxSkip` bytes of padding,
+//! like `.p2align` of GNU assembler.
 class CBAlign : public CBNode {
 public:
   ASMJIT_NONCOPYABLE(CBAlign)
@@ -694,10 +756,11 @@ public:
   // --------------------------------------------------------------------------
 
   //! Create a new `CBAlign` instance.
-  ASMJIT_INLINE CBAlign(CodeBuilder* cb, uint32_t mode, uint32_t alignment) noexcept
+  ASMJIT_INLINE CBAlign(CodeBuilder* cb, uint32_t mode, uint32_t alignment, uint32_t maxSkip = 0) noexcept
     : CBNode(cb, kNodeAlign),
       _mode(mode),
-      _alignment(alignment) {}
+      _alignment(alignment),
+      _maxSkip(maxSkip) {}
   //! Destroy the `CBAlign` instance (NEVER CALLED).
   ASMJIT_INLINE ~CBAlign() noexcept {}
 
@@ -715,12 +778,18 @@ public:
   //! Set align offset in bytes to `offset`.
   ASMJIT_INLINE void setAlignment(uint32_t alignment) noexcept { _alignment = alignment; }
 
+  //! Get the maximum count of padding bytes, zero if not limited.
+  ASMJIT_INLINE uint32_t getMaxSkip() const noexcept { return _maxSkip; }
+  //! Set the maximum count of padding bytes, zero if not limited.
+  ASMJIT_INLINE void setMaxSkip(uint32_t maxSkip) noexcept { _maxSkip = maxSkip; }
+
   // --------------------------------------------------------------------------
   // [Members]
   // --------------------------------------------------------------------------
 
   uint32_t _mode;                        //!< Align mode, see \ref AlignMode.
   uint32_t _alignment;                   //!< Alignment (in bytes).
+  uint32_t _maxSkip;                     //!< Maximum padding (in bytes), zero if not limited.
 };
 
 // ============================================================================
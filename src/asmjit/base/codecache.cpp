@@ -0,0 +1,652 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Export]
+#define ASMJIT_EXPORTS
+
+// [Dependencies]
+#include "../base/codecache.h"
+#include "../base/utils.h"
+
+#include <stdio.h>
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+// ============================================================================
+// [asmjit::CodeCache - Helpers]
+// ============================================================================
+
+//! \internal
+enum {
+  kCodeCacheHeaderSize = 56,             // Size of the header.
+  kCodeCacheSectionSize = 60,            // Size of a section record (without data).
+  kCodeCacheRelocSize = 28,              // Size of a relocation record.
+  kCodeCacheLabelSize = 24,              // Size of a label record (without name).
+  kCodeCacheHoleSize = 12,               // Size of a hole record.
+  kCodeCacheUnwindSize = 16,             // Size of an unwind record.
+  kCodeCacheFeatureWords = CpuFeatures::kMaxFeatures / 32
+};
+
+//! \internal
+//!
+//! FNV-1a hash of `size` bytes of `data`.
+static uint32_t CodeCache_checksum(const uint8_t* data, size_t size) noexcept {
+  uint32_t hVal = 0x811C9DC5U;
+  for (size_t i = 0; i < size; i++)
+    hVal = (hVal ^ data[i]) * 0x01000193U;
+  return hVal;
+}
+
+//! \internal
+//!
+//! Bounds-checked reader of serialized data.
+struct CodeCacheReader {
+  ASMJIT_INLINE CodeCacheReader(const uint8_t* data, size_t size) noexcept
+    : _ptr(data),
+      _end(data + size) {}
+
+  ASMJIT_INLINE size_t getRemaining() const noexcept { return (size_t)(_end - _ptr); }
+
+  //! Get `n` bytes and advance, or null if there is not enough data.
+  ASMJIT_INLINE const uint8_t* read(size_t n) noexcept {
+    if (ASMJIT_UNLIKELY(n > getRemaining()))
+      return nullptr;
+
+    const uint8_t* p = _ptr;
+    _ptr += n;
+    return p;
+  }
+
+  const uint8_t* _ptr;
+  const uint8_t* _end;
+};
+
+// ============================================================================
+// [asmjit::CodeCache - Save]
+// ============================================================================
+
+Error CodeCache::save(const CodeHolder* code, StringBuilder& dst, const CpuFeatures* features) noexcept {
+  if (ASMJIT_UNLIKELY(!code->isInitialized()))
+    return DebugUtils::errored(kErrorNotInitialized);
+
+  // Links of unbound labels are not serialized.
+  if (ASMJIT_UNLIKELY(code->getUnresolvedLabelsCount() != 0))
+    return DebugUtils::errored(kErrorInvalidState);
+
+  if (!features)
+    features = &CpuInfo::getHost().getFeatures();
+
+  const ZoneVector<SectionEntry*>& sections = code->getSections();
+  const ZoneVector<RelocEntry*>& relocations = code->getRelocEntries();
+  const ZoneVector<LabelEntry*>& labels = code->getLabelEntries();
+  const ZoneVector<HoleEntry>& holes = code->getHoleEntries();
+  const ZoneVector<UnwindEntry>& unwindEntries = code->getUnwindEntries();
+
+  size_t i;
+  size_t size = kCodeCacheHeaderSize + kCodeCacheFeatureWords * 4 + 4;
+
+  for (i = 0; i < sections.getLength(); i++)
+    size += kCodeCacheSectionSize + sections[i]->getBuffer().getLength();
+
+  size += relocations.getLength() * kCodeCacheRelocSize;
+
+  for (i = 0; i < labels.getLength(); i++)
+    size += kCodeCacheLabelSize + labels[i]->getNameLength();
+
+  size += holes.getLength() * kCodeCacheHoleSize;
+  size += unwindEntries.getLength() * kCodeCacheUnwindSize;
+
+  if (ASMJIT_UNLIKELY(size > 0xFFFFFFFFU))
+    return DebugUtils::errored(kErrorCodeTooLarge);
+
+  uint8_t* start = reinterpret_cast<uint8_t*>(dst.prepare(StringBuilder::kStringOpAppend, size));
+  if (ASMJIT_UNLIKELY(!start))
+    return DebugUtils::errored(kErrorNoHeapMemory);
+
+  uint8_t* p = start;
+  const CodeInfo& codeInfo = code->getCodeInfo();
+
+  // Header.
+  Utils::writeU32uLE(p +  0, kMagic);
+  Utils::writeU32uLE(p +  4, kVersion);
+  Utils::writeU32uLE(p +  8, static_cast<uint32_t>(size));
+  p[12] = static_cast<uint8_t>(codeInfo.getArchType());
+  p[13] = static_cast<uint8_t>(codeInfo.getArchSubType());
+  p[14] = static_cast<uint8_t>(codeInfo.getStackAlignment());
+  p[15] = static_cast<uint8_t>(codeInfo.getCdeclCallConv());
+  p[16] = static_cast<uint8_t>(codeInfo.getStdCallConv());
+  p[17] = static_cast<uint8_t>(codeInfo.getFastCallConv());
+  p[18] = static_cast<uint8_t>(code->isUnwindInfoEnabled());
+  p[19] = 0;
+  Utils::writeU64uLE(p + 20, codeInfo.getBaseAddress());
+  Utils::writeU32uLE(p + 28, static_cast<uint32_t>(code->getTrampolinesSize()));
+  Utils::writeU32uLE(p + 32, static_cast<uint32_t>(sections.getLength()));
+  Utils::writeU32uLE(p + 36, static_cast<uint32_t>(relocations.getLength()));
+  Utils::writeU32uLE(p + 40, static_cast<uint32_t>(labels.getLength()));
+  Utils::writeU32uLE(p + 44, kCodeCacheFeatureWords);
+  Utils::writeU32uLE(p + 48, static_cast<uint32_t>(holes.getLength()));
+  Utils::writeU32uLE(p + 52, static_cast<uint32_t>(unwindEntries.getLength()));
+  p += kCodeCacheHeaderSize;
+
+  // Required CPU features.
+  for (i = 0; i < kCodeCacheFeatureWords; i++) {
+    uint32_t word = 0;
+    for (uint32_t bit = 0; bit < 32; bit++)
+      if (features->has(static_cast<uint32_t>(i) * 32 + bit))
+        word |= static_cast<uint32_t>(1) << bit;
+
+    Utils::writeU32uLE(p, word);
+    p += 4;
+  }
+
+  // Sections.
+  for (i = 0; i < sections.getLength(); i++) {
+    const SectionEntry* se = sections[i];
+    size_t length = se->getBuffer().getLength();
+
+    Utils::writeU32uLE(p +  0, se->getId());
+    Utils::writeU32uLE(p +  4, se->getFlags());
+    Utils::writeU32uLE(p +  8, se->getAlignment());
+    Utils::writeU32uLE(p + 12, static_cast<uint32_t>(se->getVirtualSize()));
+    ::memcpy(p + 16, se->_name, 36);
+    Utils::writeU64uLE(p + 52, static_cast<uint64_t>(length));
+    p += kCodeCacheSectionSize;
+
+    if (length) {
+      ::memcpy(p, se->getBuffer().getData(), length);
+      p += length;
+    }
+  }
+
+  // Relocations, their ids are their indexes.
+  for (i = 0; i < relocations.getLength(); i++) {
+    const RelocEntry* re = relocations[i];
+
+    p[0] = static_cast<uint8_t>(re->getType());
+    p[1] = static_cast<uint8_t>(re->getSize());
+    p[2] = 0;
+    p[3] = 0;
+    Utils::writeU32uLE(p +  4, re->getSourceSectionId());
+    Utils::writeU32uLE(p +  8, re->getTargetSectionId());
+    Utils::writeU64uLE(p + 12, re->getSourceOffset());
+    Utils::writeU64uLE(p + 20, re->getData());
+    p += kCodeCacheRelocSize;
+  }
+
+  // Labels, their ids are their indexes.
+  for (i = 0; i < labels.getLength(); i++) {
+    const LabelEntry* le = labels[i];
+    size_t nameLength = le->getNameLength();
+
+    p[0] = static_cast<uint8_t>(le->getType());
+    p[1] = static_cast<uint8_t>(le->getFlags());
+    p[2] = 0;
+    p[3] = 0;
+    Utils::writeU32uLE(p +  4, le->getParentId());
+    Utils::writeU32uLE(p +  8, le->getSectionId());
+    Utils::writeU64uLE(p + 12, static_cast<uint64_t>(static_cast<int64_t>(le->getOffset())));
+    Utils::writeU32uLE(p + 20, static_cast<uint32_t>(nameLength));
+    p += kCodeCacheLabelSize;
+
+    if (nameLength) {
+      ::memcpy(p, le->getName(), nameLength);
+      p += nameLength;
+    }
+  }
+
+  // Holes, in the order they were added.
+  for (i = 0; i < holes.getLength(); i++) {
+    const HoleEntry& hole = holes[i];
+
+    Utils::writeU32uLE(p + 0, hole.getId());
+    p[4] = static_cast<uint8_t>(hole.getType());
+    p[5] = static_cast<uint8_t>(hole.getFlags());
+    p[6] = 0;
+    p[7] = 0;
+    Utils::writeU32uLE(p + 8, hole.getRelocId());
+    p += kCodeCacheHoleSize;
+  }
+
+  // Unwind entries, in the order they were added.
+  for (i = 0; i < unwindEntries.getLength(); i++) {
+    const UnwindEntry& entry = unwindEntries[i];
+
+    Utils::writeU32uLE(p +  0, entry.getLabelId());
+    p[4] = static_cast<uint8_t>(entry.getType());
+    p[5] = static_cast<uint8_t>(entry.getRegId());
+    p[6] = 0;
+    p[7] = 0;
+    Utils::writeU32uLE(p +  8, static_cast<uint32_t>(entry.getOffset()));
+    Utils::writeU32uLE(p + 12, static_cast<uint32_t>(entry.getAddend()));
+    p += kCodeCacheUnwindSize;
+  }
+
+  // `prepare()` appended exactly `size` bytes, `start` points to them.
+  ASMJIT_ASSERT(start == reinterpret_cast<uint8_t*>(dst.getData() + dst.getLength() - size));
+  ASMJIT_ASSERT((size_t)(p - start) == size - 4);
+
+  Utils::writeU32uLE(p, CodeCache_checksum(start, size - 4));
+  return kErrorOk;
+}
+
+// ============================================================================
+// [asmjit::CodeCache - Load]
+// ============================================================================
+
+//! \internal
+//!
+//! Deserialize sections, relocations, labels, holes, and unwind entries into
+//! an initialized `code`.
+static Error CodeCache_loadContent(CodeHolder* code, CodeCacheReader& reader, const uint8_t* header) noexcept {
+  uint32_t sectionsCount = Utils::readU32uLE(header + 32);
+  uint32_t relocationsCount = Utils::readU32uLE(header + 36);
+  uint32_t labelsCount = Utils::readU32uLE(header + 40);
+  uint32_t holesCount = Utils::readU32uLE(header + 48);
+  uint32_t unwindCount = Utils::readU32uLE(header + 52);
+
+  uint32_t i;
+  const uint8_t* p;
+  size_t trampolinesSize = 0;
+
+  for (i = 0; i < sectionsCount; i++) {
+    p = reader.read(kCodeCacheSectionSize);
+    if (ASMJIT_UNLIKELY(!p || Utils::readU32uLE(p) != i))
+      return DebugUtils::errored(kErrorInvalidCodeCache);
+
+    uint64_t length = Utils::readU64uLE(p + 52);
+    if (ASMJIT_UNLIKELY(length > reader.getRemaining()))
+      return DebugUtils::errored(kErrorInvalidCodeCache);
+    const uint8_t* data = reader.read(static_cast<size_t>(length));
+
+    // The first section is created by `CodeHolder::init()`.
+    SectionEntry* se;
+    if (i == 0) {
+      se = code->_sections[0];
+    }
+    else {
+      ASMJIT_PROPAGATE(code->_sections.willGrow(&code->_baseHeap));
+      se = code->_baseZone.allocZeroedT<SectionEntry>();
+      if (ASMJIT_UNLIKELY(!se))
+        return DebugUtils::errored(kErrorNoHeapMemory);
+      code->_sections.appendUnsafe(se);
+    }
+
+    uint32_t alignment = Utils::readU32uLE(p + 8);
+    if (ASMJIT_UNLIKELY((alignment & (alignment - 1)) != 0))
+      return DebugUtils::errored(kErrorInvalidCodeCache);
+
+    se->_id = i;
+    se->_flags = Utils::readU32uLE(p + 4);
+    se->_alignment = alignment;
+    se->_virtualSize = Utils::readU32uLE(p + 12);
+    ::memcpy(se->_name, p + 16, 36);
+    se->_name[35] = '\0';
+
+    if (length) {
+      CodeBuffer& buffer = se->_buffer;
+      ASMJIT_PROPAGATE(code->reserveBuffer(&buffer, static_cast<size_t>(length)));
+
+      ::memcpy(buffer._data, data, static_cast<size_t>(length));
+      buffer._length = static_cast<size_t>(length);
+    }
+  }
+
+  for (i = 0; i < relocationsCount; i++) {
+    p = reader.read(kCodeCacheRelocSize);
+    if (ASMJIT_UNLIKELY(!p))
+      return DebugUtils::errored(kErrorInvalidCodeCache);
+
+    uint32_t type = p[0];
+    uint32_t size = p[1];
+    uint32_t sourceSectionId = Utils::readU32uLE(p + 4);
+    uint32_t targetSectionId = Utils::readU32uLE(p + 8);
+    uint64_t sourceOffset = Utils::readU64uLE(p + 12);
+
+    // Validate the entry, `relocate()` would write out of bounds otherwise.
+    if (ASMJIT_UNLIKELY(type > RelocEntry::kTypeRelToRel || sourceSectionId >= sectionsCount))
+      return DebugUtils::errored(kErrorInvalidCodeCache);
+
+    if (type != RelocEntry::kTypeNone) {
+      size_t sectionLength = code->_sections[sourceSectionId]->getBuffer().getLength();
+      if (ASMJIT_UNLIKELY((size != 1 && size != 2 && size != 4 && size != 8) ||
+                          sourceOffset > sectionLength || sectionLength - sourceOffset < size))
+        return DebugUtils::errored(kErrorInvalidCodeCache);
+    }
+
+    // A trampoline patches two bytes before its displacement and stores the
+    // target after executable sections, which must have space for it.
+    if (type == RelocEntry::kTypeTrampoline) {
+      if (ASMJIT_UNLIKELY(size != 4 || sourceOffset < 2))
+        return DebugUtils::errored(kErrorInvalidCodeCache);
+      trampolinesSize += 8;
+    }
+
+    RelocEntry* re;
+    ASMJIT_PROPAGATE(code->_relocations.willGrow(&code->_baseHeap));
+    ASMJIT_PROPAGATE(code->newRelocEntry(&re, type, size));
+
+    re->_sourceSectionId = sourceSectionId;
+    re->_targetSectionId = targetSectionId;
+    re->_sourceOffset = sourceOffset;
+    re->_data = Utils::readU64uLE(p + 20);
+  }
+
+  for (i = 0; i < labelsCount; i++) {
+    p = reader.read(kCodeCacheLabelSize);
+    if (ASMJIT_UNLIKELY(!p))
+      return DebugUtils::errored(kErrorInvalidCodeCache);
+
+    uint32_t type = p[0];
+    uint32_t parentId = Utils::readU32uLE(p + 4);
+    uint32_t sectionId = Utils::readU32uLE(p + 8);
+    int64_t offset = static_cast<int64_t>(Utils::readU64uLE(p + 12));
+    uint32_t nameLength = Utils::readU32uLE(p + 20);
+
+    const char* name = reinterpret_cast<const char*>(reader.read(nameLength));
+    if (ASMJIT_UNLIKELY(!name || (sectionId != SectionEntry::kInvalidId && sectionId >= sectionsCount)))
+      return DebugUtils::errored(kErrorInvalidCodeCache);
+
+    // Labels are created in the same order, so they get the same ids.
+    uint32_t id;
+    Error err = nameLength ? code->newNamedLabelId(id, name, nameLength, type, parentId)
+                           : code->newLabelId(id);
+    if (ASMJIT_UNLIKELY(err))
+      return err == kErrorNoHeapMemory ? err : DebugUtils::errored(kErrorInvalidCodeCache);
+
+    LabelEntry* le = code->getLabelEntry(id);
+    le->_type = static_cast<uint8_t>(type);
+    le->_parentId = parentId;
+    le->_sectionId = sectionId;
+    le->_offset = static_cast<intptr_t>(offset);
+  }
+
+  // Holes and unwind entries are validated by `CodeHolder`.
+  for (i = 0; i < holesCount; i++) {
+    p = reader.read(kCodeCacheHoleSize);
+    if (ASMJIT_UNLIKELY(!p || (p[5] & ~static_cast<uint32_t>(HoleEntry::kFlagSigned)) != 0))
+      return DebugUtils::errored(kErrorInvalidCodeCache);
+
+    Error err = code->addHoleEntry(Utils::readU32uLE(p + 0), p[4], Utils::readU32uLE(p + 8), p[5]);
+    if (ASMJIT_UNLIKELY(err))
+      return err == kErrorNoHeapMemory ? err : DebugUtils::errored(kErrorInvalidCodeCache);
+  }
+
+  for (i = 0; i < unwindCount; i++) {
+    p = reader.read(kCodeCacheUnwindSize);
+    if (ASMJIT_UNLIKELY(!p))
+      return DebugUtils::errored(kErrorInvalidCodeCache);
+
+    Error err = code->addUnwindEntry(Utils::readU32uLE(p + 0), p[4], p[5],
+      static_cast<int32_t>(Utils::readU32uLE(p + 8)),
+      static_cast<int32_t>(Utils::readU32uLE(p + 12)));
+    if (ASMJIT_UNLIKELY(err))
+      return err == kErrorNoHeapMemory ? err : DebugUtils::errored(kErrorInvalidCodeCache);
+  }
+
+  // The size of trampolines is not trusted, `relocate()` writes them to the
+  // space it reserves.
+  if (ASMJIT_UNLIKELY(Utils::readU32uLE(header + 28) != trampolinesSize))
+    return DebugUtils::errored(kErrorInvalidCodeCache);
+
+  code->_trampolinesSize = static_cast<uint32_t>(trampolinesSize);
+  return kErrorOk;
+}
+
+Error CodeCache::load(CodeHolder* code, const void* data, size_t size, const CpuInfo* cpu) noexcept {
+  if (ASMJIT_UNLIKELY(code->isInitialized()))
+    return DebugUtils::errored(kErrorAlreadyInitialized);
+
+  if (!cpu)
+    cpu = &CpuInfo::getHost();
+
+  const uint8_t* start = static_cast<const uint8_t*>(data);
+  if (ASMJIT_UNLIKELY(size < kCodeCacheHeaderSize + kCodeCacheFeatureWords * 4 + 4 ||
+                      Utils::readU32uLE(start + 0) != kMagic ||
+                      Utils::readU32uLE(start + 4) != kVersion ||
+                      Utils::readU32uLE(start + 8) != size ||
+                      Utils::readU32uLE(start + 44) != kCodeCacheFeatureWords ||
+                      Utils::readU32uLE(start + size - 4) != CodeCache_checksum(start, size - 4)))
+    return DebugUtils::errored(kErrorInvalidCodeCache);
+
+  // Check whether the code can run on `cpu`.
+  if (ASMJIT_UNLIKELY(start[12] != cpu->getArchInfo().getType()))
+    return DebugUtils::errored(kErrorInvalidArch);
+
+  const uint8_t* p = start + kCodeCacheHeaderSize;
+  for (uint32_t i = 0; i < kCodeCacheFeatureWords; i++, p += 4) {
+    uint32_t word = Utils::readU32uLE(p);
+    for (uint32_t bit = 0; bit < 32; bit++)
+      if (((word >> bit) & 1) && !cpu->hasFeature(i * 32 + bit))
+        return DebugUtils::errored(kErrorFeatureNotEnabled);
+  }
+
+  CodeInfo codeInfo(start[12], start[13], Utils::readU64uLE(start + 20));
+  codeInfo.setStackAlignment(start[14]);
+  codeInfo.setCdeclCallConv(start[15]);
+  codeInfo.setStdCallConv(start[16]);
+  codeInfo.setFastCallConv(start[17]);
+
+  ASMJIT_PROPAGATE(code->init(codeInfo));
+  code->setUnwindInfoEnabled(start[18] != 0);
+
+  CodeCacheReader reader(p, (size_t)(start + size - 4 - p));
+  Error err = CodeCache_loadContent(code, reader, start);
+
+  if (ASMJIT_UNLIKELY(!err && reader.getRemaining() != 0))
+    err = DebugUtils::errored(kErrorInvalidCodeCache);
+
+  if (ASMJIT_UNLIKELY(err)) {
+    code->reset(false);
+    return err;
+  }
+
+  return kErrorOk;
+}
+
+// ============================================================================
+// [asmjit::CodeCache - File]
+// ============================================================================
+
+Error CodeCache::saveFile(const CodeHolder* code, const char* fileName, const CpuFeatures* features) noexcept {
+  StringBuilder sb;
+  ASMJIT_PROPAGATE(save(code, sb, features));
+
+  FILE* f = ::fopen(fileName, "wb");
+  if (ASMJIT_UNLIKELY(!f))
+    return DebugUtils::errored(kErrorInvalidArgument);
+
+  size_t written = ::fwrite(sb.getData(), 1, sb.getLength(), f);
+  int closed = ::fclose(f);
+
+  if (ASMJIT_UNLIKELY(written != sb.getLength() || closed != 0))
+    return DebugUtils::errored(kErrorInvalidState);
+
+  return kErrorOk;
+}
+
+Error CodeCache::loadFile(CodeHolder* code, const char* fileName, const CpuInfo* cpu) noexcept {
+  FILE* f = ::fopen(fileName, "rb");
+  if (ASMJIT_UNLIKELY(!f))
+    return DebugUtils::errored(kErrorInvalidArgument);
+
+  long size = -1;
+  if (::fseek(f, 0, SEEK_END) == 0) {
+    size = ::ftell(f);
+    ::fseek(f, 0, SEEK_SET);
+  }
+
+  if (ASMJIT_UNLIKELY(size <= 0)) {
+    ::fclose(f);
+    return DebugUtils::errored(kErrorInvalidCodeCache);
+  }
+
+  uint8_t* data = static_cast<uint8_t*>(Internal::allocMemory(static_cast<size_t>(size)));
+  if (ASMJIT_UNLIKELY(!data)) {
+    ::fclose(f);
+    return DebugUtils::errored(kErrorNoHeapMemory);
+  }
+
+  size_t read = ::fread(data, 1, static_cast<size_t>(size), f);
+  ::fclose(f);
+
+  Error err = read == static_cast<size_t>(size)
+    ? load(code, data, read, cpu)
+    : DebugUtils::errored(kErrorInvalidCodeCache);
+
+  Internal::releaseMemory(data);
+  return err;
+}
+
+// ============================================================================
+// [asmjit::CodeCache - Test]
+// ============================================================================
+
+#if defined(ASMJIT_TEST)
+//! Copy `src` to `dst`, write `value` at `offset`, and update the checksum.
+static void CodeCacheTest_patch(StringBuilder& dst, const StringBuilder& src, size_t offset, uint32_t value) noexcept {
+  dst.setString(src.getData(), src.getLength());
+
+  uint8_t* p = reinterpret_cast<uint8_t*>(dst.getData());
+  size_t size = dst.getLength();
+
+  Utils::writeU32uLE(p + offset, value);
+  Utils::writeU32uLE(p + size - 4, CodeCache_checksum(p, size - 4));
+}
+
+UNIT(base_codecache) {
+  static const uint8_t kCode[] = { 0x90, 0x90, 0x90, 0xC3, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+  CodeHolder code;
+  EXPECT(code.init(CodeInfo(ArchInfo::kTypeHost)) == kErrorOk,
+    "Failed to initialize CodeHolder");
+
+  CodeBuffer& buffer = code._sections[0]->_buffer;
+  EXPECT(code.reserveBuffer(&buffer, sizeof(kCode)) == kErrorOk,
+    "Failed to reserve the buffer");
+  ::memcpy(buffer._data, kCode, sizeof(kCode));
+  buffer._length = sizeof(kCode);
+
+  uint32_t funcId, localId, anonId;
+  EXPECT(code.newNamedLabelId(funcId, "func", Globals::kInvalidIndex, Label::kTypeGlobal, 0) == kErrorOk,
+    "Failed to create a named label");
+  EXPECT(code.newNamedLabelId(localId, "ret", Globals::kInvalidIndex, Label::kTypeLocal, funcId) == kErrorOk,
+    "Failed to create a local label");
+  EXPECT(code.newLabelId(anonId) == kErrorOk,
+    "Failed to create an anonymous label");
+
+  code.getLabelEntry(funcId)->_sectionId = 0;
+  code.getLabelEntry(funcId)->_offset = 0;
+  code.getLabelEntry(localId)->_sectionId = 0;
+  code.getLabelEntry(localId)->_offset = 3;
+
+  RelocEntry* re;
+  EXPECT(code.newRelocEntry(&re, RelocEntry::kTypeRelToAbs, 8) == kErrorOk,
+    "Failed to create a relocation entry");
+  re->_sourceSectionId = 0;
+  re->_targetSectionId = 0;
+  re->_sourceOffset = 4;
+  re->_data = 3;
+
+  // The hole keeps the first two bytes as they are.
+  EXPECT(code.newRelocEntry(&re, RelocEntry::kTypeAbsToAbs, 2) == kErrorOk,
+    "Failed to create a relocation entry");
+  re->_sourceSectionId = 0;
+  re->_sourceOffset = 0;
+  re->_data = 0x9090;
+
+  EXPECT(code.addHoleEntry(7, HoleEntry::kTypeImm, re->getId(), HoleEntry::kFlagSigned) == kErrorOk,
+    "Failed to create a hole entry");
+  EXPECT(code.addUnwindEntry(funcId, UnwindEntry::kTypeFuncStart, 0, 8) == kErrorOk,
+    "Failed to create an unwind entry");
+  code.setUnwindInfoEnabled(true);
+
+  INFO("Round trip");
+  StringBuilder sb;
+  EXPECT(CodeCache::save(&code, sb) == kErrorOk, "Failed to save the code");
+
+  CodeHolder loaded;
+  EXPECT(CodeCache::load(&loaded, sb.getData(), sb.getLength()) == kErrorOk,
+    "Failed to load the code");
+
+  const CodeBuffer& loadedBuffer = loaded.getSections()[0]->getBuffer();
+  EXPECT(loadedBuffer.getLength() == sizeof(kCode) &&
+         ::memcmp(loadedBuffer.getData(), kCode, sizeof(kCode)) == 0,
+    "Loaded code doesn't match");
+
+  EXPECT(loaded.getLabelsCount() == 3, "Loaded %u labels, expected 3", static_cast<unsigned int>(loaded.getLabelsCount()));
+  EXPECT(loaded.getLabelIdByName("func") == funcId, "Named label not found");
+  EXPECT(loaded.getLabelIdByName("ret", Globals::kInvalidIndex, funcId) == localId, "Local label not found");
+  EXPECT(loaded.getLabelEntry(localId)->getOffset() == 3, "Label offset doesn't match");
+
+  EXPECT(loaded.getRelocEntries().getLength() == 2, "Relocation entries not loaded");
+  const RelocEntry* loadedRe = loaded.getRelocEntries()[0];
+  EXPECT(loadedRe->getType() == RelocEntry::kTypeRelToAbs &&
+         loadedRe->getSourceOffset() == 4 &&
+         loadedRe->getData() == 3,
+    "Relocation entry doesn't match");
+  EXPECT(loaded.getRelocEntries()[1]->getSize() == 2, "Relocation entry of 2 bytes doesn't match");
+
+  EXPECT(loaded.getHoleEntries().getLength() == 1, "Hole entry not loaded");
+  const HoleEntry& loadedHole = loaded.getHoleEntries()[0];
+  EXPECT(loadedHole.getId() == 7 &&
+         loadedHole.getType() == HoleEntry::kTypeImm &&
+         loadedHole.hasFlag(HoleEntry::kFlagSigned) &&
+         loadedHole.getRelocId() == 1,
+    "Hole entry doesn't match");
+
+  EXPECT(loaded.isUnwindInfoEnabled(), "Unwind information should be enabled");
+  EXPECT(loaded.getUnwindEntries().getLength() == 1, "Unwind entry not loaded");
+  const UnwindEntry& loadedUnwind = loaded.getUnwindEntries()[0];
+  EXPECT(loadedUnwind.getLabelId() == funcId &&
+         loadedUnwind.getType() == UnwindEntry::kTypeFuncStart &&
+         loadedUnwind.getOffset() == 8,
+    "Unwind entry doesn't match");
+
+  uint8_t relocated[sizeof(kCode)];
+  EXPECT(loaded.relocate(relocated, 0x1000) == sizeof(kCode), "Failed to relocate the code");
+  EXPECT(Utils::readU64uLE(relocated + 4) == 0x1003, "Relocation not applied");
+
+  INFO("Corrupted data");
+  StringBuilder corrupted;
+  corrupted.setString(sb.getData(), sb.getLength());
+  corrupted.getData()[kCodeCacheHeaderSize + kCodeCacheFeatureWords * 4 + kCodeCacheSectionSize] ^= 0x01;
+
+  CodeHolder invalid;
+  EXPECT(CodeCache::load(&invalid, corrupted.getData(), corrupted.getLength()) == kErrorInvalidCodeCache,
+    "Corrupted data should be rejected");
+  EXPECT(!invalid.isInitialized(), "CodeHolder should stay uninitialized");
+
+  INFO("Inconsistent data");
+  CodeCacheTest_patch(corrupted, sb, 28, 8);
+  EXPECT(CodeCache::load(&invalid, corrupted.getData(), corrupted.getLength()) == kErrorInvalidCodeCache,
+    "Size of trampolines that doesn't match relocations should be rejected");
+
+  CodeCacheTest_patch(corrupted, sb, kCodeCacheHeaderSize + kCodeCacheFeatureWords * 4 + 8, 3);
+  EXPECT(CodeCache::load(&invalid, corrupted.getData(), corrupted.getLength()) == kErrorInvalidCodeCache,
+    "Alignment that is not a power of 2 should be rejected");
+  EXPECT(!invalid.isInitialized(), "CodeHolder should stay uninitialized");
+
+  INFO("Missing CPU features");
+  CpuFeatures required;
+  required.add(1);
+
+  CpuInfo cpu(CpuInfo::getHost());
+  cpu._features.reset();
+
+  sb.clear();
+  EXPECT(CodeCache::save(&code, sb, &required) == kErrorOk, "Failed to save the code");
+  EXPECT(CodeCache::load(&invalid, sb.getData(), sb.getLength(), &cpu) == kErrorFeatureNotEnabled,
+    "Code requiring missing features should be rejected");
+}
+#endif // ASMJIT_TEST
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
@@ -0,0 +1,83 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Guard]
+#ifndef _ASMJIT_BASE_CODECACHE_H
+#define _ASMJIT_BASE_CODECACHE_H
+
+// [Dependencies]
+#include "../base/codeholder.h"
+#include "../base/cpuinfo.h"
+#include "../base/string.h"
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+//! \addtogroup asmjit_base
+//! \{
+
+// ============================================================================
+// [asmjit::CodeCache]
+// ============================================================================
+
+//! Serializer of finalized code, used to cache code across processes.
+//!
+//! The serialized form contains `CodeInfo`, all sections with their data,
+//! relocation entries, labels (including their names, so named labels can be
+//! looked up by `CodeHolder::getLabelIdByName()`), holes, unwind entries, and
+//! CPU features the code requires. A deserialized `CodeHolder` can be added to `JitRuntime`, which
+//! relocates it to its new address.
+//!
+//! Format
+//! ------
+//!
+//! All values are little-endian. The data starts with a header that contains
+//! `kMagic`, `kVersion`, and the total size, and ends with a FNV-1a checksum
+//! of all preceding bytes. Data of a different version, data that doesn't
+//! match its size or checksum, or data that describes entries that don't fit
+//! the code is rejected by `kErrorInvalidCodeCache`.
+//!
+//! NOTE: Absolute addresses the code refers to (like addresses of functions
+//! called through an immediate operand) are stored as is, the cache is only
+//! valid as long as they don't change.
+struct CodeCache {
+  ASMJIT_ENUM(Format) {
+    kMagic = 0x43434A41U,                //!< Magic number ("AJCC").
+    kVersion = 2                         //!< Version of the format.
+  };
+
+  //! Serialize `code` and append it to `dst`.
+  //!
+  //! The code must be finalized - all labels it uses must be bound, otherwise
+  //! `kErrorInvalidState` is returned. `features` are CPU features the code
+  //! requires, all features of the host CPU are used if it's null.
+  ASMJIT_API static Error save(const CodeHolder* code, StringBuilder& dst, const CpuFeatures* features = nullptr) noexcept;
+
+  //! Deserialize `size` bytes of `data` into `code`, which must not be
+  //! initialized.
+  //!
+  //! Returns `kErrorInvalidArch` if the code targets a different architecture
+  //! than `cpu`, and `kErrorFeatureNotEnabled` if it requires features `cpu`
+  //! doesn't have. The host CPU is used if `cpu` is null.
+  ASMJIT_API static Error load(CodeHolder* code, const void* data, size_t size, const CpuInfo* cpu = nullptr) noexcept;
+
+  //! Serialize `code` to a file `fileName`, see \ref save().
+  ASMJIT_API static Error saveFile(const CodeHolder* code, const char* fileName, const CpuFeatures* features = nullptr) noexcept;
+  //! Deserialize `code` from a file `fileName`, see \ref load().
+  ASMJIT_API static Error loadFile(CodeHolder* code, const char* fileName, const CpuInfo* cpu = nullptr) noexcept;
+};
+
+//! \}
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
+
+// [Guard]
+#endif // _ASMJIT_BASE_CODECACHE_H
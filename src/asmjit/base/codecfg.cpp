@@ -0,0 +1,430 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Export]
+#define ASMJIT_EXPORTS
+
+// [Guard]
+#include "../asmjit_build.h"
+#if !defined(ASMJIT_DISABLE_BUILDER)
+
+// [Dependencies]
+#include "../base/codebuilder.h"
+#include "../base/codecfg.h"
+#include "../base/codecompiler.h"
+#include "../base/inst.h"
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+// ============================================================================
+// [asmjit::CBCfg - Helpers]
+// ============================================================================
+
+//! \internal
+//!
+//! Get whether `node` is a label (a function is also a label).
+static ASMJIT_INLINE bool CBCfg_isLabel(const CBNode* node) noexcept {
+  return node->getType() == CBNode::kNodeLabel || node->getType() == CBNode::kNodeFunc;
+}
+
+//! \internal
+//!
+//! Get whether `node` must stay in its block. Labels, comments, and alignment
+//! can be moved to the beginning of the next block without changing the code.
+static ASMJIT_INLINE bool CBCfg_isCode(const CBNode* node) noexcept {
+  switch (node->getType()) {
+    case CBNode::kNodeLabel:
+    case CBNode::kNodeFunc:
+    case CBNode::kNodeAlign:
+    case CBNode::kNodeComment:
+      return false;
+
+    default:
+      return true;
+  }
+}
+
+//! \internal
+//!
+//! Get how the control flow leaves `node`, see \ref Inst::JumpType. Calls are
+//! `kJumpTypeNone`, function returns `kJumpTypeDirect` (to the exit label),
+//! and function ends `kJumpTypeReturn`.
+static ASMJIT_INLINE uint32_t CBCfg_getJumpType(uint32_t archType, const CBNode* node) noexcept {
+  switch (node->getType()) {
+    case CBNode::kNodeInst: {
+      if (node->isJmp()) return Inst::kJumpTypeDirect;
+      if (node->isJcc()) return Inst::kJumpTypeConditional;
+
+      uint32_t jumpType = Inst::getJumpType(archType, static_cast<const CBInst*>(node)->getInstId());
+      return jumpType == Inst::kJumpTypeCall ? static_cast<uint32_t>(Inst::kJumpTypeNone) : jumpType;
+    }
+
+    // The register allocator translates the return into a jump, if needed.
+    case CBNode::kNodeFuncExit:
+      return node->isRet() && !node->isTranslated() ? Inst::kJumpTypeDirect : Inst::kJumpTypeNone;
+
+    case CBNode::kNodeSentinel:
+      return Inst::kJumpTypeReturn;
+
+    default:
+      return Inst::kJumpTypeNone;
+  }
+}
+
+//! \internal
+static ASMJIT_INLINE Error CBCfg_addEdge(ZoneHeap* heap, CBBlock* from, CBBlock* to) noexcept {
+  if (from->_successors.contains(to))
+    return kErrorOk;
+
+  ASMJIT_PROPAGATE(from->_successors.append(heap, to));
+  return to->_predecessors.append(heap, from);
+}
+
+//! \internal
+//!
+//! Find the common dominator of `a` and `b`, see "A Simple, Fast Dominance
+//! Algorithm" by Cooper, Harvey, and Kennedy. Returns null if they are only
+//! reachable from different entries.
+static ASMJIT_INLINE CBBlock* CBCfg_intersect(CBBlock* a, CBBlock* b) noexcept {
+  while (a != b) {
+    while (a->_rpoIndex > b->_rpoIndex) {
+      if (a->_idom == a) return nullptr;
+      a = a->_idom;
+    }
+
+    while (b->_rpoIndex > a->_rpoIndex) {
+      if (b->_idom == b) return nullptr;
+      b = b->_idom;
+    }
+  }
+  return a;
+}
+
+// ============================================================================
+// [asmjit::CBBlock - Accessors]
+// ============================================================================
+
+uint32_t CBBlock::getLabelFlags() const noexcept {
+  uint32_t flags = 0;
+
+  for (CBNode* node = _first; ; node = node->getNext()) {
+    uint32_t type = node->getType();
+    if (type == CBNode::kNodeLabel)
+      flags |= node->getFlags();
+    else if (type != CBNode::kNodeComment && type != CBNode::kNodeAlign)
+      break;
+
+    if (node == _last)
+      break;
+  }
+
+  return flags;
+}
+
+// ============================================================================
+// [asmjit::CBCfg - Construction / Destruction]
+// ============================================================================
+
+CBCfg::CBCfg() noexcept
+  : _zone(8192 - Zone::kZoneOverhead),
+    _heap(&_zone),
+    _blocks(),
+    _rpo(),
+    _entries(),
+    _labelBlocks(),
+    _isValid(false) {}
+CBCfg::~CBCfg() noexcept {}
+
+// ============================================================================
+// [asmjit::CBCfg - Build / Reset]
+// ============================================================================
+
+Error CBCfg::build(CodeBuilder* cb) noexcept {
+  reset();
+
+  ZoneHeap* heap = &_heap;
+  uint32_t archType = cb->getArchType();
+  ASMJIT_PROPAGATE(_labelBlocks.resize(heap, cb->getLabels().getLength()));
+
+  // --------------------------------------------------------------------------
+  // [Blocks]
+  // --------------------------------------------------------------------------
+
+  CBBlock* block = nullptr;
+  bool hasCode = false;
+  bool split = true;
+
+  for (CBNode* node = cb->getFirstNode(); node; node = node->getNext()) {
+    bool isLabel = CBCfg_isLabel(node);
+
+    if (split || (isLabel && hasCode)) {
+      void* p = _zone.alloc(sizeof(CBBlock));
+      if (ASMJIT_UNLIKELY(!p))
+        return DebugUtils::errored(kErrorNoHeapMemory);
+
+      block = new(p) CBBlock(static_cast<uint32_t>(_blocks.getLength()), node);
+      ASMJIT_PROPAGATE(_blocks.append(heap, block));
+
+      hasCode = false;
+      split = false;
+    }
+
+    block->_last = node;
+    if (isLabel) {
+      size_t index = Operand::unpackId(static_cast<CBLabel*>(node)->getId());
+      if (index < _labelBlocks.getLength())
+        _labelBlocks[index] = block;
+
+      if (node->getType() == CBNode::kNodeFunc)
+        block->_flags |= CBBlock::kFlagIsEntry;
+    }
+    else if (CBCfg_isCode(node)) {
+      hasCode = true;
+      split = CBCfg_getJumpType(archType, node) != Inst::kJumpTypeNone;
+    }
+  }
+
+  size_t numBlocks = _blocks.getLength();
+  if (!numBlocks) {
+    _isValid = true;
+    return kErrorOk;
+  }
+  _blocks[0]->_flags |= CBBlock::kFlagIsEntry;
+
+  // --------------------------------------------------------------------------
+  // [Edges]
+  // --------------------------------------------------------------------------
+
+  size_t i;
+#if !defined(ASMJIT_DISABLE_COMPILER)
+  CCFunc* func = nullptr;
+#endif // !ASMJIT_DISABLE_COMPILER
+
+  for (i = 0; i < numBlocks; i++) {
+    block = _blocks[i];
+    if (block->isEntry())
+      ASMJIT_PROPAGATE(_entries.append(heap, block));
+
+#if !defined(ASMJIT_DISABLE_COMPILER)
+    // Functions are always at the beginning of a block.
+    for (CBNode* node = block->_first; ; node = node->getNext()) {
+      if (node->getType() == CBNode::kNodeFunc)
+        func = static_cast<CCFunc*>(node);
+      if (node == block->_last || CBCfg_isCode(node))
+        break;
+    }
+#endif // !ASMJIT_DISABLE_COMPILER
+
+    CBNode* last = block->_last;
+    uint32_t jumpType = CBCfg_getJumpType(archType, last);
+
+    if (jumpType == Inst::kJumpTypeReturn) {
+      block->_flags |= CBBlock::kFlagIsExit;
+      continue;
+    }
+
+    if (jumpType != Inst::kJumpTypeDirect) {
+      block->_flags |= CBBlock::kFlagFallsThrough;
+      if (i + 1 < numBlocks)
+        ASMJIT_PROPAGATE(CBCfg_addEdge(heap, block, _blocks[i + 1]));
+    }
+
+    if (jumpType == Inst::kJumpTypeDirect || jumpType == Inst::kJumpTypeConditional) {
+      CBBlock* target = nullptr;
+
+      if (last->getType() == CBNode::kNodeInst) {
+        CBInst* inst = static_cast<CBInst*>(last);
+        if (inst->getOpCount() && inst->getOpArray()[0].isLabel())
+          target = getBlockByLabel(inst->getOpArray()[0].getId());
+      }
+#if !defined(ASMJIT_DISABLE_COMPILER)
+      else if (func) {
+        target = getBlockByLabel(func->getExitNode()->getId());
+      }
+#endif // !ASMJIT_DISABLE_COMPILER
+
+      if (target)
+        ASMJIT_PROPAGATE(CBCfg_addEdge(heap, block, target));
+      else
+        block->_flags |= CBBlock::kFlagHasUnknownSuccessor;
+    }
+  }
+
+  // --------------------------------------------------------------------------
+  // [Reverse Postorder]
+  // --------------------------------------------------------------------------
+
+  // Depth-first search starting at each entry, `_rpoIndex` is used as an index
+  // of the next successor to visit. Entries are visited in reverse order so
+  // the first entry is also the first in reverse postorder.
+  ZoneVector<CBBlock*> stack;
+  ASMJIT_PROPAGATE(stack.reserve(heap, numBlocks));
+  ASMJIT_PROPAGATE(_rpo.reserve(heap, numBlocks));
+
+  i = _entries.getLength();
+  while (i != 0) {
+    CBBlock* entry = _entries[--i];
+    if (entry->isReachable())
+      continue;
+
+    entry->_flags |= CBBlock::kFlagIsReachable;
+    entry->_rpoIndex = 0;
+    stack.appendUnsafe(entry);
+
+    while (!stack.isEmpty()) {
+      block = stack[stack.getLength() - 1];
+
+      if (block->_rpoIndex < block->_successors.getLength()) {
+        CBBlock* succ = block->_successors[block->_rpoIndex++];
+        if (!succ->isReachable()) {
+          succ->_flags |= CBBlock::kFlagIsReachable;
+          succ->_rpoIndex = 0;
+          stack.appendUnsafe(succ);
+        }
+      }
+      else {
+        stack.truncate(stack.getLength() - 1);
+        _rpo.appendUnsafe(block);
+      }
+    }
+  }
+
+  size_t numReachable = _rpo.getLength();
+  for (i = 0; i < numReachable / 2; i++)
+    Utils::swap(_rpo[i], _rpo[numReachable - 1 - i]);
+
+  for (i = 0; i < numReachable; i++)
+    _rpo[i]->_rpoIndex = static_cast<uint32_t>(i);
+
+  // --------------------------------------------------------------------------
+  // [Dominators]
+  // --------------------------------------------------------------------------
+
+  // Entries (and blocks reachable from more entries) dominate themselves
+  // while iterating, `_idom` of unprocessed blocks is null.
+  for (i = 0; i < _entries.getLength(); i++)
+    _entries[i]->_idom = _entries[i];
+
+  bool changed;
+  do {
+    changed = false;
+    for (i = 0; i < numReachable; i++) {
+      block = _rpo[i];
+      if (block->isEntry())
+        continue;
+
+      CBBlock* idom = nullptr;
+      const ZoneVector<CBBlock*>& preds = block->getPredecessors();
+
+      for (size_t j = 0, len = preds.getLength(); j < len; j++) {
+        CBBlock* pred = preds[j];
+        if (!pred->_idom)
+          continue;
+
+        if (!idom) {
+          idom = pred;
+        }
+        else {
+          idom = CBCfg_intersect(pred, idom);
+          if (!idom) {
+            idom = block;
+            break;
+          }
+        }
+      }
+
+      if (block->_idom != idom) {
+        block->_idom = idom;
+        changed = true;
+      }
+    }
+  } while (changed);
+
+  for (i = 0; i < numReachable; i++) {
+    block = _rpo[i];
+    if (block->_idom == block)
+      block->_idom = nullptr;
+  }
+
+  // --------------------------------------------------------------------------
+  // [Loops]
+  // --------------------------------------------------------------------------
+
+  // Each back edge (an edge to a dominating block) forms a natural loop that
+  // consists of the header and all blocks that reach the edge without passing
+  // the header. Outer loops come first in reverse postorder, so inner loops
+  // overwrite `_loopHeader` of their blocks.
+  ZoneVector<uint32_t> marks;
+  ASMJIT_PROPAGATE(marks.resize(heap, numBlocks));
+
+  for (i = 0; i < numReachable; i++) {
+    CBBlock* header = _rpo[i];
+    uint32_t stamp = header->_id + 1;
+
+    const ZoneVector<CBBlock*>& headerPreds = header->getPredecessors();
+    for (size_t j = 0, len = headerPreds.getLength(); j < len; j++) {
+      CBBlock* pred = headerPreds[j];
+      if (!pred->isReachable() || !header->dominates(pred))
+        continue;
+
+      if (!header->isLoopHeader()) {
+        header->_flags |= CBBlock::kFlagIsLoopHeader;
+        header->_loopParent = header->_loopHeader;
+        header->_loopHeader = header;
+        header->_loopDepth++;
+        marks[header->_id] = stamp;
+      }
+
+      if (marks[pred->_id] != stamp) {
+        marks[pred->_id] = stamp;
+        stack.appendUnsafe(pred);
+      }
+    }
+
+    while (!stack.isEmpty()) {
+      block = stack[stack.getLength() - 1];
+      stack.truncate(stack.getLength() - 1);
+
+      block->_loopHeader = header;
+      block->_loopDepth++;
+
+      const ZoneVector<CBBlock*>& preds = block->getPredecessors();
+      for (size_t j = 0, len = preds.getLength(); j < len; j++) {
+        CBBlock* pred = preds[j];
+        if (pred->isReachable() && marks[pred->_id] != stamp) {
+          marks[pred->_id] = stamp;
+          stack.appendUnsafe(pred);
+        }
+      }
+    }
+  }
+
+  _isValid = true;
+  return kErrorOk;
+}
+
+void CBCfg::reset() noexcept {
+  _blocks.reset();
+  _rpo.reset();
+  _entries.reset();
+  _labelBlocks.reset();
+
+  _heap.reset(&_zone);
+  _zone.reset(false);
+
+  _isValid = false;
+}
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
+
+// [Guard]
+#endif // !ASMJIT_DISABLE_BUILDER
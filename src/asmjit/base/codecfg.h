@@ -0,0 +1,248 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Guard]
+#ifndef _ASMJIT_BASE_CODECFG_H
+#define _ASMJIT_BASE_CODECFG_H
+
+#include "../asmjit_build.h"
+#if !defined(ASMJIT_DISABLE_BUILDER)
+
+// [Dependencies]
+#include "../base/operand.h"
+#include "../base/zone.h"
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+// ============================================================================
+// [Forward Declarations]
+// ============================================================================
+
+class CodeBuilder;
+class CBNode;
+
+//! \addtogroup asmjit_base
+//! \{
+
+// ============================================================================
+// [asmjit::CBBlock]
+// ============================================================================
+
+//! Basic block of \ref CBCfg.
+//!
+//! A block is a range of consecutive nodes `[first, last]` that can only be
+//! entered through its first node and left through its last node. Labels are
+//! always at the beginning of a block, jumps and returns always at its end.
+class CBBlock {
+public:
+  ASMJIT_NONCOPYABLE(CBBlock)
+
+  //! Block flags.
+  ASMJIT_ENUM(Flags) {
+    kFlagIsEntry             = 0x0001,   //!< Block is an entry (first block or a function).
+    kFlagIsReachable         = 0x0002,   //!< Block is reachable from an entry.
+    kFlagIsLoopHeader        = 0x0004,   //!< Block is a header of a natural loop.
+    kFlagIsExit              = 0x0008,   //!< Block ends by a return or a function end.
+    kFlagHasUnknownSuccessor = 0x0010,   //!< Block ends by an indirect jump or a jump to an unbound label.
+    kFlagFallsThrough        = 0x0020    //!< Block continues to the next block if it doesn't jump.
+  };
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  ASMJIT_INLINE CBBlock(uint32_t id, CBNode* first) noexcept
+    : _id(id),
+      _rpoIndex(kInvalidValue),
+      _flags(0),
+      _loopDepth(0),
+      _first(first),
+      _last(first),
+      _idom(nullptr),
+      _loopHeader(nullptr),
+      _loopParent(nullptr),
+      _successors(),
+      _predecessors(),
+      _passData(nullptr) {}
+
+  // --------------------------------------------------------------------------
+  // [Accessors]
+  // --------------------------------------------------------------------------
+
+  //! Get the block id, which is its index in \ref CBCfg::getBlocks().
+  ASMJIT_INLINE uint32_t getId() const noexcept { return _id; }
+  //! Get the block index in \ref CBCfg::getRpo(), `kInvalidValue` if unreachable.
+  ASMJIT_INLINE uint32_t getRpoIndex() const noexcept { return _rpoIndex; }
+
+  //! Get block flags, see \ref Flags.
+  ASMJIT_INLINE uint32_t getFlags() const noexcept { return _flags; }
+  //! Get whether the block has `flag`.
+  ASMJIT_INLINE bool hasFlag(uint32_t flag) const noexcept { return (_flags & flag) != 0; }
+
+  ASMJIT_INLINE bool isEntry() const noexcept { return hasFlag(kFlagIsEntry); }
+  ASMJIT_INLINE bool isReachable() const noexcept { return hasFlag(kFlagIsReachable); }
+  ASMJIT_INLINE bool isLoopHeader() const noexcept { return hasFlag(kFlagIsLoopHeader); }
+  ASMJIT_INLINE bool isExit() const noexcept { return hasFlag(kFlagIsExit); }
+  ASMJIT_INLINE bool hasUnknownSuccessor() const noexcept { return hasFlag(kFlagHasUnknownSuccessor); }
+  ASMJIT_INLINE bool fallsThrough() const noexcept { return hasFlag(kFlagFallsThrough); }
+
+  //! Get the first node of the block.
+  ASMJIT_INLINE CBNode* getFirst() const noexcept { return _first; }
+  //! Get the last node of the block.
+  ASMJIT_INLINE CBNode* getLast() const noexcept { return _last; }
+
+  //! Get flags of all labels at the beginning of the block combined, which
+  //! contain hints like \ref CBNode::kFlagIsLikely and \ref CBNode::kFlagIsUnlikely.
+  ASMJIT_API uint32_t getLabelFlags() const noexcept;
+
+  //! Get successors, the fall-through successor (if any) is always the first.
+  ASMJIT_INLINE const ZoneVector<CBBlock*>& getSuccessors() const noexcept { return _successors; }
+  //! Get predecessors.
+  ASMJIT_INLINE const ZoneVector<CBBlock*>& getPredecessors() const noexcept { return _predecessors; }
+
+  //! Get the immediate dominator, null if this is an entry or unreachable.
+  ASMJIT_INLINE CBBlock* getIDom() const noexcept { return _idom; }
+  //! Get whether this block dominates `other` (every block dominates itself).
+  ASMJIT_INLINE bool dominates(const CBBlock* other) const noexcept {
+    while (other) {
+      if (other == this) return true;
+      other = other->_idom;
+    }
+    return false;
+  }
+
+  //! Get the count of loops the block is in, zero if it's not in a loop.
+  ASMJIT_INLINE uint32_t getLoopDepth() const noexcept { return _loopDepth; }
+  //! Get the header of the innermost loop the block is in (the block itself
+  //! if it's a loop header), null if the block is not in a loop.
+  ASMJIT_INLINE CBBlock* getLoopHeader() const noexcept { return _loopHeader; }
+  //! Get the header of the loop that encloses this loop, only valid for loop
+  //! headers, null if the loop is outermost.
+  ASMJIT_INLINE CBBlock* getLoopParent() const noexcept { return _loopParent; }
+
+  template<typename T>
+  ASMJIT_INLINE T* getPassData() const noexcept { return (T*)_passData; }
+  template<typename T>
+  ASMJIT_INLINE void setPassData(T* data) noexcept { _passData = (void*)data; }
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  uint32_t _id;                          //!< Block id (order of the block in code).
+  uint32_t _rpoIndex;                    //!< Index in reverse postorder.
+  uint32_t _flags;                       //!< Block flags.
+  uint32_t _loopDepth;                   //!< Loop depth.
+
+  CBNode* _first;                        //!< First node.
+  CBNode* _last;                         //!< Last node.
+
+  CBBlock* _idom;                        //!< Immediate dominator.
+  CBBlock* _loopHeader;                  //!< Header of the innermost loop.
+  CBBlock* _loopParent;                  //!< Header of the enclosing loop (loop headers only).
+
+  ZoneVector<CBBlock*> _successors;      //!< Successors.
+  ZoneVector<CBBlock*> _predecessors;    //!< Predecessors.
+
+  void* _passData;                       //!< Data used exclusively by the current `CBPass`.
+};
+
+// ============================================================================
+// [asmjit::CBCfg]
+// ============================================================================
+
+//! Control-flow graph of nodes of \ref CodeBuilder.
+//!
+//! The graph is built on demand by \ref CodeBuilder::getCfg() and is rebuilt
+//! on the next request after a node has been added or removed. It provides
+//! basic blocks in code order and in reverse postorder, edges, immediate
+//! dominators, and natural loops (loop headers and nesting).
+//!
+//! Blocks are split at labels and after jumps, returns, and function ends.
+//! Entries are the first block and each function (\ref CCFunc). Jumps are
+//! recognized by node flags (\ref CodeCompiler) or by the instruction's jump
+//! type (\ref CodeBuilder), and `CCFuncRet` is an edge to the function's exit
+//! label until it's translated by the register allocator.
+//!
+//! NOTE: Loops are detected by back edges to a dominating block, so loops
+//! having more than one entry (irreducible) are not reported as loops.
+class CBCfg {
+public:
+  ASMJIT_NONCOPYABLE(CBCfg)
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  ASMJIT_API CBCfg() noexcept;
+  ASMJIT_API ~CBCfg() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Build / Reset]
+  // --------------------------------------------------------------------------
+
+  //! Build the graph of all nodes of `cb`.
+  ASMJIT_API Error build(CodeBuilder* cb) noexcept;
+  //! Reset the graph and release its memory.
+  ASMJIT_API void reset() noexcept;
+
+  //! Get whether the graph describes the current nodes.
+  ASMJIT_INLINE bool isValid() const noexcept { return _isValid; }
+  //! Mark the graph as outdated, it's rebuilt when requested again.
+  ASMJIT_INLINE void invalidate() noexcept { _isValid = false; }
+
+  // --------------------------------------------------------------------------
+  // [Accessors]
+  // --------------------------------------------------------------------------
+
+  //! Get all blocks in code order.
+  ASMJIT_INLINE const ZoneVector<CBBlock*>& getBlocks() const noexcept { return _blocks; }
+  //! Get the count of blocks.
+  ASMJIT_INLINE size_t getBlockCount() const noexcept { return _blocks.getLength(); }
+  //! Get reachable blocks in reverse postorder.
+  ASMJIT_INLINE const ZoneVector<CBBlock*>& getRpo() const noexcept { return _rpo; }
+  //! Get entry blocks in code order.
+  ASMJIT_INLINE const ZoneVector<CBBlock*>& getEntries() const noexcept { return _entries; }
+
+  //! Get the block that starts with label `labelId`, null if the label is
+  //! not bound to a node.
+  ASMJIT_INLINE CBBlock* getBlockByLabel(uint32_t labelId) const noexcept {
+    size_t index = Operand::unpackId(labelId);
+    return index < _labelBlocks.getLength() ? _labelBlocks[index] : static_cast<CBBlock*>(nullptr);
+  }
+
+  //! Get the zone used to allocate the graph, passes can use it for data
+  //! that has the same lifetime as the graph.
+  ASMJIT_INLINE Zone* getZone() noexcept { return &_zone; }
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  Zone _zone;                            //!< Zone used to allocate blocks.
+  ZoneHeap _heap;                        //!< ZoneHeap that uses `_zone`.
+
+  ZoneVector<CBBlock*> _blocks;          //!< Blocks in code order.
+  ZoneVector<CBBlock*> _rpo;             //!< Reachable blocks in reverse postorder.
+  ZoneVector<CBBlock*> _entries;         //!< Entry blocks.
+  ZoneVector<CBBlock*> _labelBlocks;     //!< Maps label indexes to blocks.
+
+  bool _isValid;                         //!< The graph describes the current nodes.
+};
+
+//! \}
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
+
+// [Guard]
+#endif // !ASMJIT_DISABLE_BUILDER
+#endif // _ASMJIT_BASE_CODECFG_H
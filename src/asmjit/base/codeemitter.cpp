@@ -44,6 +44,8 @@ CodeEmitter::CodeEmitter(uint32_t type) noexcept
     _options(0),
     _extraReg(),
     _inlineComment(nullptr),
+    _holeType(0),
+    _holeId(0),
     _none(),
     _nativeGpReg(),
     _nativeGpArray(nullptr) {}
@@ -81,6 +83,8 @@ Error CodeEmitter::onDetach(CodeHolder* code) noexcept {
   _options = 0;
   _extraReg.reset();
   _inlineComment = nullptr;
+  _holeType = 0;
+  _holeId = 0;
 
   _nativeGpReg.reset();
   _nativeGpArray = nullptr;
@@ -108,6 +112,21 @@ Error CodeEmitter::_emitOpArray(uint32_t instId, const Operand_* opArray, size_t
   }
 }
 
+Error CodeEmitter::_emitBatch(const Inst::Record* records, size_t count) {
+  if (_lastError) return _lastError;
+
+  resetInlineComment();
+  for (size_t i = 0; i < count; i++) {
+    const Inst::Record& record = records[i];
+
+    _options = record.detail.options & ~kOptionReservedMask;
+    _extraReg = record.detail.extraReg;
+    ASMJIT_PROPAGATE(_emitOpArray(record.detail.instId, record.opArray, record.opCount));
+  }
+
+  return kErrorOk;
+}
+
 // ============================================================================
 // [asmjit::CodeEmitter - Finalize]
 // ============================================================================
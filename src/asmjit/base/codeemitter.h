@@ -11,6 +11,7 @@
 // [Dependencies]
 #include "../base/arch.h"
 #include "../base/codeholder.h"
+#include "../base/inst.h"
 #include "../base/operand.h"
 
 // [Api-Begin]
@@ -77,7 +78,23 @@ public:
     //! This feature is disabled by default, because the only processor that
     //! used to take into consideration prediction hints was P4. Newer processors
     //! implement heuristics for branch prediction that ignores any static hints.
-    kHintPredictedJumps = 0x00000002U
+    kHintPredictedJumps = 0x00000002U,
+
+    //! Keep branches within 32-byte boundaries.
+    //!
+    //! Default `false`.
+    //!
+    //! X86/X64 Specific
+    //! ----------------
+    //!
+    //! Intel processors affected by the JCC erratum (Skylake and derived) don't
+    //! cache uops of jumps that cross or end on a 32-byte boundary, which makes
+    //! hot loops much slower after the microcode update. If this option is
+    //! enabled the assembler pads jumps, calls, returns, and macro-fused pairs
+    //! like `cmp+jcc` by multi-byte NOPs so they never cross or end on such
+    //! boundary (like `-mbranches-within-32B-boundaries` option of binutils).
+    //! The code is expected to be placed to a 32-byte aligned address.
+    kHintAlignBranches = 0x00000004U
   };
 
   //! CodeEmitter options that are merged with instruction options.
@@ -174,6 +191,8 @@ public:
   virtual Error _emit(uint32_t instId, const Operand_& o0, const Operand_& o1, const Operand_& o2, const Operand_& o3, const Operand_& o4, const Operand_& o5) = 0;
   //! Emit instruction having operands stored in array.
   virtual Error _emitOpArray(uint32_t instId, const Operand_* opArray, size_t opCount);
+  //! Emit instructions stored in `records` array of `count` records.
+  virtual Error _emitBatch(const Inst::Record* records, size_t count);
 
   //! Create a new label.
   virtual Label newLabel() = 0;
@@ -337,6 +356,25 @@ public:
   //! Reset annotation of the next instruction to null.
   ASMJIT_INLINE void resetInlineComment() noexcept { _inlineComment = nullptr; }
 
+  //! Get if the next instruction has a hole.
+  ASMJIT_INLINE bool hasHole() const noexcept { return _holeType != 0; }
+  //! Get the type of the hole of the next instruction, see \ref HoleEntry::Type.
+  ASMJIT_INLINE uint32_t getHoleType() const noexcept { return _holeType; }
+  //! Get the id of the hole of the next instruction.
+  ASMJIT_INLINE uint32_t getHoleId() const noexcept { return _holeId; }
+  //! Mark an operand of the next instruction as a hole `id` of `type`.
+  //!
+  //! The operand is recorded by \ref Assembler as a \ref HoleEntry, which
+  //! can be patched by \ref CodeTemplate without generating the code again.
+  //! The value emitted decides the encoding, so it must be of the largest
+  //! size the hole will be patched to (like `0x7FFFFFFF` for a 32-bit value).
+  ASMJIT_INLINE void setHole(uint32_t type, uint32_t id) noexcept {
+    _holeType = type;
+    _holeId = id;
+  }
+  //! Reset the hole of the next instruction.
+  ASMJIT_INLINE void resetHole() noexcept { _holeType = 0; }
+
   // --------------------------------------------------------------------------
   // [Helpers]
   // --------------------------------------------------------------------------
@@ -461,6 +499,20 @@ public:
     return _emitOpArray(instId, opArray, opCount);
   }
 
+  //! Emit an array of pre-built instructions.
+  //!
+  //! Each record provides its own options and extra register, options of the
+  //! next instruction and its inline comment are not used. Emitting stops at
+  //! the first instruction that fails, instructions emitted before it are kept
+  //! by \ref Assembler, but \ref CodeBuilder adds either all or none of them.
+  //!
+  //! It's a convenience, not a faster path for \ref Assembler, which encodes
+  //! each record by `_emitOpArray()`, so the cost of an instruction is the same
+  //! as of `emit()`. \ref CodeBuilder allocates all nodes at once.
+  ASMJIT_INLINE Error emitBatch(const Inst::Record* records, size_t count) {
+    return _emitBatch(records, count);
+  }
+
   // --------------------------------------------------------------------------
   // [Members]
   // --------------------------------------------------------------------------
@@ -482,6 +534,8 @@ public:
   uint32_t _options;                     //!< Used to pass instruction options        (affects the next instruction).
   RegOnly _extraReg;                     //!< Extra register (op-mask {k} on AVX-512) (affects the next instruction).
   const char* _inlineComment;            //!< Inline comment of the next instruction  (affects the next instruction).
+  uint32_t _holeType;                    //!< Hole type, see \ref HoleEntry::Type   (affects the next instruction).
+  uint32_t _holeId;                      //!< Hole id                                 (affects the next instruction).
 
   Operand_ _none;                        //!< Used to pass unused operands to `_emit()` instead of passing null.
   Reg _nativeGpReg;                      //!< Native GP register with zero id.
@@ -9,6 +9,7 @@
 
 // [Dependencies]
 #include "../base/assembler.h"
+#include "../base/runtime.h"
 #include "../base/utils.h"
 #include "../base/vmem.h"
 
@@ -40,11 +41,27 @@ static void CodeHolder_setGlobalOption(CodeHolder* self, uint32_t clear, uint32_
   }
 }
 
+static void CodeHolder_setGlobalHint(CodeHolder* self, uint32_t clear, uint32_t add) noexcept {
+  // Modify global hints of `CodeHolder` itself.
+  self->_globalHints = (self->_globalHints & ~clear) | add;
+
+  // Modify all global hints of all `CodeEmitter`s attached.
+  CodeEmitter* emitter = self->_emitters;
+  while (emitter) {
+    emitter->_globalHints = (emitter->_globalHints & ~clear) | add;
+    emitter = emitter->_nextEmitter;
+  }
+}
+
 static void CodeHolder_resetInternal(CodeHolder* self, bool releaseMemory) noexcept {
   // Detach all `CodeEmitter`s.
   while (self->_emitters)
     self->detach(self->_emitters);
 
+  // The first section refers to memory of a stream, release it.
+  if (self->_streamRuntime)
+    self->_streamRuntime->_releaseStream(self);
+
   // Reset everything into its construction state.
   self->_codeInfo.reset();
   self->_globalHints = 0;
@@ -54,6 +71,11 @@ static void CodeHolder_resetInternal(CodeHolder* self, bool releaseMemory) noexc
 
   self->_unresolvedLabelsCount = 0;
   self->_trampolinesSize = 0;
+  self->_groupAlignment = 0;
+  self->_groupStride = 0;
+  self->_constPoolSectionId = SectionEntry::kInvalidId;
+  self->_trampolinesOffset = 0;
+  self->_unwindInfoEnabled = 0;
 
   // Reset all sections.
   size_t numSections = self->_sections.getLength();
@@ -70,6 +92,8 @@ static void CodeHolder_resetInternal(CodeHolder* self, bool releaseMemory) noexc
 
   self->_namedLabels.reset(heap);
   self->_relocations.reset();
+  self->_unwindEntries.reset();
+  self->_holeEntries.reset();
   self->_labels.reset();
   self->_sections.reset();
 
@@ -89,8 +113,14 @@ CodeHolder::CodeHolder() noexcept
     _cgAsm(nullptr),
     _logger(nullptr),
     _errorHandler(nullptr),
+    _streamRuntime(nullptr),
     _unresolvedLabelsCount(0),
     _trampolinesSize(0),
+    _groupAlignment(0),
+    _groupStride(0),
+    _constPoolSectionId(SectionEntry::kInvalidId),
+    _trampolinesOffset(0),
+    _unwindInfoEnabled(0),
     _baseZone(16384 - Zone::kZoneOverhead),
     _dataZone(16384 - Zone::kZoneOverhead),
     _baseHeap(&_baseZone),
@@ -232,16 +262,25 @@ void CodeHolder::sync() noexcept {
   if (_cgAsm) _cgAsm->sync();
 }
 
+// ============================================================================
+// [asmjit::CodeHolder - Global Information]
+// ============================================================================
+
+void CodeHolder::addGlobalHints(uint32_t hints) noexcept {
+  CodeHolder_setGlobalHint(this, 0, hints);
+}
+
+void CodeHolder::clearGlobalHints(uint32_t hints) noexcept {
+  CodeHolder_setGlobalHint(this, hints, 0);
+}
+
 // ============================================================================
 // [asmjit::CodeHolder - Result Information]
 // ============================================================================
 
 size_t CodeHolder::getCodeSize() const noexcept {
-  // Reflect all changes first.
-  const_cast<CodeHolder*>(this)->sync();
-
-  // TODO: Support sections.
-  return _sections[0]->_buffer._length + getTrampolinesSize();
+  // Reflect all changes first, `flatten()` syncs.
+  return const_cast<CodeHolder*>(this)->flatten();
 }
 
 // ============================================================================
@@ -267,6 +306,20 @@ Error CodeHolder::setErrorHandler(ErrorHandler* handler) noexcept {
 // [asmjit::CodeHolder - Sections]
 // ============================================================================
 
+static void CodeHolder_updateAssembler(CodeHolder* self, CodeBuffer* cb) noexcept {
+  // Update the `Assembler` pointers if attached. Maybe we should introduce an
+  // event for this, but since only one Assembler can be attached at a time it
+  // should not matter how these pointers are updated.
+  Assembler* a = self->_cgAsm;
+  if (a && &a->_section->_buffer == cb) {
+    size_t offset = a->getOffset();
+
+    a->_bufferData = cb->_data;
+    a->_bufferEnd  = cb->_data + cb->_capacity;
+    a->_bufferPtr  = cb->_data + offset;
+  }
+}
+
 static Error CodeHolder_reserveInternal(CodeHolder* self, CodeBuffer* cb, size_t n) noexcept {
   uint8_t* oldData = cb->_data;
   uint8_t* newData;
@@ -279,21 +332,16 @@ static Error CodeHolder_reserveInternal(CodeHolder* self, CodeBuffer* cb, size_t
   if (ASMJIT_UNLIKELY(!newData))
     return DebugUtils::errored(kErrorNoHeapMemory);
 
+  // The content of an external buffer is copied, the new buffer is owned.
+  if (oldData && cb->isExternal()) {
+    ::memcpy(newData, oldData, cb->_length);
+    cb->_isExternal = false;
+  }
+
   cb->_data = newData;
   cb->_capacity = n;
 
-  // Update the `Assembler` pointers if attached. Maybe we should introduce an
-  // event for this, but since only one Assembler can be attached at a time it
-  // should not matter how these pointers are updated.
-  Assembler* a = self->_cgAsm;
-  if (a && &a->_section->_buffer == cb) {
-    size_t offset = a->getOffset();
-
-    a->_bufferData = newData;
-    a->_bufferEnd  = newData + n;
-    a->_bufferPtr  = newData + offset;
-  }
-
+  CodeHolder_updateAssembler(self, cb);
   return kErrorOk;
 }
 
@@ -356,6 +404,145 @@ Error CodeHolder::reserveBuffer(CodeBuffer* cb, size_t n) noexcept {
   return CodeHolder_reserveInternal(this, cb, n);
 }
 
+Error CodeHolder::setExternalBuffer(SectionEntry* section, void* data, size_t capacity) noexcept {
+  if (_cgAsm) _cgAsm->sync();
+
+  CodeBuffer* cb = &section->_buffer;
+  if (ASMJIT_UNLIKELY(cb->getLength() != 0 || cb->isFixedSize()))
+    return DebugUtils::errored(kErrorInvalidState);
+
+  if (cb->hasData() && !cb->isExternal())
+    Internal::releaseMemory(cb->_data);
+
+  cb->_data = static_cast<uint8_t*>(data);
+  cb->_capacity = capacity;
+  cb->_isExternal = true;
+
+  CodeHolder_updateAssembler(this, cb);
+  return kErrorOk;
+}
+
+void CodeHolder::fixBufferSize(SectionEntry* section) noexcept {
+  if (_cgAsm) _cgAsm->sync();
+
+  CodeBuffer* cb = &section->_buffer;
+  cb->_capacity = cb->_length;
+  cb->_isFixedSize = true;
+
+  CodeHolder_updateAssembler(this, cb);
+}
+
+Error CodeHolder::newSection(SectionEntry** sectionOut, const char* name, size_t nameLength, uint32_t flags, uint32_t alignment) noexcept {
+  *sectionOut = nullptr;
+
+  if (nameLength == Globals::kInvalidIndex)
+    nameLength = ::strlen(name);
+
+  if (ASMJIT_UNLIKELY(nameLength == 0 || nameLength >= sizeof(SectionEntry::_name) ||
+                      (alignment & (alignment - 1)) != 0 || getSectionByName(name, nameLength)))
+    return DebugUtils::errored(kErrorInvalidArgument);
+
+  size_t index = _sections.getLength();
+  if (ASMJIT_UNLIKELY(index >= SectionEntry::kInvalidId))
+    return DebugUtils::errored(kErrorInvalidState);
+
+  ASMJIT_PROPAGATE(_sections.willGrow(&_baseHeap));
+  SectionEntry* se = _baseZone.allocZeroedT<SectionEntry>();
+
+  if (ASMJIT_UNLIKELY(!se))
+    return DebugUtils::errored(kErrorNoHeapMemory);
+
+  se->_id = static_cast<uint32_t>(index);
+  se->_flags = flags;
+  se->_alignment = alignment;
+  ::memcpy(se->_name, name, nameLength);
+
+  _sections.appendUnsafe(se);
+  *sectionOut = se;
+  return kErrorOk;
+}
+
+SectionEntry* CodeHolder::getSectionByName(const char* name, size_t nameLength) const noexcept {
+  if (nameLength == Globals::kInvalidIndex)
+    nameLength = ::strlen(name);
+
+  if (nameLength >= sizeof(SectionEntry::_name))
+    return nullptr;
+
+  size_t numSections = _sections.getLength();
+  for (size_t i = 0; i < numSections; i++) {
+    SectionEntry* se = _sections[i];
+    if (::memcmp(se->_name, name, nameLength) == 0 && se->_name[nameLength] == '\0')
+      return se;
+  }
+
+  return nullptr;
+}
+
+//! \internal
+//!
+//! Get the image group of `section` - executable, read-only, or writable.
+static ASMJIT_INLINE uint32_t CodeHolder_getSectionGroup(const SectionEntry* section) noexcept {
+  if (section->hasFlag(SectionEntry::kFlagExec)) return 0;
+  if (section->hasFlag(SectionEntry::kFlagConst)) return 1;
+  return 2;
+}
+
+size_t CodeHolder::flatten() noexcept {
+  sync();
+
+  size_t numSections = _sections.getLength();
+  size_t stride = _groupStride;
+  size_t offset;
+
+L_Restart:
+  offset = 0;
+  for (uint32_t group = 0; group < 3; group++) {
+    bool isFirst = true;
+
+    for (size_t i = 0; i < numSections; i++) {
+      SectionEntry* se = _sections[i];
+      if (se->hasFlag(SectionEntry::kFlagInfo) || CodeHolder_getSectionGroup(se) != group)
+        continue;
+
+      size_t alignment = std::max<size_t>(se->getAlignment(), 1);
+      if (isFirst && group != 0 && stride != 0) {
+        // The previous group doesn't fit, lay out the image without stride.
+        if (offset > group * stride) {
+          stride = 0;
+          goto L_Restart;
+        }
+        offset = group * stride;
+      }
+      else if (isFirst && offset != 0) {
+        alignment = std::max<size_t>(alignment, _groupAlignment);
+      }
+
+      offset = Utils::alignTo<size_t>(offset, alignment);
+      se->_offset = static_cast<uint64_t>(offset);
+
+      offset += se->getImageSize();
+      isFirst = false;
+    }
+
+    // Trampolines follow executable sections.
+    if (group == 0) {
+      _trampolinesOffset = offset;
+      offset += getTrampolinesSize();
+    }
+  }
+
+  return offset;
+}
+
+Error CodeHolder::setConstPoolSectionId(uint32_t sectionId) noexcept {
+  if (ASMJIT_UNLIKELY(sectionId != SectionEntry::kInvalidId && sectionId >= _sections.getLength()))
+    return DebugUtils::errored(kErrorInvalidArgument);
+
+  _constPoolSectionId = sectionId;
+  return kErrorOk;
+}
+
 // ============================================================================
 // [asmjit::CodeHolder - Labels & Symbols]
 // ============================================================================
@@ -367,18 +554,22 @@ namespace {
 //! Only used to lookup a label from `_namedLabels`.
 class LabelByName {
 public:
-  ASMJIT_INLINE LabelByName(const char* name, size_t nameLength, uint32_t hVal) noexcept
+  ASMJIT_INLINE LabelByName(const char* name, size_t nameLength, uint32_t hVal, uint32_t parentId) noexcept
     : name(name),
-      nameLength(static_cast<uint32_t>(nameLength)) {}
+      nameLength(static_cast<uint32_t>(nameLength)),
+      hVal(hVal),
+      parentId(parentId) {}
 
   ASMJIT_INLINE bool matches(const LabelEntry* entry) const noexcept {
     return static_cast<uint32_t>(entry->getNameLength()) == nameLength &&
+           entry->getParentId() == parentId &&
            ::memcmp(entry->getName(), name, nameLength) == 0;
   }
 
   const char* name;
   uint32_t nameLength;
   uint32_t hVal;
+  uint32_t parentId;
 };
 
 // Returns a hash of `name` and fixes `nameLength` if it's `Globals::kInvalidIndex`.
@@ -477,7 +668,7 @@ Error CodeHolder::newNamedLabelId(uint32_t& idOut, const char* name, size_t name
   // Don't allow to insert duplicates. Local labels allow duplicates that have
   // different id, this is already accomplished by having a different hashes
   // between the same label names having different parent labels.
-  LabelEntry* le = _namedLabels.get(LabelByName(name, nameLength, hVal));
+  LabelEntry* le = _namedLabels.get(LabelByName(name, nameLength, hVal, parentId));
   if (ASMJIT_UNLIKELY(le))
     return DebugUtils::errored(kErrorLabelAlreadyDefined);
 
@@ -497,7 +688,7 @@ Error CodeHolder::newNamedLabelId(uint32_t& idOut, const char* name, size_t name
   le->_hVal = hVal;
   le->_setId(id);
   le->_type = static_cast<uint8_t>(type);
-  le->_parentId = 0;
+  le->_parentId = parentId;
   le->_sectionId = SectionEntry::kInvalidId;
   le->_offset = 0;
 
@@ -522,7 +713,10 @@ uint32_t CodeHolder::getLabelIdByName(const char* name, size_t nameLength, uint3
   uint32_t hVal = CodeHolder_hashNameAndFixLen(name, nameLength);
   if (ASMJIT_UNLIKELY(!nameLength)) return 0;
 
-  LabelEntry* le = _namedLabels.get(LabelByName(name, nameLength, hVal));
+  // Must match the hash calculated by `newNamedLabelId()`.
+  hVal ^= parentId;
+
+  LabelEntry* le = _namedLabels.get(LabelByName(name, nameLength, hVal, parentId));
   return le ? le->getId() : static_cast<uint32_t>(0);
 }
 
@@ -557,13 +751,117 @@ Error CodeHolder::newRelocEntry(RelocEntry** dst, uint32_t type, uint32_t size)
   return kErrorOk;
 }
 
-// TODO: Support multiple sections, this only relocates the first.
+bool CodeHolder::_relocateEntry(
+  uint8_t* dst, size_t imageSize, uint64_t baseAddress,
+  const RelocEntry* re, uint64_t sourceOffset, uint64_t targetOffset, size_t& trampOffset) noexcept {
+
+  uint64_t ptr = re->getData();
+  size_t codeOffset = static_cast<size_t>(sourceOffset + re->getSourceOffset());
+
+  // Make sure that the `RelocEntry` is correct, we don't want to write
+  // out of bounds in `dst`.
+  if (ASMJIT_UNLIKELY(codeOffset + re->getSize() > imageSize))
+    return false;
+
+  // Whether to use trampoline, can be only used if relocation type is `kRelocTrampoline`.
+  bool useTrampoline = false;
+
+  switch (re->getType()) {
+    case RelocEntry::kTypeAbsToAbs: {
+      break;
+    }
+
+    case RelocEntry::kTypeRelToAbs: {
+      ptr += baseAddress + targetOffset;
+      break;
+    }
+
+    case RelocEntry::kTypeAbsToRel: {
+      ptr -= baseAddress + codeOffset + re->getSize();
+      break;
+    }
+
+    case RelocEntry::kTypeTrampoline: {
+      if (re->getSize() != 4)
+        return false;
+
+      ptr -= baseAddress + codeOffset + re->getSize();
+      if (!Utils::isInt32(static_cast<int64_t>(ptr))) {
+        ptr = (uint64_t)trampOffset - codeOffset - re->getSize();
+        useTrampoline = true;
+      }
+      break;
+    }
+
+    case RelocEntry::kTypeRelToRel: {
+      // The data already accounts for the size of the displacement and
+      // for the rest of the instruction.
+      ptr += targetOffset - codeOffset;
+      if (ASMJIT_UNLIKELY(re->getSize() == 1 ? !Utils::isInt8(static_cast<int64_t>(ptr))
+                                             : !Utils::isInt32(static_cast<int64_t>(ptr))))
+        return false;
+      break;
+    }
+
+    default:
+      return false;
+  }
+
+  switch (re->getSize()) {
+    case 1:
+      Utils::writeU8(dst + codeOffset, static_cast<uint32_t>(ptr & 0xFFU));
+      break;
+
+    case 2:
+      Utils::writeU16u(dst + codeOffset, static_cast<uint32_t>(ptr & 0xFFFFU));
+      break;
+
+    case 4:
+      Utils::writeU32u(dst + codeOffset, static_cast<uint32_t>(ptr & 0xFFFFFFFFU));
+      break;
+
+    case 8:
+      Utils::writeU64u(dst + codeOffset, ptr);
+      break;
+
+    default:
+      return false;
+  }
+
+  // Handle the trampoline case.
+  if (useTrampoline) {
+    // Bytes that replace [REX, OPCODE] bytes.
+    uint32_t byte0 = 0xFF;
+    uint32_t byte1 = dst[codeOffset - 1];
+
+    if (byte1 == 0xE8) {
+      // Patch CALL/MOD byte to FF/2 (-> 0x15).
+      byte1 = x86EncodeMod(0, 2, 5);
+    }
+    else if (byte1 == 0xE9) {
+      // Patch JMP/MOD byte to FF/4 (-> 0x25).
+      byte1 = x86EncodeMod(0, 4, 5);
+    }
+    else {
+      return false;
+    }
+
+    // Patch `jmp/call` instruction.
+    ASMJIT_ASSERT(codeOffset >= 2);
+    dst[codeOffset - 2] = static_cast<uint8_t>(byte0);
+    dst[codeOffset - 1] = static_cast<uint8_t>(byte1);
+
+    // Store absolute address and advance the trampoline pointer.
+    Utils::writeU64u(dst + trampOffset, re->getData());
+    trampOffset += 8;
+  }
+
+  return true;
+}
+
 // TODO: This should go to Runtime as it's responsible for relocating the
 //       code, CodeHolder should just hold it.
 size_t CodeHolder::relocate(void* _dst, uint64_t baseAddress) const noexcept {
-  SectionEntry* section = _sections[0];
-  ASMJIT_ASSERT(section != nullptr);
-
   uint8_t* dst = static_cast<uint8_t*>(_dst);
   if (baseAddress == Globals::kNoBaseAddress)
     baseAddress = static_cast<uint64_t>((uintptr_t)dst);
@@ -572,15 +870,61 @@ size_t CodeHolder::relocate(void* _dst, uint64_t baseAddress) const noexcept {
   Logger* logger = getLogger();
 #endif // ASMJIT_DISABLE_LOGGING
 
-  size_t minCodeSize = section->getBuffer().getLength(); // Minimum code size.
-  size_t maxCodeSize = getCodeSize();                    // Includes all possible trampolines.
+  // Includes all possible trampolines.
+  size_t maxCodeSize = const_cast<CodeHolder*>(this)->flatten();
+  size_t textEnd = _sections[0]->getOffset() == 0 ? _sections[0]->getPhysicalSize() : size_t(0);
 
-  // We will copy the exact size of the generated code. Extra code for trampolines
-  // is generated on-the-fly by the relocator (this code doesn't exist at the moment).
-  ::memcpy(dst, section->_buffer._data, minCodeSize);
+  size_t numSections = _sections.getLength();
+
+  // Copy all sections to their offsets, padding and zero initialized parts
+  // are cleared (everything after the physical data of the first section).
+  // Extra code for trampolines is generated on-the-fly by the relocator (this
+  // code doesn't exist at the moment).
+  if (!_groupStride) {
+    ::memset(dst + textEnd, 0, maxCodeSize - textEnd);
+  }
+  else {
+    // Memory between groups can be used by other images, clear each group.
+    ::memset(dst + textEnd, 0, _trampolinesOffset + _trampolinesSize - textEnd);
+
+    for (uint32_t group = 1; group < 3; group++) {
+      size_t groupStart = maxCodeSize;
+      size_t groupEnd = 0;
+
+      for (size_t i = 0; i < numSections; i++) {
+        const SectionEntry* se = _sections[i];
+        if (se->hasFlag(SectionEntry::kFlagInfo) || CodeHolder_getSectionGroup(se) != group)
+          continue;
+
+        groupStart = std::min<size_t>(groupStart, static_cast<size_t>(se->getOffset()));
+        groupEnd = std::max<size_t>(groupEnd, static_cast<size_t>(se->getOffset()) + se->getImageSize());
+      }
+
+      if (groupStart < groupEnd)
+        ::memset(dst + groupStart, 0, groupEnd - groupStart);
+    }
+  }
+  size_t usedSize = _trampolinesOffset;
+
+  for (size_t i = 0; i < numSections; i++) {
+    const SectionEntry* se = _sections[i];
+    if (se->hasFlag(SectionEntry::kFlagInfo))
+      continue;
+
+    // The buffer can already be at its place if it's external, an empty
+    // section may have no buffer at all.
+    size_t offset = static_cast<size_t>(se->getOffset());
+    size_t physicalSize = se->getPhysicalSize();
+    if (physicalSize != 0 && se->_buffer._data != dst + offset)
+      ::memcpy(dst + offset, se->_buffer._data, physicalSize);
+
+    // Memory after trampolines is only used by data sections.
+    if (offset >= _trampolinesOffset)
+      usedSize = std::max<size_t>(usedSize, offset + se->getImageSize());
+  }
 
   // Trampoline offset from the beginning of dst/baseAddress.
-  size_t trampOffset = minCodeSize;
+  size_t trampOffset = _trampolinesOffset;
 
   // Relocate all recorded locations.
   size_t numRelocs = _relocations.getLength();
@@ -593,102 +937,148 @@ size_t CodeHolder::relocate(void* _dst, uint64_t baseAddress) const noexcept {
     if (re->getType() == RelocEntry::kTypeNone)
       continue;
 
-    uint64_t ptr = re->getData();
-    size_t codeOffset = static_cast<size_t>(re->getSourceOffset());
-
-    // Make sure that the `RelocEntry` is correct, we don't want to write
-    // out of bounds in `dst`.
-    if (ASMJIT_UNLIKELY(codeOffset + re->getSize() > maxCodeSize))
-      return DebugUtils::errored(kErrorInvalidRelocEntry);
-
-    // Whether to use trampoline, can be only used if relocation type is `kRelocTrampoline`.
-    bool useTrampoline = false;
+    // Offsets of the source and target sections in the image. A relocation
+    // without a target section targets the first one.
+    uint32_t sourceSectionId = re->getSourceSectionId();
+    uint32_t targetSectionId = re->getTargetSectionId();
 
-    switch (re->getType()) {
-      case RelocEntry::kTypeAbsToAbs: {
-        break;
-      }
-
-      case RelocEntry::kTypeRelToAbs: {
-        ptr += baseAddress;
-        break;
-      }
+    if (ASMJIT_UNLIKELY(sourceSectionId >= numSections ||
+                        (targetSectionId != SectionEntry::kInvalidId && targetSectionId >= numSections)))
+      return 0;
 
-      case RelocEntry::kTypeAbsToRel: {
-        ptr -= baseAddress + re->getSourceOffset() + re->getSize();
-        break;
-      }
+    uint64_t targetOffset = 0;
+    if (targetSectionId != SectionEntry::kInvalidId)
+      targetOffset = _sections[targetSectionId]->getOffset();
 
-      case RelocEntry::kTypeTrampoline: {
-        if (re->getSize() != 4)
-          return DebugUtils::errored(kErrorInvalidRelocEntry);
+    size_t prevTrampOffset = trampOffset;
+    if (ASMJIT_UNLIKELY(!_relocateEntry(dst, maxCodeSize, baseAddress, re, _sections[sourceSectionId]->getOffset(), targetOffset, trampOffset)))
+      return 0;
 
-        ptr -= baseAddress + re->getSourceOffset() + re->getSize();
-        if (!Utils::isInt32(static_cast<int64_t>(ptr))) {
-          ptr = (uint64_t)trampOffset - re->getSourceOffset() - re->getSize();
-          useTrampoline = true;
-        }
-        break;
-      }
+#if !defined(ASMJIT_DISABLE_LOGGING)
+    if (logger && trampOffset != prevTrampOffset)
+      logger->logf("[reloc] dq 0x%016llX ; Trampoline\n", re->getData());
+#else
+    (void)prevTrampOffset;
+#endif // !ASMJIT_DISABLE_LOGGING
+  }
 
-      default:
-        return DebugUtils::errored(kErrorInvalidRelocEntry);
-    }
+  // If there are no trampolines and data sections this is the same as the
+  // size of executable sections.
+  return std::max<size_t>(usedSize, trampOffset);
+}
 
-    switch (re->getSize()) {
-      case 1:
-        Utils::writeU8(dst + codeOffset, static_cast<uint32_t>(ptr & 0xFFU));
-        break;
+// ============================================================================
+// [asmjit::CodeHolder - Unwind Information]
+// ============================================================================
 
-      case 4:
-        Utils::writeU32u(dst + codeOffset, static_cast<uint32_t>(ptr & 0xFFFFFFFFU));
-        break;
+Error CodeHolder::addUnwindEntry(uint32_t labelId, uint32_t type, uint32_t regId, int32_t offset, int32_t addend) noexcept {
+  if (ASMJIT_UNLIKELY(!getLabelEntry(labelId) || type > UnwindEntry::kTypeRestoreState))
+    return DebugUtils::errored(kErrorInvalidArgument);
 
-      case 8:
-        Utils::writeU64u(dst + codeOffset, ptr);
-        break;
+  UnwindEntry entry;
+  entry._labelId = labelId;
+  entry._type = static_cast<uint8_t>(type);
+  entry._regId = static_cast<uint8_t>(regId);
+  entry._reserved[0] = 0;
+  entry._reserved[1] = 0;
+  entry._offset = offset;
+  entry._addend = addend;
 
-      default:
-        return DebugUtils::errored(kErrorInvalidRelocEntry);
-    }
+  return _unwindEntries.append(&_baseHeap, entry);
+}
 
-    // Handle the trampoline case.
-    if (useTrampoline) {
-      // Bytes that replace [REX, OPCODE] bytes.
-      uint32_t byte0 = 0xFF;
-      uint32_t byte1 = dst[codeOffset - 1];
+// ============================================================================
+// [asmjit::CodeHolder - Holes]
+// ============================================================================
 
-      if (byte1 == 0xE8) {
-        // Patch CALL/MOD byte to FF/2 (-> 0x15).
-        byte1 = x86EncodeMod(0, 2, 5);
-      }
-      else if (byte1 == 0xE9) {
-        // Patch JMP/MOD byte to FF/4 (-> 0x25).
-        byte1 = x86EncodeMod(0, 4, 5);
-      }
-      else {
-        return DebugUtils::errored(kErrorInvalidRelocEntry);
-      }
+Error CodeHolder::addHoleEntry(uint32_t id, uint32_t type, uint32_t relocId, uint32_t flags) noexcept {
+  if (ASMJIT_UNLIKELY(type == HoleEntry::kTypeNone || type >= HoleEntry::kTypeCount || relocId >= _relocations.getLength()))
+    return DebugUtils::errored(kErrorInvalidArgument);
 
-      // Patch `jmp/call` instruction.
-      ASMJIT_ASSERT(codeOffset >= 2);
-      dst[codeOffset - 2] = static_cast<uint8_t>(byte0);
-      dst[codeOffset - 1] = static_cast<uint8_t>(byte1);
+  HoleEntry entry;
+  entry._id = id;
+  entry._type = static_cast<uint8_t>(type);
+  entry._flags = static_cast<uint8_t>(flags);
+  entry._reserved[0] = 0;
+  entry._reserved[1] = 0;
+  entry._relocId = relocId;
 
-      // Store absolute address and advance the trampoline pointer.
-      Utils::writeU64u(dst + trampOffset, re->getData());
-      trampOffset += 8;
+  return _holeEntries.append(&_baseHeap, entry);
+}
 
-#if !defined(ASMJIT_DISABLE_LOGGING)
-      if (logger)
-        logger->logf("[reloc] dq 0x%016llX ; Trampoline\n", re->getData());
-#endif // !ASMJIT_DISABLE_LOGGING
-    }
-  }
+// ============================================================================
+// [asmjit::CodeHolder - Test]
+// ============================================================================
 
-  // If there are no trampolines this is the same as `minCodeSize`.
-  return trampOffset;
+#if defined(ASMJIT_TEST)
+UNIT(base_codeholder_sections) {
+  // mov eax, [rip + rodata]; ret
+  static const uint8_t kText[] = { 0x8B, 0x05, 0x00, 0x00, 0x00, 0x00, 0xC3 };
+  static const uint8_t kConst[] = { 0x2A, 0x00, 0x00, 0x00 };
+
+  CodeHolder code;
+  EXPECT(code.init(CodeInfo(ArchInfo::kTypeHost)) == kErrorOk,
+    "Failed to initialize CodeHolder");
+
+  CodeBuffer& text = code._sections[0]->_buffer;
+  EXPECT(code.reserveBuffer(&text, sizeof(kText)) == kErrorOk,
+    "Failed to reserve the buffer");
+  ::memcpy(text._data, kText, sizeof(kText));
+  text._length = sizeof(kText);
+
+  INFO("Creating sections");
+  SectionEntry* rodata;
+  SectionEntry* data;
+  SectionEntry* invalid;
+
+  EXPECT(code.newSection(&rodata, ".rodata", Globals::kInvalidIndex, SectionEntry::kFlagConst, 16) == kErrorOk,
+    "Failed to create .rodata section");
+  EXPECT(code.newSection(&data, ".data", Globals::kInvalidIndex, 0, 8) == kErrorOk,
+    "Failed to create .data section");
+  EXPECT(code.newSection(&invalid, ".data") == DebugUtils::errored(kErrorInvalidArgument),
+    "Section names must be unique");
+  EXPECT(code.newSection(&invalid, ".bss", Globals::kInvalidIndex, 0, 3) == DebugUtils::errored(kErrorInvalidArgument),
+    "Section alignment must be a power of 2");
+  EXPECT(code.getSectionByName(".data") == data,
+    "Failed to find .data section");
+
+  CodeBuffer& constBuffer = rodata->_buffer;
+  EXPECT(code.reserveBuffer(&constBuffer, sizeof(kConst)) == kErrorOk,
+    "Failed to reserve the buffer");
+  ::memcpy(constBuffer._data, kConst, sizeof(kConst));
+  constBuffer._length = sizeof(kConst);
+  data->setVirtualSize(8);
+
+  RelocEntry* re;
+  EXPECT(code.newRelocEntry(&re, RelocEntry::kTypeRelToRel, 4) == kErrorOk,
+    "Failed to create a relocation entry");
+  re->_sourceSectionId = 0;
+  re->_targetSectionId = rodata->getId();
+  re->_sourceOffset = 2;
+  re->_data = static_cast<uint64_t>(int64_t(-4));
+
+  INFO("Packed layout");
+  EXPECT(code.flatten() == 32, "Image should be 32 bytes long");
+  EXPECT(rodata->getOffset() == 16, "Section .rodata should start at 16");
+  EXPECT(data->getOffset() == 24, "Section .data should start at 24");
+
+  uint8_t image[192];
+  ::memset(image, 0xCC, sizeof(image));
+
+  EXPECT(code.relocate(image) == 32, "Failed to relocate the code");
+  EXPECT(Utils::readI32u(image + 2) == 10, "Displacement should point to .rodata");
+  EXPECT(image[16] == 0x2A && image[7] == 0 && image[31] == 0, "Sections should be copied and padded by zeros");
+
+  INFO("Group alignment");
+  code.setGroupAlignment(64);
+  EXPECT(code.flatten() == 136, "Image should be 136 bytes long");
+  EXPECT(rodata->getOffset() == 64, "Section .rodata should start at 64");
+  EXPECT(data->getOffset() == 128, "Section .data should start at 128");
+
+  EXPECT(code.relocate(image) == 136, "Failed to relocate the code");
+  EXPECT(Utils::readI32u(image + 2) == 58, "Displacement should point to .rodata");
 }
+#endif // ASMJIT_TEST
 
 } // asmjit namespace
 
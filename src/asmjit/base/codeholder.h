@@ -32,6 +32,7 @@ namespace asmjit {
 class Assembler;
 class CodeEmitter;
 class CodeHolder;
+class JitRuntime;
 
 // ============================================================================
 // [asmjit::AlignMode]
@@ -113,13 +114,17 @@ public:
       _cdeclCallConv(CallConv::kIdNone),
       _stdCallConv(CallConv::kIdNone),
       _fastCallConv(CallConv::kIdNone),
-      _baseAddress(Globals::kNoBaseAddress) {}
+      _baseAddress(Globals::kNoBaseAddress),
+      _codeRegionStart(0),
+      _codeRegionEnd(0) {}
   ASMJIT_INLINE CodeInfo(const CodeInfo& other) noexcept { init(other); }
 
   explicit ASMJIT_INLINE CodeInfo(uint32_t archType, uint32_t archMode = 0, uint64_t baseAddress = Globals::kNoBaseAddress) noexcept
     : _archInfo(archType, archMode),
       _packedMiscInfo(0),
-      _baseAddress(baseAddress) {}
+      _baseAddress(baseAddress),
+      _codeRegionStart(0),
+      _codeRegionEnd(0) {}
 
   // --------------------------------------------------------------------------
   // [Init / Reset]
@@ -133,12 +138,16 @@ public:
     _archInfo = other._archInfo;
     _packedMiscInfo = other._packedMiscInfo;
     _baseAddress = other._baseAddress;
+    _codeRegionStart = other._codeRegionStart;
+    _codeRegionEnd = other._codeRegionEnd;
   }
 
   ASMJIT_INLINE void init(uint32_t archType, uint32_t archMode = 0, uint64_t baseAddress = Globals::kNoBaseAddress) noexcept {
     _archInfo.init(archType, archMode);
     _packedMiscInfo = 0;
     _baseAddress = baseAddress;
+    _codeRegionStart = 0;
+    _codeRegionEnd = 0;
   }
 
   ASMJIT_INLINE void reset() noexcept {
@@ -148,6 +157,8 @@ public:
     _stdCallConv = CallConv::kIdNone;
     _fastCallConv = CallConv::kIdNone;
     _baseAddress = Globals::kNoBaseAddress;
+    _codeRegionStart = 0;
+    _codeRegionEnd = 0;
   }
 
   // --------------------------------------------------------------------------
@@ -193,6 +204,27 @@ public:
   ASMJIT_INLINE void setBaseAddress(uint64_t p) noexcept { _baseAddress = p; }
   ASMJIT_INLINE void resetBaseAddress() noexcept { _baseAddress = Globals::kNoBaseAddress; }
 
+  //! Get whether the code is known to be placed into a region of memory.
+  //!
+  //! If the base address is not known, but the region is, then jumps and
+  //! calls to absolute addresses reachable by rel32 from the whole region are
+  //! encoded directly, without a trampoline.
+  ASMJIT_INLINE bool hasCodeRegion() const noexcept { return _codeRegionEnd != 0; }
+  //! Get the first address of the code region.
+  ASMJIT_INLINE uint64_t getCodeRegionStart() const noexcept { return _codeRegionStart; }
+  //! Get the address after the end of the code region.
+  ASMJIT_INLINE uint64_t getCodeRegionEnd() const noexcept { return _codeRegionEnd; }
+  //! Set the code region to [start, start + size).
+  ASMJIT_INLINE void setCodeRegion(uint64_t start, uint64_t size) noexcept {
+    _codeRegionStart = start;
+    _codeRegionEnd = start + size;
+  }
+  //! Reset the code region.
+  ASMJIT_INLINE void resetCodeRegion() noexcept {
+    _codeRegionStart = 0;
+    _codeRegionEnd = 0;
+  }
+
   // --------------------------------------------------------------------------
   // [Operator Overload]
   // --------------------------------------------------------------------------
@@ -218,6 +250,8 @@ public:
   };
 
   uint64_t _baseAddress;                 //!< Base address.
+  uint64_t _codeRegionStart;             //!< Start of the code region.
+  uint64_t _codeRegionEnd;               //!< End of the code region (0 if not known).
 };
 
 // ============================================================================
@@ -256,6 +290,12 @@ struct CodeBuffer {
 // ============================================================================
 
 //! Section entry.
+//!
+//! Sections are laid out by \ref CodeHolder::flatten() into a single image in
+//! three groups - executable sections (`kFlagExec`), read-only data sections
+//! (`kFlagConst` without `kFlagExec`) and writable data sections (no flags).
+//! The first section (`.text`) always starts at offset zero. Sections having
+//! `kFlagInfo` are not part of the image.
 class SectionEntry {
 public:
   ASMJIT_ENUM(Id) {
@@ -298,6 +338,15 @@ public:
   ASMJIT_INLINE size_t getVirtualSize() const noexcept { return _virtualSize; }
   ASMJIT_INLINE void setVirtualSize(uint32_t size) noexcept { _virtualSize = size; }
 
+  //! Get the size the section occupies in the image (physical size, or
+  //! virtual size if greater, the rest is zero initialized).
+  ASMJIT_INLINE size_t getImageSize() const noexcept {
+    return std::max<size_t>(_buffer.getLength(), _virtualSize);
+  }
+
+  //! Get the offset of the section in the image, see \ref CodeHolder::flatten().
+  ASMJIT_INLINE uint64_t getOffset() const noexcept { return _offset; }
+
   ASMJIT_INLINE CodeBuffer& getBuffer() noexcept { return _buffer; }
   ASMJIT_INLINE const CodeBuffer& getBuffer() const noexcept { return _buffer; }
 
@@ -309,6 +358,7 @@ public:
   uint32_t _flags;                       //!< Section flags.
   uint32_t _alignment;                   //!< Section alignment requirements (0 if no requirements).
   uint32_t _virtualSize;                 //!< Virtual size of the section (zero initialized mostly).
+  uint64_t _offset;                      //!< Offset of the section in the image.
   union {
     char _name[36];                      //!< Section name (max 35 characters, PE allows max 8).
     uint32_t _nameAsU32[36 / 4];         //!< Section name as `uint32_t[]` (only optimization).
@@ -434,7 +484,8 @@ struct RelocEntry {
     kTypeAbsToAbs    = 1,                //!< Relocate absolute to absolute.
     kTypeRelToAbs    = 2,                //!< Relocate relative to absolute.
     kTypeAbsToRel    = 3,                //!< Relocate absolute to relative.
-    kTypeTrampoline  = 4                 //!< Relocate absolute to relative or use trampoline.
+    kTypeTrampoline  = 4,                //!< Relocate absolute to relative or use trampoline.
+    kTypeRelToRel    = 5                 //!< Relocate relative to relative (displacement to another section).
   };
 
   // ------------------------------------------------------------------------
@@ -466,6 +517,97 @@ struct RelocEntry {
   uint64_t _data;                        //!< Relocation data (target offset, target address, etc).
 };
 
+// ============================================================================
+// [asmjit::HoleEntry]
+// ============================================================================
+
+//! Hole entry, a patchable operand of an instruction (see \ref CodeTemplate).
+//!
+//! Holes are marked by \ref CodeEmitter::setHole() before the instruction is
+//! emitted. Each hole refers to a \ref RelocEntry that describes where its
+//! value is stored, the value emitted is kept as relocation data, so the code
+//! works as is even if it's not patched.
+struct HoleEntry {
+  //! Hole type.
+  ASMJIT_ENUM(Type) {
+    kTypeNone        = 0,                //!< No hole.
+    kTypeImm         = 1,                //!< Immediate operand (`kTypeAbsToAbs` relocation of 1, 2, 4, or 8 bytes).
+    kTypeDisp        = 2,                //!< 32-bit displacement of a memory operand (`kTypeAbsToAbs` relocation).
+    kTypeTarget      = 3,                //!< Absolute target of a jump or call (`kTypeAbsToRel` or `kTypeTrampoline` relocation).
+    kTypeCount       = 4                 //!< Count of hole types.
+  };
+
+  //! Hole flags.
+  ASMJIT_ENUM(Flags) {
+    kFlagSigned      = 0x01              //!< Immediate is sign-extended by the CPU, only signed values fit.
+  };
+
+  // ------------------------------------------------------------------------
+  // [Accessors]
+  // ------------------------------------------------------------------------
+
+  ASMJIT_INLINE uint32_t getId() const noexcept { return _id; }
+  ASMJIT_INLINE uint32_t getType() const noexcept { return _type; }
+  ASMJIT_INLINE uint32_t getFlags() const noexcept { return _flags; }
+  ASMJIT_INLINE bool hasFlag(uint32_t flag) const noexcept { return (_flags & flag) != 0; }
+  ASMJIT_INLINE uint32_t getRelocId() const noexcept { return _relocId; }
+
+  // ------------------------------------------------------------------------
+  // [Members]
+  // ------------------------------------------------------------------------
+
+  uint32_t _id;                          //!< Hole id, provided by the user.
+  uint8_t _type;                         //!< Type of the hole.
+  uint8_t _flags;                        //!< Flags of the hole.
+  uint8_t _reserved[2];                  //!< Reserved.
+  uint32_t _relocId;                     //!< Relocation entry of the hole.
+};
+
+// ============================================================================
+// [asmjit::UnwindEntry]
+// ============================================================================
+
+//! Unwind entry, describes how a function frame changes at a label.
+//!
+//! Unwind entries are recorded by prolog and epilog emitters if the code
+//! holder has unwind information enabled, and are used to generate DWARF
+//! call frame information, see \ref UnwindUtils. All offsets are in bytes
+//! and relative to the canonical frame address (CFA), which is the value of
+//! the stack pointer before the call instruction that called the function.
+struct UnwindEntry {
+  //! Unwind entry type.
+  ASMJIT_ENUM(Type) {
+    kTypeFuncStart     = 0,              //!< Function starts, CFA is the stack pointer + `offset`.
+    kTypeSaveReg       = 1,              //!< GP register `regId` has been saved at CFA + `offset`.
+    kTypeCfaOffset     = 2,              //!< CFA is the current CFA register + `offset`.
+    kTypeCfaReg        = 3,              //!< CFA is GP register `regId` + `offset`.
+    kTypeCfaDeref      = 4,              //!< CFA is [GP register `regId` + `offset`] + `addend`.
+    kTypeRememberState = 5,              //!< Remember the current state (epilog starts).
+    kTypeRestoreState  = 6               //!< Restore the remembered state (epilog ended).
+  };
+
+  // ------------------------------------------------------------------------
+  // [Accessors]
+  // ------------------------------------------------------------------------
+
+  ASMJIT_INLINE uint32_t getLabelId() const noexcept { return _labelId; }
+  ASMJIT_INLINE uint32_t getType() const noexcept { return _type; }
+  ASMJIT_INLINE uint32_t getRegId() const noexcept { return _regId; }
+  ASMJIT_INLINE int32_t getOffset() const noexcept { return _offset; }
+  ASMJIT_INLINE int32_t getAddend() const noexcept { return _addend; }
+
+  // ------------------------------------------------------------------------
+  // [Members]
+  // ------------------------------------------------------------------------
+
+  uint32_t _labelId;                     //!< Label bound where the frame changes.
+  uint8_t _type;                         //!< Type of the entry.
+  uint8_t _regId;                        //!< GP register id.
+  uint8_t _reserved[2];                  //!< Reserved.
+  int32_t _offset;                       //!< Offset, depends on the type.
+  int32_t _addend;                       //!< Addend, depends on the type.
+};
+
 // ============================================================================
 // [asmjit::CodeHolder]
 // ============================================================================
@@ -547,6 +689,11 @@ public:
 
   //! Get global hints, internally propagated to all `CodeEmitter`s attached.
   ASMJIT_INLINE uint32_t getGlobalHints() const noexcept { return _globalHints; }
+  //! Add global `hints`, see \ref CodeEmitter::Hints.
+  ASMJIT_API void addGlobalHints(uint32_t hints) noexcept;
+  //! Clear global `hints`, see \ref CodeEmitter::Hints.
+  ASMJIT_API void clearGlobalHints(uint32_t hints) noexcept;
+
   //! Get global options, internally propagated to all `CodeEmitter`s attached.
   ASMJIT_INLINE uint32_t getGlobalOptions() const noexcept { return _globalOptions; }
 
@@ -598,10 +745,68 @@ public:
 
   //! Get a section entry of the given index.
   ASMJIT_INLINE SectionEntry* getSectionEntry(size_t index) const noexcept { return _sections[index]; }
+  //! Get number of sections.
+  ASMJIT_INLINE size_t getSectionsCount() const noexcept { return _sections.getLength(); }
+
+  //! Create a new section `name` having `flags` (see \ref SectionEntry::Flags)
+  //! and `alignment` (a power of 2, or zero if there are no requirements).
+  //!
+  //! Returns `kErrorInvalidArgument` if the name is empty, too long, or used
+  //! by another section.
+  ASMJIT_API Error newSection(SectionEntry** sectionOut, const char* name, size_t nameLength = Globals::kInvalidIndex, uint32_t flags = 0, uint32_t alignment = 0) noexcept;
+  //! Get a section by `name`, or null if there is no such section.
+  ASMJIT_API SectionEntry* getSectionByName(const char* name, size_t nameLength = Globals::kInvalidIndex) const noexcept;
+
+  //! Get the alignment of the first section of each group in the image.
+  ASMJIT_INLINE uint32_t getGroupAlignment() const noexcept { return _groupAlignment; }
+  //! Set the alignment of the first section of each group in the image.
+  //!
+  //! Runtimes use the page size, so each group can be protected separately.
+  //! Zero (the default) packs sections by their own alignment only.
+  ASMJIT_INLINE void setGroupAlignment(uint32_t alignment) noexcept { _groupAlignment = alignment; }
+
+  //! Get the distance between the starts of groups in the image.
+  ASMJIT_INLINE uint32_t getGroupStride() const noexcept { return _groupStride; }
+  //! Set the distance between the starts of groups in the image.
+  //!
+  //! If non-zero, read-only sections start at `stride` and writable sections
+  //! at `2 * stride`, unless the previous group doesn't fit, in which case the
+  //! stride is ignored. Runtimes use it to pack small images into shared pages,
+  //! \ref relocate() doesn't write between groups then. Zero (the default)
+  //! places each group after the previous one.
+  ASMJIT_INLINE void setGroupStride(uint32_t stride) noexcept { _groupStride = stride; }
+
+  //! Lay out all sections into a single image and return its size.
+  //!
+  //! Executable sections come first, followed by space reserved for possible
+  //! trampolines, read-only data sections, and writable data sections. Each
+  //! section is aligned to its alignment, see \ref SectionEntry::getOffset().
+  //! Called by \ref getCodeSize() and \ref relocate().
+  ASMJIT_API size_t flatten() noexcept;
+
+  //! Get the id of the section constant pools are embedded to.
+  //!
+  //! It's `SectionEntry::kInvalidId` by default, which means the current
+  //! section of the \ref Assembler (constant pools are embedded into code).
+  ASMJIT_INLINE uint32_t getConstPoolSectionId() const noexcept { return _constPoolSectionId; }
+  //! Set the section constant pools are embedded to (a read-only data section
+  //! keeps constants out of the instruction cache).
+  ASMJIT_API Error setConstPoolSectionId(uint32_t sectionId) noexcept;
 
   ASMJIT_API Error growBuffer(CodeBuffer* cb, size_t n) noexcept;
   ASMJIT_API Error reserveBuffer(CodeBuffer* cb, size_t n) noexcept;
 
+  //! Use `data` of `capacity` bytes as the buffer of `section`, which must be
+  //! empty, otherwise `kErrorInvalidState` is returned.
+  //!
+  //! The buffer is not owned by `CodeHolder`. If the code doesn't fit into
+  //! it, it's copied to a buffer allocated by `CodeHolder` and `data` is no
+  //! longer used (the buffer is no longer external then).
+  ASMJIT_API Error setExternalBuffer(SectionEntry* section, void* data, size_t capacity) noexcept;
+  //! Make the buffer of `section` fixed size, its capacity is reduced to its
+  //! length, so nothing can be added to it anymore.
+  ASMJIT_API void fixBufferSize(SectionEntry* section) noexcept;
+
   // --------------------------------------------------------------------------
   // [Labels & Symbols]
   // --------------------------------------------------------------------------
@@ -703,12 +908,63 @@ public:
   //! \return The number bytes actually used. If the code emitter reserved
   //! space for possible trampolines, but didn't use it, the number of bytes
   //! used can actually be less than the expected worst case. Virtual memory
-  //! allocator can shrink the memory it allocated initially.
+  //! allocator can shrink the memory it allocated initially. Zero is returned
+  //! on failure (an invalid relocation or a displacement that doesn't fit).
+  //!
+  //! All sections are relocated at their offsets in the image, see \ref
+  //! flatten(). Padding between sections is zero initialized, except space
+  //! between groups if the group stride is set (see \ref setGroupStride()).
   //!
   //! A given buffer will be overwritten, to get the number of bytes required,
   //! use `getCodeSize()`.
   ASMJIT_API size_t relocate(void* dst, uint64_t baseAddress = Globals::kNoBaseAddress) const noexcept;
 
+  //! \internal
+  //!
+  //! Apply a single relocation `re` to the image `dst` of `imageSize` bytes,
+  //! used by `relocate()` and \ref CodeTemplate. `sourceOffset` and `targetOffset`
+  //! are offsets of the source and target sections in the image, `trampOffset`
+  //! is the offset of the next free trampoline, which is advanced if used.
+  //!
+  //! Returns false if the relocation is invalid or its displacement doesn't fit.
+  ASMJIT_API static bool _relocateEntry(
+    uint8_t* dst, size_t imageSize, uint64_t baseAddress,
+    const RelocEntry* re, uint64_t sourceOffset, uint64_t targetOffset, size_t& trampOffset) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Holes]
+  // --------------------------------------------------------------------------
+
+  //! Get if the code contains holes.
+  ASMJIT_INLINE bool hasHoles() const noexcept { return !_holeEntries.isEmpty(); }
+  //! Get array of `HoleEntry` records, in the order they were added.
+  ASMJIT_INLINE const ZoneVector<HoleEntry>& getHoleEntries() const noexcept { return _holeEntries; }
+
+  //! Add a hole `id` of `type` stored at a relocation `relocId`, see \ref HoleEntry.
+  ASMJIT_API Error addHoleEntry(uint32_t id, uint32_t type, uint32_t relocId, uint32_t flags = 0) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Unwind Information]
+  // --------------------------------------------------------------------------
+
+  //! Get whether prolog and epilog emitters record unwind entries.
+  ASMJIT_INLINE bool isUnwindInfoEnabled() const noexcept { return _unwindInfoEnabled != 0; }
+  //! Enable or disable recording of unwind entries (disabled by default).
+  //!
+  //! Must be enabled before the prolog and epilog are emitted. `JitRuntime`
+  //! registers the unwind information of the code on hosts that support it
+  //! (Linux and BSD, by `__register_frame()`), so debuggers, profilers, and C++
+  //! exceptions can unwind through it.
+  ASMJIT_INLINE void setUnwindInfoEnabled(bool enabled) noexcept { _unwindInfoEnabled = static_cast<uint8_t>(enabled); }
+
+  //! Get if the code contains unwind entries.
+  ASMJIT_INLINE bool hasUnwindEntries() const noexcept { return !_unwindEntries.isEmpty(); }
+  //! Get array of `UnwindEntry` records, in the order they were added.
+  ASMJIT_INLINE const ZoneVector<UnwindEntry>& getUnwindEntries() const noexcept { return _unwindEntries; }
+
+  //! Add an unwind entry of `type` at label `labelId`, see \ref UnwindEntry.
+  ASMJIT_API Error addUnwindEntry(uint32_t labelId, uint32_t type, uint32_t regId = 0, int32_t offset = 0, int32_t addend = 0) noexcept;
+
   // --------------------------------------------------------------------------
   // [Members]
   // --------------------------------------------------------------------------
@@ -723,9 +979,15 @@ public:
 
   Logger* _logger;                       //!< Attached \ref Logger, used by all consumers.
   ErrorHandler* _errorHandler;           //!< Attached \ref ErrorHandler.
+  JitRuntime* _streamRuntime;            //!< Runtime that streams the first section (or null).
 
   uint32_t _unresolvedLabelsCount;       //!< Count of label references which were not resolved.
   uint32_t _trampolinesSize;             //!< Size of all possible trampolines.
+  uint32_t _groupAlignment;              //!< Alignment of the first section of each group.
+  uint32_t _groupStride;                 //!< Distance between the starts of groups (or zero).
+  uint32_t _constPoolSectionId;          //!< Section of constant pools (or `SectionEntry::kInvalidId`).
+  size_t _trampolinesOffset;             //!< Offset of trampolines in the image.
+  uint8_t _unwindInfoEnabled;            //!< Whether unwind entries are recorded.
 
   Zone _baseZone;                        //!< Base zone (used to allocate core structures).
   Zone _dataZone;                        //!< Data zone (used to allocate extra data like label names).
@@ -734,6 +996,8 @@ public:
   ZoneVector<SectionEntry*> _sections;   //!< Section entries.
   ZoneVector<LabelEntry*> _labels;       //!< Label entries (each label is stored here).
   ZoneVector<RelocEntry*> _relocations;  //!< Relocation entries.
+  ZoneVector<UnwindEntry> _unwindEntries;//!< Unwind entries.
+  ZoneVector<HoleEntry> _holeEntries;    //!< Hole entries.
   ZoneHash<LabelEntry> _namedLabels;     //!< Label name -> LabelEntry (only named labels).
 };
 
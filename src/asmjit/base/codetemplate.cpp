@@ -0,0 +1,306 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Export]
+#define ASMJIT_EXPORTS
+
+// [Dependencies]
+#include "../base/codetemplate.h"
+#include "../base/utils.h"
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+// ============================================================================
+// [asmjit::CodeTemplate - Helpers]
+// ============================================================================
+
+//! \internal
+//!
+//! Get whether `value` fits a hole of `type` stored in `size` bytes, signed
+//! and unsigned values are both accepted unless the hole has `kFlagSigned`.
+static ASMJIT_INLINE bool CodeTemplate_fits(uint32_t type, uint32_t flags, uint32_t size, uint64_t value) noexcept {
+  int64_t sValue = static_cast<int64_t>(value);
+
+  switch (type) {
+    case HoleEntry::kTypeImm:
+      if (flags & HoleEntry::kFlagSigned) {
+        if (size == 1) return Utils::isInt8(sValue);
+        if (size == 2) return Utils::isInt16(sValue);
+        if (size == 4) return Utils::isInt32(sValue);
+        return true;
+      }
+
+      if (size == 1) return Utils::isInt8(sValue) || Utils::isUInt8(sValue);
+      if (size == 2) return Utils::isInt16(sValue) || Utils::isUInt16(sValue);
+      if (size == 4) return Utils::isInt32(sValue) || Utils::isUInt32(sValue);
+      return true;
+
+    case HoleEntry::kTypeDisp:
+      return Utils::isInt32(sValue);
+
+    default:
+      return true;
+  }
+}
+
+// ============================================================================
+// [asmjit::CodeTemplate - Construction / Destruction]
+// ============================================================================
+
+CodeTemplate::CodeTemplate() noexcept
+  : _image(nullptr),
+    _imageSize(0),
+    _trampolinesOffset(0),
+    _relocs(nullptr),
+    _relocCount(0),
+    _holes(nullptr),
+    _holeCount(0) {}
+CodeTemplate::~CodeTemplate() noexcept { reset(); }
+
+// ============================================================================
+// [asmjit::CodeTemplate - Init / Reset]
+// ============================================================================
+
+Error CodeTemplate::init(CodeHolder* code) noexcept {
+  reset();
+
+  if (ASMJIT_UNLIKELY(code->getUnresolvedLabelsCount() != 0))
+    return DebugUtils::errored(kErrorInvalidState);
+
+  // Includes all possible trampolines.
+  size_t imageSize = code->flatten();
+  size_t numRelocs = code->_relocations.getLength();
+  size_t numHoles = code->_holeEntries.getLength();
+  size_t numSections = code->_sections.getLength();
+
+  // The image, relocations, and holes share a single allocation.
+  size_t relocsOffset = Utils::alignTo<size_t>(imageSize, 8);
+  size_t holesOffset = relocsOffset + numRelocs * sizeof(RelocEntry);
+  size_t flagsOffset = holesOffset + numHoles * sizeof(Hole);
+
+  uint8_t* p = static_cast<uint8_t*>(Internal::allocMemory(flagsOffset + numRelocs));
+  if (ASMJIT_UNLIKELY(!p))
+    return DebugUtils::errored(kErrorNoHeapMemory);
+
+  _image = p;
+  _imageSize = imageSize;
+  _trampolinesOffset = code->_trampolinesOffset;
+  _relocs = reinterpret_cast<RelocEntry*>(p + relocsOffset);
+  _holes = reinterpret_cast<Hole*>(p + holesOffset);
+
+  // Copy all sections to their offsets, see `CodeHolder::relocate()`.
+  ::memset(p, 0, imageSize);
+  for (size_t i = 0; i < numSections; i++) {
+    const SectionEntry* se = code->_sections[i];
+    if (!se->hasFlag(SectionEntry::kFlagInfo))
+      ::memcpy(p + static_cast<size_t>(se->getOffset()), se->_buffer._data, se->getPhysicalSize());
+  }
+
+  // Relocations used by holes are only applied when instantiated.
+  uint8_t* isHole = p + flagsOffset;
+  ::memset(isHole, 0, numRelocs);
+
+  for (size_t i = 0; i < numHoles; i++)
+    isHole[code->_holeEntries[i].getRelocId()] = 1;
+
+  // Relocations are made relative to the image, their source and target
+  // sections are folded into the source offset and data.
+  size_t trampOffset = _trampolinesOffset;
+  for (size_t i = 0; i < numRelocs; i++) {
+    const RelocEntry* src = code->_relocations[i];
+    uint32_t type = src->getType();
+
+    if (type == RelocEntry::kTypeNone) {
+      if (ASMJIT_UNLIKELY(isHole[i])) {
+        reset();
+        return DebugUtils::errored(kErrorInvalidState);
+      }
+      continue;
+    }
+
+    uint32_t sourceSectionId = src->getSourceSectionId();
+    uint32_t targetSectionId = src->getTargetSectionId();
+
+    if (ASMJIT_UNLIKELY(sourceSectionId >= numSections ||
+                        (targetSectionId != SectionEntry::kInvalidId && targetSectionId >= numSections))) {
+      reset();
+      return DebugUtils::errored(kErrorInvalidState);
+    }
+
+    RelocEntry re = *src;
+    re._sourceSectionId = 0;
+    re._targetSectionId = SectionEntry::kInvalidId;
+    re._sourceOffset += code->_sections[sourceSectionId]->getOffset();
+
+    if (targetSectionId != SectionEntry::kInvalidId && (type == RelocEntry::kTypeRelToAbs || type == RelocEntry::kTypeRelToRel))
+      re._data += code->_sections[targetSectionId]->getOffset();
+
+    if (isHole[i]) {
+      // Holes are stored with their relocation, it's applied by `instantiate()`.
+      for (size_t j = 0; j < numHoles; j++) {
+        const HoleEntry& he = code->_holeEntries[j];
+        if (he.getRelocId() != i) continue;
+
+        Hole& hole = _holes[j];
+        hole.id = he.getId();
+        hole.type = he.getType();
+        hole.flags = he.getFlags();
+        hole.re = re;
+      }
+    }
+    else if (type == RelocEntry::kTypeAbsToAbs || type == RelocEntry::kTypeRelToRel) {
+      if (ASMJIT_UNLIKELY(!CodeHolder::_relocateEntry(p, imageSize, 0, &re, 0, 0, trampOffset))) {
+        reset();
+        return DebugUtils::errored(kErrorInvalidDisplacement);
+      }
+    }
+    else {
+      _relocs[_relocCount++] = re;
+    }
+  }
+
+  _holeCount = numHoles;
+  return kErrorOk;
+}
+
+void CodeTemplate::reset() noexcept {
+  if (_image)
+    Internal::releaseMemory(_image);
+
+  _image = nullptr;
+  _imageSize = 0;
+  _trampolinesOffset = 0;
+  _relocs = nullptr;
+  _relocCount = 0;
+  _holes = nullptr;
+  _holeCount = 0;
+}
+
+// ============================================================================
+// [asmjit::CodeTemplate - Instantiate]
+// ============================================================================
+
+Error CodeTemplate::instantiate(void* _dst, const uint64_t* values, size_t count, uint64_t baseAddress) const noexcept {
+  if (ASMJIT_UNLIKELY(!_image))
+    return DebugUtils::errored(kErrorNotInitialized);
+
+  uint8_t* dst = static_cast<uint8_t*>(_dst);
+  if (baseAddress == Globals::kNoBaseAddress)
+    baseAddress = static_cast<uint64_t>((uintptr_t)dst);
+
+  // Validate all values first, `dst` is not touched if any of them is invalid.
+  size_t i;
+  for (i = 0; i < _holeCount; i++) {
+    const Hole& hole = _holes[i];
+    if (ASMJIT_UNLIKELY(hole.id >= count))
+      return DebugUtils::errored(kErrorInvalidArgument);
+
+    if (ASMJIT_UNLIKELY(!CodeTemplate_fits(hole.type, hole.flags, hole.re.getSize(), values[hole.id])))
+      return DebugUtils::errored(hole.type == HoleEntry::kTypeImm ? kErrorInvalidImmediate : kErrorInvalidDisplacement);
+  }
+
+  ::memcpy(dst, _image, _imageSize);
+  size_t trampOffset = _trampolinesOffset;
+
+  for (i = 0; i < _relocCount; i++) {
+    if (ASMJIT_UNLIKELY(!CodeHolder::_relocateEntry(dst, _imageSize, baseAddress, &_relocs[i], 0, 0, trampOffset)))
+      return DebugUtils::errored(kErrorInvalidDisplacement);
+  }
+
+  for (i = 0; i < _holeCount; i++) {
+    const Hole& hole = _holes[i];
+    RelocEntry re = hole.re;
+    re._data = values[hole.id];
+
+    // A rel32 target that can't use a trampoline must be within +-2GB.
+    if (re.getType() == RelocEntry::kTypeAbsToRel) {
+      int64_t disp = static_cast<int64_t>(re._data - (baseAddress + re.getSourceOffset() + re.getSize()));
+      if (ASMJIT_UNLIKELY(re.getSize() == 4 && !Utils::isInt32(disp)))
+        return DebugUtils::errored(kErrorInvalidDisplacement);
+    }
+
+    if (ASMJIT_UNLIKELY(!CodeHolder::_relocateEntry(dst, _imageSize, baseAddress, &re, 0, 0, trampOffset)))
+      return DebugUtils::errored(kErrorInvalidDisplacement);
+  }
+
+  return kErrorOk;
+}
+
+// ============================================================================
+// [asmjit::CodeTemplate - Test]
+// ============================================================================
+
+#if defined(ASMJIT_TEST)
+UNIT(base_codetemplate) {
+  // mov eax, imm32; add eax, [rel data]; ret
+  static const uint8_t kCode[] = { 0xB8, 0x01, 0x00, 0x00, 0x00, 0x03, 0x05, 0x00, 0x00, 0x00, 0x00, 0xC3 };
+
+  CodeHolder code;
+  EXPECT(code.init(CodeInfo(ArchInfo::kTypeHost)) == kErrorOk,
+    "Failed to initialize CodeHolder");
+
+  CodeBuffer& buffer = code._sections[0]->_buffer;
+  EXPECT(code.reserveBuffer(&buffer, sizeof(kCode)) == kErrorOk,
+    "Failed to reserve the buffer");
+  ::memcpy(buffer._data, kCode, sizeof(kCode));
+  buffer._length = sizeof(kCode);
+
+  RelocEntry* re;
+  EXPECT(code.newRelocEntry(&re, RelocEntry::kTypeAbsToAbs, 4) == kErrorOk,
+    "Failed to create a relocation entry");
+  re->_sourceSectionId = 0;
+  re->_sourceOffset = 1;
+  re->_data = 1;
+  EXPECT(code.addHoleEntry(7, HoleEntry::kTypeImm, re->getId()) == kErrorOk,
+    "Failed to add a hole");
+
+  // The displacement refers to the `ret` instruction (zero displacement), it's
+  // not a hole, so it's applied by `init()`.
+  EXPECT(code.newRelocEntry(&re, RelocEntry::kTypeRelToRel, 4) == kErrorOk,
+    "Failed to create a relocation entry");
+  re->_sourceSectionId = 0;
+  re->_targetSectionId = 0;
+  re->_sourceOffset = 7;
+  re->_data = 7;
+
+  EXPECT(code.addHoleEntry(0, HoleEntry::kTypeImm, 100) == DebugUtils::errored(kErrorInvalidArgument),
+    "Holes must refer to existing relocations");
+
+  CodeTemplate tmpl;
+  EXPECT(tmpl.init(&code) == kErrorOk, "Failed to initialize CodeTemplate");
+  EXPECT(tmpl.getHoleCount() == 1, "CodeTemplate should have 1 hole");
+
+  uint8_t dst[64];
+  uint64_t values[8] = { 0 };
+
+  INFO("Instantiating with hole 7 being 0x12345678");
+  values[7] = 0x12345678;
+  EXPECT(tmpl.getImageSize() <= sizeof(dst), "Image doesn't fit the buffer");
+  EXPECT(tmpl.instantiate(dst, values, 8) == kErrorOk, "Failed to instantiate");
+  EXPECT(Utils::readU32u(dst + 1) == 0x12345678U, "Hole was not patched");
+  EXPECT(Utils::readU32u(dst + 7) == 0, "Relocation was not applied");
+
+  INFO("Instantiating with hole 7 being -1");
+  values[7] = static_cast<uint64_t>(int64_t(-1));
+  EXPECT(tmpl.instantiate(dst, values, 8) == kErrorOk, "Failed to instantiate");
+  EXPECT(Utils::readU32u(dst + 1) == 0xFFFFFFFFU, "Hole was not patched");
+
+  INFO("Rejecting values that don't fit");
+  values[7] = static_cast<uint64_t>(1) << 32;
+  EXPECT(tmpl.instantiate(dst, values, 8) == DebugUtils::errored(kErrorInvalidImmediate),
+    "Value that doesn't fit 32 bits must be rejected");
+  EXPECT(tmpl.instantiate(dst, values, 7) == DebugUtils::errored(kErrorInvalidArgument),
+    "Hole id out of range must be rejected");
+}
+#endif
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
@@ -0,0 +1,135 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Guard]
+#ifndef _ASMJIT_BASE_CODETEMPLATE_H
+#define _ASMJIT_BASE_CODETEMPLATE_H
+
+// [Dependencies]
+#include "../base/codeholder.h"
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+//! \addtogroup asmjit_base
+//! \{
+
+// ============================================================================
+// [asmjit::CodeTemplate]
+// ============================================================================
+
+//! Code template, finalized code that can be instantiated many times with
+//! different values of its holes (see \ref HoleEntry).
+//!
+//! The template is created from a `CodeHolder` once. Instantiation copies the
+//! image and patches relocations that depend on the base address and all
+//! holes, so specializing the code for other constants doesn't require to
+//! generate (and register-allocate) it again.
+//!
+//! \code
+//! X86Assembler a(&code);
+//! a.setHole(HoleEntry::kTypeImm, 0);
+//! a.mov(x86::eax, 0x7FFFFFFF);            // Placeholder of the largest size.
+//! a.ret();
+//!
+//! CodeTemplate tmpl;
+//! tmpl.init(&code);
+//!
+//! uint64_t values[] = { 42 };
+//! tmpl.instantiate(dst, values, 1);       // `dst` has `getImageSize()` bytes.
+//! \endcode
+//!
+//! NOTE: The value emitted as a placeholder decides the encoding of the
+//! instruction, so a hole can only be patched to values that fit its size.
+//! An immediate sign-extended by the CPU (`add r64, imm32`, for example)
+//! only accepts signed values, see \ref HoleEntry::kFlagSigned.
+class CodeTemplate {
+public:
+  ASMJIT_NONCOPYABLE(CodeTemplate)
+
+  //! \internal
+  //!
+  //! Hole and its relocation, relative to the image.
+  struct Hole {
+    uint32_t id;                         //!< Hole id.
+    uint32_t type;                       //!< Hole type, see \ref HoleEntry::Type.
+    uint32_t flags;                      //!< Hole flags, see \ref HoleEntry::Flags.
+    RelocEntry re;                       //!< Relocation describing the hole.
+  };
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  ASMJIT_API CodeTemplate() noexcept;
+  ASMJIT_API ~CodeTemplate() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Init / Reset]
+  // --------------------------------------------------------------------------
+
+  //! Create the template from `code`.
+  //!
+  //! All labels must be bound, otherwise `kErrorInvalidState` is returned.
+  //! `code` is flattened (see \ref CodeHolder::flatten()) to get the layout of
+  //! the image. Relocations that don't depend on the base address are applied
+  //! to the image once, the remaining ones are applied by \ref instantiate().
+  ASMJIT_API Error init(CodeHolder* code) noexcept;
+  //! Release the template.
+  ASMJIT_API void reset() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Accessors]
+  // --------------------------------------------------------------------------
+
+  //! Get whether the template is initialized.
+  ASMJIT_INLINE bool isInitialized() const noexcept { return _image != nullptr; }
+  //! Get the size of the image (including trampolines and data sections).
+  ASMJIT_INLINE size_t getImageSize() const noexcept { return _imageSize; }
+  //! Get the count of holes.
+  ASMJIT_INLINE size_t getHoleCount() const noexcept { return _holeCount; }
+  //! Get holes, in the order they were emitted.
+  ASMJIT_INLINE const Hole* getHoles() const noexcept { return _holes; }
+
+  // --------------------------------------------------------------------------
+  // [Instantiate]
+  // --------------------------------------------------------------------------
+
+  //! Instantiate the template into `dst`, which must have `getImageSize()`
+  //! bytes. Each hole is patched to `values[id]`, where `count` is the count
+  //! of values.
+  //!
+  //! Returns `kErrorInvalidArgument` if a hole id is out of range, and either
+  //! `kErrorInvalidImmediate` or `kErrorInvalidDisplacement` if a value
+  //! doesn't fit its hole. `dst` is used as a base address if `baseAddress`
+  //! is `Globals::kNoBaseAddress`.
+  ASMJIT_API Error instantiate(void* dst, const uint64_t* values, size_t count, uint64_t baseAddress = Globals::kNoBaseAddress) const noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  uint8_t* _image;                       //!< Image with base independent relocations applied.
+  size_t _imageSize;                     //!< Size of the image.
+  size_t _trampolinesOffset;             //!< Offset of trampolines in the image.
+
+  RelocEntry* _relocs;                   //!< Relocations that depend on the base address.
+  size_t _relocCount;                    //!< Count of `_relocs`.
+  Hole* _holes;                          //!< Holes.
+  size_t _holeCount;                     //!< Count of `_holes`.
+};
+
+//! \}
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
+
+// [Guard]
+#endif // _ASMJIT_BASE_CODETEMPLATE_H
@@ -44,6 +44,7 @@ static const char errorMessages[] =
   "Non-local label can't have parent\0"
   "Relocation index overflow\0"
   "Invalid relocation entry\0"
+  "Invalid code cache\0"
   "Invalid instruction\0"
   "Invalid register type\0"
   "Invalid register kind\0"
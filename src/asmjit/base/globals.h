@@ -147,6 +147,8 @@ ASMJIT_ENUM(ErrorCode) {
   kErrorRelocIndexOverflow,
   //! Invalid relocation entry.
   kErrorInvalidRelocEntry,
+  //! Serialized code is corrupted or has a different version (\ref CodeCache).
+  kErrorInvalidCodeCache,
 
   //! Invalid instruction.
   kErrorInvalidInstruction,
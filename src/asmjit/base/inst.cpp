@@ -28,6 +28,19 @@
 
 namespace asmjit {
 
+// ============================================================================
+// [asmjit::Inst - JumpType]
+// ============================================================================
+
+uint32_t Inst::getJumpType(uint32_t archType, uint32_t instId) noexcept {
+  #if defined(ASMJIT_BUILD_X86)
+  if (ArchInfo::isX86Family(archType))
+    return X86Inst::isDefinedId(instId) ? X86Inst::getInst(instId).getCommonData().getJumpType() : static_cast<uint32_t>(kJumpTypeNone);
+  #endif
+
+  return kJumpTypeNone;
+}
+
 // ============================================================================
 // [asmjit::Inst - Validate]
 // ============================================================================
@@ -82,10 +82,76 @@ struct Inst {
     RegOnly extraReg;
   };
 
+  // --------------------------------------------------------------------------
+  // [Record]
+  // --------------------------------------------------------------------------
+
+  //! Instruction and its operands stored in a single structure, used to emit
+  //! arrays of pre-built instructions by \ref CodeEmitter::emitBatch().
+  //!
+  //! Only the first `opCount` operands are used, the remaining ones don't have
+  //! to be initialized.
+  class Record {
+  public:
+    // ------------------------------------------------------------------------
+    // [Init]
+    // ------------------------------------------------------------------------
+
+    //! Initialize the record to `instId` having `opCount` operands copied from `opArray`.
+    ASMJIT_INLINE void init(uint32_t instId, uint32_t options, const Operand_* opArray, uint32_t opCount) noexcept {
+      ASMJIT_ASSERT(opCount <= 6);
+
+      detail.instId = instId;
+      detail.options = options;
+      detail.extraReg.reset();
+
+      this->opCount = opCount;
+      for (uint32_t i = 0; i < opCount; i++)
+        this->opArray[i].copyFrom(opArray[i]);
+    }
+
+    ASMJIT_INLINE void init(uint32_t instId) noexcept {
+      init(instId, 0, nullptr, 0);
+    }
+
+    ASMJIT_INLINE void init(uint32_t instId, const Operand_& o0) noexcept {
+      init(instId, 0, &o0, 1);
+    }
+
+    ASMJIT_INLINE void init(uint32_t instId, const Operand_& o0, const Operand_& o1) noexcept {
+      const Operand_ ops[] = { o0, o1 };
+      init(instId, 0, ops, 2);
+    }
+
+    ASMJIT_INLINE void init(uint32_t instId, const Operand_& o0, const Operand_& o1, const Operand_& o2) noexcept {
+      const Operand_ ops[] = { o0, o1, o2 };
+      init(instId, 0, ops, 3);
+    }
+
+    ASMJIT_INLINE void init(uint32_t instId, const Operand_& o0, const Operand_& o1, const Operand_& o2, const Operand_& o3) noexcept {
+      const Operand_ ops[] = { o0, o1, o2, o3 };
+      init(instId, 0, ops, 4);
+    }
+
+    // ------------------------------------------------------------------------
+    // [Members]
+    // ------------------------------------------------------------------------
+
+    Detail detail;                       //!< Instruction id, options, and extra register.
+    uint32_t opCount;                    //!< Count of operands used (0..6).
+    uint32_t reserved;                   //!< \internal
+    Operand_ opArray[6];                 //!< Instruction operands.
+  };
+
   // --------------------------------------------------------------------------
   // [API]
   // --------------------------------------------------------------------------
 
+  //! Get the jump type of the instruction `instId`, see \ref JumpType.
+  //!
+  //! Returns `kJumpTypeNone` if `instId` is not a valid instruction of `archType`.
+  ASMJIT_API static uint32_t getJumpType(uint32_t archType, uint32_t instId) noexcept;
+
 #if !defined(ASMJIT_DISABLE_VALIDATION)
   //! Validate the given instruction.
   ASMJIT_API static Error validate(uint32_t archType, const Detail& detail, const Operand_* operands, uint32_t count) noexcept;
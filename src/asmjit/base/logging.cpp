@@ -391,6 +391,8 @@ Error Logging::formatNode(
         sb.appendFormat(".align %u (%s)",
           node->getAlignment(),
           node->getMode() == kAlignCode ? "code" : "data"));
+      if (node->getMaxSkip())
+        ASMJIT_PROPAGATE(sb.appendFormat(" max-skip %u", node->getMaxSkip()));
       break;
     }
 
@@ -14,10 +14,16 @@
 #if ASMJIT_OS_POSIX
 # include <sys/types.h>
 # include <sys/mman.h>
+# include <fcntl.h>
+# include <stdio.h>
 # include <time.h>
 # include <unistd.h>
 #endif // ASMJIT_OS_POSIX
 
+#if ASMJIT_OS_LINUX
+# include <sys/syscall.h>
+#endif // ASMJIT_OS_LINUX
+
 #if ASMJIT_OS_MAC
 # include <mach/mach_time.h>
 #endif // ASMJIT_OS_MAC
@@ -50,6 +56,7 @@ static ASMJIT_NOINLINE const VMemInfo& OSUtils_GetVMemInfo() noexcept {
 
     vmi.pageSize = Utils::alignToPowerOf2<uint32_t>(info.dwPageSize);
     vmi.pageGranularity = info.dwAllocationGranularity;
+    vmi.largePageSize = ::GetLargePageMinimum();
     vmi.hCurrentProcess = ::GetCurrentProcess();
   }
 
@@ -58,6 +65,13 @@ static ASMJIT_NOINLINE const VMemInfo& OSUtils_GetVMemInfo() noexcept {
 
 VMemInfo OSUtils::getVirtualMemoryInfo() noexcept { return OSUtils_GetVMemInfo(); }
 
+static ASMJIT_INLINE DWORD OSUtils_getProtectFlags(uint32_t flags) noexcept {
+  if (flags & OSUtils::kVMExecutable)
+    return (flags & OSUtils::kVMWritable) ? PAGE_EXECUTE_READWRITE : PAGE_EXECUTE_READ;
+  else
+    return (flags & OSUtils::kVMWritable) ? PAGE_READWRITE : PAGE_READONLY;
+}
+
 void* OSUtils::allocVirtualMemory(size_t size, size_t* allocated, uint32_t flags) noexcept {
   return allocProcessMemory(static_cast<HANDLE>(0), size, allocated, flags);
 }
@@ -79,15 +93,19 @@ void* OSUtils::allocProcessMemory(HANDLE hProcess, size_t size, size_t* allocate
   size_t alignedSize = Utils::alignTo(size, vmi.pageSize);
 
   // Windows XP SP2 / Vista+ allow data-execution-prevention (DEP).
-  DWORD protectFlags = 0;
+  DWORD protectFlags = OSUtils_getProtectFlags(flags);
 
-  if (flags & kVMExecutable)
-    protectFlags |= (flags & kVMWritable) ? PAGE_EXECUTE_READWRITE : PAGE_EXECUTE_READ;
-  else
-    protectFlags |= (flags & kVMWritable) ? PAGE_READWRITE : PAGE_READONLY;
+  // Large pages require `SeLockMemoryPrivilege`, fall back to regular pages.
+  LPVOID mBase = nullptr;
+  if ((flags & kVMLargePages) && vmi.largePageSize) {
+    alignedSize = Utils::alignTo(size, vmi.largePageSize);
+    mBase = ::VirtualAllocEx(hProcess, nullptr, alignedSize, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, protectFlags);
+  }
 
-  LPVOID mBase = ::VirtualAllocEx(hProcess, nullptr, alignedSize, MEM_COMMIT | MEM_RESERVE, protectFlags);
-  if (ASMJIT_UNLIKELY(!mBase)) return nullptr;
+  if (!mBase) {
+    mBase = ::VirtualAllocEx(hProcess, nullptr, alignedSize, MEM_COMMIT | MEM_RESERVE, protectFlags);
+    if (ASMJIT_UNLIKELY(!mBase)) return nullptr;
+  }
 
   ASMJIT_ASSERT(Utils::isAligned<size_t>(reinterpret_cast<size_t>(mBase), vmi.pageSize));
   if (allocated) *allocated = alignedSize;
@@ -103,6 +121,78 @@ Error OSUtils::releaseProcessMemory(HANDLE hProcess, void* p, size_t size) noexc
 
   return kErrorOk;
 }
+
+Error OSUtils::allocDualMapping(size_t size, size_t* allocated, void** rx, void** rw) noexcept {
+  if (size == 0)
+    return DebugUtils::errored(kErrorInvalidArgument);
+
+  const VMemInfo& vmi = OSUtils_GetVMemInfo();
+  size_t alignedSize = Utils::alignTo(size, vmi.pageGranularity);
+
+  uint64_t size64 = static_cast<uint64_t>(alignedSize);
+  HANDLE hMapping = ::CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr,
+    PAGE_EXECUTE_READWRITE | SEC_COMMIT,
+    static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64 & 0xFFFFFFFFU), nullptr);
+  if (ASMJIT_UNLIKELY(!hMapping))
+    return DebugUtils::errored(kErrorFeatureNotEnabled);
+
+  void* rxView = ::MapViewOfFile(hMapping, FILE_MAP_READ | FILE_MAP_EXECUTE, 0, 0, alignedSize);
+  void* rwView = ::MapViewOfFile(hMapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, alignedSize);
+
+  // Views keep the mapping alive.
+  ::CloseHandle(hMapping);
+
+  if (ASMJIT_UNLIKELY(!rxView || !rwView)) {
+    if (rxView) ::UnmapViewOfFile(rxView);
+    if (rwView) ::UnmapViewOfFile(rwView);
+    return DebugUtils::errored(kErrorNoVirtualMemory);
+  }
+
+  if (allocated) *allocated = alignedSize;
+  *rx = rxView;
+  *rw = rwView;
+  return kErrorOk;
+}
+
+//! \internal
+//!
+//! Reserve `size` bytes at `addr` (or anywhere if null), returns null on failure.
+static void* OSUtils_reserveAt(uint64_t addr, size_t size) noexcept {
+  return ::VirtualAlloc(reinterpret_cast<LPVOID>(static_cast<uintptr_t>(addr)), size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+Error OSUtils::commitVirtualMemory(void* p, size_t size, uint32_t flags) noexcept {
+  // Large pages can't be committed to a range that was only reserved.
+  if (ASMJIT_UNLIKELY(!::VirtualAlloc(p, size, MEM_COMMIT, OSUtils_getProtectFlags(flags))))
+    return DebugUtils::errored(kErrorNoVirtualMemory);
+
+  return kErrorOk;
+}
+
+Error OSUtils::decommitVirtualMemory(void* p, size_t size) noexcept {
+  if (ASMJIT_UNLIKELY(!::VirtualFree(p, size, MEM_DECOMMIT)))
+    return DebugUtils::errored(kErrorInvalidState);
+
+  return kErrorOk;
+}
+
+Error OSUtils::protectVirtualMemory(void* p, size_t size, uint32_t flags) noexcept {
+  DWORD oldProtect;
+  if (ASMJIT_UNLIKELY(!::VirtualProtect(p, size, OSUtils_getProtectFlags(flags), &oldProtect)))
+    return DebugUtils::errored(kErrorInvalidState);
+
+  return kErrorOk;
+}
+
+Error OSUtils::releaseDualMapping(void* rx, void* rw, size_t size) noexcept {
+  BOOL rxOk = ::UnmapViewOfFile(rx);
+  BOOL rwOk = ::UnmapViewOfFile(rw);
+
+  if (ASMJIT_UNLIKELY(!rxOk || !rwOk))
+    return DebugUtils::errored(kErrorInvalidState);
+
+  return kErrorOk;
+}
 #endif // ASMJIT_OS_WINDOWS
 
 // Posix specific implementation using `mmap()` and `munmap()`.
@@ -113,12 +203,46 @@ Error OSUtils::releaseProcessMemory(HANDLE hProcess, void* p, size_t size) noexc
 # define MAP_ANONYMOUS MAP_ANON
 #endif // MAP_ANONYMOUS
 
+// Reserved ranges are never accounted as committed memory if supported.
+#if !defined(MAP_NORESERVE)
+# define MAP_NORESERVE 0
+#endif // MAP_NORESERVE
+
+//! \internal
+//!
+//! Get the size of large pages, reads `/proc/meminfo` on Linux.
+static size_t OSUtils_GetLargePageSize() noexcept {
+#if ASMJIT_OS_LINUX && (ASMJIT_ARCH_X86 || ASMJIT_ARCH_X64)
+  size_t size = 0;
+
+  FILE* f = ::fopen("/proc/meminfo", "r");
+  if (f) {
+    char line[128];
+    unsigned long kb;
+
+    while (::fgets(line, ASMJIT_ARRAY_SIZE(line), f)) {
+      if (::sscanf(line, "Hugepagesize: %lu kB", &kb) == 1) {
+        size = static_cast<size_t>(kb) * 1024;
+        break;
+      }
+    }
+    ::fclose(f);
+  }
+
+  // Fall back to 2MB, which is supported by all X86 CPUs in PAE and 64-bit modes.
+  return size ? size : static_cast<size_t>(2 * 1024 * 1024);
+#else
+  return 0;
+#endif
+}
+
 static const VMemInfo& OSUtils_GetVMemInfo() noexcept {
   static VMemInfo vmi;
   if (ASMJIT_UNLIKELY(!vmi.pageSize)) {
     size_t pageSize = ::getpagesize();
-    vmi.pageSize = pageSize;
+    vmi.largePageSize = OSUtils_GetLargePageSize();
     vmi.pageGranularity = std::max<size_t>(pageSize, 65536);
+    vmi.pageSize = pageSize;
   }
   return vmi;
 };
@@ -134,6 +258,40 @@ void* OSUtils::allocVirtualMemory(size_t size, size_t* allocated, uint32_t flags
   if (flags & kVMWritable  ) protection |= PROT_WRITE;
   if (flags & kVMExecutable) protection |= PROT_EXEC;
 
+  size_t largePageSize = vmi.largePageSize;
+  if ((flags & kVMLargePages) && largePageSize) {
+    alignedSize = Utils::alignTo<size_t>(size, largePageSize);
+
+#if defined(MAP_HUGETLB)
+    // Explicit huge pages, only available if the administrator reserved them.
+    void* mbase = ::mmap(nullptr, alignedSize, protection, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (mbase != MAP_FAILED) {
+      if (allocated) *allocated = alignedSize;
+      return mbase;
+    }
+#endif // MAP_HUGETLB
+
+    // Regular pages aligned to the large page size, so the kernel can back
+    // them by transparent huge pages. Over-allocate and trim to align.
+    uint8_t* raw = static_cast<uint8_t*>(
+      ::mmap(nullptr, alignedSize + largePageSize, protection, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (ASMJIT_UNLIKELY(raw == MAP_FAILED)) return nullptr;
+
+    uint8_t* mbaseAligned = Utils::alignTo<uint8_t*>(raw, largePageSize);
+    size_t head = (size_t)(mbaseAligned - raw);
+    size_t tail = largePageSize - head;
+
+    if (head) ::munmap(raw, head);
+    if (tail) ::munmap(mbaseAligned + alignedSize, tail);
+
+#if defined(MADV_HUGEPAGE)
+    ::madvise(mbaseAligned, alignedSize, MADV_HUGEPAGE);
+#endif // MADV_HUGEPAGE
+
+    if (allocated) *allocated = alignedSize;
+    return mbaseAligned;
+  }
+
   void* mbase = ::mmap(nullptr, alignedSize, protection, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
   if (ASMJIT_UNLIKELY(mbase == MAP_FAILED)) return nullptr;
 
@@ -147,8 +305,212 @@ Error OSUtils::releaseVirtualMemory(void* p, size_t size) noexcept {
 
   return kErrorOk;
 }
+
+//! \internal
+//!
+//! Create an anonymous file that can be mapped multiple times.
+//!
+//! Linux provides `memfd_create()`, which is used when available (it's called
+//! through `syscall()` as older C libraries don't provide a wrapper). Other
+//! systems use a POSIX shared memory object that is unlinked immediately.
+static int OSUtils_createAnonymousFile() noexcept {
+#if ASMJIT_OS_LINUX && defined(SYS_memfd_create)
+  int fd = static_cast<int>(::syscall(SYS_memfd_create, "asmjit", 1 /* MFD_CLOEXEC */));
+  if (fd >= 0)
+    return fd;
+#endif // ASMJIT_OS_LINUX
+
+  static volatile size_t internalCounter;
+  char name[64];
+
+  for (uint32_t retry = 0; retry < 16; retry++) {
+    size_t counter = AtomicUtils::fetchAdd(&internalCounter, 1);
+    ::snprintf(name, ASMJIT_ARRAY_SIZE(name), "/asmjit-%u-%u",
+      static_cast<unsigned int>(::getpid()), static_cast<unsigned int>(counter));
+
+    int fd = ::shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (fd >= 0) {
+      ::shm_unlink(name);
+      return fd;
+    }
+  }
+
+  return -1;
+}
+
+Error OSUtils::allocDualMapping(size_t size, size_t* allocated, void** rx, void** rw) noexcept {
+  if (size == 0)
+    return DebugUtils::errored(kErrorInvalidArgument);
+
+  const VMemInfo& vmi = OSUtils_GetVMemInfo();
+  size_t alignedSize = Utils::alignTo<size_t>(size, vmi.pageSize);
+
+  int fd = OSUtils_createAnonymousFile();
+  if (ASMJIT_UNLIKELY(fd < 0))
+    return DebugUtils::errored(kErrorFeatureNotEnabled);
+
+  if (ASMJIT_UNLIKELY(::ftruncate(fd, static_cast<off_t>(alignedSize)) != 0)) {
+    ::close(fd);
+    return DebugUtils::errored(kErrorNoVirtualMemory);
+  }
+
+  void* rxView = ::mmap(nullptr, alignedSize, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+  void* rwView = ::mmap(nullptr, alignedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  // Mappings keep the file alive.
+  ::close(fd);
+
+  if (ASMJIT_UNLIKELY(rxView == MAP_FAILED || rwView == MAP_FAILED)) {
+    if (rxView != MAP_FAILED) ::munmap(rxView, alignedSize);
+    if (rwView != MAP_FAILED) ::munmap(rwView, alignedSize);
+
+    // Executable mapping of a file can be forbidden by the host (noexec).
+    return DebugUtils::errored(rxView == MAP_FAILED ? kErrorFeatureNotEnabled : kErrorNoVirtualMemory);
+  }
+
+  if (allocated) *allocated = alignedSize;
+  *rx = rxView;
+  *rw = rwView;
+  return kErrorOk;
+}
+
+//! \internal
+//!
+//! Reserve `size` bytes at `addr` (or anywhere if null), returns null on
+//! failure. The kernel treats `addr` as a hint, so the result can differ.
+static void* OSUtils_reserveAt(uint64_t addr, size_t size) noexcept {
+  const VMemInfo& vmi = OSUtils_GetVMemInfo();
+  size_t granularity = vmi.pageGranularity;
+
+  if (addr) {
+    void* mbase = ::mmap(reinterpret_cast<void*>(static_cast<uintptr_t>(addr)), size,
+      PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return mbase != MAP_FAILED ? mbase : nullptr;
+  }
+
+  // Over-reserve and trim, so the range is aligned to the page granularity.
+  uint8_t* raw = static_cast<uint8_t*>(
+    ::mmap(nullptr, size + granularity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+  if (ASMJIT_UNLIKELY(raw == MAP_FAILED)) return nullptr;
+
+  uint8_t* mbaseAligned = Utils::alignTo<uint8_t*>(raw, granularity);
+  size_t head = (size_t)(mbaseAligned - raw);
+  size_t tail = granularity - head;
+
+  if (head) ::munmap(raw, head);
+  if (tail) ::munmap(mbaseAligned + size, tail);
+  return mbaseAligned;
+}
+
+Error OSUtils::commitVirtualMemory(void* p, size_t size, uint32_t flags) noexcept {
+  int protection = PROT_READ;
+
+  if (flags & kVMWritable  ) protection |= PROT_WRITE;
+  if (flags & kVMExecutable) protection |= PROT_EXEC;
+
+  if (ASMJIT_UNLIKELY(::mprotect(p, size, protection) != 0))
+    return DebugUtils::errored(kErrorNoVirtualMemory);
+
+#if defined(MADV_HUGEPAGE)
+  if (flags & kVMLargePages)
+    ::madvise(p, size, MADV_HUGEPAGE);
+#endif // MADV_HUGEPAGE
+
+  return kErrorOk;
+}
+
+Error OSUtils::decommitVirtualMemory(void* p, size_t size) noexcept {
+  // Mapping a fresh reservation over the range discards its pages.
+  void* mbase = ::mmap(p, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+  if (ASMJIT_UNLIKELY(mbase == MAP_FAILED))
+    return DebugUtils::errored(kErrorInvalidState);
+
+  return kErrorOk;
+}
+
+Error OSUtils::protectVirtualMemory(void* p, size_t size, uint32_t flags) noexcept {
+  int protection = PROT_READ;
+
+  if (flags & kVMWritable  ) protection |= PROT_WRITE;
+  if (flags & kVMExecutable) protection |= PROT_EXEC;
+
+  if (ASMJIT_UNLIKELY(::mprotect(p, size, protection) != 0))
+    return DebugUtils::errored(kErrorInvalidState);
+
+  return kErrorOk;
+}
+
+Error OSUtils::releaseDualMapping(void* rx, void* rw, size_t size) noexcept {
+  int rxResult = ::munmap(rx, size);
+  int rwResult = ::munmap(rw, size);
+
+  if (ASMJIT_UNLIKELY(rxResult != 0 || rwResult != 0))
+    return DebugUtils::errored(kErrorInvalidState);
+
+  return kErrorOk;
+}
 #endif // ASMJIT_OS_POSIX
 
+void* OSUtils::reserveVirtualMemory(size_t size, size_t* reserved, const void* hint) noexcept {
+  if (size == 0)
+    return nullptr;
+
+  const VMemInfo& vmi = OSUtils_GetVMemInfo();
+  size_t granularity = vmi.pageGranularity;
+  size_t alignedSize = Utils::alignTo<size_t>(size, granularity);
+
+  // Every address is reachable by rel32 in 32-bit mode.
+  if (!hint || !ASMJIT_ARCH_64BIT) {
+    void* p = OSUtils_reserveAt(0, alignedSize);
+    if (p && reserved) *reserved = alignedSize;
+    return p;
+  }
+
+  // The range [start, start + size) must be within +/-2GB of `hint`.
+  const uint64_t kMaxDistance = 0x7FFFFFFFU;
+  if (alignedSize > kMaxDistance)
+    return nullptr;
+
+  uint64_t h = static_cast<uint64_t>((uintptr_t)hint);
+  uint64_t lo = h > kMaxDistance + granularity ? h - kMaxDistance : static_cast<uint64_t>(granularity);
+  uint64_t hi = h + kMaxDistance - alignedSize;
+
+  // Try addresses above and below `hint` with an increasing distance, the
+  // whole window is covered by 64 attempts per side.
+  uint64_t step = (kMaxDistance + 1) / 64;
+  uint64_t mask = ~static_cast<uint64_t>(granularity - 1);
+
+  for (uint32_t i = 0; i < 2 * 65; i++) {
+    uint64_t delta = static_cast<uint64_t>(i >> 1) * step;
+    uint64_t addr;
+
+    if (i & 1) {
+      if (h < lo + delta + alignedSize) continue;
+      addr = (h - delta - alignedSize) & mask;
+    }
+    else {
+      addr = ((h + granularity - 1) & mask) + delta;
+    }
+
+    if (addr < lo || addr > hi)
+      continue;
+
+    void* p = OSUtils_reserveAt(addr, alignedSize);
+    if (!p) continue;
+
+    // The kernel can place the range elsewhere if `addr` is not available.
+    uint64_t start = static_cast<uint64_t>((uintptr_t)p);
+    if (start >= lo && start <= hi && (start & ~mask) == 0) {
+      if (reserved) *reserved = alignedSize;
+      return p;
+    }
+
+    releaseVirtualMemory(p, alignedSize);
+  }
+
+  return nullptr;
+}
+
 // ============================================================================
 // [asmjit::OSUtils - GetTickCount]
 // ============================================================================
@@ -30,6 +30,7 @@ struct VMemInfo {
 #endif // ASMJIT_OS_WINDOWS
   size_t pageSize;                       //!< Virtual memory page size.
   size_t pageGranularity;                //!< Virtual memory page granularity.
+  size_t largePageSize;                  //!< Large page size (0 if not supported).
 };
 
 // ============================================================================
@@ -62,16 +63,52 @@ struct OSUtils {
   //! Virtual memory flags.
   ASMJIT_ENUM(VMFlags) {
     kVMWritable   = 0x00000001U,         //!< Virtual memory is writable.
-    kVMExecutable = 0x00000002U          //!< Virtual memory is executable.
+    kVMExecutable = 0x00000002U,         //!< Virtual memory is executable.
+    kVMLargePages = 0x00000004U          //!< Prefer large pages, falls back to regular pages.
   };
 
   ASMJIT_API static VMemInfo getVirtualMemoryInfo() noexcept;
 
   //! Allocate virtual memory.
+  //!
+  //! If `kVMLargePages` is specified and `VMemInfo::largePageSize` is not zero
+  //! the size is aligned to the large page size and the memory is aligned to
+  //! it as well. The memory is backed by large pages if the host allows that,
+  //! otherwise regular pages are used (this is not an error).
   ASMJIT_API static void* allocVirtualMemory(size_t size, size_t* allocated, uint32_t flags) noexcept;
   //! Release virtual memory previously allocated by \ref allocVirtualMemory().
   ASMJIT_API static Error releaseVirtualMemory(void* p, size_t size) noexcept;
 
+  //! Allocate virtual memory that is mapped twice.
+  //!
+  //! Both views share the same physical memory. `rx` view is readable and
+  //! executable and `rw` view is readable and writable, so no page is ever
+  //! writable and executable at the same time. Returns `kErrorFeatureNotEnabled`
+  //! if the host doesn't support such mappings.
+  ASMJIT_API static Error allocDualMapping(size_t size, size_t* allocated, void** rx, void** rw) noexcept;
+  //! Release virtual memory previously allocated by \ref allocDualMapping().
+  ASMJIT_API static Error releaseDualMapping(void* rx, void* rw, size_t size) noexcept;
+
+  //! Reserve a range of virtual memory without committing it.
+  //!
+  //! Both the address and size are aligned to `VMemInfo::pageGranularity`.
+  //! If `hint` is not null the whole range is placed within +/-2GB of `hint`,
+  //! so a rel32 displacement can reach `hint` from anywhere in it. Returns
+  //! null if no such range is available. The memory must be committed by
+  //! \ref commitVirtualMemory() before use and released by \ref releaseVirtualMemory().
+  ASMJIT_API static void* reserveVirtualMemory(size_t size, size_t* reserved, const void* hint) noexcept;
+  //! Commit pages of a range reserved by \ref reserveVirtualMemory().
+  //!
+  //! `kVMLargePages` is only a hint here, the kernel can use transparent huge
+  //! pages if the range is aligned to `VMemInfo::largePageSize` (Linux).
+  ASMJIT_API static Error commitVirtualMemory(void* p, size_t size, uint32_t flags) noexcept;
+  //! Decommit pages committed by \ref commitVirtualMemory(), the range stays reserved.
+  ASMJIT_API static Error decommitVirtualMemory(void* p, size_t size) noexcept;
+
+  //! Change protection of committed pages to `flags` (the memory is always
+  //! readable). Both `p` and `size` must be aligned to `VMemInfo::pageSize`.
+  ASMJIT_API static Error protectVirtualMemory(void* p, size_t size, uint32_t flags) noexcept;
+
 #if ASMJIT_OS_WINDOWS
   //! Allocate virtual memory of `hProcess` (Windows).
   ASMJIT_API static void* allocProcessMemory(HANDLE hProcess, size_t size, size_t* allocated, uint32_t flags) noexcept;
@@ -112,6 +149,8 @@ struct Lock {
 
   //! Lock.
   ASMJIT_INLINE void lock() noexcept { EnterCriticalSection(&_handle); }
+  //! Lock if it's not locked by another thread, returns true if locked.
+  ASMJIT_INLINE bool tryLock() noexcept { return TryEnterCriticalSection(&_handle) != 0; }
   //! Unlock.
   ASMJIT_INLINE void unlock() noexcept { LeaveCriticalSection(&_handle); }
 #endif // ASMJIT_OS_WINDOWS
@@ -130,6 +169,8 @@ struct Lock {
 
   //! Lock.
   ASMJIT_INLINE void lock() noexcept { pthread_mutex_lock(&_handle); }
+  //! Lock if it's not locked by another thread, returns true if locked.
+  ASMJIT_INLINE bool tryLock() noexcept { return pthread_mutex_trylock(&_handle) == 0; }
   //! Unlock.
   ASMJIT_INLINE void unlock() noexcept { pthread_mutex_unlock(&_handle); }
 #endif // ASMJIT_OS_POSIX
@@ -167,6 +208,67 @@ struct AutoLock {
   Lock& _target;
 };
 
+// ============================================================================
+// [asmjit::AtomicUtils]
+// ============================================================================
+
+//! \internal
+//!
+//! Minimal set of word-sized atomic operations used by lock-free paths.
+//!
+//! Loads have acquire semantics and stores have release semantics, all
+//! read-modify-write operations are sequentially consistent.
+struct AtomicUtils {
+#if ASMJIT_CC_MSC
+  static ASMJIT_INLINE size_t load(const volatile size_t* p) noexcept {
+    size_t x = *p;
+    _ReadWriteBarrier();
+    return x;
+  }
+
+  static ASMJIT_INLINE void store(volatile size_t* p, size_t x) noexcept {
+    _ReadWriteBarrier();
+    *p = x;
+  }
+
+# if ASMJIT_ARCH_64BIT
+  static ASMJIT_INLINE size_t fetchAdd(volatile size_t* p, size_t x) noexcept { return (size_t)InterlockedExchangeAdd64((volatile LONG64*)p, (LONG64)x); }
+  static ASMJIT_INLINE size_t fetchOr(volatile size_t* p, size_t x) noexcept { return (size_t)InterlockedOr64((volatile LONG64*)p, (LONG64)x); }
+  static ASMJIT_INLINE size_t exchange(volatile size_t* p, size_t x) noexcept { return (size_t)InterlockedExchange64((volatile LONG64*)p, (LONG64)x); }
+  static ASMJIT_INLINE bool compareExchange(volatile size_t* p, size_t expected, size_t x) noexcept { return (size_t)InterlockedCompareExchange64((volatile LONG64*)p, (LONG64)x, (LONG64)expected) == expected; }
+# else
+  static ASMJIT_INLINE size_t fetchAdd(volatile size_t* p, size_t x) noexcept { return (size_t)InterlockedExchangeAdd((volatile LONG*)p, (LONG)x); }
+  static ASMJIT_INLINE size_t fetchOr(volatile size_t* p, size_t x) noexcept { return (size_t)InterlockedOr((volatile LONG*)p, (LONG)x); }
+  static ASMJIT_INLINE size_t exchange(volatile size_t* p, size_t x) noexcept { return (size_t)InterlockedExchange((volatile LONG*)p, (LONG)x); }
+  static ASMJIT_INLINE bool compareExchange(volatile size_t* p, size_t expected, size_t x) noexcept { return (size_t)InterlockedCompareExchange((volatile LONG*)p, (LONG)x, (LONG)expected) == expected; }
+# endif
+
+  static ASMJIT_INLINE void fence() noexcept { MemoryBarrier(); }
+#else
+  static ASMJIT_INLINE size_t load(const volatile size_t* p) noexcept { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+  static ASMJIT_INLINE void store(volatile size_t* p, size_t x) noexcept { __atomic_store_n(p, x, __ATOMIC_RELEASE); }
+
+  static ASMJIT_INLINE size_t fetchAdd(volatile size_t* p, size_t x) noexcept { return __atomic_fetch_add(p, x, __ATOMIC_SEQ_CST); }
+  static ASMJIT_INLINE size_t fetchOr(volatile size_t* p, size_t x) noexcept { return __atomic_fetch_or(p, x, __ATOMIC_SEQ_CST); }
+  static ASMJIT_INLINE size_t exchange(volatile size_t* p, size_t x) noexcept { return __atomic_exchange_n(p, x, __ATOMIC_SEQ_CST); }
+  static ASMJIT_INLINE bool compareExchange(volatile size_t* p, size_t expected, size_t x) noexcept { return __atomic_compare_exchange_n(p, &expected, x, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); }
+
+  static ASMJIT_INLINE void fence() noexcept { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+#endif
+
+  //! Load a pointer (acquire).
+  template<typename T>
+  static ASMJIT_INLINE T* loadPtr(T* const volatile* p) noexcept {
+    return reinterpret_cast<T*>(load(reinterpret_cast<const volatile size_t*>(p)));
+  }
+
+  //! Store a pointer (release).
+  template<typename T>
+  static ASMJIT_INLINE void storePtr(T* volatile* p, T* x) noexcept {
+    store(reinterpret_cast<volatile size_t*>(p), reinterpret_cast<size_t>(x));
+  }
+};
+
 //! \}
 
 } // asmjit namespace
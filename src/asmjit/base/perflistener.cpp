@@ -0,0 +1,396 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Export]
+#define ASMJIT_EXPORTS
+
+// [Dependencies]
+#include "../base/perflistener.h"
+#include "../base/utils.h"
+
+#if ASMJIT_OS_LINUX
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <fcntl.h>
+# include <time.h>
+# include <unistd.h>
+#endif // ASMJIT_OS_LINUX
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+// ============================================================================
+// [asmjit::PerfListener - Helpers]
+// ============================================================================
+
+#if ASMJIT_OS_LINUX
+//! \internal
+//!
+//! Jit dump format, see `tools/perf/Documentation/jitdump-specification.txt`
+//! of the Linux kernel. All values are in the native byte order.
+enum {
+  kJitDumpMagic = 0x4A695444,            // "JiTD".
+  kJitDumpVersion = 1,
+  kJitDumpCodeLoad = 0                   // JIT_CODE_LOAD record.
+};
+
+//! \internal
+struct PerfJitDumpHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t totalSize;
+  uint32_t elfMach;
+  uint32_t pad1;
+  uint32_t pid;
+  uint64_t timestamp;
+  uint64_t flags;
+};
+
+//! \internal
+struct PerfJitDumpCodeLoad {
+  uint32_t id;
+  uint32_t totalSize;
+  uint64_t timestamp;
+  uint32_t pid;
+  uint32_t tid;
+  uint64_t vma;
+  uint64_t codeAddr;
+  uint64_t codeSize;
+  uint64_t codeIndex;
+};
+
+//! \internal
+//!
+//! ELF machine of the host.
+static ASMJIT_INLINE uint32_t PerfListener_getElfMach() noexcept {
+#if ASMJIT_ARCH_X64
+  return 62;                             // EM_X86_64.
+#elif ASMJIT_ARCH_X86
+  return 3;                              // EM_386.
+#elif ASMJIT_ARCH_ARM64
+  return 183;                            // EM_AARCH64.
+#elif ASMJIT_ARCH_ARM32
+  return 40;                             // EM_ARM.
+#else
+  return 0;                              // EM_NONE.
+#endif
+}
+
+//! \internal
+//!
+//! Timestamp of jit dump records, must match `perf record -k mono`.
+static uint64_t PerfListener_getTimestamp() noexcept {
+  struct timespec ts;
+  if (::clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+    return 0;
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000U + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+//! \internal
+//!
+//! Write a symbol `name` of `size` bytes at `p` to all open files.
+static void PerfListener_writeSymbol(PerfListener* self, const uint8_t* p, size_t size, const char* name, size_t nameLength) noexcept {
+  if (self->_perfMap) {
+    ::fprintf(self->_perfMap, "%llx %llx %.*s\n",
+      static_cast<unsigned long long>((uintptr_t)p),
+      static_cast<unsigned long long>(size),
+      static_cast<int>(nameLength), name);
+  }
+
+  if (self->_jitDump) {
+    PerfJitDumpCodeLoad record;
+    record.id = kJitDumpCodeLoad;
+    record.totalSize = static_cast<uint32_t>(sizeof(record) + nameLength + 1 + size);
+    record.timestamp = PerfListener_getTimestamp();
+    record.pid = static_cast<uint32_t>(::getpid());
+    record.tid = static_cast<uint32_t>(::syscall(SYS_gettid));
+    record.vma = static_cast<uint64_t>((uintptr_t)p);
+    record.codeAddr = static_cast<uint64_t>((uintptr_t)p);
+    record.codeSize = static_cast<uint64_t>(size);
+    record.codeIndex = self->_codeIndex;
+
+    ::fwrite(&record, sizeof(record), 1, self->_jitDump);
+    ::fwrite(name, 1, nameLength, self->_jitDump);
+    ::fputc(0, self->_jitDump);
+    ::fwrite(p, 1, size, self->_jitDump);
+  }
+
+  self->_codeIndex++;
+}
+#endif // ASMJIT_OS_LINUX
+
+// ============================================================================
+// [asmjit::PerfListener - Construction / Destruction]
+// ============================================================================
+
+PerfListener::PerfListener() noexcept
+  : _formats(0),
+    _perfMap(nullptr),
+    _jitDump(nullptr),
+    _jitDumpMarker(nullptr),
+    _jitDumpMarkerSize(0),
+    _codeIndex(0) {}
+
+PerfListener::~PerfListener() noexcept {
+  close();
+}
+
+// ============================================================================
+// [asmjit::PerfListener - Open / Close]
+// ============================================================================
+
+Error PerfListener::open(uint32_t formats, const char* dir) noexcept {
+#if ASMJIT_OS_LINUX
+  if (ASMJIT_UNLIKELY(isOpen()))
+    return DebugUtils::errored(kErrorAlreadyInitialized);
+
+  if (ASMJIT_UNLIKELY(formats == 0 || (formats & ~(kFormatPerfMap | kFormatJitDump)) != 0))
+    return DebugUtils::errored(kErrorInvalidArgument);
+
+  if (!dir)
+    dir = "/tmp";
+
+  AutoLock locked(_lock);
+  unsigned int pid = static_cast<unsigned int>(::getpid());
+  char path[1024];
+
+  if (formats & kFormatPerfMap) {
+    ::snprintf(path, ASMJIT_ARRAY_SIZE(path), "%s/perf-%u.map", dir, pid);
+    _perfMap = ::fopen(path, "w");
+    if (ASMJIT_UNLIKELY(!_perfMap))
+      return DebugUtils::errored(kErrorInvalidArgument);
+  }
+
+  if (formats & kFormatJitDump) {
+    ::snprintf(path, ASMJIT_ARRAY_SIZE(path), "%s/jit-%u.dump", dir, pid);
+
+    int fd = ::open(path, O_CREAT | O_TRUNC | O_RDWR, 0666);
+    if (ASMJIT_UNLIKELY(fd < 0))
+      goto _Failed;
+
+    // `perf record` finds the file by this executable mapping of it.
+    size_t markerSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    void* marker = ::mmap(nullptr, markerSize, PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0);
+    if (ASMJIT_UNLIKELY(marker == MAP_FAILED)) {
+      ::close(fd);
+      goto _Failed;
+    }
+
+    _jitDump = ::fdopen(fd, "w+");
+    if (ASMJIT_UNLIKELY(!_jitDump)) {
+      ::munmap(marker, markerSize);
+      ::close(fd);
+      goto _Failed;
+    }
+
+    _jitDumpMarker = marker;
+    _jitDumpMarkerSize = markerSize;
+
+    PerfJitDumpHeader header;
+    header.magic = kJitDumpMagic;
+    header.version = kJitDumpVersion;
+    header.totalSize = static_cast<uint32_t>(sizeof(header));
+    header.elfMach = PerfListener_getElfMach();
+    header.pad1 = 0;
+    header.pid = pid;
+    header.timestamp = PerfListener_getTimestamp();
+    header.flags = 0;
+
+    ::fwrite(&header, sizeof(header), 1, _jitDump);
+    ::fflush(_jitDump);
+  }
+
+  _formats = formats;
+  return kErrorOk;
+
+_Failed:
+  if (_perfMap) {
+    ::fclose(_perfMap);
+    _perfMap = nullptr;
+  }
+  return DebugUtils::errored(kErrorInvalidArgument);
+#else
+  ASMJIT_UNUSED(formats);
+  ASMJIT_UNUSED(dir);
+  return DebugUtils::errored(kErrorFeatureNotEnabled);
+#endif // ASMJIT_OS_LINUX
+}
+
+void PerfListener::close() noexcept {
+#if ASMJIT_OS_LINUX
+  AutoLock locked(_lock);
+
+  if (_perfMap) {
+    ::fclose(_perfMap);
+    _perfMap = nullptr;
+  }
+
+  if (_jitDump) {
+    ::fclose(_jitDump);
+    ::munmap(_jitDumpMarker, _jitDumpMarkerSize);
+
+    _jitDump = nullptr;
+    _jitDumpMarker = nullptr;
+    _jitDumpMarkerSize = 0;
+  }
+
+  _formats = 0;
+#endif // ASMJIT_OS_LINUX
+}
+
+// ============================================================================
+// [asmjit::PerfListener - Interface]
+// ============================================================================
+
+void PerfListener::onCodeAdded(const void* p, size_t size, const CodeHolder* code) noexcept {
+#if ASMJIT_OS_LINUX
+  AutoLock locked(_lock);
+  if (!isOpen())
+    return;
+
+  // Global labels bound in the relocated section, sorted by their offsets.
+  // Insertion sort is fine, labels are mostly bound in ascending order.
+  const ZoneVector<LabelEntry*>& labels = code->getLabelEntries();
+  size_t i, count = 0;
+
+  const LabelEntry** symbols = static_cast<const LabelEntry**>(
+    Internal::allocMemory(labels.getLength() * sizeof(LabelEntry*) + 1));
+
+  if (symbols) {
+    for (i = 0; i < labels.getLength(); i++) {
+      const LabelEntry* le = labels[i];
+      if (le->getType() != Label::kTypeGlobal || le->getSectionId() != 0 ||
+          le->getOffset() < 0 || static_cast<size_t>(le->getOffset()) >= size)
+        continue;
+
+      size_t j = count++;
+      while (j > 0 && symbols[j - 1]->getOffset() > le->getOffset()) {
+        symbols[j] = symbols[j - 1];
+        j--;
+      }
+      symbols[j] = le;
+    }
+  }
+
+  const uint8_t* base = static_cast<const uint8_t*>(p);
+  size_t start = 0;
+
+  // Code without a label at its beginning.
+  if (count == 0 || symbols[0]->getOffset() != 0) {
+    char name[64];
+    size_t end = count ? static_cast<size_t>(symbols[0]->getOffset()) : size;
+    int nameLength = ::snprintf(name, ASMJIT_ARRAY_SIZE(name), "asmjit_func_%llu",
+      static_cast<unsigned long long>(_codeIndex));
+
+    PerfListener_writeSymbol(this, base, end, name, static_cast<size_t>(nameLength));
+    start = end;
+  }
+
+  // Each symbol ends where the next one starts, or at the end of the code.
+  for (i = 0; i < count; i++) {
+    size_t end = i + 1 < count ? static_cast<size_t>(symbols[i + 1]->getOffset()) : size;
+    if (end == start)
+      continue;
+
+    PerfListener_writeSymbol(this, base + start, end - start, symbols[i]->getName(), symbols[i]->getNameLength());
+    start = end;
+  }
+
+  if (symbols)
+    Internal::releaseMemory(symbols);
+
+  if (_perfMap) ::fflush(_perfMap);
+  if (_jitDump) ::fflush(_jitDump);
+#else
+  ASMJIT_UNUSED(p);
+  ASMJIT_UNUSED(size);
+  ASMJIT_UNUSED(code);
+#endif // ASMJIT_OS_LINUX
+}
+
+// ============================================================================
+// [asmjit::PerfListener - Test]
+// ============================================================================
+
+#if defined(ASMJIT_TEST) && ASMJIT_OS_LINUX
+UNIT(base_perflistener) {
+  static const uint8_t kCode[] = { 0x90, 0x90, 0xC3, 0xC3 };
+
+  CodeHolder code;
+  code.init(CodeInfo(ArchInfo::kTypeHost));
+
+  CodeBuffer& buffer = code._sections[0]->_buffer;
+  code.reserveBuffer(&buffer, sizeof(kCode));
+  ::memcpy(buffer._data, kCode, sizeof(kCode));
+  buffer._length = sizeof(kCode);
+
+  uint32_t id;
+  EXPECT(code.newNamedLabelId(id, "perf_test_func", Globals::kInvalidIndex, Label::kTypeGlobal, 0) == kErrorOk,
+    "Failed to create a named label");
+  code.getLabelEntry(id)->_sectionId = 0;
+  code.getLabelEntry(id)->_offset = 3;
+
+  PerfListener listener;
+  EXPECT(listener.open(PerfListener::kFormatPerfMap | PerfListener::kFormatJitDump) == kErrorOk,
+    "Failed to open the listener");
+
+  JitRuntime rt;
+  rt.setListener(&listener);
+
+  void* p;
+  EXPECT(rt._add(&p, &code) == kErrorOk, "Failed to add code");
+  rt.release(p);
+  listener.close();
+
+  char mapPath[64];
+  char dumpPath[64];
+  ::snprintf(mapPath, ASMJIT_ARRAY_SIZE(mapPath), "/tmp/perf-%u.map", static_cast<unsigned int>(::getpid()));
+  ::snprintf(dumpPath, ASMJIT_ARRAY_SIZE(dumpPath), "/tmp/jit-%u.dump", static_cast<unsigned int>(::getpid()));
+
+  INFO("Perf map");
+  char line[256];
+  char expected[2][256];
+  ::snprintf(expected[0], 256, "%llx 3 asmjit_func_0\n", static_cast<unsigned long long>((uintptr_t)p));
+  ::snprintf(expected[1], 256, "%llx 1 perf_test_func\n", static_cast<unsigned long long>((uintptr_t)p + 3));
+
+  FILE* f = ::fopen(mapPath, "r");
+  EXPECT(f != nullptr, "Perf map not found");
+  for (uint32_t i = 0; i < 2; i++) {
+    EXPECT(::fgets(line, 256, f) != nullptr, "Perf map is incomplete");
+    EXPECT(::strcmp(line, expected[i]) == 0, "Expected '%s', got '%s'", expected[i], line);
+  }
+  ::fclose(f);
+
+  INFO("Jit dump");
+  PerfJitDumpHeader header;
+  PerfJitDumpCodeLoad record;
+  uint8_t data[sizeof("asmjit_func_0") + 3];
+
+  f = ::fopen(dumpPath, "rb");
+  EXPECT(f != nullptr, "Jit dump not found");
+  EXPECT(::fread(&header, sizeof(header), 1, f) == 1 && header.magic == kJitDumpMagic,
+    "Invalid jit dump header");
+  EXPECT(::fread(&record, sizeof(record), 1, f) == 1 && ::fread(data, sizeof(data), 1, f) == 1,
+    "Jit dump is incomplete");
+  EXPECT(record.id == kJitDumpCodeLoad && record.totalSize == sizeof(record) + sizeof(data) &&
+         record.codeAddr == static_cast<uint64_t>((uintptr_t)p) && record.codeSize == 3,
+    "Invalid jit dump record");
+  EXPECT(::strcmp(reinterpret_cast<char*>(data), "asmjit_func_0") == 0 &&
+         ::memcmp(data + sizeof("asmjit_func_0"), kCode, 3) == 0,
+    "Invalid jit dump record data");
+  ::fclose(f);
+
+  ::remove(mapPath);
+  ::remove(dumpPath);
+}
+#endif // ASMJIT_TEST && ASMJIT_OS_LINUX
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
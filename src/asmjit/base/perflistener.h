@@ -0,0 +1,104 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Guard]
+#ifndef _ASMJIT_BASE_PERFLISTENER_H
+#define _ASMJIT_BASE_PERFLISTENER_H
+
+// [Dependencies]
+#include "../base/osutils.h"
+#include "../base/runtime.h"
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+//! \addtogroup asmjit_base
+//! \{
+
+// ============================================================================
+// [asmjit::PerfListener]
+// ============================================================================
+
+//! Listener that makes code added to \ref JitRuntime visible to Linux `perf`.
+//!
+//! Two formats are supported, both can be written at the same time:
+//!
+//!   - `kFormatPerfMap` - `perf-<pid>.map` file, which only contains names of
+//!     symbols and their addresses. It's enough for `perf report`, `perf` only
+//!     looks for it in `/tmp`.
+//!   - `kFormatJitDump` - `jit-<pid>.dump` file, which also contains the code,
+//!     so `perf annotate` can disassemble it. The profile must be recorded by
+//!     `perf record -k mono` and injected by `perf inject --jit`.
+//!
+//! Symbols are named by global labels bound in the code (so a function should
+//! bind a named label at its beginning). Code that doesn't start with a named
+//! label gets a generated name.
+//!
+//! The listener is only supported on Linux, `open()` returns
+//! `kErrorFeatureNotEnabled` elsewhere.
+class ASMJIT_VIRTAPI PerfListener : public JitListener {
+public:
+  ASMJIT_NONCOPYABLE(PerfListener)
+
+  //! Output formats.
+  ASMJIT_ENUM(Format) {
+    kFormatPerfMap = 0x00000001U,        //!< Write `perf-<pid>.map`.
+    kFormatJitDump = 0x00000002U         //!< Write `jit-<pid>.dump`.
+  };
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  //! Create a `PerfListener` instance, which is not open.
+  ASMJIT_API PerfListener() noexcept;
+  //! Destroy the `PerfListener` instance, see \ref close().
+  ASMJIT_API virtual ~PerfListener() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Open / Close]
+  // --------------------------------------------------------------------------
+
+  //! Get whether the listener is open.
+  ASMJIT_INLINE bool isOpen() const noexcept { return _formats != 0; }
+  //! Get formats the listener writes, see \ref Format.
+  ASMJIT_INLINE uint32_t getFormats() const noexcept { return _formats; }
+
+  //! Create files of `formats` in `dir` (`/tmp` if null).
+  ASMJIT_API Error open(uint32_t formats, const char* dir = nullptr) noexcept;
+  //! Close all files.
+  ASMJIT_API void close() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Interface]
+  // --------------------------------------------------------------------------
+
+  ASMJIT_API virtual void onCodeAdded(const void* p, size_t size, const CodeHolder* code) noexcept override;
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  Lock _lock;                            //!< Lock of all files.
+  uint32_t _formats;                     //!< Formats written, see \ref Format.
+  FILE* _perfMap;                        //!< Perf map stream.
+  FILE* _jitDump;                        //!< Jit dump stream.
+  void* _jitDumpMarker;                  //!< Mapping of the jit dump seen by `perf record`.
+  size_t _jitDumpMarkerSize;             //!< Size of `_jitDumpMarker`.
+  uint64_t _codeIndex;                   //!< Index of the next symbol.
+};
+
+//! \}
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
+
+// [Guard]
+#endif // _ASMJIT_BASE_PERFLISTENER_H
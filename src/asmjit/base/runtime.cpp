@@ -11,6 +11,18 @@
 #include "../base/assembler.h"
 #include "../base/cpuinfo.h"
 #include "../base/runtime.h"
+#include "../base/unwind.h"
+
+// Unwind information of JIT code is registered by `__register_frame()` of
+// libgcc, which accepts the whole `.eh_frame` data. The same function provided
+// by LLVM's libunwind (used on Mac) accepts a single FDE, so it's not used.
+#if (ASMJIT_OS_LINUX || ASMJIT_OS_BSD) && !ASMJIT_OS_MAC && (ASMJIT_CC_GCC || ASMJIT_CC_CLANG)
+# define ASMJIT_RUNTIME_EH_FRAME 1
+extern "C" void __register_frame(void*);
+extern "C" void __deregister_frame(void*);
+#else
+# define ASMJIT_RUNTIME_EH_FRAME 0
+#endif
 
 // [Api-Begin]
 #include "../asmjit_apibegin.h"
@@ -96,12 +108,923 @@ void HostRuntime::flush(const void* p, size_t size) noexcept {
   hostFlushInstructionCache(p, size);
 }
 
+// ============================================================================
+// [asmjit::JitListener - Construction / Destruction]
+// ============================================================================
+
+JitListener::JitListener() noexcept {}
+JitListener::~JitListener() noexcept {}
+
+// ============================================================================
+// [asmjit::JitRuntime - Epoch]
+// ============================================================================
+
+//! \internal
+//!
+//! Read-side state of a single thread.
+struct JitRuntime::EpochRecord {
+  EpochRecord* next;                     // Next record (records are never removed).
+  uintptr_t threadId;                    // Thread that owns the record.
+  volatile size_t state;                 // Observed epoch | 1 inside a section, 0 otherwise.
+  size_t depth;                          // Nesting depth, only accessed by the owner.
+};
+
+//! \internal
+//!
+//! Code released during an `epoch`, waiting for a grace period.
+struct JitRuntime::RetiredEntry {
+  RetiredEntry* next;                    // Next (older) entry.
+  void* p;                               // Retired code.
+  size_t epoch;                          // Epoch of `release()`.
+};
+
+typedef JitRuntime::EpochRecord EpochRecord;
+typedef JitRuntime::RetiredEntry RetiredEntry;
+
+static void jitFrameRelease(JitRuntime* self, void* p) noexcept;
+static void* jitImageRelease(JitRuntime* self, void* p) noexcept;
+
+static ASMJIT_THREAD_LOCAL size_t jitEpochTlsSerial;
+static ASMJIT_THREAD_LOCAL EpochRecord* jitEpochTlsRecord;
+
+//! \internal
+//!
+//! Get a record of the calling thread, the record is created if `create` is
+//! true. Records are only prepended, so the list is searched without a lock.
+static EpochRecord* jitEpochGetRecord(JitRuntime* self, bool create) noexcept {
+  if (ASMJIT_LIKELY(jitEpochTlsSerial == self->_epochSerial))
+    return jitEpochTlsRecord;
+
+  // Address of a thread-local variable is used as a thread id, a record of a
+  // thread that has terminated is adopted by a new thread with the same id.
+  uintptr_t threadId = (uintptr_t)&jitEpochTlsSerial;
+
+  EpochRecord* record = AtomicUtils::loadPtr(&self->_epochRecords);
+  while (record && record->threadId != threadId)
+    record = record->next;
+
+  if (!record) {
+    if (!create)
+      return nullptr;
+
+    record = static_cast<EpochRecord*>(Internal::allocMemory(sizeof(EpochRecord)));
+    if (ASMJIT_UNLIKELY(!record))
+      return nullptr;
+
+    record->threadId = threadId;
+    record->state = 0;
+    record->depth = 0;
+
+    AutoLock locked(self->_epochLock);
+    record->next = self->_epochRecords;
+    AtomicUtils::storePtr(&self->_epochRecords, record);
+  }
+
+  jitEpochTlsSerial = self->_epochSerial;
+  jitEpochTlsRecord = record;
+  return record;
+}
+
+//! \internal
+//!
+//! Get whether any thread is inside a read-side section.
+static bool jitEpochHasReaders(JitRuntime* self) noexcept {
+  for (EpochRecord* record = self->_epochRecords; record; record = record->next)
+    if (AtomicUtils::load(&record->state) != 0)
+      return true;
+  return false;
+}
+
+//! \internal
+//!
+//! Advance the global epoch if all threads inside a section have observed it.
+static bool jitEpochTryAdvance(JitRuntime* self) noexcept {
+  size_t epoch = self->_epoch;
+
+  for (EpochRecord* record = self->_epochRecords; record; record = record->next) {
+    size_t state = AtomicUtils::load(&record->state);
+    if (state != 0 && state != (epoch | 1))
+      return false;
+  }
+
+  AtomicUtils::store(&self->_epoch, epoch + 2);
+  return true;
+}
+
+//! \internal
+//!
+//! Release retired code after its grace period, or all of it if `all` is
+//! true (only if there are no readers). Code retired during epoch `E` can be
+//! released after the epoch has been advanced twice - the first advance
+//! waits for readers that observed `E - 2`, the second one for readers that
+//! observed `E` before the code was retired.
+static void jitEpochReclaim(JitRuntime* self, bool all) noexcept {
+  RetiredEntry** pPrev = &self->_retired;
+  RetiredEntry* entry = self->_retired;
+
+  while (entry) {
+    RetiredEntry* next = entry->next;
+
+    if (all || self->_epoch - entry->epoch >= 4) {
+      jitFrameRelease(self, entry->p);
+      self->_memMgr.release(jitImageRelease(self, entry->p));
+      Internal::releaseMemory(entry);
+
+      self->_retiredCount--;
+      *pPrev = next;
+    }
+    else {
+      pPrev = &entry->next;
+    }
+
+    entry = next;
+  }
+}
+
+// ============================================================================
+// [asmjit::JitRuntime - Dedup]
+// ============================================================================
+
+//! \internal
+//!
+//! Function shared by `add()`, hashed by its code and relocations.
+struct JitRuntime::DedupEntry : public ZoneHashNode {
+  void* p;                               // Shared function.
+  size_t size;                           // Size of the relocated code.
+  size_t refCount;                       // Count of `add()` calls that returned it.
+  DedupLink* link;                       // Link hashed by the address.
+};
+
+//! \internal
+//!
+//! Link of a shared function hashed by its address.
+struct JitRuntime::DedupLink : public ZoneHashNode {
+  DedupEntry* entry;                     // Shared function.
+};
+
+typedef JitRuntime::DedupEntry DedupEntry;
+typedef JitRuntime::DedupLink DedupLink;
+
+//! \internal
+//!
+//! Hash code and relocations of `code`.
+//!
+//! Code stored in `CodeHolder` doesn't depend on the address it's relocated
+//! to, only relocation entries do, so the content of sections is hashed as is.
+static uint32_t jitDedupHashCode(const CodeHolder* code) noexcept {
+  const ZoneVector<SectionEntry*>& sections = code->getSections();
+  const ZoneVector<RelocEntry*>& relocations = code->getRelocEntries();
+
+  uint32_t hVal = 0;
+  size_t i;
+
+  for (i = 0; i < sections.getLength(); i++) {
+    const CodeBuffer& buffer = sections[i]->getBuffer();
+    const uint8_t* data = buffer.getData();
+    size_t length = buffer.getLength();
+
+    hVal = Utils::hashRound(hVal, static_cast<uint32_t>(length));
+    for (size_t j = 0; j < length; j++)
+      hVal = Utils::hashRound(hVal, data[j]);
+  }
+
+  for (i = 0; i < relocations.getLength(); i++) {
+    const RelocEntry* re = relocations[i];
+    if (re->getType() == RelocEntry::kTypeNone)
+      continue;
+
+    hVal = Utils::hashRound(hVal, re->getType() | (re->getSize() << 8));
+    hVal = Utils::hashRound(hVal, re->getSourceSectionId() ^ (re->getTargetSectionId() << 16));
+    hVal = Utils::hashRound(hVal, static_cast<uint32_t>(re->getSourceOffset()));
+    hVal = Utils::hashRound(hVal, static_cast<uint32_t>(re->getData()));
+    hVal = Utils::hashRound(hVal, static_cast<uint32_t>(re->getData() >> 32));
+  }
+
+  return hVal;
+}
+
+//! \internal
+static ASMJIT_INLINE uint32_t jitDedupHashAddress(const void* p) noexcept {
+  uint64_t x = static_cast<uint64_t>((uintptr_t)p);
+  return static_cast<uint32_t>(x >> 4) ^ static_cast<uint32_t>(x >> 32);
+}
+
+//! \internal
+//!
+//! Key that matches a shared function equal to `code`.
+//!
+//! Two functions are equal if `code` relocated to the address of the shared
+//! function produces the same bytes - it's exact and handles trampolines and
+//! relocations to absolute addresses without comparing them separately.
+class JitDedupByCode {
+public:
+  ASMJIT_INLINE JitDedupByCode(const CodeHolder* code, size_t codeSize, uint32_t hVal) noexcept
+    : hVal(hVal),
+      code(code),
+      codeSize(codeSize),
+      buffer(nullptr) {}
+  ASMJIT_INLINE ~JitDedupByCode() noexcept {
+    if (buffer) Internal::releaseMemory(buffer);
+  }
+
+  ASMJIT_INLINE bool matches(const DedupEntry* entry) const noexcept {
+    if (entry->_hVal != hVal || entry->size > codeSize)
+      return false;
+
+    if (!buffer) {
+      buffer = static_cast<uint8_t*>(Internal::allocMemory(codeSize));
+      if (ASMJIT_UNLIKELY(!buffer))
+        return false;
+    }
+
+    size_t relocSize = code->relocate(buffer, static_cast<uint64_t>((uintptr_t)entry->p));
+    return relocSize == entry->size && ::memcmp(buffer, entry->p, relocSize) == 0;
+  }
+
+  uint32_t hVal;
+  const CodeHolder* code;
+  size_t codeSize;
+  mutable uint8_t* buffer;
+};
+
+//! \internal
+//!
+//! Key that matches a shared function by its address.
+class JitDedupByAddress {
+public:
+  ASMJIT_INLINE JitDedupByAddress(const void* p) noexcept
+    : hVal(jitDedupHashAddress(p)),
+      p(p) {}
+
+  ASMJIT_INLINE bool matches(const DedupLink* link) const noexcept {
+    return link->entry->p == p;
+  }
+
+  uint32_t hVal;
+  const void* p;
+};
+
+//! \internal
+//!
+//! Get a shared function equal to `code` and add a reference to it, or null.
+static void* jitDedupAcquire(JitRuntime* self, const CodeHolder* code, size_t codeSize, uint32_t hVal) noexcept {
+  AutoLock locked(self->_dedupLock);
+
+  DedupEntry* entry = self->_dedupByCode.get(JitDedupByCode(code, codeSize, hVal));
+  if (!entry)
+    return nullptr;
+
+  entry->refCount++;
+  self->_dedupHitsCount++;
+  self->_dedupSavedSize += entry->size;
+  return entry->p;
+}
+
+//! \internal
+//!
+//! Share a function `p` added by `add()`. It's not an error if this fails,
+//! the function is just not shared.
+static void jitDedupInsert(JitRuntime* self, void* p, size_t size, uint32_t hVal) noexcept {
+  AutoLock locked(self->_dedupLock);
+
+  DedupEntry* entry = self->_dedupHeap.allocT<DedupEntry>();
+  DedupLink* link = self->_dedupHeap.allocT<DedupLink>();
+
+  if (ASMJIT_UNLIKELY(!entry || !link)) {
+    if (entry) self->_dedupHeap.release(entry, sizeof(DedupEntry));
+    if (link) self->_dedupHeap.release(link, sizeof(DedupLink));
+    return;
+  }
+
+  entry->_hVal = hVal;
+  entry->p = p;
+  entry->size = size;
+  entry->refCount = 1;
+  entry->link = link;
+
+  link->_hVal = jitDedupHashAddress(p);
+  link->entry = entry;
+
+  self->_dedupByCode.put(entry);
+  self->_dedupByAddress.put(link);
+}
+
+//! \internal
+//!
+//! Release a reference to a shared function `p`. Returns true if the function
+//! is still referenced and must not be released.
+static bool jitDedupRelease(JitRuntime* self, void* p) noexcept {
+  AutoLock locked(self->_dedupLock);
+
+  DedupLink* link = self->_dedupByAddress.get(JitDedupByAddress(p));
+  if (!link)
+    return false;
+
+  DedupEntry* entry = link->entry;
+  if (--entry->refCount != 0) {
+    self->_dedupSavedSize -= entry->size;
+    return true;
+  }
+
+  self->_dedupByCode.del(entry);
+  self->_dedupByAddress.del(link);
+
+  self->_dedupHeap.release(entry, sizeof(DedupEntry));
+  self->_dedupHeap.release(link, sizeof(DedupLink));
+  return false;
+}
+
+// ============================================================================
+// [asmjit::JitRuntime - Frames]
+// ============================================================================
+
+//! \internal
+//!
+//! Unwind information of a function registered by `add()`.
+struct JitRuntime::FrameEntry : public ZoneHashNode {
+  void* p;                               // Function.
+  void* ehFrame;                         // Registered `.eh_frame` data.
+};
+
+typedef JitRuntime::FrameEntry FrameEntry;
+
+//! \internal
+//!
+//! Key that matches unwind information of a function by its address.
+class JitFrameByAddress {
+public:
+  ASMJIT_INLINE JitFrameByAddress(const void* p) noexcept
+    : hVal(jitDedupHashAddress(p)),
+      p(p) {}
+
+  ASMJIT_INLINE bool matches(const FrameEntry* entry) const noexcept {
+    return entry->p == p;
+  }
+
+  uint32_t hVal;
+  const void* p;
+};
+
+//! \internal
+//!
+//! Register unwind information of `code` relocated to `p`, does nothing if
+//! the code has no unwind entries or the host doesn't support registration.
+static Error jitFrameRegister(JitRuntime* self, void* p, size_t size, const CodeHolder* code) noexcept {
+#if ASMJIT_RUNTIME_EH_FRAME
+  if (!code->hasUnwindEntries())
+    return kErrorOk;
+
+  StringBuilderTmp<256> sb;
+  ASMJIT_PROPAGATE(UnwindUtils::buildEhFrame(code, static_cast<uint64_t>((uintptr_t)p), size, sb));
+
+  if (sb.getLength() == 0)
+    return kErrorOk;
+
+  void* ehFrame = Internal::allocMemory(sb.getLength());
+  if (ASMJIT_UNLIKELY(!ehFrame))
+    return DebugUtils::errored(kErrorNoHeapMemory);
+  ::memcpy(ehFrame, sb.getData(), sb.getLength());
+
+  AutoLock locked(self->_frameLock);
+  FrameEntry* entry = self->_frameHeap.allocT<FrameEntry>();
+
+  if (ASMJIT_UNLIKELY(!entry)) {
+    Internal::releaseMemory(ehFrame);
+    return DebugUtils::errored(kErrorNoHeapMemory);
+  }
+
+  entry->_hVal = jitDedupHashAddress(p);
+  entry->p = p;
+  entry->ehFrame = ehFrame;
+
+  __register_frame(ehFrame);
+  self->_frames.put(entry);
+#else
+  ASMJIT_UNUSED(self);
+  ASMJIT_UNUSED(p);
+  ASMJIT_UNUSED(size);
+  ASMJIT_UNUSED(code);
+#endif
+
+  return kErrorOk;
+}
+
+//! \internal
+//!
+//! Deregister unwind information of `p`, called before `p` is released.
+static void jitFrameRelease(JitRuntime* self, void* p) noexcept {
+#if ASMJIT_RUNTIME_EH_FRAME
+  AutoLock locked(self->_frameLock);
+  if (self->_frames.getSize() == 0)
+    return;
+
+  FrameEntry* entry = self->_frames.get(JitFrameByAddress(p));
+  if (!entry)
+    return;
+
+  __deregister_frame(entry->ehFrame);
+  Internal::releaseMemory(entry->ehFrame);
+
+  self->_frames.del(entry);
+  self->_frameHeap.release(entry, sizeof(FrameEntry));
+#else
+  ASMJIT_UNUSED(self);
+  ASMJIT_UNUSED(p);
+#endif
+}
+
+// ============================================================================
+// [asmjit::JitRuntime - Images]
+// ============================================================================
+
+//! \internal
+//!
+//! Code added with constant or writable sections, which are protected by
+//! changing the protection of their pages. A small image is packed into an
+//! arena shared with other images, otherwise the image is page aligned inside
+//! of the memory allocated by `VMemMgr`, which also covers the last page, so
+//! no other allocation shares the protected pages.
+struct JitRuntime::ImageEntry : public ZoneHashNode {
+  void* p;                               // Image (its first section).
+  void* allocated;                       // Memory allocated by `VMemMgr`.
+  ImageArena* arena;                     // Arena of a packed image (or null).
+  uint8_t* protectedStart;               // Pages of constant & writable sections.
+  size_t protectedSize;                  // Size of protected pages.
+};
+
+//! \internal
+//!
+//! Three consecutive pages (see \ref CodeHolder::setGroupStride()) shared by
+//! small images - executable, read-only, and writable. Each image is placed
+//! at the same offset in all pages, so the protection of pages never changes
+//! and a single large page is enough for many images.
+struct JitRuntime::ImageArena {
+  uint8_t* allocated;                    // Memory allocated by `VMemMgr`.
+  uint8_t* p;                            // The first page.
+  size_t pageSize;                       // Size of a page.
+  size_t offset;                         // Offset of the next image.
+  size_t count;                          // Count of images.
+};
+
+typedef JitRuntime::ImageEntry ImageEntry;
+typedef JitRuntime::ImageArena ImageArena;
+
+//! \internal
+//!
+//! Key that matches an image by its address.
+class JitImageByAddress {
+public:
+  ASMJIT_INLINE JitImageByAddress(const void* p) noexcept
+    : hVal(jitDedupHashAddress(p)),
+      p(p) {}
+
+  ASMJIT_INLINE bool matches(const ImageEntry* entry) const noexcept {
+    return entry->p == p;
+  }
+
+  uint32_t hVal;
+  const void* p;
+};
+
+//! \internal
+//!
+//! Get whether `code` has non-empty sections that are not executable.
+static bool jitImageHasData(const CodeHolder* code) noexcept {
+  const ZoneVector<SectionEntry*>& sections = code->getSections();
+  for (size_t i = 1; i < sections.getLength(); i++) {
+    const SectionEntry* se = sections[i];
+    if (!se->hasFlag(SectionEntry::kFlagExec) && !se->hasFlag(SectionEntry::kFlagInfo) && se->getImageSize() != 0)
+      return true;
+  }
+  return false;
+}
+
+//! \internal
+//!
+//! Get the protection of executable memory allocated by `VMemMgr`.
+static ASMJIT_INLINE uint32_t jitImageCodeProtection(JitRuntime* self) noexcept {
+  return self->_memMgr.isDualMappingEnabled()
+    ? uint32_t(OSUtils::kVMExecutable)
+    : uint32_t(OSUtils::kVMExecutable | OSUtils::kVMWritable);
+}
+
+//! \internal
+//!
+//! Get the size of the largest group of `code` laid out with the group stride
+//! of `pageSize` and the alignment of the image. Returns false if the image
+//! can't be packed into an arena.
+static bool jitImageGetPackedSize(const CodeHolder* code, size_t pageSize, size_t* sizeOut, size_t* codeSizeOut, size_t* alignmentOut) noexcept {
+  const ZoneVector<SectionEntry*>& sections = code->getSections();
+  size_t size = 0;
+  size_t codeSize = 0;
+  size_t alignment = 64;
+
+  for (size_t i = 0; i < sections.getLength(); i++) {
+    const SectionEntry* se = sections[i];
+    if (se->hasFlag(SectionEntry::kFlagInfo))
+      continue;
+
+    size_t offset = static_cast<size_t>(se->getOffset());
+    size_t end = offset + se->getImageSize();
+    alignment = std::max<size_t>(alignment, se->getAlignment());
+
+    if (se->hasFlag(SectionEntry::kFlagExec)) {
+      codeSize = std::max<size_t>(codeSize, end);
+    }
+    else {
+      size_t start = se->hasFlag(SectionEntry::kFlagConst) ? pageSize : pageSize * 2;
+      if (offset < start)
+        return false;
+      size = std::max<size_t>(size, end - start);
+    }
+  }
+
+  // Trampolines follow executable sections.
+  codeSize += code->getTrampolinesSize();
+  size = std::max<size_t>(size, codeSize);
+
+  if (size > pageSize || alignment > pageSize)
+    return false;
+
+  *sizeOut = size;
+  *codeSizeOut = codeSize;
+  *alignmentOut = alignment;
+  return true;
+}
+
+//! \internal
+//!
+//! Restore the protection of `arena` and return its memory to be released by
+//! `VMemMgr`, must be called with `_imageLock` held.
+static void* jitImageReleaseArena(JitRuntime* self, ImageArena* arena) noexcept {
+  void* allocated = arena->allocated;
+  OSUtils::protectVirtualMemory(arena->p + arena->pageSize, arena->pageSize * 2, jitImageCodeProtection(self));
+
+  self->_imageHeap.release(arena, sizeof(ImageArena));
+  return allocated;
+}
+
+//! \internal
+//!
+//! Add `code` into the current arena, or a new one if it doesn't fit. Called
+//! with `_imageLock` held, which also protects the read-only page while it's
+//! writable.
+static Error jitImageAddPacked(JitRuntime* self, ImageEntry* entry, CodeHolder* code, size_t pageSize, size_t size, size_t alignment, void** dst) noexcept {
+  ImageArena* arena = self->_imageArena;
+  size_t offset = arena ? Utils::alignTo<size_t>(arena->offset, alignment) : size_t(0);
+
+  if (!arena || arena->pageSize != pageSize || offset + size > pageSize) {
+    ImageArena* newArena = self->_imageHeap.allocT<ImageArena>();
+    if (ASMJIT_UNLIKELY(!newArena))
+      return DebugUtils::errored(kErrorNoHeapMemory);
+
+    uint8_t* allocated = static_cast<uint8_t*>(self->_memMgr.alloc(pageSize * 4, self->getAllocType()));
+    if (ASMJIT_UNLIKELY(!allocated)) {
+      self->_imageHeap.release(newArena, sizeof(ImageArena));
+      return DebugUtils::errored(kErrorNoVirtualMemory);
+    }
+
+    uint8_t* p = Utils::alignTo<uint8_t*>(allocated, pageSize);
+    Error err = OSUtils::protectVirtualMemory(p + pageSize, pageSize, 0);
+    if (!err)
+      err = OSUtils::protectVirtualMemory(p + pageSize * 2, pageSize, OSUtils::kVMWritable);
+
+    if (ASMJIT_UNLIKELY(err)) {
+      OSUtils::protectVirtualMemory(p + pageSize, pageSize * 2, jitImageCodeProtection(self));
+      self->_memMgr.release(allocated);
+      self->_imageHeap.release(newArena, sizeof(ImageArena));
+      return err;
+    }
+
+    newArena->allocated = allocated;
+    newArena->p = p;
+    newArena->pageSize = pageSize;
+    newArena->offset = 0;
+    newArena->count = 0;
+
+    // The previous arena is released by its last image.
+    if (arena && arena->count == 0)
+      self->_memMgr.release(jitImageReleaseArena(self, arena));
+
+    arena = newArena;
+    self->_imageArena = arena;
+    offset = 0;
+  }
+
+  uint8_t* p = arena->p + offset;
+  uint8_t* rw = static_cast<uint8_t*>(self->_memMgr.getWritablePtr(arena->allocated)) + (p - arena->allocated);
+
+  // The writable view of dual-mapped memory is never protected.
+  bool isDualMapped = self->_memMgr.isDualMappingEnabled();
+  if (!isDualMapped)
+    ASMJIT_PROPAGATE(OSUtils::protectVirtualMemory(arena->p + pageSize, pageSize, OSUtils::kVMWritable));
+
+  size_t relocSize = code->relocate(rw, static_cast<uint64_t>((uintptr_t)p));
+
+  Error err = kErrorOk;
+  if (!isDualMapped)
+    err = OSUtils::protectVirtualMemory(arena->p + pageSize, pageSize, 0);
+
+  if (ASMJIT_UNLIKELY(relocSize == 0))
+    return DebugUtils::errored(kErrorInvalidState);
+  ASMJIT_PROPAGATE(err);
+
+  arena->offset = offset + size;
+  arena->count++;
+
+  entry->_hVal = jitDedupHashAddress(p);
+  entry->p = p;
+  entry->allocated = nullptr;
+  entry->arena = arena;
+  entry->protectedStart = nullptr;
+  entry->protectedSize = 0;
+
+  self->_images.put(entry);
+  *dst = p;
+  return kErrorOk;
+}
+
+//! \internal
+//!
+//! Add `code` that has constant or writable sections. Its sections are
+//! placed to separate pages (see \ref CodeHolder::setGroupAlignment()) that
+//! are protected after the code is relocated. Images whose groups fit into
+//! a page are packed into arenas, so large pages are not used up by a small
+//! image.
+static Error jitImageAdd(JitRuntime* self, void** dst, CodeHolder* code, size_t* relocSizeOut) noexcept {
+  const VMemInfo& vmi = OSUtils::getVirtualMemoryInfo();
+  size_t pageSize = vmi.pageSize;
+
+  // Large pages can only be protected as a whole.
+  if (self->_memMgr.isLargePagesEnabled() && vmi.largePageSize != 0)
+    pageSize = vmi.largePageSize;
+
+  code->setGroupAlignment(static_cast<uint32_t>(pageSize));
+  code->setGroupStride(static_cast<uint32_t>(pageSize));
+  code->flatten();
+
+  size_t packedSize, packedCodeSize, packedAlignment;
+  if (jitImageGetPackedSize(code, pageSize, &packedSize, &packedCodeSize, &packedAlignment)) {
+    AutoLock locked(self->_imageLock);
+    ImageEntry* entry = self->_imageHeap.allocT<ImageEntry>();
+    if (ASMJIT_UNLIKELY(!entry))
+      return DebugUtils::errored(kErrorNoHeapMemory);
+
+    Error err = jitImageAddPacked(self, entry, code, pageSize, packedSize, packedAlignment, dst);
+    if (ASMJIT_UNLIKELY(err)) {
+      self->_imageHeap.release(entry, sizeof(ImageEntry));
+      return err;
+    }
+
+    // Only the code is reported, the data is in other pages.
+    *relocSizeOut = packedCodeSize;
+    return kErrorOk;
+  }
+
+  code->setGroupStride(0);
+  size_t codeSize = code->getCodeSize();
+
+  ImageEntry* entry;
+  {
+    AutoLock locked(self->_imageLock);
+    entry = self->_imageHeap.allocT<ImageEntry>();
+  }
+
+  if (ASMJIT_UNLIKELY(!entry))
+    return DebugUtils::errored(kErrorNoHeapMemory);
+
+  Error err = kErrorOk;
+  size_t imageSize = Utils::alignTo<size_t>(codeSize, pageSize);
+  uint8_t* allocated = static_cast<uint8_t*>(self->_memMgr.alloc(imageSize + pageSize, self->getAllocType()));
+
+  if (ASMJIT_UNLIKELY(!allocated)) {
+    err = DebugUtils::errored(kErrorNoVirtualMemory);
+  }
+  else {
+    uint8_t* p = Utils::alignTo<uint8_t*>(allocated, pageSize);
+    uint8_t* rw = static_cast<uint8_t*>(self->_memMgr.getWritablePtr(allocated)) + (p - allocated);
+
+    size_t relocSize = code->relocate(rw, static_cast<uint64_t>((uintptr_t)p));
+    if (ASMJIT_UNLIKELY(relocSize == 0)) {
+      err = DebugUtils::errored(kErrorInvalidState);
+    }
+    else {
+      // Sections of each group are contiguous and groups are page aligned.
+      const ZoneVector<SectionEntry*>& sections = code->getSections();
+      size_t constStart = imageSize;
+      size_t writableStart = imageSize;
+
+      for (size_t i = 1; i < sections.getLength(); i++) {
+        const SectionEntry* se = sections[i];
+        if (se->hasFlag(SectionEntry::kFlagExec) || se->hasFlag(SectionEntry::kFlagInfo) || se->getImageSize() == 0)
+          continue;
+
+        size_t offset = static_cast<size_t>(se->getOffset());
+        if (se->hasFlag(SectionEntry::kFlagConst))
+          constStart = std::min(constStart, offset);
+        else
+          writableStart = std::min(writableStart, offset);
+      }
+
+      if (constStart < writableStart)
+        err = OSUtils::protectVirtualMemory(p + constStart, writableStart - constStart, 0);
+
+      if (!err && writableStart < imageSize)
+        err = OSUtils::protectVirtualMemory(p + writableStart, imageSize - writableStart, OSUtils::kVMWritable);
+
+      size_t protectedStart = std::min(constStart, writableStart);
+      if (ASMJIT_UNLIKELY(err)) {
+        OSUtils::protectVirtualMemory(p + protectedStart, imageSize - protectedStart, jitImageCodeProtection(self));
+      }
+      else {
+        entry->_hVal = jitDedupHashAddress(p);
+        entry->p = p;
+        entry->allocated = allocated;
+        entry->arena = nullptr;
+        entry->protectedStart = p + protectedStart;
+        entry->protectedSize = imageSize - protectedStart;
+
+        AutoLock locked(self->_imageLock);
+        self->_images.put(entry);
+
+        *dst = p;
+        *relocSizeOut = relocSize;
+        return kErrorOk;
+      }
+    }
+
+    self->_memMgr.release(allocated);
+  }
+
+  AutoLock locked(self->_imageLock);
+  self->_imageHeap.release(entry, sizeof(ImageEntry));
+  return err;
+}
+
+//! \internal
+//!
+//! Restore the protection of image `p` and return the memory to be released
+//! by `VMemMgr`, which is `p` itself if it's not an image.
+static void* jitImageRelease(JitRuntime* self, void* p) noexcept {
+  AutoLock locked(self->_imageLock);
+  if (self->_images.getSize() == 0)
+    return p;
+
+  ImageEntry* entry = self->_images.get(JitImageByAddress(p));
+  if (!entry)
+    return p;
+
+  void* allocated = entry->allocated;
+  ImageArena* arena = entry->arena;
+
+  if (arena) {
+    // The current arena is kept and reused when it's empty.
+    if (--arena->count == 0) {
+      if (arena == self->_imageArena)
+        arena->offset = 0;
+      else
+        allocated = jitImageReleaseArena(self, arena);
+    }
+  }
+  else {
+    OSUtils::protectVirtualMemory(entry->protectedStart, entry->protectedSize, jitImageCodeProtection(self));
+  }
+
+  self->_images.del(entry);
+  self->_imageHeap.release(entry, sizeof(ImageEntry));
+  return allocated;
+}
+
+// ============================================================================
+// [asmjit::JitRuntime - Streams]
+// ============================================================================
+
+//! \internal
+//!
+//! Memory used as the buffer of the first section of a `CodeHolder`.
+struct JitRuntime::StreamEntry : public ZoneHashNode {
+  CodeHolder* code;                      // Streamed code.
+  uint8_t* p;                            // Executable memory.
+  uint8_t* rw;                           // Writable view of `p`.
+  size_t capacity;                       // Size of `p`.
+};
+
+typedef JitRuntime::StreamEntry StreamEntry;
+
+//! \internal
+//!
+//! Key that matches a stream by its `CodeHolder`.
+class JitStreamByCode {
+public:
+  ASMJIT_INLINE JitStreamByCode(const CodeHolder* code) noexcept
+    : hVal(jitDedupHashAddress(code)),
+      code(code) {}
+
+  ASMJIT_INLINE bool matches(const StreamEntry* entry) const noexcept {
+    return entry->code == code;
+  }
+
+  uint32_t hVal;
+  const CodeHolder* code;
+};
+
+//! \internal
+//!
+//! Remove the stream of `code` and store its memory to `out`, returns false
+//! if `code` is not streamed.
+static bool jitStreamDetach(JitRuntime* self, CodeHolder* code, StreamEntry* out) noexcept {
+  AutoLock locked(self->_imageLock);
+  if (self->_streams.getSize() == 0)
+    return false;
+
+  StreamEntry* entry = self->_streams.get(JitStreamByCode(code));
+  if (!entry)
+    return false;
+
+  *out = *entry;
+  code->_streamRuntime = nullptr;
+
+  self->_streams.del(entry);
+  self->_imageHeap.release(entry, sizeof(StreamEntry));
+  return true;
+}
+
+//! \internal
+//!
+//! Move the first section of `code` to a heap buffer if it's still `stream`.
+static Error jitStreamMoveToHeap(CodeHolder* code, const StreamEntry& stream) noexcept {
+  CodeBuffer& buffer = code->_sections[0]->_buffer;
+  if (buffer._data != stream.rw)
+    return kErrorOk;
+
+  // Growing an external buffer copies it to a buffer owned by `code`.
+  return code->growBuffer(&buffer, buffer._capacity - buffer._length + 1);
+}
+
 // ============================================================================
 // [asmjit::JitRuntime - Construction / Destruction]
 // ============================================================================
 
-JitRuntime::JitRuntime() noexcept {}
-JitRuntime::~JitRuntime() noexcept {}
+static volatile size_t jitEpochSerialCounter;
+
+JitRuntime::JitRuntime() noexcept
+  : _listener(nullptr),
+    _epoch(2),
+    _epochSerial(AtomicUtils::fetchAdd(&jitEpochSerialCounter, 1) + 1),
+    _epochRecords(nullptr),
+    _retired(nullptr),
+    _retiredCount(0),
+    _dedupEnabled(false),
+    _dedupZone(8192 - Zone::kZoneOverhead),
+    _dedupHeap(&_dedupZone),
+    _dedupByCode(&_dedupHeap),
+    _dedupByAddress(&_dedupHeap),
+    _dedupHitsCount(0),
+    _dedupSavedSize(0),
+    _frameZone(8192 - Zone::kZoneOverhead),
+    _frameHeap(&_frameZone),
+    _frames(&_frameHeap),
+    _imageZone(8192 - Zone::kZoneOverhead),
+    _imageHeap(&_imageZone),
+    _images(&_imageHeap),
+    _streams(&_imageHeap),
+    _imageArena(nullptr) {}
+
+JitRuntime::~JitRuntime() noexcept {
+  EpochRecord* record = _epochRecords;
+  while (record) {
+    EpochRecord* next = record->next;
+    Internal::releaseMemory(record);
+    record = next;
+  }
+
+  // Retired code is released by `_memMgr`.
+  RetiredEntry* entry = _retired;
+  while (entry) {
+    RetiredEntry* next = entry->next;
+    Internal::releaseMemory(entry);
+    entry = next;
+  }
+
+  // Streamed memory is released by `_memMgr`, holders must not refer to the
+  // runtime anymore.
+  for (uint32_t i = 0; i < _streams._bucketsCount; i++) {
+    for (ZoneHashNode* node = _streams._data[i]; node; node = node->_hashNext)
+      static_cast<StreamEntry*>(node)->code->_streamRuntime = nullptr;
+  }
+
+  // Code is released by `_memMgr`, but its unwind information must be
+  // deregistered here.
+#if ASMJIT_RUNTIME_EH_FRAME
+  for (uint32_t i = 0; i < _frames._bucketsCount; i++) {
+    for (ZoneHashNode* node = _frames._data[i]; node; node = node->_hashNext) {
+      void* ehFrame = static_cast<FrameEntry*>(node)->ehFrame;
+      __deregister_frame(ehFrame);
+      Internal::releaseMemory(ehFrame);
+    }
+  }
+#endif
+}
 
 // ============================================================================
 // [asmjit::JitRuntime - Interface]
@@ -114,14 +1037,93 @@ Error JitRuntime::_add(void** dst, CodeHolder* code) noexcept {
     return DebugUtils::errored(kErrorNoCodeGenerated);
   }
 
+  // Streamed code is relocated in place if it fits, otherwise it's copied as
+  // any other code.
+  StreamEntry stream;
+  if (jitStreamDetach(this, code, &stream)) {
+    CodeBuffer& buffer = code->_sections[0]->_buffer;
+    if (buffer._data == stream.rw && codeSize <= stream.capacity && !jitImageHasData(code)) {
+      size_t relocSize = code->relocate(stream.rw, static_cast<uint64_t>((uintptr_t)stream.p));
+      Error err = relocSize ? jitFrameRegister(this, stream.p, relocSize, code)
+                            : DebugUtils::errored(kErrorInvalidState);
+
+      if (ASMJIT_UNLIKELY(err)) {
+        *dst = nullptr;
+        jitStreamMoveToHeap(code, stream);
+        _memMgr.release(stream.p);
+        return err;
+      }
+
+      if (relocSize < stream.capacity)
+        _memMgr.shrink(stream.p, relocSize);
+
+      // The rest of the memory has been released.
+      code->fixBufferSize(code->_sections[0]);
+
+      flush(stream.p, relocSize);
+      *dst = stream.p;
+
+      if (_listener)
+        _listener->onCodeAdded(stream.p, relocSize, code);
+      return kErrorOk;
+    }
+
+    Error err = jitStreamMoveToHeap(code, stream);
+    _memMgr.release(stream.p);
+
+    if (ASMJIT_UNLIKELY(err)) {
+      *dst = nullptr;
+      return err;
+    }
+  }
+
+  // Code with constant or writable sections is never shared.
+  if (jitImageHasData(code)) {
+    void* p = nullptr;
+    size_t relocSize = 0;
+
+    Error err = jitImageAdd(this, &p, code, &relocSize);
+    if (!err) {
+      err = jitFrameRegister(this, p, relocSize, code);
+      if (ASMJIT_UNLIKELY(err))
+        _memMgr.release(jitImageRelease(this, p));
+    }
+
+    if (ASMJIT_UNLIKELY(err)) {
+      *dst = nullptr;
+      return err;
+    }
+
+    flush(p, relocSize);
+    *dst = p;
+
+    if (_listener)
+      _listener->onCodeAdded(p, relocSize, code);
+    return kErrorOk;
+  }
+
+  uint32_t hVal = 0;
+  if (_dedupEnabled) {
+    hVal = jitDedupHashCode(code);
+
+    void* shared = jitDedupAcquire(this, code, codeSize, hVal);
+    if (shared) {
+      *dst = shared;
+      return kErrorOk;
+    }
+  }
+
   void* p = _memMgr.alloc(codeSize, getAllocType());
   if (ASMJIT_UNLIKELY(!p)) {
     *dst = nullptr;
     return DebugUtils::errored(kErrorNoVirtualMemory);
   }
 
-  // Relocate the code and release the unused memory back to `VMemMgr`.
-  size_t relocSize = code->relocate(p);
+  // Relocate the code and release the unused memory back to `VMemMgr`. If the
+  // memory is dual-mapped the code is written through the writable view, but
+  // relocated to the executable address `p`.
+  void* rw = _memMgr.getWritablePtr(p);
+  size_t relocSize = code->relocate(rw, static_cast<uint64_t>((uintptr_t)p));
   if (ASMJIT_UNLIKELY(relocSize == 0)) {
     *dst = nullptr;
     _memMgr.release(p);
@@ -131,15 +1133,531 @@ Error JitRuntime::_add(void** dst, CodeHolder* code) noexcept {
   if (relocSize < codeSize)
     _memMgr.shrink(p, relocSize);
 
+  Error err = jitFrameRegister(this, p, relocSize, code);
+  if (ASMJIT_UNLIKELY(err)) {
+    *dst = nullptr;
+    _memMgr.release(p);
+    return err;
+  }
+
   flush(p, relocSize);
   *dst = p;
 
+  if (_listener)
+    _listener->onCodeAdded(p, relocSize, code);
+
+  if (_dedupEnabled)
+    jitDedupInsert(this, p, relocSize, hVal);
+
   return kErrorOk;
 }
 
 Error JitRuntime::_release(void* p) noexcept {
-  return _memMgr.release(p);
+  // A shared function is released by the last `release()`.
+  if (_dedupEnabled && jitDedupRelease(this, p))
+    return kErrorOk;
+
+  AutoLock locked(_epochLock);
+
+  // Pairs with the fence in `enterReadSection()` - either the reader's state
+  // is visible here, or the reader can't see the unpublished function.
+  AtomicUtils::fence();
+  if (!jitEpochHasReaders(this)) {
+    jitEpochReclaim(this, true);
+    jitFrameRelease(this, p);
+    return _memMgr.release(jitImageRelease(this, p));
+  }
+
+  RetiredEntry* entry = static_cast<RetiredEntry*>(Internal::allocMemory(sizeof(RetiredEntry)));
+  if (ASMJIT_UNLIKELY(!entry))
+    return DebugUtils::errored(kErrorNoHeapMemory);
+
+  entry->next = _retired;
+  entry->p = p;
+  entry->epoch = _epoch;
+
+  _retired = entry;
+  _retiredCount++;
+
+  jitEpochTryAdvance(this);
+  jitEpochReclaim(this, false);
+  return kErrorOk;
+}
+
+// ============================================================================
+// [asmjit::JitRuntime - Reclamation]
+// ============================================================================
+
+Error JitRuntime::enterReadSection() noexcept {
+  EpochRecord* record = jitEpochGetRecord(this, true);
+  if (ASMJIT_UNLIKELY(!record))
+    return DebugUtils::errored(kErrorNoHeapMemory);
+
+  if (record->depth++ == 0) {
+    AtomicUtils::store(&record->state, AtomicUtils::load(&_epoch) | 1);
+    // The state must be visible before the reader loads any function pointer.
+    AtomicUtils::fence();
+  }
+
+  return kErrorOk;
+}
+
+void JitRuntime::leaveReadSection() noexcept {
+  EpochRecord* record = jitEpochGetRecord(this, false);
+  if (ASMJIT_UNLIKELY(!record || record->depth == 0))
+    return;
+
+  if (--record->depth == 0)
+    AtomicUtils::store(&record->state, 0);
+}
+
+void JitRuntime::reclaim() noexcept {
+  AutoLock locked(_epochLock);
+  AtomicUtils::fence();
+
+  if (!jitEpochHasReaders(this)) {
+    jitEpochReclaim(this, true);
+  }
+  else {
+    jitEpochTryAdvance(this);
+    jitEpochReclaim(this, false);
+  }
+}
+
+Error JitRuntime::setDedupEnabled(bool enabled) noexcept {
+  AutoLock locked(_dedupLock);
+
+  if (!enabled && _dedupByAddress.getSize() != 0)
+    return DebugUtils::errored(kErrorInvalidState);
+
+  _dedupEnabled = enabled;
+  return kErrorOk;
+}
+
+Error JitRuntime::beginStream(CodeHolder* code, size_t capacity) noexcept {
+  if (ASMJIT_UNLIKELY(!code->isInitialized() || capacity == 0))
+    return DebugUtils::errored(kErrorInvalidArgument);
+
+  AutoLock locked(_imageLock);
+  if (ASMJIT_UNLIKELY(_streams.get(JitStreamByCode(code))))
+    return DebugUtils::errored(kErrorInvalidState);
+
+  StreamEntry* entry = _imageHeap.allocT<StreamEntry>();
+  if (ASMJIT_UNLIKELY(!entry))
+    return DebugUtils::errored(kErrorNoHeapMemory);
+
+  uint8_t* p = static_cast<uint8_t*>(_memMgr.alloc(capacity, getAllocType()));
+  if (ASMJIT_UNLIKELY(!p)) {
+    _imageHeap.release(entry, sizeof(StreamEntry));
+    return DebugUtils::errored(kErrorNoVirtualMemory);
+  }
+
+  uint8_t* rw = static_cast<uint8_t*>(_memMgr.getWritablePtr(p));
+  Error err = code->setExternalBuffer(code->_sections[0], rw, capacity);
+
+  if (ASMJIT_UNLIKELY(err)) {
+    _memMgr.release(p);
+    _imageHeap.release(entry, sizeof(StreamEntry));
+    return err;
+  }
+
+  entry->_hVal = jitDedupHashAddress(code);
+  entry->code = code;
+  entry->p = p;
+  entry->rw = rw;
+  entry->capacity = capacity;
+
+  _streams.put(entry);
+  code->_streamRuntime = this;
+  return kErrorOk;
+}
+
+Error JitRuntime::cancelStream(CodeHolder* code) noexcept {
+  StreamEntry stream;
+  if (!jitStreamDetach(this, code, &stream))
+    return kErrorOk;
+
+  Error err = jitStreamMoveToHeap(code, stream);
+  _memMgr.release(stream.p);
+  return err;
+}
+
+void JitRuntime::_releaseStream(CodeHolder* code) noexcept {
+  StreamEntry stream;
+  if (jitStreamDetach(this, code, &stream))
+    _memMgr.release(stream.p);
+}
+
+Error JitRuntime::reserveCodeRegion(size_t size, const void* hint) noexcept {
+  _codeInfo.resetCodeRegion();
+  ASMJIT_PROPAGATE(_memMgr.reserveRegion(size, hint));
+
+  _codeInfo.setCodeRegion(static_cast<uint64_t>((uintptr_t)_memMgr.getRegionStart()), _memMgr.getRegionSize());
+  return kErrorOk;
+}
+
+Error JitRuntime::releaseCodeRegion() noexcept {
+  ASMJIT_PROPAGATE(_memMgr.releaseRegion());
+
+  _codeInfo.resetCodeRegion();
+  return kErrorOk;
+}
+
+Error JitRuntime::addBatch(CodeHolder** holders, size_t count, void** out) noexcept {
+  // Functions are aligned to a cache line, which is also the granularity of
+  // `VMemMgr`, so the region can be split at function boundaries.
+  static const size_t kBatchAlignment = 64;
+
+  size_t i;
+  size_t totalSize = 0;
+  bool hasImages = false;
+
+  // Streamed holders are relocated in place by `_add()`.
+  {
+    AutoLock locked(_imageLock);
+    if (_streams.getSize() != 0) {
+      for (i = 0; i < count && !hasImages; i++)
+        hasImages = _streams.get(JitStreamByCode(holders[i])) != nullptr;
+    }
+  }
+
+  for (i = 0; i < count; i++) {
+    out[i] = nullptr;
+
+    size_t codeSize = holders[i]->getCodeSize();
+    if (ASMJIT_UNLIKELY(codeSize == 0))
+      return DebugUtils::errored(kErrorNoCodeGenerated);
+
+    hasImages |= jitImageHasData(holders[i]);
+    totalSize = Utils::alignTo(totalSize, kBatchAlignment) + codeSize;
+  }
+
+  if (count == 0)
+    return kErrorOk;
+
+  uint32_t allocType = getAllocType();
+  bool freeable = allocType != VMemMgr::kAllocPermanent;
+  Error err = kErrorOk;
+
+  uint8_t* p;
+  uint8_t* rw;
+  size_t offset;
+
+  // Images need their own pages and streams are relocated in place.
+  if (hasImages)
+    goto _AddEach;
+
+  p = static_cast<uint8_t*>(_memMgr.alloc(totalSize, allocType));
+  if (ASMJIT_UNLIKELY(!p))
+    return DebugUtils::errored(kErrorNoVirtualMemory);
+
+  rw = static_cast<uint8_t*>(_memMgr.getWritablePtr(p));
+  offset = 0;
+
+  for (i = 0; i < count; i++) {
+    CodeHolder* code = holders[i];
+    size_t codeSize = code->getCodeSize();
+    size_t nextOffset = Utils::alignTo(offset + codeSize, kBatchAlignment);
+
+    // Split the rest of the region, so each function is a separate allocation.
+    if (freeable && i + 1 < count) {
+      err = _memMgr.split(p + offset, nextOffset - offset);
+      if (ASMJIT_UNLIKELY(err)) {
+        _memMgr.release(p + offset);
+
+        // Served by a thread cache, add the holders one by one.
+        if (i == 0 && err == kErrorInvalidState)
+          goto _AddEach;
+        goto _Failed;
+      }
+    }
+
+    size_t relocSize = code->relocate(rw + offset, static_cast<uint64_t>((uintptr_t)(p + offset)));
+    if (ASMJIT_UNLIKELY(relocSize == 0)) {
+      if (freeable) {
+        _memMgr.release(p + offset);
+        if (i + 1 < count)
+          _memMgr.release(p + nextOffset);
+      }
+
+      err = DebugUtils::errored(kErrorInvalidState);
+      goto _Failed;
+    }
+
+    // Release the unused memory of this function back to `VMemMgr`.
+    if (freeable && relocSize < codeSize)
+      _memMgr.shrink(p + offset, relocSize);
+
+    err = jitFrameRegister(this, p + offset, relocSize, code);
+    if (ASMJIT_UNLIKELY(err)) {
+      if (freeable) {
+        _memMgr.release(p + offset);
+        if (i + 1 < count)
+          _memMgr.release(p + nextOffset);
+      }
+      goto _Failed;
+    }
+
+    if (_listener)
+      _listener->onCodeAdded(p + offset, relocSize, code);
+
+    out[i] = p + offset;
+    offset = nextOffset;
+  }
+
+  flush(p, totalSize);
+  return kErrorOk;
+
+_AddEach:
+  for (i = 0; i < count; i++) {
+    err = _add(&out[i], holders[i]);
+    if (ASMJIT_UNLIKELY(err)) goto _Failed;
+  }
+  return kErrorOk;
+
+_Failed:
+  // Code added by `_add()` can be shared or already running, release it the
+  // same way as `release()` does.
+  for (i = 0; i < count; i++) {
+    if (out[i])
+      _release(out[i]);
+    out[i] = nullptr;
+  }
+  return err;
+}
+
+// ============================================================================
+// [asmjit::JitRuntime - Test]
+// ============================================================================
+
+#if defined(ASMJIT_TEST)
+UNIT(base_runtime_reclaim) {
+  JitRuntime rt;
+  VMemMgr* memmgr = rt.getMemMgr();
+
+  // Released immediately if there are no readers.
+  void* a = memmgr->alloc(64);
+  void* b = memmgr->alloc(64);
+  EXPECT(a != nullptr && b != nullptr, "Couldn't allocate virtual memory");
+  EXPECT(rt.release(a) == kErrorOk, "Failed to release %p", a);
+  EXPECT(rt.getRetiredCount() == 0, "Code should be released immediately");
+
+  // Retired while a reader is inside a (nested) section.
+  EXPECT(rt.enterReadSection() == kErrorOk, "Failed to enter a read-side section");
+  EXPECT(rt.enterReadSection() == kErrorOk, "Failed to enter a read-side section");
+
+  a = memmgr->alloc(64);
+  EXPECT(rt.release(a) == kErrorOk, "Failed to release %p", a);
+  EXPECT(rt.getRetiredCount() == 1, "Code should be retired");
+
+  rt.leaveReadSection();
+  rt.reclaim();
+  EXPECT(rt.getRetiredCount() == 1, "Code can't be released inside a section");
+
+  rt.leaveReadSection();
+  rt.reclaim();
+  EXPECT(rt.getRetiredCount() == 0, "Code should be released after the reader left");
+
+  // A grace period elapses even if the reader keeps entering new sections.
+  rt.enterReadSection();
+  EXPECT(rt.release(b) == kErrorOk, "Failed to release %p", b);
+  EXPECT(rt.getRetiredCount() == 1, "Code should be retired");
+
+  for (uint32_t i = 0; i < 2; i++) {
+    rt.leaveReadSection();
+    rt.enterReadSection();
+    rt.reclaim();
+  }
+
+  EXPECT(rt.getRetiredCount() == 0, "Code should be released after a grace period");
+  EXPECT(memmgr->getUsedBytes() == 0, "All memory should be released");
+  rt.leaveReadSection();
+}
+
+static void JitRuntimeTest_initCode(CodeHolder& code, const uint8_t* data, size_t size) {
+  code.init(CodeInfo(ArchInfo::kTypeHost));
+
+  CodeBuffer& buffer = code._sections[0]->_buffer;
+  code.reserveBuffer(&buffer, size);
+  ::memcpy(buffer._data, data, size);
+  buffer._length = size;
+}
+
+UNIT(base_runtime_dedup) {
+  static const uint8_t kCodeA[] = { 0x90, 0x90, 0xC3 };
+  static const uint8_t kCodeB[] = { 0x90, 0xC3 };
+
+  JitRuntime rt;
+  VMemMgr* memmgr = rt.getMemMgr();
+  EXPECT(rt.setDedupEnabled(true) == kErrorOk, "Failed to enable deduplication");
+
+  CodeHolder codeA1, codeA2, codeB;
+  JitRuntimeTest_initCode(codeA1, kCodeA, sizeof(kCodeA));
+  JitRuntimeTest_initCode(codeA2, kCodeA, sizeof(kCodeA));
+  JitRuntimeTest_initCode(codeB, kCodeB, sizeof(kCodeB));
+
+  void* a1;
+  void* a2;
+  void* b;
+
+  EXPECT(rt._add(&a1, &codeA1) == kErrorOk, "Failed to add code");
+  EXPECT(rt._add(&a2, &codeA2) == kErrorOk, "Failed to add code");
+  EXPECT(rt._add(&b, &codeB) == kErrorOk, "Failed to add code");
+
+  EXPECT(a1 == a2, "Identical code should be shared");
+  EXPECT(a1 != b, "Different code must not be shared");
+  EXPECT(rt.getDedupHitsCount() == 1, "Expected 1 hit, got %u", static_cast<unsigned int>(rt.getDedupHitsCount()));
+  EXPECT(rt.getDedupSavedSize() == sizeof(kCodeA), "Expected %u bytes saved, got %u",
+    static_cast<unsigned int>(sizeof(kCodeA)), static_cast<unsigned int>(rt.getDedupSavedSize()));
+
+  // Shared code is released by the last `release()`.
+  EXPECT(rt.release(a1) == kErrorOk, "Failed to release %p", a1);
+  EXPECT(::memcmp(a2, kCodeA, sizeof(kCodeA)) == 0, "Shared code should still be valid");
+  EXPECT(rt.getDedupSavedSize() == 0, "No bytes should be saved");
+  EXPECT(rt.setDedupEnabled(false) == kErrorInvalidState, "Shared code still exists");
+
+  // A failed batch releases only its own reference of shared code. The image
+  // makes `addBatch()` add the holders one by one (its data is larger than a
+  // page, so it's not packed into an arena that would outlive it), and the
+  // relocation with an invalid section makes the last one fail.
+  size_t dataSize = OSUtils::getVirtualMemoryInfo().pageSize + 1;
+
+  CodeHolder codeA3, codeImage, codeInvalid;
+  JitRuntimeTest_initCode(codeA3, kCodeA, sizeof(kCodeA));
+  JitRuntimeTest_initCode(codeImage, kCodeB, sizeof(kCodeB));
+  JitRuntimeTest_initCode(codeInvalid, kCodeB, sizeof(kCodeB));
+
+  SectionEntry* data;
+  EXPECT(codeImage.newSection(&data, ".data", Globals::kInvalidIndex, 0, 8) == kErrorOk, "Failed to create a section");
+  codeImage.reserveBuffer(&data->_buffer, dataSize);
+  ::memset(data->_buffer._data, 0, dataSize);
+  data->_buffer._length = dataSize;
+
+  RelocEntry* re;
+  EXPECT(codeInvalid.newRelocEntry(&re, RelocEntry::kTypeAbsToAbs, 4) == kErrorOk, "Failed to create a relocation");
+  re->_sourceSectionId = 100;
+
+  CodeHolder* holders[] = { &codeA3, &codeImage, &codeInvalid };
+  void* out[ASMJIT_ARRAY_SIZE(holders)];
+
+  EXPECT(rt.addBatch(holders, ASMJIT_ARRAY_SIZE(holders), out) != kErrorOk, "The batch should fail");
+  EXPECT(out[0] == nullptr && out[1] == nullptr && out[2] == nullptr, "A failed batch should return no code");
+  EXPECT(rt.getDedupHitsCount() == 2, "Expected 2 hits, got %u", static_cast<unsigned int>(rt.getDedupHitsCount()));
+  EXPECT(rt.getDedupSavedSize() == 0, "The reference of the batch should be released");
+  EXPECT(::memcmp(a2, kCodeA, sizeof(kCodeA)) == 0, "Shared code should still be valid");
+
+  EXPECT(rt.release(a2) == kErrorOk, "Failed to release %p", a2);
+  EXPECT(rt.release(b) == kErrorOk, "Failed to release %p", b);
+  EXPECT(memmgr->getUsedBytes() == 0, "All memory should be released");
+  EXPECT(rt.setDedupEnabled(false) == kErrorOk, "Failed to disable deduplication");
+}
+
+UNIT(base_runtime_images) {
+  static const uint8_t kCode[] = { 0xC3 };
+  static const uint32_t kNumImages = 3;
+
+  JitRuntime rt;
+  VMemMgr* memmgr = rt.getMemMgr();
+  size_t pageSize = OSUtils::getVirtualMemoryInfo().pageSize;
+
+  void* p[kNumImages];
+  size_t usedBytes = 0;
+
+  for (uint32_t round = 0; round < 2; round++) {
+    for (uint32_t i = 0; i < kNumImages; i++) {
+      CodeHolder code;
+      JitRuntimeTest_initCode(code, kCode, sizeof(kCode));
+
+      SectionEntry* rodata;
+      SectionEntry* data;
+      EXPECT(code.newSection(&rodata, ".rodata", Globals::kInvalidIndex, SectionEntry::kFlagConst, 16) == kErrorOk &&
+             code.newSection(&data, ".data", Globals::kInvalidIndex, 0, 8) == kErrorOk, "Failed to create sections");
+
+      code.reserveBuffer(&rodata->_buffer, 4);
+      ::memcpy(rodata->_buffer._data, &i, 4);
+      rodata->_buffer._length = 4;
+
+      code.reserveBuffer(&data->_buffer, 4);
+      ::memset(data->_buffer._data, 0, 4);
+      data->_buffer._length = 4;
+
+      void* func;
+      EXPECT(rt._add(&func, &code) == kErrorOk, "Failed to add code");
+      EXPECT(rodata->getOffset() == pageSize && data->getOffset() == pageSize * 2, "Data should be in the next pages");
+
+      uint32_t value;
+      ::memcpy(&value, static_cast<uint8_t*>(func) + pageSize, 4);
+      EXPECT(value == i, "Constant data of image #%u should be %u, got %u", i, i, value);
+
+      if (round == 0) {
+        p[i] = func;
+        if (i == 0) usedBytes = memmgr->getUsedBytes();
+      }
+      else {
+        EXPECT(p[i] == func, "An empty arena should be reused");
+      }
+    }
+
+    EXPECT(static_cast<uint8_t*>(p[1]) - static_cast<uint8_t*>(p[0]) == 64, "Small images should be packed");
+    EXPECT(memmgr->getUsedBytes() == usedBytes, "Small images should share an arena");
+
+    for (uint32_t i = 0; i < kNumImages; i++)
+      EXPECT(rt.release(p[i]) == kErrorOk, "Failed to release %p", p[i]);
+  }
+}
+
+UNIT(base_runtime_stream) {
+  static const uint8_t kCode[] = { 0x90, 0xC3 };
+
+  JitRuntime rt;
+  VMemMgr* memmgr = rt.getMemMgr();
+
+  CodeHolder code;
+  code.init(CodeInfo(ArchInfo::kTypeHost));
+  EXPECT(rt.beginStream(&code, 256) == kErrorOk, "Failed to begin a stream");
+  EXPECT(rt.beginStream(&code, 256) == kErrorInvalidState, "Code is already streamed");
+
+  CodeBuffer& buffer = code._sections[0]->_buffer;
+  uint8_t* streamData = buffer._data;
+  ::memcpy(buffer._data, kCode, sizeof(kCode));
+  buffer._length = sizeof(kCode);
+
+  void* p;
+  EXPECT(rt._add(&p, &code) == kErrorOk, "Failed to add code");
+  EXPECT(buffer._data == streamData, "Streamed code should not be moved");
+  EXPECT(memmgr->getWritablePtr(p) == streamData, "Streamed code should be relocated in place");
+  EXPECT(buffer._isFixedSize && buffer._capacity == sizeof(kCode), "Buffer should be fixed to the code size");
+  EXPECT(rt.release(p) == kErrorOk, "Failed to release %p", p);
+
+  // A cancelled stream keeps its content in a buffer owned by `CodeHolder`.
+  CodeHolder cancelled;
+  cancelled.init(CodeInfo(ArchInfo::kTypeHost));
+  EXPECT(rt.beginStream(&cancelled, 256) == kErrorOk, "Failed to begin a stream");
+
+  CodeBuffer& cancelledBuffer = cancelled._sections[0]->_buffer;
+  ::memcpy(cancelledBuffer._data, kCode, sizeof(kCode));
+  cancelledBuffer._length = sizeof(kCode);
+
+  EXPECT(rt.cancelStream(&cancelled) == kErrorOk, "Failed to cancel a stream");
+  EXPECT(!cancelledBuffer._isExternal, "Buffer should be owned by CodeHolder");
+  EXPECT(::memcmp(cancelledBuffer._data, kCode, sizeof(kCode)) == 0, "Content should be preserved");
+  EXPECT(memmgr->getUsedBytes() == 0, "All memory should be released");
+
+  // A stream is released when its `CodeHolder` is reset or destroyed.
+  {
+    CodeHolder dropped;
+    dropped.init(CodeInfo(ArchInfo::kTypeHost));
+    EXPECT(rt.beginStream(&dropped, 256) == kErrorOk, "Failed to begin a stream");
+
+    dropped.reset();
+    EXPECT(memmgr->getUsedBytes() == 0, "Memory of a reset stream should be released");
+
+    dropped.init(CodeInfo(ArchInfo::kTypeHost));
+    EXPECT(rt.beginStream(&dropped, 256) == kErrorOk, "Failed to begin a stream after reset");
+  }
+  EXPECT(memmgr->getUsedBytes() == 0, "Memory of a destroyed stream should be released");
 }
+#endif // ASMJIT_TEST
 
 } // asmjit namespace
 
@@ -91,6 +91,10 @@ public:
   //! The beginning of the memory allocated for the function is returned in
   //! `dst`. If failed the \ref Error code is returned and `dst` is set to null
   //! (this means that you don't have to set it to null before calling `add()`).
+  //!
+  //! \ref JitRuntime places constant and writable sections of `code` (see
+  //! \ref CodeHolder::newSection()) to their own pages after the code, which
+  //! are not executable and, in case of constant sections, not writable.
   virtual Error _add(void** dst, CodeHolder* code) noexcept = 0;
 
   //! Release `p` allocated by `add()`.
@@ -142,6 +146,36 @@ public:
   ASMJIT_API virtual void flush(const void* p, size_t size) noexcept;
 };
 
+// ============================================================================
+// [asmjit::JitListener]
+// ============================================================================
+
+//! Listener of code added to \ref JitRuntime, used by profilers and debuggers.
+//!
+//! See \ref PerfListener, which makes code visible to Linux `perf`.
+class ASMJIT_VIRTAPI JitListener {
+public:
+  ASMJIT_NONCOPYABLE(JitListener)
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  //! Create a `JitListener` instance.
+  ASMJIT_API JitListener() noexcept;
+  //! Destroy the `JitListener` instance.
+  ASMJIT_API virtual ~JitListener() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Interface]
+  // --------------------------------------------------------------------------
+
+  //! Called after `code` has been relocated to `p`, `size` is the size of the
+  //! relocated code (including trampolines). Can be called concurrently if
+  //! the runtime is used by multiple threads.
+  virtual void onCodeAdded(const void* p, size_t size, const CodeHolder* code) noexcept = 0;
+};
+
 // ============================================================================
 // [asmjit::JitRuntime]
 // ============================================================================
@@ -172,6 +206,31 @@ public:
   //! Get the virtual memory manager.
   ASMJIT_INLINE VMemMgr* getMemMgr() const noexcept { return const_cast<VMemMgr*>(&_memMgr); }
 
+  //! Get the size of memory arenas the code is allocated from.
+  ASMJIT_INLINE size_t getArenaSize() const noexcept { return _memMgr.getBlockSize(); }
+  //! Get whether the code is allocated from large page arenas.
+  ASMJIT_INLINE bool isLargePagesEnabled() const noexcept { return _memMgr.isLargePagesEnabled(); }
+  //! Enable or disable large page arenas, see \ref VMemMgr::setLargePagesEnabled().
+  ASMJIT_INLINE Error setLargePagesEnabled(bool enabled) noexcept { return _memMgr.setLargePagesEnabled(enabled); }
+
+  //! Get the listener notified about added code, null if none.
+  ASMJIT_INLINE JitListener* getListener() const noexcept { return _listener; }
+  //! Set the listener notified about added code, null to remove it.
+  //!
+  //! The listener is not owned by the runtime. Must not be called concurrently
+  //! with `add()`.
+  ASMJIT_INLINE void setListener(JitListener* listener) noexcept { _listener = listener; }
+
+  //! Reserve a code region of `size` bytes near `hint`, see \ref VMemMgr::reserveRegion().
+  //!
+  //! The region is also stored in the runtime's `CodeInfo`, so `CodeHolder`s
+  //! initialized by it afterwards encode jumps and calls to absolute addresses
+  //! near `hint` (like functions of the main executable if `hint` points to
+  //! it) and to other functions in the region as rel32 without trampolines.
+  ASMJIT_API Error reserveCodeRegion(size_t size, const void* hint = nullptr) noexcept;
+  //! Release the code region, see \ref VMemMgr::releaseRegion().
+  ASMJIT_API Error releaseCodeRegion() noexcept;
+
   // --------------------------------------------------------------------------
   // [Interface]
   // --------------------------------------------------------------------------
@@ -179,12 +238,186 @@ public:
   ASMJIT_API Error _add(void** dst, CodeHolder* code) noexcept override;
   ASMJIT_API Error _release(void* p) noexcept override;
 
+  //! Add code of all `holders` by using a single allocation and flush.
+  //!
+  //! Each function starts at a cache-line aligned offset of the allocated
+  //! region and its address is stored to `out`. Functions can be released by
+  //! `release()` separately, releasing all of them releases the batch. If the
+  //! region comes from a thread cache of `VMemMgr` (it can't be split in such
+  //! case) the holders are added one by one instead, which is also the case
+  //! if any holder has constant or writable sections. If any holder fails then
+  //! nothing is added and all `out` entries are set to null.
+  ASMJIT_API Error addBatch(CodeHolder** holders, size_t count, void** out) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Streaming]
+  // --------------------------------------------------------------------------
+
+  //! Emit the code of `code` directly to executable memory.
+  //!
+  //! Allocates `capacity` bytes from `VMemMgr` and uses them (their writable
+  //! view if dual mapping is enabled) as the buffer of the first section of
+  //! `code`, which must be empty. `add()` then relocates the code in place
+  //! and releases the unused memory, so the code is neither copied nor held
+  //! in a heap buffer. The section refers to the added code until `code` is
+  //! reset and it can't grow anymore. Streamed code is never shared (see
+  //! \ref setDedupEnabled()).
+  //!
+  //! If the code doesn't fit into `capacity` bytes (including trampolines and
+  //! other sections) it's copied to a heap buffer by `CodeHolder` or `add()`
+  //! and added as usual. The memory is released by `add()` or \ref cancelStream(),
+  //! when `code` is reset or destroyed, or when the runtime is destroyed.
+  ASMJIT_API Error beginStream(CodeHolder* code, size_t capacity) noexcept;
+
+  //! Stop streaming `code` without adding it, the code is moved to a heap
+  //! buffer. Does nothing if `code` is not streamed.
+  ASMJIT_API Error cancelStream(CodeHolder* code) noexcept;
+
+  //! \internal
+  //!
+  //! Release the memory streamed by `code` without moving its content, called
+  //! by `CodeHolder` when it's reset or destroyed.
+  ASMJIT_API void _releaseStream(CodeHolder* code) noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Deduplication]
+  // --------------------------------------------------------------------------
+
+  //! Get whether `add()` shares identical functions.
+  ASMJIT_INLINE bool isDedupEnabled() const noexcept { return _dedupEnabled; }
+
+  //! Enable or disable sharing of identical functions (disabled by default).
+  //!
+  //! If enabled, `add()` returns an existing function if the code holder
+  //! contains the same code and relocations as a function added before and
+  //! not yet released, the function is reference counted and must be released
+  //! by `release()` once per `add()`. Code added by `addBatch()` is shared only
+  //! if the holders are added one by one.
+  //! Returns `kErrorInvalidState` if sharing is being disabled while shared
+  //! functions still exist. Must not be called concurrently with `add()`.
+  ASMJIT_API Error setDedupEnabled(bool enabled) noexcept;
+
+  //! Get the count of `add()` calls that returned an existing function.
+  ASMJIT_INLINE size_t getDedupHitsCount() const noexcept { return _dedupHitsCount; }
+  //! Get the count of bytes of executable memory currently saved by sharing.
+  ASMJIT_INLINE size_t getDedupSavedSize() const noexcept { return _dedupSavedSize; }
+
+  // --------------------------------------------------------------------------
+  // [Reclamation]
+  // --------------------------------------------------------------------------
+
+  //! Enter a read-side section of the calling thread.
+  //!
+  //! Code released by `release()` while any thread is inside a read-side
+  //! section is only retired - it's returned to `VMemMgr` after all threads
+  //! that were inside a section at that time have left it (a grace period),
+  //! so threads can keep executing a function that is being replaced. Code
+  //! is released immediately if no thread is inside a section. Functions must
+  //! be unpublished (no longer reachable by readers) before they are released.
+  //!
+  //! Sections can be nested and are cheap - they don't take locks and don't
+  //! use atomic read-modify-write instructions, only a store followed by a
+  //! memory fence. The first call of a thread allocates its record, which is
+  //! kept until the runtime is destroyed, `kErrorNoHeapMemory` is returned if
+  //! that fails. A thread must not terminate inside a section.
+  ASMJIT_API Error enterReadSection() noexcept;
+  //! Leave a read-side section entered by \ref enterReadSection().
+  ASMJIT_API void leaveReadSection() noexcept;
+
+  //! Return retired code to `VMemMgr` if its grace period has elapsed.
+  //!
+  //! Called by `release()` automatically, it's only needed to reclaim memory
+  //! earlier than by the next `release()`.
+  ASMJIT_API void reclaim() noexcept;
+
+  //! Get the count of functions retired, but not yet returned to `VMemMgr`.
+  ASMJIT_INLINE size_t getRetiredCount() const noexcept { return _retiredCount; }
+
+  //! Scoped read-side section.
+  class ReadScope {
+  public:
+    ASMJIT_NONCOPYABLE(ReadScope)
+
+    ASMJIT_INLINE ReadScope(JitRuntime& runtime) noexcept : _runtime(runtime) { _runtime.enterReadSection(); }
+    ASMJIT_INLINE ~ReadScope() noexcept { _runtime.leaveReadSection(); }
+
+    //! Runtime of the section.
+    JitRuntime& _runtime;
+  };
+
   // --------------------------------------------------------------------------
   // [Members]
   // --------------------------------------------------------------------------
 
   //! Virtual memory manager.
   VMemMgr _memMgr;
+  //! Listener notified about added code.
+  JitListener* _listener;
+
+  //! \internal
+  //! \{
+
+  struct EpochRecord;
+  struct RetiredEntry;
+
+  // Lock of writers (`release()` and `reclaim()`).
+  Lock _epochLock;
+  // Global epoch, advanced by 2 as the lowest bit marks active records.
+  volatile size_t _epoch;
+  // Serial of this runtime, used to cache records in thread-local storage.
+  size_t _epochSerial;
+  // Records of all threads that entered a read-side section.
+  EpochRecord* volatile _epochRecords;
+  // Retired code, the most recent first.
+  RetiredEntry* _retired;
+  size_t _retiredCount;
+
+  struct DedupEntry;
+  struct DedupLink;
+
+  // Lock of deduplication tables.
+  Lock _dedupLock;
+  // Whether `add()` shares identical functions.
+  bool _dedupEnabled;
+  // Zone and heap used by deduplication tables.
+  Zone _dedupZone;
+  ZoneHeap _dedupHeap;
+  // Shared functions by the hash of their code.
+  ZoneHash<DedupEntry> _dedupByCode;
+  // Shared functions by their address.
+  ZoneHash<DedupLink> _dedupByAddress;
+  // Statistics.
+  size_t _dedupHitsCount;
+  size_t _dedupSavedSize;
+
+  struct FrameEntry;
+
+  // Lock of registered unwind information.
+  Lock _frameLock;
+  // Zone and heap used by `_frames`.
+  Zone _frameZone;
+  ZoneHeap _frameHeap;
+  // Registered unwind information by the address of the function.
+  ZoneHash<FrameEntry> _frames;
+
+  struct ImageEntry;
+  struct ImageArena;
+  struct StreamEntry;
+
+  // Lock of images (code added with constant or writable sections) and
+  // streams (code emitted directly to executable memory).
+  Lock _imageLock;
+  // Zone and heap used by `_images` and `_streams`.
+  Zone _imageZone;
+  ZoneHeap _imageHeap;
+  // Images by the address of their first section.
+  ZoneHash<ImageEntry> _images;
+  // Streams by their `CodeHolder`.
+  ZoneHash<StreamEntry> _streams;
+  // Arena small images are packed into (or null).
+  ImageArena* _imageArena;
+
+  //! \}
 };
 
 //! \}
@@ -0,0 +1,433 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Export]
+#define ASMJIT_EXPORTS
+
+// [Dependencies]
+#include "../base/unwind.h"
+#include "../base/utils.h"
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+// ============================================================================
+// [asmjit::UnwindUtils - Helpers]
+// ============================================================================
+
+//! \internal
+//!
+//! DWARF constants used by `.eh_frame`.
+enum {
+  kDwCfaAdvanceLoc      = 0x40,
+  kDwCfaOffset          = 0x80,
+  kDwCfaAdvanceLoc1     = 0x02,
+  kDwCfaAdvanceLoc2     = 0x03,
+  kDwCfaAdvanceLoc4     = 0x04,
+  kDwCfaRememberState   = 0x0A,
+  kDwCfaRestoreState    = 0x0B,
+  kDwCfaDefCfa          = 0x0C,
+  kDwCfaDefCfaOffset    = 0x0E,
+  kDwCfaDefCfaExpression= 0x0F,
+  kDwCfaNop             = 0x00,
+
+  kDwOpBReg0            = 0x70,
+  kDwOpDeref            = 0x06,
+  kDwOpPlusUConst       = 0x23,
+
+  kDwEhPeAbsPtr         = 0x00
+};
+
+//! \internal
+//!
+//! Mapping of X86 GP register ids to DWARF register numbers (i386 psABI).
+static const uint8_t ehFrameX86RegMap[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+
+//! \internal
+//!
+//! Mapping of X64 GP register ids to DWARF register numbers (AMD64 psABI).
+static const uint8_t ehFrameX64RegMap[16] = { 0, 2, 1, 3, 7, 6, 4, 5, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+//! \internal
+//!
+//! Appends `.eh_frame` data to a `StringBuilder`, remembers the first error.
+class EhFrameWriter {
+public:
+  ASMJIT_INLINE EhFrameWriter(StringBuilder& sb) noexcept
+    : _sb(sb),
+      _err(kErrorOk) {}
+
+  ASMJIT_INLINE Error getError() const noexcept { return _err; }
+  ASMJIT_INLINE size_t getOffset() const noexcept { return _sb.getLength(); }
+
+  ASMJIT_INLINE uint8_t* reserve(size_t n) noexcept {
+    if (ASMJIT_UNLIKELY(_err))
+      return nullptr;
+
+    uint8_t* p = reinterpret_cast<uint8_t*>(_sb.prepare(StringBuilder::kStringOpAppend, n));
+    if (ASMJIT_UNLIKELY(!p))
+      _err = DebugUtils::errored(kErrorNoHeapMemory);
+    return p;
+  }
+
+  ASMJIT_INLINE void emitU8(uint32_t x) noexcept {
+    uint8_t* p = reserve(1);
+    if (p) p[0] = static_cast<uint8_t>(x);
+  }
+
+  ASMJIT_INLINE void emitU16(uint32_t x) noexcept {
+    uint8_t* p = reserve(2);
+    if (p) Utils::writeU16u(p, x);
+  }
+
+  ASMJIT_INLINE void emitU32(uint32_t x) noexcept {
+    uint8_t* p = reserve(4);
+    if (p) Utils::writeU32u(p, x);
+  }
+
+  ASMJIT_INLINE void emitAddress(uint64_t x, uint32_t size) noexcept {
+    uint8_t* p = reserve(size);
+    if (!p) return;
+
+    if (size == 4)
+      Utils::writeU32u(p, static_cast<uint32_t>(x));
+    else
+      Utils::writeU64u(p, x);
+  }
+
+  ASMJIT_INLINE void emitULeb(uint32_t x) noexcept {
+    do {
+      uint32_t byte = x & 0x7F;
+      x >>= 7;
+      emitU8(x ? byte | 0x80 : byte);
+    } while (x);
+  }
+
+  ASMJIT_INLINE void emitSLeb(int32_t x) noexcept {
+    for (;;) {
+      uint32_t byte = static_cast<uint32_t>(x) & 0x7F;
+      x >>= 7;
+
+      if ((x == 0 && !(byte & 0x40)) || (x == -1 && (byte & 0x40))) {
+        emitU8(byte);
+        break;
+      }
+      emitU8(byte | 0x80);
+    }
+  }
+
+  //! Pad the entry that starts at `start` by `DW_CFA_nop` to `alignment`,
+  //! and store its length.
+  ASMJIT_INLINE void endEntry(size_t start, uint32_t alignment) noexcept {
+    while ((getOffset() - start) % alignment != 0)
+      emitU8(kDwCfaNop);
+
+    if (!_err)
+      Utils::writeU32u(_sb.getData() + start, static_cast<uint32_t>(getOffset() - start - 4));
+  }
+
+  StringBuilder& _sb;
+  Error _err;
+};
+
+// ============================================================================
+// [asmjit::UnwindUtils - BuildEhFrame]
+// ============================================================================
+
+Error UnwindUtils::buildEhFrame(const CodeHolder* code, uint64_t baseAddress, size_t codeSize, StringBuilder& dst) noexcept {
+  const ZoneVector<UnwindEntry>& entries = code->getUnwindEntries();
+  if (entries.isEmpty())
+    return kErrorOk;
+
+  const uint8_t* regMap;
+  uint32_t regCount;
+  uint32_t gpSize;
+  uint32_t raRegId;
+
+  switch (code->getArchType()) {
+    case ArchInfo::kTypeX86:
+      regMap = ehFrameX86RegMap;
+      regCount = ASMJIT_ARRAY_SIZE(ehFrameX86RegMap);
+      gpSize = 4;
+      raRegId = 8;
+      break;
+
+    case ArchInfo::kTypeX64:
+      regMap = ehFrameX64RegMap;
+      regCount = ASMJIT_ARRAY_SIZE(ehFrameX64RegMap);
+      gpSize = 8;
+      raRegId = 16;
+      break;
+
+    default:
+      return DebugUtils::errored(kErrorInvalidArch);
+  }
+
+  // Offsets of all bound entries, sorted. The sort must be stable as entries
+  // at the same offset must be applied in the order they were added.
+  size_t i, j;
+  size_t count = 0;
+  size_t numEntries = entries.getLength();
+
+  // Offsets are first, so both arrays are aligned.
+  size_t* offsets = static_cast<size_t*>(Internal::allocMemory(numEntries * (sizeof(size_t) + sizeof(uint32_t))));
+  if (ASMJIT_UNLIKELY(!offsets))
+    return DebugUtils::errored(kErrorNoHeapMemory);
+  uint32_t* order = reinterpret_cast<uint32_t*>(offsets + numEntries);
+
+  for (i = 0; i < numEntries; i++) {
+    const LabelEntry* le = code->getLabelEntry(entries[i].getLabelId());
+    if (!le || le->getSectionId() != 0 || le->getOffset() < 0 || static_cast<size_t>(le->getOffset()) > codeSize)
+      continue;
+
+    size_t offset = static_cast<size_t>(le->getOffset());
+    for (j = count++; j > 0 && offsets[j - 1] > offset; j--) {
+      offsets[j] = offsets[j - 1];
+      order[j] = order[j - 1];
+    }
+
+    offsets[j] = offset;
+    order[j] = static_cast<uint32_t>(i);
+  }
+
+  EhFrameWriter w(dst);
+  Error err = kErrorOk;
+
+  // CIE - CFA is SP + gpSize and the return address is at CFA - gpSize.
+  size_t cieStart = w.getOffset();
+  w.emitU32(0);                          // Length, patched by `endEntry()`.
+  w.emitU32(0);                          // CIE id.
+  w.emitU8(1);                           // Version.
+  w.emitU8('z');                         // Augmentation "zR".
+  w.emitU8('R');
+  w.emitU8(0);
+  w.emitULeb(1);                         // Code alignment factor.
+  w.emitSLeb(-static_cast<int32_t>(gpSize));
+  w.emitULeb(raRegId);
+  w.emitULeb(1);                         // Augmentation data length.
+  w.emitU8(kDwEhPeAbsPtr);               // FDE address encoding.
+  w.emitU8(kDwCfaDefCfa);
+  w.emitULeb(regMap[4]);                 // SP has id 4 on both X86 and X64.
+  w.emitULeb(gpSize);
+  w.emitU8(kDwCfaOffset | raRegId);
+  w.emitULeb(1);
+  w.endEntry(cieStart, gpSize);
+
+  for (i = 0; i < count; i++) {
+    const UnwindEntry& funcEntry = entries[order[i]];
+    if (funcEntry.getType() != UnwindEntry::kTypeFuncStart)
+      continue;
+
+    size_t funcStart = offsets[i];
+    size_t funcEnd = codeSize;
+
+    for (j = i + 1; j < count; j++) {
+      if (entries[order[j]].getType() == UnwindEntry::kTypeFuncStart) {
+        funcEnd = offsets[j];
+        break;
+      }
+    }
+
+    if (funcEnd <= funcStart)
+      continue;
+
+    // FDE.
+    size_t fdeStart = w.getOffset();
+    w.emitU32(0);                        // Length, patched by `endEntry()`.
+    w.emitU32(static_cast<uint32_t>(fdeStart + 4 - cieStart));
+    w.emitAddress(baseAddress + funcStart, gpSize);
+    w.emitAddress(funcEnd - funcStart, gpSize);
+    w.emitULeb(0);                       // Augmentation data length.
+
+    if (funcEntry.getOffset() != static_cast<int32_t>(gpSize)) {
+      w.emitU8(kDwCfaDefCfaOffset);
+      w.emitULeb(static_cast<uint32_t>(funcEntry.getOffset()));
+    }
+
+    size_t loc = funcStart;
+    for (j = i + 1; j < count; j++) {
+      const UnwindEntry& entry = entries[order[j]];
+      if (entry.getType() == UnwindEntry::kTypeFuncStart)
+        break;
+
+      uint32_t regId = entry.getRegId();
+      if (ASMJIT_UNLIKELY(regId >= regCount)) {
+        err = DebugUtils::errored(kErrorInvalidState);
+        goto _Done;
+      }
+
+      size_t delta = offsets[j] - loc;
+      if (delta) {
+        if (delta < 64) {
+          w.emitU8(kDwCfaAdvanceLoc | static_cast<uint32_t>(delta));
+        }
+        else if (delta < 256) {
+          w.emitU8(kDwCfaAdvanceLoc1);
+          w.emitU8(static_cast<uint32_t>(delta));
+        }
+        else if (delta < 65536) {
+          w.emitU8(kDwCfaAdvanceLoc2);
+          w.emitU16(static_cast<uint32_t>(delta));
+        }
+        else {
+          w.emitU8(kDwCfaAdvanceLoc4);
+          w.emitU32(static_cast<uint32_t>(delta));
+        }
+        loc = offsets[j];
+      }
+
+      switch (entry.getType()) {
+        case UnwindEntry::kTypeSaveReg: {
+          int32_t offset = entry.getOffset();
+          if (ASMJIT_UNLIKELY(offset >= 0 || (-offset) % static_cast<int32_t>(gpSize) != 0)) {
+            err = DebugUtils::errored(kErrorInvalidState);
+            goto _Done;
+          }
+
+          w.emitU8(kDwCfaOffset | regMap[regId]);
+          w.emitULeb(static_cast<uint32_t>(-offset) / gpSize);
+          break;
+        }
+
+        case UnwindEntry::kTypeCfaOffset:
+          w.emitU8(kDwCfaDefCfaOffset);
+          w.emitULeb(static_cast<uint32_t>(entry.getOffset()));
+          break;
+
+        case UnwindEntry::kTypeCfaReg:
+          w.emitU8(kDwCfaDefCfa);
+          w.emitULeb(regMap[regId]);
+          w.emitULeb(static_cast<uint32_t>(entry.getOffset()));
+          break;
+
+        case UnwindEntry::kTypeCfaDeref: {
+          // DW_OP_breg(regId) offset, DW_OP_deref, DW_OP_plus_uconst addend.
+          StringBuilderTmp<32> expr;
+          EhFrameWriter e(expr);
+          e.emitU8(kDwOpBReg0 + regMap[regId]);
+          e.emitSLeb(entry.getOffset());
+          e.emitU8(kDwOpDeref);
+          e.emitU8(kDwOpPlusUConst);
+          e.emitULeb(static_cast<uint32_t>(entry.getAddend()));
+
+          if (ASMJIT_UNLIKELY(e.getError())) {
+            err = e.getError();
+            goto _Done;
+          }
+
+          w.emitU8(kDwCfaDefCfaExpression);
+          w.emitULeb(static_cast<uint32_t>(expr.getLength()));
+
+          uint8_t* p = w.reserve(expr.getLength());
+          if (p) ::memcpy(p, expr.getData(), expr.getLength());
+          break;
+        }
+
+        case UnwindEntry::kTypeRememberState:
+          w.emitU8(kDwCfaRememberState);
+          break;
+
+        case UnwindEntry::kTypeRestoreState:
+          w.emitU8(kDwCfaRestoreState);
+          break;
+      }
+    }
+
+    w.endEntry(fdeStart, gpSize);
+  }
+
+  // Terminator.
+  w.emitU32(0);
+  err = w.getError();
+
+_Done:
+  Internal::releaseMemory(offsets);
+  return err;
+}
+
+// ============================================================================
+// [asmjit::UnwindUtils - Test]
+// ============================================================================
+
+#if defined(ASMJIT_TEST)
+static uint32_t UnwindUtilsTest_newLabel(CodeHolder& code, intptr_t offset) {
+  uint32_t labelId;
+  code.newLabelId(labelId);
+
+  LabelEntry* le = code.getLabelEntry(labelId);
+  le->_sectionId = 0;
+  le->_offset = offset;
+  return labelId;
+}
+
+UNIT(base_unwind) {
+  // push rbp; mov rbp, rsp; pop rbp; ret
+  static const uint8_t kCode[] = { 0x55, 0x48, 0x89, 0xE5, 0x5D, 0xC3 };
+
+  static const uint8_t kEhFrame[] = {
+    // CIE.
+    0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 'z' , 'R' , 0x00,
+    0x01, 0x78, 0x10, 0x01, 0x00, 0x0C, 0x07, 0x08, 0x90, 0x01, 0x00, 0x00,
+    // FDE.
+    0x2C, 0x00, 0x00, 0x00, 0x1C, 0x00, 0x00, 0x00,
+    0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x41, 0x0E, 0x10, 0x86, 0x02,        // push rbp
+    0x43, 0x0C, 0x06, 0x10,              // mov rbp, rsp
+    0x0A,                                // (epilog)
+    0x41, 0x0C, 0x07, 0x08,              // pop rbp
+    0x41, 0x0B,                          // ret
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    // Terminator.
+    0x00, 0x00, 0x00, 0x00
+  };
+
+  CodeHolder code;
+  EXPECT(code.init(CodeInfo(ArchInfo::kTypeX64)) == kErrorOk,
+    "Failed to initialize CodeHolder");
+
+  CodeBuffer& buffer = code._sections[0]->_buffer;
+  code.reserveBuffer(&buffer, sizeof(kCode));
+  ::memcpy(buffer._data, kCode, sizeof(kCode));
+  buffer._length = sizeof(kCode);
+
+  StringBuilder sb;
+  EXPECT(UnwindUtils::buildEhFrame(&code, 0x1000, sizeof(kCode), sb) == kErrorOk && sb.getLength() == 0,
+    "Code without unwind entries must produce no data");
+
+  code.addUnwindEntry(UnwindUtilsTest_newLabel(code, 0), UnwindEntry::kTypeFuncStart, 0, 8);
+  code.addUnwindEntry(UnwindUtilsTest_newLabel(code, 1), UnwindEntry::kTypeCfaOffset, 0, 16);
+  code.addUnwindEntry(UnwindUtilsTest_newLabel(code, 1), UnwindEntry::kTypeSaveReg, 5, -16);
+  code.addUnwindEntry(UnwindUtilsTest_newLabel(code, 4), UnwindEntry::kTypeCfaReg, 5, 16);
+  code.addUnwindEntry(UnwindUtilsTest_newLabel(code, 4), UnwindEntry::kTypeRememberState);
+  code.addUnwindEntry(UnwindUtilsTest_newLabel(code, 5), UnwindEntry::kTypeCfaReg, 4, 8);
+  code.addUnwindEntry(UnwindUtilsTest_newLabel(code, 6), UnwindEntry::kTypeRestoreState);
+
+  INFO("Building .eh_frame of X64 function");
+  EXPECT(UnwindUtils::buildEhFrame(&code, 0x1000, sizeof(kCode), sb) == kErrorOk,
+    "Failed to build .eh_frame");
+  EXPECT(sb.getLength() == sizeof(kEhFrame),
+    "Invalid size of .eh_frame: %u (expected %u)", unsigned(sb.getLength()), unsigned(sizeof(kEhFrame)));
+  EXPECT(::memcmp(sb.getData(), kEhFrame, sizeof(kEhFrame)) == 0,
+    "Invalid content of .eh_frame");
+
+  INFO("Rejecting invalid unwind entries");
+  EXPECT(code.addUnwindEntry(0xFFFFFFFFU, UnwindEntry::kTypeFuncStart) == kErrorInvalidArgument,
+    "Unwind entry of an invalid label must be rejected");
+
+  code.addUnwindEntry(UnwindUtilsTest_newLabel(code, 2), UnwindEntry::kTypeSaveReg, 3, -12);
+  sb.clear();
+  EXPECT(UnwindUtils::buildEhFrame(&code, 0x1000, sizeof(kCode), sb) == kErrorInvalidState,
+    "Save offset not aligned to the register size must be rejected");
+}
+#endif // ASMJIT_TEST
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
@@ -0,0 +1,51 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Guard]
+#ifndef _ASMJIT_BASE_UNWIND_H
+#define _ASMJIT_BASE_UNWIND_H
+
+// [Dependencies]
+#include "../base/codeholder.h"
+#include "../base/string.h"
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+//! \addtogroup asmjit_base
+//! \{
+
+// ============================================================================
+// [asmjit::UnwindUtils]
+// ============================================================================
+
+//! Unwind information utilities.
+struct UnwindUtils {
+  //! Build DWARF `.eh_frame` data describing functions of `code`.
+  //!
+  //! The data contains a single CIE followed by an FDE of each function, which
+  //! starts at \ref UnwindEntry::kTypeFuncStart and ends where the next one
+  //! starts or at `codeSize`, and is terminated by a zero length entry, so it
+  //! can be passed to `__register_frame()` of libgcc. Addresses are absolute,
+  //! relative to `baseAddress` the code was relocated to. Nothing is appended
+  //! to `dst` if the code has no unwind entries.
+  //!
+  //! Returns `kErrorInvalidArch` if the architecture is not supported (only
+  //! X86 and X64 are).
+  ASMJIT_API static Error buildEhFrame(const CodeHolder* code, uint64_t baseAddress, size_t codeSize, StringBuilder& dst) noexcept;
+};
+
+//! \}
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
+
+// [Guard]
+#endif // _ASMJIT_BASE_UNWIND_H
@@ -94,6 +94,152 @@ static void _SetBits(size_t* buf, size_t index, size_t len) noexcept {
     *buf |= ((~(size_t)0) >> (kBitsPerEntity - len));
 }
 
+//! \internal
+//!
+//! Clear `len` bits in `buf` starting at `index` bit index.
+static void _ClearBits(size_t* buf, size_t index, size_t len) noexcept {
+  buf += index / kBitsPerEntity;
+  size_t j = index % kBitsPerEntity;
+
+  while (len) {
+    size_t c = kBitsPerEntity - j;
+    if (c > len)
+      c = len;
+
+    *buf++ &= ~(((~(size_t)0) >> (kBitsPerEntity - c)) << j);
+    len -= c;
+    j = 0;
+  }
+}
+
+//! \internal
+//!
+//! Get the index of the first set bit in `x`, which must not be zero.
+static ASMJIT_INLINE size_t _FirstBit(size_t x) noexcept {
+  ASMJIT_ASSERT(x != 0);
+
+#if ASMJIT_CC_MSC_GE(14, 0, 0)
+  unsigned long i;
+# if ASMJIT_ARCH_64BIT
+  _BitScanForward64(&i, x);
+# else
+  _BitScanForward(&i, x);
+# endif
+  return static_cast<size_t>(i);
+#elif ASMJIT_CC_GCC_GE(3, 4, 6) || ASMJIT_CC_CLANG
+  return static_cast<size_t>(__builtin_ctzll(static_cast<unsigned long long>(x)));
+#else
+  size_t i = 0;
+  while (!(x & 1)) {
+    x >>= 1;
+    i++;
+  }
+  return i;
+#endif
+}
+
+//! \internal
+//!
+//! Get the index of the last set bit in `x`, which must not be zero.
+static ASMJIT_INLINE size_t _LastBit(size_t x) noexcept {
+  ASMJIT_ASSERT(x != 0);
+
+#if ASMJIT_CC_MSC_GE(14, 0, 0)
+  unsigned long i;
+# if ASMJIT_ARCH_64BIT
+  _BitScanReverse64(&i, x);
+# else
+  _BitScanReverse(&i, x);
+# endif
+  return static_cast<size_t>(i);
+#elif ASMJIT_CC_GCC_GE(3, 4, 6) || ASMJIT_CC_CLANG
+  return static_cast<size_t>(63 - __builtin_clzll(static_cast<unsigned long long>(x)));
+#else
+  size_t i = 0;
+  while (x >>= 1)
+    i++;
+  return i;
+#endif
+}
+
+//! \internal
+//!
+//! Get a mask of all bit indexes where `n` continuous zero bits of `used` start,
+//! `n` must be between 1 and `kBitsPerEntity`.
+static ASMJIT_INLINE size_t _FindRuns(size_t used, size_t n) noexcept {
+  size_t runs = ~used;
+  size_t len = 1;
+
+  while (len < n) {
+    size_t shift = len < n - len ? len : n - len;
+    runs &= runs >> shift;
+    len += shift;
+  }
+
+  return runs;
+}
+
+//! \internal
+//!
+//! Get the length of the longest run of zero bits in `used`.
+static ASMJIT_INLINE size_t _LongestRun(size_t used) noexcept {
+  size_t x = ~used;
+  size_t n = 0;
+
+  while (x) {
+    x &= x >> 1;
+    n++;
+  }
+
+  return n;
+}
+
+//! \internal
+//!
+//! Get whether `len` bits in `buf` starting at `index` are all zero.
+static bool _IsRangeZero(const size_t* buf, size_t index, size_t len) noexcept {
+  buf += index / kBitsPerEntity;
+  size_t j = index % kBitsPerEntity;
+
+  while (len) {
+    size_t c = kBitsPerEntity - j;
+    if (c > len)
+      c = len;
+
+    size_t mask = ((~(size_t)0) >> (kBitsPerEntity - c)) << j;
+    if (*buf++ & mask)
+      return false;
+
+    len -= c;
+    j = 0;
+  }
+
+  return true;
+}
+
+//! \internal
+//!
+//! Get whether `len` bits in `buf` starting at `index` are all set.
+static bool _IsRangeSet(const size_t* buf, size_t index, size_t len) noexcept {
+  buf += index / kBitsPerEntity;
+  size_t j = index % kBitsPerEntity;
+
+  while (len) {
+    size_t c = kBitsPerEntity - j;
+    if (c > len)
+      c = len;
+
+    size_t mask = ((~(size_t)0) >> (kBitsPerEntity - c)) << j;
+    if ((*buf++ & mask) != mask)
+      return false;
+
+    len -= c;
+    j = 0;
+  }
+
+  return true;
+}
+
 // ============================================================================
 // [asmjit::VMemMgr::TypeDefs]
 // ============================================================================
@@ -101,6 +247,9 @@ static void _SetBits(size_t* buf, size_t index, size_t len) noexcept {
 typedef VMemMgr::RbNode RbNode;
 typedef VMemMgr::MemNode MemNode;
 typedef VMemMgr::PermanentNode PermanentNode;
+typedef VMemMgr::FreeList FreeList;
+typedef VMemMgr::CacheChunk CacheChunk;
+typedef VMemMgr::ThreadCache ThreadCache;
 
 // ============================================================================
 // [asmjit::VMemMgr::RbNode]
@@ -193,6 +342,7 @@ struct VMemMgr::MemNode : public RbNode {
 
     baUsed = other->baUsed;
     baCont = other->baCont;
+    rw = other->rw;
   }
 
   // Get available space.
@@ -209,6 +359,7 @@ struct VMemMgr::MemNode : public RbNode {
 
   size_t* baUsed;        // Contains bits about used blocks       (0 = unused, 1 = used).
   size_t* baCont;        // Contains bits about continuous blocks (0 = stop  , 1 = continue).
+  uint8_t* rw;           // Writable view of `mem` (same as `mem` if not dual-mapped).
 };
 
 // ============================================================================
@@ -224,10 +375,101 @@ struct VMemMgr::PermanentNode {
 
   PermanentNode* prev;   // Pointer to prev chunk or nullptr.
   uint8_t* mem;          // Base pointer (virtual memory address).
+  uint8_t* rw;           // Writable view of `mem` (same as `mem` if not dual-mapped).
   size_t size;           // Count of bytes allocated.
   size_t used;           // Count of bytes used.
 };
 
+// ============================================================================
+// [asmjit::VMemMgr::FreeList]
+// ============================================================================
+
+//! \internal
+enum {
+  kFreeListUnit     = 64,                // Granularity of size classes.
+  kFreeListCount    = 16,                // Count of size classes.
+  kFreeListCapacity = 16                 // Count of runs remembered per class.
+};
+
+//! \internal
+//!
+//! Recently released runs of a single size class, class `i` contains runs that
+//! have at least `(i + 1) * kFreeListUnit` bytes (the last class contains all
+//! larger runs). Runs are only hints - they are validated against bit-arrays
+//! of their node before use, so stale entries are harmless and dropped.
+struct VMemMgr::FreeList {
+  size_t count;                          // Count of runs.
+  uint8_t* runs[kFreeListCapacity];      // Runs, the last one is the most recent.
+};
+
+// ============================================================================
+// [asmjit::VMemMgr - Region]
+// ============================================================================
+
+//! \internal
+//!
+//! Commit `size` bytes of the reserved region, must be called with
+//! `self->_lock` held. Large page arenas are aligned to the block size.
+static uint8_t* vMemMgrAllocRegion(VMemMgr* self, size_t size, size_t* vSize) noexcept {
+  size_t unit = OSUtils::getVirtualMemoryInfo().pageGranularity;
+  size_t alignment = self->_largePagesEnabled ? self->_blockSize : unit;
+
+  size_t alignedSize = Utils::alignTo<size_t>(size, alignment);
+  size_t n = alignedSize / unit;
+  size_t step = alignment / unit;
+  size_t count = self->_regionSize / unit;
+
+  // The region is aligned to `unit`, which divides the block size.
+  uint8_t* start = self->_regionStart;
+  size_t i = (size_t)(Utils::alignTo<uint8_t*>(start, alignment) - start) / unit;
+
+  // First fit, nodes are created rarely so a linear scan is fine.
+  for (; i + n <= count; i += step) {
+    if (!_IsRangeZero(self->_regionUsed, i, n))
+      continue;
+
+    uint8_t* p = start + i * unit;
+    uint32_t flags = OSUtils::kVMWritable | OSUtils::kVMExecutable;
+    if (self->_largePagesEnabled)
+      flags |= OSUtils::kVMLargePages;
+
+    if (OSUtils::commitVirtualMemory(p, alignedSize, flags) != kErrorOk)
+      return nullptr;
+
+    _SetBits(self->_regionUsed, i, n);
+    *vSize = alignedSize;
+    return p;
+  }
+
+  return nullptr;
+}
+
+//! \internal
+//!
+//! Decommit memory allocated by `vMemMgrAllocRegion()`.
+static Error vMemMgrReleaseRegionMem(VMemMgr* self, uint8_t* p, size_t vSize) noexcept {
+  size_t unit = OSUtils::getVirtualMemoryInfo().pageGranularity;
+  _ClearBits(self->_regionUsed, (size_t)(p - self->_regionStart) / unit, vSize / unit);
+  return OSUtils::decommitVirtualMemory(p, vSize);
+}
+
+//! \internal
+//!
+//! Release the reserved region, all nodes must be already released. The
+//! address range stays reserved if `keepVirtualMemory` is true.
+static void vMemMgrReleaseRegion(VMemMgr* self, bool keepVirtualMemory) noexcept {
+  if (!self->_regionStart)
+    return;
+
+  if (!keepVirtualMemory)
+    OSUtils::releaseVirtualMemory(self->_regionStart, self->_regionSize);
+  Internal::releaseMemory(self->_regionUsed);
+
+  self->_regionStart = nullptr;
+  self->_regionSize = 0;
+  self->_regionUsed = nullptr;
+}
+
 // ============================================================================
 // [asmjit::VMemMgr - Private]
 // ============================================================================
@@ -235,19 +477,50 @@ struct VMemMgr::PermanentNode {
 //! \internal
 //!
 //! Helper to avoid `#ifdef`s in the code.
-ASMJIT_INLINE uint8_t* vMemMgrAllocVMem(VMemMgr* self, size_t size, size_t* vSize) noexcept {
+//!
+//! Stores the writable view of the returned memory into `rw`.
+ASMJIT_INLINE uint8_t* vMemMgrAllocVMem(VMemMgr* self, size_t size, size_t* vSize, uint8_t** rw) noexcept {
+  if (self->_regionStart) {
+    uint8_t* p = vMemMgrAllocRegion(self, size, vSize);
+    *rw = p;
+    return p;
+  }
+
+  if (self->_dualMappingEnabled) {
+    void* rxView;
+    void* rwView;
+
+    if (OSUtils::allocDualMapping(size, vSize, &rxView, &rwView) != kErrorOk)
+      return nullptr;
+
+    *rw = static_cast<uint8_t*>(rwView);
+    return static_cast<uint8_t*>(rxView);
+  }
+
   uint32_t flags = OSUtils::kVMWritable | OSUtils::kVMExecutable;
+  if (self->_largePagesEnabled)
+    flags |= OSUtils::kVMLargePages;
+
 #if !ASMJIT_OS_WINDOWS
-  return static_cast<uint8_t*>(OSUtils::allocVirtualMemory(size, vSize, flags));
+  uint8_t* p = static_cast<uint8_t*>(OSUtils::allocVirtualMemory(size, vSize, flags));
 #else
-  return static_cast<uint8_t*>(OSUtils::allocProcessMemory(self->_hProcess, size, vSize, flags));
+  uint8_t* p = static_cast<uint8_t*>(OSUtils::allocProcessMemory(self->_hProcess, size, vSize, flags));
 #endif
+  *rw = p;
+  return p;
 }
 
 //! \internal
 //!
 //! Helper to avoid `#ifdef`s in the code.
-ASMJIT_INLINE Error vMemMgrReleaseVMem(VMemMgr* self, void* p, size_t vSize) noexcept {
+ASMJIT_INLINE Error vMemMgrReleaseVMem(VMemMgr* self, void* p, void* rw, size_t vSize) noexcept {
+  if (p != rw)
+    return OSUtils::releaseDualMapping(p, rw, vSize);
+
+  uint8_t* mem = static_cast<uint8_t*>(p);
+  if (mem >= self->_regionStart && mem < self->_regionStart + self->_regionSize)
+    return vMemMgrReleaseRegionMem(self, mem, vSize);
+
 #if !ASMJIT_OS_WINDOWS
   return OSUtils::releaseVirtualMemory(p, vSize);
 #else
@@ -269,7 +542,8 @@ static bool vMemMgrCheckTree(VMemMgr* self) noexcept {
 //! Returns set-up `MemNode*` or nullptr if allocation failed.
 static MemNode* vMemMgrCreateNode(VMemMgr* self, size_t size, size_t density) noexcept {
   size_t vSize;
-  uint8_t* vmem = vMemMgrAllocVMem(self, size, &vSize);
+  uint8_t* rw;
+  uint8_t* vmem = vMemMgrAllocVMem(self, size, &vSize, &rw);
   if (!vmem) return nullptr;
 
   size_t blocks = (vSize / density);
@@ -280,7 +554,7 @@ static MemNode* vMemMgrCreateNode(VMemMgr* self, size_t size, size_t density) no
 
   // Out of memory.
   if (!node || !data) {
-    vMemMgrReleaseVMem(self, vmem, vSize);
+    vMemMgrReleaseVMem(self, vmem, rw, vSize);
     if (node) Internal::releaseMemory(node);
     if (data) Internal::releaseMemory(data);
     return nullptr;
@@ -305,6 +579,7 @@ static MemNode* vMemMgrCreateNode(VMemMgr* self, size_t size, size_t density) no
   ::memset(data, 0, bsize * 2);
   node->baUsed = reinterpret_cast<size_t*>(data);
   node->baCont = reinterpret_cast<size_t*>(data + bsize);
+  node->rw = rw;
 
   return node;
 }
@@ -515,6 +790,76 @@ static MemNode* vMemMgrFindNodeByPtr(VMemMgr* self, uint8_t* mem) noexcept {
   return node;
 }
 
+//! \internal
+//!
+//! Remember a released run at `p` that has `size` bytes.
+static void vMemMgrPushRun(VMemMgr* self, uint8_t* p, size_t size) noexcept {
+  if (size < kFreeListUnit)
+    return;
+
+  FreeList* lists = self->_freeLists;
+  if (!lists) {
+    lists = static_cast<FreeList*>(Internal::allocMemory(kFreeListCount * sizeof(FreeList)));
+    if (!lists) return;
+
+    ::memset(lists, 0, kFreeListCount * sizeof(FreeList));
+    self->_freeLists = lists;
+  }
+
+  size_t classId = size / kFreeListUnit - 1;
+  if (classId >= kFreeListCount)
+    classId = kFreeListCount - 1;
+
+  // Drop the oldest run if the list is full.
+  FreeList& list = lists[classId];
+  if (list.count == kFreeListCapacity) {
+    ::memmove(list.runs, list.runs + 1, (kFreeListCapacity - 1) * sizeof(uint8_t*));
+    list.count--;
+  }
+
+  list.runs[list.count++] = p;
+}
+
+//! \internal
+//!
+//! Find a remembered run that has at least `vSize` bytes available.
+//!
+//! Returns the node that contains the run and stores its first block into
+//! `index` and its size in blocks into `need`, or returns nullptr.
+static MemNode* vMemMgrPopRun(VMemMgr* self, size_t vSize, size_t* index, size_t* need) noexcept {
+  FreeList* lists = self->_freeLists;
+  if (!lists) return nullptr;
+
+  size_t classId = (vSize + kFreeListUnit - 1) / kFreeListUnit - 1;
+  if (classId >= kFreeListCount)
+    classId = kFreeListCount - 1;
+
+  for (; classId < kFreeListCount; classId++) {
+    FreeList& list = lists[classId];
+
+    while (list.count) {
+      uint8_t* p = list.runs[--list.count];
+      MemNode* node = vMemMgrFindNodeByPtr(self, p);
+      if (!node) continue;
+
+      size_t offset = (size_t)(p - node->mem);
+      if (offset % node->density != 0)
+        continue;
+
+      size_t i = offset / node->density;
+      size_t n = (vSize + node->density - 1) / node->density;
+
+      if (i + n <= node->blocks && _IsRangeZero(node->baUsed, i, n)) {
+        *index = i;
+        *need = n;
+        return node;
+      }
+    }
+  }
+
+  return nullptr;
+}
+
 static void* vMemMgrAllocPermanent(VMemMgr* self, size_t vSize) noexcept {
   static const size_t permanentAlignment = 32;
   static const size_t permanentNodeSize  = 32768;
@@ -536,7 +881,7 @@ static void* vMemMgrAllocPermanent(VMemMgr* self, size_t vSize) noexcept {
     node = static_cast<PermanentNode*>(Internal::allocMemory(sizeof(PermanentNode)));
     if (!node) return nullptr;
 
-    node->mem = vMemMgrAllocVMem(self, nodeSize, &node->size);
+    node->mem = vMemMgrAllocVMem(self, nodeSize, &node->size, &node->rw);
     if (!node->mem) {
       Internal::releaseMemory(node);
       return nullptr;
@@ -572,7 +917,14 @@ static void* vMemMgrAllocFreeable(VMemMgr* self, size_t vSize) noexcept {
     return nullptr;
 
   AutoLock locked(self->_lock);
-  MemNode* node = self->_optimal;
+  MemNode* node;
+
+  // Try recently released runs first, small blocks are typically served here.
+  node = vMemMgrPopRun(self, vSize, &i, &need);
+  if (node)
+    goto L_Found;
+
+  node = self->_optimal;
   minVSize = self->_blockSize;
 
   // Try to find memory block in existing nodes.
@@ -589,53 +941,60 @@ static void* vMemMgrAllocFreeable(VMemMgr* self, size_t vSize) noexcept {
     }
 
     size_t* up = node->baUsed;     // Current ubits address.
-    size_t ubits;                  // Current ubits[0] value.
-    size_t bit;                    // Current bit mask.
     size_t blocks = node->blocks;  // Count of blocks in node.
-    size_t cont = 0;               // How many bits are currently freed in find loop.
+    size_t cont = 0;               // Free blocks at the end of the previous word(s).
     size_t maxCont = 0;            // Largest continuous block (bits count).
-    size_t j;
 
     need = M_DIV((vSize + node->density - 1), node->density);
-    i = 0;
 
-    // Try to find node that is large enough.
-    while (i < blocks) {
-      ubits = *up++;
+    // Try to find node that is large enough, a word at a time.
+    for (i = 0; i < blocks; i += kBitsPerEntity) {
+      size_t ubits = *up++;
 
-      // Fast skip used blocks.
-      if (ubits == ~(size_t)0) {
-        if (cont > maxCont)
-          maxCont = cont;
-        cont = 0;
+      // Blocks past the end of the node are treated as used.
+      if (blocks - i < kBitsPerEntity)
+        ubits |= (~(size_t)0) << (blocks - i);
 
-        i += kBitsPerEntity;
+      // Fast path for a completely free word, the run continues.
+      if (ubits == 0) {
+        cont += kBitsPerEntity;
+        if (cont >= need) {
+          i = i + kBitsPerEntity - cont;
+          goto L_Found;
+        }
         continue;
       }
 
-      size_t max = kBitsPerEntity;
-      if (i + max > blocks)
-        max = blocks - i;
-
-      for (j = 0, bit = 1; j < max; bit <<= 1) {
-        j++;
-        if ((ubits & bit) == 0) {
-          if (++cont == need) {
-            i += j;
-            i -= cont;
-            goto L_Found;
-          }
+      // Free blocks at the start of the word complete the previous run.
+      size_t head = _FirstBit(ubits);
+      if (cont + head >= need) {
+        i -= cont;
+        goto L_Found;
+      }
 
-          continue;
-        }
+      if (cont + head > maxCont)
+        maxCont = cont + head;
 
-        if (cont > maxCont) maxCont = cont;
-        cont = 0;
+      // Runs that start and end within the word.
+      if (need < kBitsPerEntity) {
+        size_t runs = _FindRuns(ubits, need);
+        if (runs) {
+          i += _FirstBit(runs);
+          goto L_Found;
+        }
       }
 
-      i += kBitsPerEntity;
+      size_t longest = _LongestRun(ubits);
+      if (longest > maxCont)
+        maxCont = longest;
+
+      // Free blocks at the end of the word start a new run.
+      cont = kBitsPerEntity - 1 - _LastBit(ubits);
     }
 
+    if (cont > maxCont)
+      maxCont = cont;
+
     // Because we traversed the entire node, we can set largest node size that
     // will be used to cache next traversing.
     node->largestBlock = maxCont * node->density;
@@ -685,104 +1044,12 @@ L_Found:
 
 //! \internal
 //!
-//! Reset the whole `VMemMgr` instance, freeing all heap memory allocated an
-//! virtual memory allocated unless `keepVirtualMemory` is true (and this is
-//! only used when writing data to a remote process).
-static void vMemMgrReset(VMemMgr* self, bool keepVirtualMemory) noexcept {
-  MemNode* node = self->_first;
-
-  while (node) {
-    MemNode* next = node->next;
-
-    if (!keepVirtualMemory)
-      vMemMgrReleaseVMem(self, node->mem, node->size);
-
-    Internal::releaseMemory(node->baUsed);
-    Internal::releaseMemory(node);
-
-    node = next;
-  }
-
-  self->_allocatedBytes = 0;
-  self->_usedBytes = 0;
-
-  self->_root = nullptr;
-  self->_first = nullptr;
-  self->_last = nullptr;
-  self->_optimal = nullptr;
-}
-
-// ============================================================================
-// [asmjit::VMemMgr - Construction / Destruction]
-// ============================================================================
-
-#if !ASMJIT_OS_WINDOWS
-VMemMgr::VMemMgr() noexcept {
-#else
-VMemMgr::VMemMgr(HANDLE hProcess) noexcept {
-#endif
-
-  VMemInfo vm = OSUtils::getVirtualMemoryInfo();
-
-#if ASMJIT_OS_WINDOWS
-  _hProcess = hProcess ? hProcess : vm.hCurrentProcess;
-#endif // ASMJIT_OS_WINDOWS
-
-  _blockSize = vm.pageGranularity;
-  _blockDensity = 64;
-
-  _allocatedBytes = 0;
-  _usedBytes = 0;
-
-  _root = nullptr;
-  _first = nullptr;
-  _last = nullptr;
-  _optimal = nullptr;
-
-  _permanent = nullptr;
-  _keepVirtualMemory = false;
-}
-
-VMemMgr::~VMemMgr() noexcept {
-  // Freeable memory cleanup - Also frees the virtual memory if configured to.
-  vMemMgrReset(this, _keepVirtualMemory);
-
-  // Permanent memory cleanup - Never frees the virtual memory.
-  PermanentNode* node = _permanent;
-  while (node) {
-    PermanentNode* prev = node->prev;
-    Internal::releaseMemory(node);
-    node = prev;
-  }
-}
-
-// ============================================================================
-// [asmjit::VMemMgr - Reset]
-// ============================================================================
-
-void VMemMgr::reset() noexcept {
-  vMemMgrReset(this, false);
-}
-
-// ============================================================================
-// [asmjit::VMemMgr - Alloc / Release]
-// ============================================================================
-
-void* VMemMgr::alloc(size_t size, uint32_t type) noexcept {
-  if (type == kAllocPermanent)
-    return vMemMgrAllocPermanent(this, size);
-  else
-    return vMemMgrAllocFreeable(this, size);
-}
-
-Error VMemMgr::release(void* p) noexcept {
-  if (!p) return kErrorOk;
-
-  AutoLock locked(_lock);
-  MemNode* node = vMemMgrFindNodeByPtr(this, static_cast<uint8_t*>(p));
+//! Release memory at `p`, must be called with `self->_lock` held.
+static Error vMemMgrReleaseLocked(VMemMgr* self, uint8_t* p) noexcept {
+  MemNode* node = vMemMgrFindNodeByPtr(self, p);
   if (!node) return DebugUtils::errored(kErrorInvalidArgument);
 
-  size_t offset = (size_t)((uint8_t*)p - (uint8_t*)node->mem);
+  size_t offset = (size_t)(p - node->mem);
   size_t bitpos = M_DIV(offset, node->density);
   size_t i = (bitpos / kBitsPerEntity);
 
@@ -818,12 +1085,12 @@ Error VMemMgr::release(void* p) noexcept {
   // If the freed block is fully allocated node then it's needed to
   // update 'optimal' pointer in memory manager.
   if (node->used == node->size) {
-    MemNode* cur = _optimal;
+    MemNode* cur = self->_optimal;
 
     do {
       cur = cur->prev;
       if (cur == node) {
-        _optimal = node;
+        self->_optimal = node;
         break;
       }
     } while (cur);
@@ -835,59 +1102,1081 @@ Error VMemMgr::release(void* p) noexcept {
     node->largestBlock = cont;
 
   node->used -= cont;
-  _usedBytes -= cont;
+  self->_usedBytes -= cont;
 
-  // If page is empty, we can free it.
-  if (node->used == 0) {
+  // If page is empty, we can free it. The last large page arena is kept as
+  // it's expensive to map it again.
+  if (node->used == 0 && !(self->_largePagesEnabled && self->_first == self->_last)) {
     // Free memory associated with node (this memory is not accessed
     // anymore so it's safe).
-    vMemMgrReleaseVMem(this, node->mem, node->size);
+    vMemMgrReleaseVMem(self, node->mem, node->rw, node->size);
     Internal::releaseMemory(node->baUsed);
 
     node->baUsed = nullptr;
     node->baCont = nullptr;
 
     // Statistics.
-    _allocatedBytes -= node->size;
+    self->_allocatedBytes -= node->size;
 
     // Remove node. This function can return different node than
     // passed into, but data is copied into previous node if needed.
-    Internal::releaseMemory(vMemMgrRemoveNode(this, node));
-    ASMJIT_ASSERT(vMemMgrCheckTree(this));
+    Internal::releaseMemory(vMemMgrRemoveNode(self, node));
+    ASMJIT_ASSERT(vMemMgrCheckTree(self));
+  }
+  else if (node->used != 0) {
+    vMemMgrPushRun(self, p, cont);
   }
 
   return kErrorOk;
 }
 
-Error VMemMgr::shrink(void* p, size_t used) noexcept {
-  if (!p) return kErrorOk;
-  if (used == 0)
-    return release(p);
+// ============================================================================
+// [asmjit::VMemMgr - ThreadCache]
+// ============================================================================
 
-  AutoLock locked(_lock);
-  MemNode* node = vMemMgrFindNodeByPtr(this, (uint8_t*)p);
-  if (!node) return DebugUtils::errored(kErrorInvalidArgument);
+// Thread caches sit in front of `vMemMgrAllocFreeable()`. Each cache owns
+// chunks carved from the shared `MemNode`s. A chunk covers exactly one word of
+// the node's bit-arrays, so it's aligned to its size. Each chunk is split into
+// slots of a single size class, thus the state of all its slots fits into a
+// single `size_t` and finding a free slot is a single bit-scan:
+//
+// - `used` bits are only accessed by the owning thread, thus alloc and release
+//   done by the owner never take the lock. Chunks that have free slots are
+//   linked in per-class lists, full chunks are not linked at all.
+//
+// - `remote` bits are set atomically by threads that release memory they don't
+//   own. The thread that sets the first bit pushes the chunk to a lock-free
+//   stack of its owner, which is drained by the owner when it runs out of free
+//   slots of the requested class (before it asks the shared allocator).
+//
+// A radix map is used to translate an address into a chunk without locking.
+// Its inner arrays are created under the lock and are never released before
+// the `VMemMgr` is destroyed, so readers only need acquire loads.
+//
+// When a thread terminates its caches are flushed - empty chunks are returned
+// to the shared nodes and the caches become orphaned (their `threadId` is
+// zero). Slots of an orphaned cache are released under the lock and a chunk
+// is returned as soon as it's empty. An orphaned cache is adopted by the next
+// thread that needs a new cache, so their count is bounded by the count of
+// threads that run at the same time.
 
-  size_t offset = (size_t)((uint8_t*)p - (uint8_t*)node->mem);
-  size_t bitpos = M_DIV(offset, node->density);
-  size_t i = (bitpos / kBitsPerEntity);
+//! \internal
+enum {
+  kCacheDensity    = 64,                        // Size of a block within a chunk.
+  kCacheBlocks     = kBitsPerEntity,            // Blocks per chunk.
+  kCacheChunkSize  = kCacheBlocks * kCacheDensity,
+  kCacheChunkShift = ASMJIT_ARCH_64BIT ? 12 : 11,
+  kCacheMaxBlocks  = kCacheBlocks / 2,          // The largest cached allocation (in blocks).
+  kCacheMaxEmpty   = 8,                         // Maximum empty chunks kept by a thread cache.
+  kCacheClassCount = ASMJIT_ARCH_64BIT ? 12 : 10,
+
+  kCacheMapBits    = ASMJIT_ARCH_64BIT ? 12 : 7,
+  kCacheMapSize    = 1 << kCacheMapBits,
+  kCacheMapMask    = kCacheMapSize - 1,
+  kCacheRootBits   = (ASMJIT_ARCH_64BIT ? 48 : 32) - kCacheChunkShift - kCacheMapBits * 2,
+  kCacheRootSize   = 1 << kCacheRootBits
+};
 
-  size_t* up = node->baUsed + i;  // Current ubits address.
-  size_t* cp = node->baCont + i;  // Current cbits address.
-  size_t ubits = *up;             // Current ubits[0] value.
-  size_t cbits = *cp;             // Current cbits[0] value.
-  size_t bit = (size_t)1 << (bitpos % kBitsPerEntity);
+// Size of each class in blocks and a class of each size (up to 32 blocks).
+static const uint8_t vMemCacheClassSize[12] = {
+  1, 2, 3, 4, 5, 6, 8, 10, 12, 16, 21, 32
+};
 
-  size_t cont = 0;
-  size_t usedBlocks = (used + node->density - 1) / node->density;
+static const uint8_t vMemCacheClassOf[33] = {
+  0, 0, 1, 2, 3, 4, 5, 6, 6, 7, 7, 8, 8, 9, 9, 9, 9,
+  10, 10, 10, 10, 10, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11
+};
 
-  bool stop;
+//! \internal
+//!
+//! Chunk of slots owned by a `ThreadCache`.
+struct VMemMgr::CacheChunk {
+  CacheChunk* prev;                      // Prev chunk in a list of `owner`.
+  CacheChunk* next;                      // Next chunk in a list of `owner`.
+  CacheChunk* remoteNext;                // Next chunk in the remote stack of `owner`.
+  ThreadCache* owner;                    // Owner of this chunk.
+  uint8_t* mem;                          // Chunk memory (aligned to `kCacheChunkSize`).
+  size_t slotSize;                       // Size of a slot in bytes.
+  size_t slots;                          // Blocks where slots start.
+  size_t used;                           // Used slots (owner only).
+  volatile size_t remote;                // Slots released by other threads (atomic).
+  uint32_t classId;                      // Size class of slots.
+};
 
-  // Find the first block we can mark as free.
-  for (;;) {
-    stop = (cbits & bit) == 0;
-    if (stop)
-      return kErrorOk;
+//! \internal
+//!
+//! Per-thread cache.
+struct VMemMgr::ThreadCache {
+  ThreadCache* next;                     // Next cache of the same `VMemMgr`.
+  ThreadCache* threadNext;               // Next cache of the same thread.
+  VMemMgr* owner;                        // Owner of this cache.
+  volatile size_t threadId;              // Id of the owning thread, zero if orphaned.
+  volatile size_t state;                 // Spin-lock and state flags (see `kCacheState...`).
+  CacheChunk* volatile remote;           // Chunks that have remote slots (lock-free stack).
+  CacheChunk* empty;                     // Chunks that have no used slots.
+  size_t emptyCount;                     // Count of empty chunks.
+  CacheChunk* partial[kCacheClassCount]; // Chunks that have free slots, per class.
+};
+
+//! \internal
+//!
+//! State of `ThreadCache`, changed only when `kCacheStateLocked` is held.
+enum {
+  kCacheStateLocked   = 0x1,            // Spin-lock.
+  kCacheStateLinked   = 0x2,            // Linked in a thread list, freed by the thread.
+  kCacheStateDetached = 0x4             // The `VMemMgr` was reset or destroyed.
+};
+
+// The last cache used by the current thread. The serial number is unique per
+// `VMemMgr` instance and it's regenerated by `reset()`, so a stale cache from
+// a destroyed or reset instance is never used.
+static ASMJIT_THREAD_LOCAL size_t vMemCacheTlsSerial;
+static ASMJIT_THREAD_LOCAL ThreadCache* vMemCacheTlsCache;
+// All caches of the current thread, flushed when the thread terminates.
+static ASMJIT_THREAD_LOCAL ThreadCache* vMemCacheTlsList;
+
+static volatile size_t vMemCacheSerialCounter;
+
+static ASMJIT_INLINE size_t vMemCacheNewSerial() noexcept {
+  return AtomicUtils::fetchAdd(&vMemCacheSerialCounter, 1) + 1;
+}
+
+// Address of a thread-local variable is used as a thread id, it's unique for
+// all threads that are alive.
+static ASMJIT_INLINE size_t vMemCacheThreadId() noexcept {
+  return (size_t)&vMemCacheTlsSerial;
+}
+
+//! \internal
+//!
+//! Acquire the spin-lock of `cache`, returns its state flags.
+static ASMJIT_INLINE size_t vMemCacheLockState(ThreadCache* cache) noexcept {
+  for (;;) {
+    size_t state = AtomicUtils::load(&cache->state) & ~static_cast<size_t>(kCacheStateLocked);
+    if (AtomicUtils::compareExchange(&cache->state, state, state | kCacheStateLocked))
+      return state;
+  }
+}
+
+//! \internal
+//!
+//! Release the spin-lock of `cache` and set its state flags to `state`.
+static ASMJIT_INLINE void vMemCacheUnlockState(ThreadCache* cache, size_t state) noexcept {
+  AtomicUtils::store(&cache->state, state & ~static_cast<size_t>(kCacheStateLocked));
+}
+
+static ASMJIT_INLINE void vMemCacheLink(CacheChunk** pList, CacheChunk* chunk) noexcept {
+  CacheChunk* head = *pList;
+
+  chunk->prev = nullptr;
+  chunk->next = head;
+
+  if (head) head->prev = chunk;
+  *pList = chunk;
+}
+
+static ASMJIT_INLINE void vMemCacheUnlink(CacheChunk** pList, CacheChunk* chunk) noexcept {
+  CacheChunk* prev = chunk->prev;
+  CacheChunk* next = chunk->next;
+
+  if (prev)
+    prev->next = next;
+  else
+    *pList = next;
+
+  if (next) next->prev = prev;
+
+  chunk->prev = nullptr;
+  chunk->next = nullptr;
+}
+
+static ASMJIT_INLINE CacheChunk* vMemCacheFindChunk(VMemMgr* self, const void* p) noexcept {
+  size_t key = static_cast<size_t>((uintptr_t)p >> kCacheChunkShift);
+  if (key >> (kCacheMapBits * 2) >= kCacheRootSize)
+    return nullptr;
+
+  size_t* mid = reinterpret_cast<size_t*>(AtomicUtils::load(&self->_cacheMap[key >> (kCacheMapBits * 2)]));
+  if (!mid) return nullptr;
+
+  size_t* leaf = reinterpret_cast<size_t*>(AtomicUtils::load(&mid[(key >> kCacheMapBits) & kCacheMapMask]));
+  if (!leaf) return nullptr;
+
+  return reinterpret_cast<CacheChunk*>(AtomicUtils::load(&leaf[key & kCacheMapMask]));
+}
+
+//! \internal
+//!
+//! Associate `p` with `chunk` in the radix map, must be called with lock held.
+static Error vMemCacheMapChunk(VMemMgr* self, const void* p, CacheChunk* chunk) noexcept {
+  size_t key = static_cast<size_t>((uintptr_t)p >> kCacheChunkShift);
+  if (key >> (kCacheMapBits * 2) >= kCacheRootSize)
+    return DebugUtils::errored(kErrorNoVirtualMemory);
+
+  size_t* slot = &self->_cacheMap[key >> (kCacheMapBits * 2)];
+  for (uint32_t level = 0; level < 2; level++) {
+    size_t* array = reinterpret_cast<size_t*>(*slot);
+    if (!array) {
+      if (!chunk) return kErrorOk;
+
+      array = static_cast<size_t*>(Internal::allocMemory(kCacheMapSize * sizeof(size_t)));
+      if (ASMJIT_UNLIKELY(!array))
+        return DebugUtils::errored(kErrorNoHeapMemory);
+
+      ::memset(array, 0, kCacheMapSize * sizeof(size_t));
+      AtomicUtils::storePtr(reinterpret_cast<size_t* volatile*>(slot), array);
+    }
+
+    size_t shift = level == 0 ? kCacheMapBits : 0;
+    slot = &array[(key >> shift) & kCacheMapMask];
+  }
+
+  AtomicUtils::store(slot, reinterpret_cast<size_t>(chunk));
+  return kErrorOk;
+}
+
+//! \internal
+//!
+//! Release the radix map, called by the destructor.
+static void vMemCacheReleaseMap(VMemMgr* self) noexcept {
+  size_t* root = self->_cacheMap;
+  if (!root) return;
+
+  for (size_t i = 0; i < kCacheRootSize; i++) {
+    size_t* mid = reinterpret_cast<size_t*>(root[i]);
+    if (!mid) continue;
+
+    for (size_t j = 0; j < kCacheMapSize; j++)
+      Internal::releaseMemory(reinterpret_cast<size_t*>(mid[j]));
+    Internal::releaseMemory(mid);
+  }
+
+  Internal::releaseMemory(root);
+  self->_cacheMap = nullptr;
+}
+
+//! \internal
+//!
+//! Carve a new chunk from the shared nodes, the chunk is not linked.
+static CacheChunk* vMemCacheNewChunk(VMemMgr* self, ThreadCache* cache) noexcept {
+  CacheChunk* chunk = static_cast<CacheChunk*>(Internal::allocMemory(sizeof(CacheChunk)));
+  if (ASMJIT_UNLIKELY(!chunk)) return nullptr;
+
+  AutoLock locked(self->_lock);
+  MemNode* node;
+  size_t i;
+
+  // Find a word of blocks that is completely free.
+  for (node = self->_optimal; node; node = node->next) {
+    if (node->getAvailable() < kCacheChunkSize) {
+      if (node == self->_optimal && node->next)
+        self->_optimal = node->next;
+      continue;
+    }
+
+    size_t words = node->blocks / kBitsPerEntity;
+    for (i = 0; i < words; i++)
+      if (node->baUsed[i] == 0)
+        goto L_Found;
+  }
+
+  {
+    size_t blockSize = std::max<size_t>(self->_blockSize, kCacheChunkSize);
+
+    node = vMemMgrCreateNode(self, blockSize, kCacheDensity);
+    if (!node) {
+      Internal::releaseMemory(chunk);
+      return nullptr;
+    }
+
+    vMemMgrInsertNode(self, node);
+    ASMJIT_ASSERT(vMemMgrCheckTree(self));
+
+    self->_allocatedBytes += node->size;
+    i = 0;
+  }
+
+L_Found:
+  {
+    size_t index = i * kBitsPerEntity;
+    _SetBits(node->baUsed, index, kCacheBlocks);
+    _SetBits(node->baCont, index, kCacheBlocks - 1);
+
+    node->used += kCacheChunkSize;
+    node->largestBlock = 0;
+    self->_usedBytes += kCacheChunkSize;
+
+    chunk->mem = node->mem + index * kCacheDensity;
+  }
+
+  if (ASMJIT_UNLIKELY(vMemCacheMapChunk(self, chunk->mem, chunk) != kErrorOk)) {
+    vMemMgrReleaseLocked(self, chunk->mem);
+    Internal::releaseMemory(chunk);
+    return nullptr;
+  }
+
+  chunk->prev = nullptr;
+  chunk->next = nullptr;
+  chunk->remoteNext = nullptr;
+  chunk->owner = cache;
+  chunk->used = 0;
+  chunk->remote = 0;
+  return chunk;
+}
+
+//! \internal
+//!
+//! Split an empty `chunk` into slots of the given class.
+static ASMJIT_INLINE void vMemCacheInitChunk(CacheChunk* chunk, uint32_t classId) noexcept {
+  size_t n = vMemCacheClassSize[classId];
+  size_t slots = 0;
+
+  for (size_t i = 0; i + n <= kCacheBlocks; i += n)
+    slots |= static_cast<size_t>(1) << i;
+
+  chunk->slotSize = n * kCacheDensity;
+  chunk->slots = slots;
+  chunk->classId = classId;
+}
+
+//! \internal
+//!
+//! Return an empty `chunk` to the shared nodes, must be called with lock held.
+static ASMJIT_INLINE void vMemCacheReleaseChunkLocked(VMemMgr* self, CacheChunk* chunk) noexcept {
+  vMemCacheMapChunk(self, chunk->mem, nullptr);
+  vMemMgrReleaseLocked(self, chunk->mem);
+  Internal::releaseMemory(chunk);
+}
+
+//! \internal
+//!
+//! Free `mask` slots of `chunk`, called by the owner only. If the cache is
+//! orphaned the caller must hold the lock instead.
+static void vMemCacheFreeSlots(VMemMgr* self, ThreadCache* cache, CacheChunk* chunk, size_t mask) noexcept {
+  bool wasFull = chunk->used == chunk->slots;
+  chunk->used &= ~mask;
+
+  if (chunk->used != 0) {
+    if (wasFull)
+      vMemCacheLink(&cache->partial[chunk->classId], chunk);
+    return;
+  }
+
+  if (!wasFull)
+    vMemCacheUnlink(&cache->partial[chunk->classId], chunk);
+
+  // Orphaned caches don't keep empty chunks, the lock is already held.
+  if (cache->threadId == 0) {
+    vMemCacheReleaseChunkLocked(self, chunk);
+    return;
+  }
+
+  if (cache->emptyCount < kCacheMaxEmpty) {
+    vMemCacheLink(&cache->empty, chunk);
+    cache->emptyCount++;
+    return;
+  }
+
+  // Return the chunk to the shared nodes.
+  AutoLock locked(self->_lock);
+  vMemCacheReleaseChunkLocked(self, chunk);
+}
+
+//! \internal
+//!
+//! Reclaim all slots released by other threads, returns true if any.
+static bool vMemCacheReclaim(VMemMgr* self, ThreadCache* cache) noexcept {
+  CacheChunk* chunk = reinterpret_cast<CacheChunk*>(
+    AtomicUtils::exchange(reinterpret_cast<volatile size_t*>(&cache->remote), 0));
+
+  if (!chunk)
+    return false;
+
+  do {
+    // Must be read before `remote` is cleared, the chunk can be pushed again
+    // by another thread right after that.
+    CacheChunk* next = chunk->remoteNext;
+    size_t bits = AtomicUtils::exchange(&chunk->remote, 0);
+
+    if (bits)
+      vMemCacheFreeSlots(self, cache, chunk, bits);
+    chunk = next;
+  } while (chunk);
+
+  return true;
+}
+
+//! \internal
+//!
+//! Flush `cache` of a terminating thread, must be called with lock held.
+//!
+//! A thread that loaded the thread id before it was cleared may still push a
+//! chunk to the remote stack, such slots are reclaimed when the cache is
+//! adopted.
+static void vMemCacheOrphanLocked(VMemMgr* self, ThreadCache* cache) noexcept {
+  AtomicUtils::store(&cache->threadId, 0);
+  vMemCacheReclaim(self, cache);
+
+  CacheChunk* chunk = cache->empty;
+  while (chunk) {
+    CacheChunk* next = chunk->next;
+    vMemCacheReleaseChunkLocked(self, chunk);
+    chunk = next;
+  }
+
+  cache->empty = nullptr;
+  cache->emptyCount = 0;
+}
+
+//! \internal
+//!
+//! Called when a thread that has caches terminates, `data` is the first cache
+//! of `vMemCacheTlsList`.
+//!
+//! The lock is always acquired before the spin-lock of a cache (`reset()` can
+//! be called with the lock held), so the lock is only tried here and the
+//! spin-lock is released if it's busy.
+static void vMemCacheThreadExit(void* data) noexcept {
+  ThreadCache* cache = static_cast<ThreadCache*>(data);
+
+  while (cache) {
+    ThreadCache* next = cache->threadNext;
+
+    for (;;) {
+      size_t state = vMemCacheLockState(cache);
+
+      if (state & kCacheStateDetached) {
+        // The `VMemMgr` was reset or destroyed and left the cache to us.
+        Internal::releaseMemory(cache);
+        break;
+      }
+
+      // The spin-lock is held until the lock is released, `reset()` waits for
+      // it before it releases the cache and the `VMemMgr` itself.
+      VMemMgr* self = cache->owner;
+      if (self->_lock.tryLock()) {
+        vMemCacheOrphanLocked(self, cache);
+        self->_lock.unlock();
+        vMemCacheUnlockState(cache, state & ~static_cast<size_t>(kCacheStateLinked));
+        break;
+      }
+
+      vMemCacheUnlockState(cache, state);
+    }
+
+    cache = next;
+  }
+
+  vMemCacheTlsSerial = 0;
+  vMemCacheTlsCache = nullptr;
+  vMemCacheTlsList = nullptr;
+}
+
+#if ASMJIT_OS_WINDOWS
+static volatile size_t vMemCacheFlsIndex; // FLS index + 1, zero if not allocated.
+
+static VOID WINAPI vMemCacheFlsCallback(PVOID data) {
+  vMemCacheThreadExit(data);
+}
+
+//! \internal
+//!
+//! Make `list` the thread data passed to `vMemCacheThreadExit()`.
+static bool vMemCacheSetThreadList(ThreadCache* list) noexcept {
+  size_t index = AtomicUtils::load(&vMemCacheFlsIndex);
+  if (!index) {
+    DWORD newIndex = ::FlsAlloc(vMemCacheFlsCallback);
+    if (newIndex == FLS_OUT_OF_INDEXES)
+      return false;
+
+    if (AtomicUtils::compareExchange(&vMemCacheFlsIndex, 0, static_cast<size_t>(newIndex) + 1)) {
+      index = static_cast<size_t>(newIndex) + 1;
+    }
+    else {
+      ::FlsFree(newIndex);
+      index = AtomicUtils::load(&vMemCacheFlsIndex);
+    }
+  }
+
+  return ::FlsSetValue(static_cast<DWORD>(index - 1), list) != 0;
+}
+#else
+static pthread_once_t vMemCacheKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t vMemCacheKey;
+static bool vMemCacheKeyValid;
+
+static void vMemCacheInitKey() noexcept {
+  vMemCacheKeyValid = pthread_key_create(&vMemCacheKey, vMemCacheThreadExit) == 0;
+}
+
+//! \internal
+//!
+//! Make `list` the thread data passed to `vMemCacheThreadExit()`.
+static bool vMemCacheSetThreadList(ThreadCache* list) noexcept {
+  pthread_once(&vMemCacheKeyOnce, vMemCacheInitKey);
+  return vMemCacheKeyValid && pthread_setspecific(vMemCacheKey, list) == 0;
+}
+#endif
+
+//! \internal
+//!
+//! Link `cache` to the list of the current thread, caches of reset or destroyed
+//! `VMemMgr` instances are released. Without the list `reset()` releases it.
+static void vMemCacheLinkThread(ThreadCache* cache) noexcept {
+  ThreadCache** pPrev = &vMemCacheTlsList;
+  ThreadCache* node;
+
+  while ((node = *pPrev) != nullptr) {
+    size_t state = vMemCacheLockState(node);
+    if (state & kCacheStateDetached) {
+      *pPrev = node->threadNext;
+      Internal::releaseMemory(node);
+    }
+    else {
+      vMemCacheUnlockState(node, state);
+      pPrev = &node->threadNext;
+    }
+  }
+
+  cache->threadNext = vMemCacheTlsList;
+  if (!vMemCacheSetThreadList(cache))
+    return;
+
+  size_t state = vMemCacheLockState(cache);
+  vMemCacheUnlockState(cache, state | kCacheStateLinked);
+  vMemCacheTlsList = cache;
+}
+
+//! \internal
+//!
+//! Get a cache of the current thread, creates it if it doesn't exist.
+static ThreadCache* vMemCacheGet(VMemMgr* self) noexcept {
+  if (ASMJIT_LIKELY(vMemCacheTlsSerial == self->_cacheSerial))
+    return vMemCacheTlsCache;
+
+  size_t threadId = vMemCacheThreadId();
+  AutoLock locked(self->_lock);
+
+  // The current thread may already have a cache if it used another instance
+  // since, otherwise the first orphaned cache is adopted.
+  ThreadCache* cache = self->_threadCaches;
+  ThreadCache* orphan = nullptr;
+
+  while (cache && cache->threadId != threadId) {
+    if (!orphan && cache->threadId == 0)
+      orphan = cache;
+    cache = cache->next;
+  }
+
+  if (!cache) {
+    if (orphan) {
+      cache = orphan;
+      AtomicUtils::store(&cache->threadId, threadId);
+    }
+    else {
+      cache = static_cast<ThreadCache*>(Internal::allocMemory(sizeof(ThreadCache)));
+      if (ASMJIT_UNLIKELY(!cache)) return nullptr;
+
+      ::memset(cache, 0, sizeof(ThreadCache));
+      cache->next = self->_threadCaches;
+      cache->owner = self;
+      cache->threadId = threadId;
+      self->_threadCaches = cache;
+    }
+    vMemCacheLinkThread(cache);
+  }
+
+  vMemCacheTlsSerial = self->_cacheSerial;
+  vMemCacheTlsCache = cache;
+  return cache;
+}
+
+static void* vMemCacheAlloc(VMemMgr* self, size_t vSize) noexcept {
+  ThreadCache* cache = vMemCacheGet(self);
+  if (ASMJIT_UNLIKELY(!cache)) return nullptr;
+
+  uint32_t classId = vMemCacheClassOf[(vSize + kCacheDensity - 1) / kCacheDensity];
+  CacheChunk* chunk = cache->partial[classId];
+
+  if (ASMJIT_UNLIKELY(!chunk)) {
+    // Reclaim slots released by other threads first, then reuse an empty
+    // chunk, and carve a new one from the shared nodes as a last resort.
+    if (AtomicUtils::loadPtr(&cache->remote) && vMemCacheReclaim(self, cache))
+      chunk = cache->partial[classId];
+
+    if (!chunk) {
+      chunk = cache->empty;
+      if (chunk) {
+        vMemCacheUnlink(&cache->empty, chunk);
+        cache->emptyCount--;
+      }
+      else {
+        chunk = vMemCacheNewChunk(self, cache);
+        if (ASMJIT_UNLIKELY(!chunk)) return nullptr;
+      }
+
+      vMemCacheInitChunk(chunk, classId);
+      vMemCacheLink(&cache->partial[classId], chunk);
+    }
+  }
+
+  size_t index = _FirstBit(chunk->slots & ~chunk->used);
+  chunk->used |= static_cast<size_t>(1) << index;
+
+  if (chunk->used == chunk->slots)
+    vMemCacheUnlink(&cache->partial[classId], chunk);
+
+  return chunk->mem + index * kCacheDensity;
+}
+
+static Error vMemCacheRelease(VMemMgr* self, CacheChunk* chunk, uint8_t* p) noexcept {
+  size_t offset = (size_t)(p - chunk->mem);
+  if (ASMJIT_UNLIKELY(offset % chunk->slotSize != 0))
+    return DebugUtils::errored(kErrorInvalidArgument);
+
+  size_t bit = static_cast<size_t>(1) << (offset / kCacheDensity);
+  if (ASMJIT_UNLIKELY(!(chunk->slots & bit)))
+    return DebugUtils::errored(kErrorInvalidArgument);
+
+  ThreadCache* cache = chunk->owner;
+  size_t threadId = AtomicUtils::load(&cache->threadId);
+
+  // The owner has terminated - release under the lock, unless the cache has
+  // been adopted in the meantime.
+  if (ASMJIT_UNLIKELY(threadId == 0)) {
+    AutoLock locked(self->_lock);
+    threadId = cache->threadId;
+
+    if (threadId == 0) {
+      if (ASMJIT_UNLIKELY(!(chunk->used & bit)))
+        return DebugUtils::errored(kErrorInvalidArgument);
+
+      vMemCacheFreeSlots(self, cache, chunk, bit);
+      return kErrorOk;
+    }
+  }
+
+  // Released by a thread that doesn't own the chunk - lock-free return. The
+  // thread that sets the first bit is responsible for pushing the chunk.
+  if (threadId != vMemCacheThreadId()) {
+    if (AtomicUtils::fetchOr(&chunk->remote, bit) == 0) {
+      for (;;) {
+        CacheChunk* head = AtomicUtils::loadPtr(&cache->remote);
+        chunk->remoteNext = head;
+
+        if (AtomicUtils::compareExchange(reinterpret_cast<volatile size_t*>(&cache->remote),
+                                         reinterpret_cast<size_t>(head),
+                                         reinterpret_cast<size_t>(chunk)))
+          break;
+      }
+    }
+    return kErrorOk;
+  }
+
+  if (ASMJIT_UNLIKELY(!(chunk->used & bit)))
+    return DebugUtils::errored(kErrorInvalidArgument);
+
+  vMemCacheFreeSlots(self, cache, chunk, bit);
+  return kErrorOk;
+}
+
+static Error vMemCacheShrink(CacheChunk* chunk, uint8_t* p) noexcept {
+  // Slots have a fixed size, so there is nothing to shrink.
+  size_t offset = (size_t)(p - chunk->mem);
+  if (ASMJIT_UNLIKELY(offset % chunk->slotSize != 0))
+    return DebugUtils::errored(kErrorInvalidArgument);
+
+  return kErrorOk;
+}
+
+//! \internal
+//!
+//! Return empty chunks of the current thread's cache to the shared nodes, must
+//! be called with lock held. Empty chunks of other threads can't be touched,
+//! they are returned when their threads terminate.
+static void vMemCacheReleaseEmptyLocked(VMemMgr* self) noexcept {
+  if (vMemCacheTlsSerial != self->_cacheSerial)
+    return;
+
+  ThreadCache* cache = vMemCacheTlsCache;
+  CacheChunk* chunk = cache->empty;
+
+  while (chunk) {
+    CacheChunk* next = chunk->next;
+    vMemCacheReleaseChunkLocked(self, chunk);
+    chunk = next;
+  }
+
+  cache->empty = nullptr;
+  cache->emptyCount = 0;
+}
+
+//! \internal
+//!
+//! Destroy all thread caches, the memory of their chunks is not released.
+//!
+//! Caches linked to a thread list are detached and released by their thread,
+//! this waits for threads that are flushing them as they terminate.
+static void vMemCacheReset(VMemMgr* self) noexcept {
+  ThreadCache* cache = self->_threadCaches;
+
+  while (cache) {
+    ThreadCache* next = cache->next;
+    size_t state = vMemCacheLockState(cache);
+
+    if (state & kCacheStateLinked)
+      vMemCacheUnlockState(cache, state | kCacheStateDetached);
+    else
+      Internal::releaseMemory(cache);
+
+    cache = next;
+  }
+
+  // Full chunks are not linked anywhere, use the map to find all of them.
+  size_t* root = self->_cacheMap;
+  if (root) {
+    for (size_t i = 0; i < kCacheRootSize; i++) {
+      size_t* mid = reinterpret_cast<size_t*>(root[i]);
+      if (!mid) continue;
+
+      for (size_t j = 0; j < kCacheMapSize; j++) {
+        size_t* leaf = reinterpret_cast<size_t*>(mid[j]);
+        if (!leaf) continue;
+
+        for (size_t k = 0; k < kCacheMapSize; k++) {
+          if (!leaf[k]) continue;
+          Internal::releaseMemory(reinterpret_cast<CacheChunk*>(leaf[k]));
+          leaf[k] = 0;
+        }
+      }
+    }
+  }
+
+  self->_threadCaches = nullptr;
+  self->_cacheSerial = vMemCacheNewSerial();
+}
+
+//! \internal
+//!
+//! Reset the whole `VMemMgr` instance, freeing all heap memory allocated an
+//! virtual memory allocated unless `keepVirtualMemory` is true (and this is
+//! only used when writing data to a remote process).
+static void vMemMgrReset(VMemMgr* self, bool keepVirtualMemory) noexcept {
+  vMemCacheReset(self);
+  MemNode* node = self->_first;
+
+  while (node) {
+    MemNode* next = node->next;
+
+    if (!keepVirtualMemory)
+      vMemMgrReleaseVMem(self, node->mem, node->rw, node->size);
+
+    Internal::releaseMemory(node->baUsed);
+    Internal::releaseMemory(node);
+
+    node = next;
+  }
+
+  self->_allocatedBytes = 0;
+  self->_usedBytes = 0;
+
+  self->_root = nullptr;
+  self->_first = nullptr;
+  self->_last = nullptr;
+  self->_optimal = nullptr;
+
+  if (self->_freeLists)
+    ::memset(self->_freeLists, 0, kFreeListCount * sizeof(FreeList));
+}
+
+//! \internal
+//!
+//! Release all nodes if none of them is used (a large page arena can be kept
+//! empty), returns false if some memory is still in use. Used before a mode
+//! that affects how nodes are allocated is changed, must be called with lock
+//! held.
+static bool vMemMgrReleaseUnused(VMemMgr* self) noexcept {
+  vMemCacheReleaseEmptyLocked(self);
+
+  for (MemNode* node = self->_first; node; node = node->next)
+    if (node->used != 0)
+      return false;
+
+  if (self->_first)
+    vMemMgrReset(self, false);
+  return true;
+}
+
+// ============================================================================
+// [asmjit::VMemMgr - Construction / Destruction]
+// ============================================================================
+
+#if !ASMJIT_OS_WINDOWS
+VMemMgr::VMemMgr() noexcept {
+#else
+VMemMgr::VMemMgr(HANDLE hProcess) noexcept {
+#endif
+
+  VMemInfo vm = OSUtils::getVirtualMemoryInfo();
+
+#if ASMJIT_OS_WINDOWS
+  _hProcess = hProcess ? hProcess : vm.hCurrentProcess;
+#endif // ASMJIT_OS_WINDOWS
+
+  _blockSize = vm.pageGranularity;
+  _blockDensity = 64;
+
+  _allocatedBytes = 0;
+  _usedBytes = 0;
+
+  _root = nullptr;
+  _first = nullptr;
+  _last = nullptr;
+  _optimal = nullptr;
+
+  _permanent = nullptr;
+  _freeLists = nullptr;
+  _keepVirtualMemory = false;
+
+  _threadCacheEnabled = false;
+  _dualMappingEnabled = false;
+  _largePagesEnabled = false;
+  _threadCaches = nullptr;
+  _cacheMap = nullptr;
+  _cacheSerial = vMemCacheNewSerial();
+
+  _regionStart = nullptr;
+  _regionSize = 0;
+  _regionUsed = nullptr;
+}
+
+VMemMgr::~VMemMgr() noexcept {
+  // Freeable memory cleanup - Also frees the virtual memory if configured to.
+  vMemMgrReset(this, _keepVirtualMemory);
+  vMemCacheReleaseMap(this);
+  Internal::releaseMemory(_freeLists);
+
+  // The region contains permanent memory if there is any.
+  vMemMgrReleaseRegion(this, _keepVirtualMemory || _permanent != nullptr);
+
+  // Permanent memory cleanup - Never frees the virtual memory.
+  PermanentNode* node = _permanent;
+  while (node) {
+    PermanentNode* prev = node->prev;
+    Internal::releaseMemory(node);
+    node = prev;
+  }
+}
+
+// ============================================================================
+// [asmjit::VMemMgr - Reset]
+// ============================================================================
+
+void VMemMgr::reset() noexcept {
+  vMemMgrReset(this, false);
+}
+
+// ============================================================================
+// [asmjit::VMemMgr - ThreadCache]
+// ============================================================================
+
+Error VMemMgr::setThreadCacheEnabled(bool enabled) noexcept {
+  AutoLock locked(_lock);
+  if (_threadCacheEnabled == enabled)
+    return kErrorOk;
+
+  // Allocated memory would be released by a wrong path if the mode changed.
+  if (!vMemMgrReleaseUnused(this))
+    return DebugUtils::errored(kErrorInvalidState);
+
+  if (enabled && !_cacheMap) {
+    size_t* root = static_cast<size_t*>(Internal::allocMemory(kCacheRootSize * sizeof(size_t)));
+    if (ASMJIT_UNLIKELY(!root))
+      return DebugUtils::errored(kErrorNoHeapMemory);
+
+    ::memset(root, 0, kCacheRootSize * sizeof(size_t));
+    _cacheMap = root;
+  }
+
+  _threadCacheEnabled = enabled;
+  return kErrorOk;
+}
+
+// ============================================================================
+// [asmjit::VMemMgr - DualMapping]
+// ============================================================================
+
+Error VMemMgr::setDualMappingEnabled(bool enabled) noexcept {
+  AutoLock locked(_lock);
+  if (_dualMappingEnabled == enabled)
+    return kErrorOk;
+
+  // Allocated memory would be released by a wrong path if the mode changed.
+  if (_permanent || !vMemMgrReleaseUnused(this))
+    return DebugUtils::errored(kErrorInvalidState);
+
+  if (enabled) {
+    // Views of the same memory can't be placed into the reserved region.
+    if (_regionStart)
+      return DebugUtils::errored(kErrorInvalidState);
+
+#if ASMJIT_OS_WINDOWS
+    // Views can only be created in the current process.
+    if (_hProcess != OSUtils::getVirtualMemoryInfo().hCurrentProcess)
+      return DebugUtils::errored(kErrorFeatureNotEnabled);
+#endif // ASMJIT_OS_WINDOWS
+
+    // Make sure the host allows it, so the caller can fall back.
+    void* rx;
+    void* rw;
+    size_t vSize;
+
+    ASMJIT_PROPAGATE(OSUtils::allocDualMapping(1, &vSize, &rx, &rw));
+    OSUtils::releaseDualMapping(rx, rw, vSize);
+  }
+
+  _dualMappingEnabled = enabled;
+  return kErrorOk;
+}
+
+// ============================================================================
+// [asmjit::VMemMgr - LargePages]
+// ============================================================================
+
+Error VMemMgr::setLargePagesEnabled(bool enabled) noexcept {
+  AutoLock locked(_lock);
+  if (_largePagesEnabled == enabled)
+    return kErrorOk;
+
+  // Nodes allocated with a different block size would be mixed otherwise.
+  if (!vMemMgrReleaseUnused(this))
+    return DebugUtils::errored(kErrorInvalidState);
+
+  VMemInfo vm = OSUtils::getVirtualMemoryInfo();
+  if (enabled) {
+    if (!vm.largePageSize)
+      return DebugUtils::errored(kErrorFeatureNotEnabled);
+    _blockSize = vm.largePageSize;
+  }
+  else {
+    _blockSize = vm.pageGranularity;
+  }
+
+  _largePagesEnabled = enabled;
+  return kErrorOk;
+}
+
+// ============================================================================
+// [asmjit::VMemMgr - Region]
+// ============================================================================
+
+Error VMemMgr::reserveRegion(size_t size, const void* hint) noexcept {
+  AutoLock locked(_lock);
+
+  // Nodes would be released by a wrong path if they were allocated already.
+  if (_permanent || _dualMappingEnabled || !vMemMgrReleaseUnused(this))
+    return DebugUtils::errored(kErrorInvalidState);
+
+#if ASMJIT_OS_WINDOWS
+  // The region can only be reserved in the current process.
+  if (_hProcess != OSUtils::getVirtualMemoryInfo().hCurrentProcess)
+    return DebugUtils::errored(kErrorFeatureNotEnabled);
+#endif // ASMJIT_OS_WINDOWS
+
+  vMemMgrReleaseRegion(this, false);
+
+  size_t vSize;
+  uint8_t* p = static_cast<uint8_t*>(OSUtils::reserveVirtualMemory(size, &vSize, hint));
+  if (ASMJIT_UNLIKELY(!p))
+    return DebugUtils::errored(kErrorNoVirtualMemory);
+
+  size_t count = vSize / OSUtils::getVirtualMemoryInfo().pageGranularity;
+  size_t bSize = ((count + kBitsPerEntity - 1) / kBitsPerEntity) * sizeof(size_t);
+
+  size_t* used = static_cast<size_t*>(Internal::allocMemory(bSize));
+  if (ASMJIT_UNLIKELY(!used)) {
+    OSUtils::releaseVirtualMemory(p, vSize);
+    return DebugUtils::errored(kErrorNoHeapMemory);
+  }
+
+  ::memset(used, 0, bSize);
+  _regionStart = p;
+  _regionSize = vSize;
+  _regionUsed = used;
+  return kErrorOk;
+}
+
+Error VMemMgr::releaseRegion() noexcept {
+  AutoLock locked(_lock);
+  if (!_regionStart)
+    return kErrorOk;
+
+  if (_permanent || !vMemMgrReleaseUnused(this))
+    return DebugUtils::errored(kErrorInvalidState);
+
+  vMemMgrReleaseRegion(this, false);
+  return kErrorOk;
+}
+
+// ============================================================================
+// [asmjit::VMemMgr - Alloc / Release]
+// ============================================================================
+
+void* VMemMgr::alloc(size_t size, uint32_t type) noexcept {
+  if (type == kAllocPermanent)
+    return vMemMgrAllocPermanent(this, size);
+
+  if (_threadCacheEnabled && size != 0 && size <= kCacheMaxBlocks * kCacheDensity)
+    return vMemCacheAlloc(this, size);
+  else
+    return vMemMgrAllocFreeable(this, size);
+}
+
+Error VMemMgr::release(void* p) noexcept {
+  if (!p) return kErrorOk;
+
+  if (_threadCacheEnabled) {
+    CacheChunk* chunk = vMemCacheFindChunk(this, p);
+    if (chunk) return vMemCacheRelease(this, chunk, static_cast<uint8_t*>(p));
+  }
+
+  AutoLock locked(_lock);
+  return vMemMgrReleaseLocked(this, static_cast<uint8_t*>(p));
+}
+
+Error VMemMgr::shrink(void* p, size_t used) noexcept {
+  if (!p) return kErrorOk;
+  if (used == 0)
+    return release(p);
+
+  if (_threadCacheEnabled) {
+    CacheChunk* chunk = vMemCacheFindChunk(this, p);
+    if (chunk) return vMemCacheShrink(chunk, static_cast<uint8_t*>(p));
+  }
+
+  AutoLock locked(_lock);
+  MemNode* node = vMemMgrFindNodeByPtr(this, (uint8_t*)p);
+  if (!node) return DebugUtils::errored(kErrorInvalidArgument);
+
+  size_t offset = (size_t)((uint8_t*)p - (uint8_t*)node->mem);
+  size_t bitpos = M_DIV(offset, node->density);
+  size_t i = (bitpos / kBitsPerEntity);
+
+  size_t* up = node->baUsed + i;  // Current ubits address.
+  size_t* cp = node->baCont + i;  // Current cbits address.
+  size_t ubits = *up;             // Current ubits[0] value.
+  size_t cbits = *cp;             // Current cbits[0] value.
+  size_t bit = (size_t)1 << (bitpos % kBitsPerEntity);
+
+  size_t cont = 0;
+  size_t usedBlocks = (used + node->density - 1) / node->density;
+
+  bool stop;
+
+  // Find the first block we can mark as free.
+  for (;;) {
+    stop = (cbits & bit) == 0;
+    if (stop)
+      return kErrorOk;
 
     if (++cont == usedBlocks)
       break;
@@ -934,9 +2223,58 @@ _EnterFreeLoop:
   node->used -= cont;
   _usedBytes -= cont;
 
+  vMemMgrPushRun(this, static_cast<uint8_t*>(p) + usedBlocks * node->density, cont);
+  return kErrorOk;
+}
+
+Error VMemMgr::split(void* p, size_t offset) noexcept {
+  if (!p || offset == 0)
+    return DebugUtils::errored(kErrorInvalidArgument);
+
+  if (_threadCacheEnabled && vMemCacheFindChunk(this, p))
+    return DebugUtils::errored(kErrorInvalidState);
+
+  AutoLock locked(_lock);
+  MemNode* node = vMemMgrFindNodeByPtr(this, static_cast<uint8_t*>(p));
+  if (!node) return DebugUtils::errored(kErrorInvalidArgument);
+
+  size_t density = node->density;
+  size_t start = (size_t)(static_cast<uint8_t*>(p) - node->mem);
+
+  if (start % density != 0 || offset % density != 0)
+    return DebugUtils::errored(kErrorInvalidArgument);
+
+  // All blocks up to the split point must continue the allocation at `p`.
+  size_t index = start / density;
+  size_t count = offset / density;
+
+  if (index + count >= node->blocks || !_IsRangeSet(node->baCont, index, count))
+    return DebugUtils::errored(kErrorInvalidArgument);
+
+  size_t last = index + count - 1;
+  node->baCont[last / kBitsPerEntity] &= ~((size_t)1 << (last % kBitsPerEntity));
   return kErrorOk;
 }
 
+void* VMemMgr::getWritablePtr(void* p) noexcept {
+  if (!_dualMappingEnabled)
+    return p;
+
+  uint8_t* mem = static_cast<uint8_t*>(p);
+  AutoLock locked(_lock);
+
+  MemNode* node = vMemMgrFindNodeByPtr(this, mem);
+  if (node)
+    return node->rw + (size_t)(mem - node->mem);
+
+  for (PermanentNode* pNode = _permanent; pNode; pNode = pNode->prev) {
+    if (mem >= pNode->mem && mem < pNode->mem + pNode->size)
+      return pNode->rw + (size_t)(mem - pNode->mem);
+  }
+
+  return nullptr;
+}
+
 // ============================================================================
 // [asmjit::VMem - Test]
 // ============================================================================
@@ -981,9 +2319,7 @@ static void VMemTest_shuffle(void** a, void** b, size_t count) noexcept {
   }
 }
 
-UNIT(base_vmem) {
-  VMemMgr memmgr;
-
+static void VMemTest_allocRelease(VMemMgr& memmgr) noexcept {
   // Should be predictible.
   srand(100);
 
@@ -1072,6 +2408,337 @@ UNIT(base_vmem) {
   Internal::releaseMemory(a);
   Internal::releaseMemory(b);
 }
+
+UNIT(base_vmem) {
+  VMemMgr memmgr;
+  VMemTest_allocRelease(memmgr);
+}
+
+UNIT(base_vmem_reuse) {
+  VMemMgr memmgr;
+
+  INFO("Reusing released blocks");
+  uint8_t* a = static_cast<uint8_t*>(memmgr.alloc(128));
+  uint8_t* b = static_cast<uint8_t*>(memmgr.alloc(128));
+  uint8_t* c = static_cast<uint8_t*>(memmgr.alloc(128));
+
+  EXPECT(a && b && c, "Couldn't allocate virtual memory");
+  EXPECT(memmgr.release(b) == kErrorOk, "Failed to free %p", b);
+
+  uint8_t* d = static_cast<uint8_t*>(memmgr.alloc(100));
+  EXPECT(d == b, "Released block %p should be reused, got %p", b, d);
+
+  INFO("Reusing a shrunk tail");
+  uint8_t* e = static_cast<uint8_t*>(memmgr.alloc(1024));
+  EXPECT(e != nullptr, "Couldn't allocate virtual memory");
+  EXPECT(memmgr.shrink(e, 64) == kErrorOk, "Failed to shrink %p", e);
+
+  uint8_t* f = static_cast<uint8_t*>(memmgr.alloc(512));
+  EXPECT(f == e + 64, "Shrunk tail %p should be reused, got %p", e + 64, f);
+
+  INFO("Allocating blocks that span multiple words");
+  uint8_t* blocks[8];
+  size_t i;
+
+  for (i = 0; i < 8; i++) {
+    blocks[i] = static_cast<uint8_t*>(memmgr.alloc(5000));
+    EXPECT(blocks[i] != nullptr, "Couldn't allocate virtual memory");
+    ::memset(blocks[i], static_cast<int>(i), 5000);
+  }
+
+  for (i = 0; i < 8; i++) {
+    for (size_t j = 0; j < 5000; j++)
+      EXPECT(blocks[i][j] == static_cast<uint8_t>(i), "Block %p overlaps with another one", blocks[i]);
+  }
+
+  EXPECT(memmgr.release(blocks[3]) == kErrorOk, "Failed to free %p", blocks[3]);
+  uint8_t* g = static_cast<uint8_t*>(memmgr.alloc(4000));
+  EXPECT(g == blocks[3], "Released block %p should be reused, got %p", blocks[3], g);
+
+  memmgr.reset();
+  EXPECT(memmgr.getUsedBytes() == 0, "All memory should be released by reset()");
+}
+
+// Used by `base_vmem_threadcache` to release memory from a different thread.
+struct VMemTestRemote {
+  VMemMgr* memmgr;
+  void** ptrs;
+  int count;
+  int failed;
+};
+
+#if ASMJIT_OS_WINDOWS
+static DWORD WINAPI VMemTest_remoteRelease(LPVOID arg) {
+#else
+static void* VMemTest_remoteRelease(void* arg) {
+#endif
+  VMemTestRemote* remote = static_cast<VMemTestRemote*>(arg);
+  for (int i = 0; i < remote->count; i += 2)
+    remote->failed |= remote->memmgr->release(remote->ptrs[i]) != kErrorOk;
+  return 0;
+}
+
+// Used by `base_vmem_threadcache` to allocate memory by a thread that exits.
+struct VMemTestExit {
+  VMemMgr* memmgr;
+  void* kept;
+  int failed;
+};
+
+#if ASMJIT_OS_WINDOWS
+static DWORD WINAPI VMemTest_threadExit(LPVOID arg) {
+#else
+static void* VMemTest_threadExit(void* arg) {
+#endif
+  VMemTestExit* data = static_cast<VMemTestExit*>(arg);
+  void* ptrs[kCacheClassCount];
+
+  // Each size class gets its own chunk, only the first allocation is kept,
+  // the other chunks become empty and stay in the cache.
+  uint32_t i;
+  for (i = 0; i < kCacheClassCount; i++) {
+    ptrs[i] = data->memmgr->alloc(vMemCacheClassSize[i] * kCacheDensity);
+    data->failed |= ptrs[i] == nullptr;
+  }
+
+  for (i = 1; i < kCacheClassCount; i++)
+    data->failed |= data->memmgr->release(ptrs[i]) != kErrorOk;
+
+  data->kept = ptrs[0];
+  return 0;
+}
+
+static void VMemTest_runThread(
+#if ASMJIT_OS_WINDOWS
+  LPTHREAD_START_ROUTINE func,
+#else
+  void* (*func)(void*),
+#endif
+  void* arg) {
+
+#if ASMJIT_OS_WINDOWS
+  HANDLE thread = ::CreateThread(nullptr, 0, func, arg, 0, nullptr);
+  EXPECT(thread != nullptr, "Couldn't create a thread");
+  ::WaitForSingleObject(thread, INFINITE);
+  ::CloseHandle(thread);
+#else
+  pthread_t thread;
+  EXPECT(pthread_create(&thread, nullptr, func, arg) == 0,
+    "Couldn't create a thread");
+  pthread_join(thread, nullptr);
+#endif
+}
+
+UNIT(base_vmem_split) {
+  VMemMgr memmgr;
+
+  uint8_t* p = static_cast<uint8_t*>(memmgr.alloc(1024));
+  EXPECT(p != nullptr, "Couldn't allocate virtual memory");
+
+  EXPECT(memmgr.split(p, 100) == kErrorInvalidArgument, "Split offset must be aligned");
+  EXPECT(memmgr.split(p, 2048) == kErrorInvalidArgument, "Split offset must be inside the allocation");
+
+  EXPECT(memmgr.split(p, 256) == kErrorOk, "Failed to split %p", p);
+  EXPECT(memmgr.split(p + 256, 512) == kErrorOk, "Failed to split %p", p + 256);
+  EXPECT(memmgr.getUsedBytes() == 1024, "Split shouldn't change used bytes");
+
+  EXPECT(memmgr.release(p + 256) == kErrorOk, "Failed to free %p", p + 256);
+  EXPECT(memmgr.getUsedBytes() == 512, "Only the middle part should be released");
+
+  EXPECT(memmgr.release(p) == kErrorOk, "Failed to free %p", p);
+  EXPECT(memmgr.release(p + 768) == kErrorOk, "Failed to free %p", p + 768);
+  EXPECT(memmgr.getUsedBytes() == 0, "All memory should be released");
+}
+
+UNIT(base_vmem_dualmapping) {
+  VMemMgr memmgr;
+
+  Error err = memmgr.setDualMappingEnabled(true);
+  if (err == kErrorFeatureNotEnabled) {
+    INFO("Dual mapping is not supported by the host, skipping");
+    return;
+  }
+  EXPECT(err == kErrorOk, "Failed to enable dual mapping");
+
+  uint8_t* rx[3];
+  uint8_t* rw[3];
+
+  rx[0] = static_cast<uint8_t*>(memmgr.alloc(128));
+  rx[1] = static_cast<uint8_t*>(memmgr.alloc(100000));
+  rx[2] = static_cast<uint8_t*>(memmgr.alloc(64, VMemMgr::kAllocPermanent));
+
+  for (uint32_t i = 0; i < 3; i++) {
+    EXPECT(rx[i] != nullptr, "Couldn't allocate virtual memory");
+
+    rw[i] = static_cast<uint8_t*>(memmgr.getWritablePtr(rx[i]));
+    EXPECT(rw[i] != nullptr && rw[i] != rx[i],
+      "Writable view of %p should be a different address", rx[i]);
+
+    ::memset(rw[i], static_cast<int>(0x40 + i), 64);
+    EXPECT(rx[i][0] == 0x40 + i && rx[i][63] == 0x40 + i,
+      "Data written through %p should be visible through %p", rw[i], rx[i]);
+  }
+
+  EXPECT(memmgr.setDualMappingEnabled(false) == kErrorInvalidState,
+    "Dual mapping can't be disabled while memory is allocated");
+
+  EXPECT(memmgr.release(rx[0]) == kErrorOk, "Failed to free %p", rx[0]);
+  EXPECT(memmgr.release(rx[1]) == kErrorOk, "Failed to free %p", rx[1]);
+}
+
+UNIT(base_vmem_largepages) {
+  VMemMgr memmgr;
+
+  Error err = memmgr.setLargePagesEnabled(true);
+  if (err == kErrorFeatureNotEnabled) {
+    INFO("Large pages are not supported by the host, skipping");
+    return;
+  }
+  EXPECT(err == kErrorOk, "Failed to enable large pages");
+
+  size_t largePageSize = OSUtils::getVirtualMemoryInfo().largePageSize;
+  EXPECT(memmgr.getBlockSize() == largePageSize,
+    "Block size should be the large page size (%u)", static_cast<unsigned int>(largePageSize));
+
+  VMemTest_allocRelease(memmgr);
+
+  uint8_t* p = static_cast<uint8_t*>(memmgr.alloc(256));
+  EXPECT(p != nullptr, "Couldn't allocate virtual memory");
+  EXPECT(memmgr.getAllocatedBytes() % largePageSize == 0,
+    "Arenas should be multiples of the large page size");
+
+  EXPECT(memmgr.setLargePagesEnabled(false) == kErrorInvalidState,
+    "Large pages can't be disabled while memory is allocated");
+
+  // The last arena is kept after its memory is released.
+  EXPECT(memmgr.release(p) == kErrorOk, "Failed to free %p", p);
+  EXPECT(memmgr.getUsedBytes() == 0, "All memory should be released");
+  EXPECT(memmgr.setLargePagesEnabled(false) == kErrorOk,
+    "Large pages should be possible to disable when no memory is used");
+  EXPECT(memmgr.getAllocatedBytes() == 0, "Empty arena should be released");
+}
+
+UNIT(base_vmem_region) {
+  VMemMgr memmgr;
+
+  // Reserve the region near this code, as if it was the main executable.
+  const void* hint = (const void*)(uintptr_t)&VMemTest_fill;
+  EXPECT(memmgr.reserveRegion(1024 * 1024 * 1024, hint) == kErrorOk,
+    "Failed to reserve a region near %p", hint);
+
+  uint8_t* start = memmgr.getRegionStart();
+  uint8_t* end = start + memmgr.getRegionSize();
+  INFO("Region [%p, %p) reserved near %p", start, end, hint);
+
+  EXPECT(Utils::isInt32(static_cast<int64_t>((intptr_t)hint - (intptr_t)start)) &&
+         Utils::isInt32(static_cast<int64_t>((intptr_t)end - (intptr_t)hint)),
+    "Region should be within 2GB of the hint");
+
+  EXPECT(memmgr.setDualMappingEnabled(true) == kErrorInvalidState,
+    "Dual mapping can't be enabled if a region is reserved");
+
+  VMemTest_allocRelease(memmgr);
+
+  // Nodes, also the ones larger than the block size, are inside the region.
+  void* a = memmgr.alloc(256);
+  void* b = memmgr.alloc(memmgr.getBlockSize() * 3);
+  EXPECT(a != nullptr && b != nullptr, "Couldn't allocate virtual memory");
+
+  EXPECT((uint8_t*)a >= start && (uint8_t*)a < end, "Memory %p should be inside the region", a);
+  EXPECT((uint8_t*)b >= start && (uint8_t*)b < end, "Memory %p should be inside the region", b);
+
+  EXPECT(memmgr.releaseRegion() == kErrorInvalidState,
+    "Region can't be released while memory is allocated");
+
+  EXPECT(memmgr.release(a) == kErrorOk, "Failed to free %p", a);
+  EXPECT(memmgr.release(b) == kErrorOk, "Failed to free %p", b);
+
+  // Decommitted units are reused.
+  a = memmgr.alloc(256);
+  EXPECT(a == start, "Memory %p should be at the start of the region", a);
+  EXPECT(memmgr.release(a) == kErrorOk, "Failed to free %p", a);
+
+  EXPECT(memmgr.releaseRegion() == kErrorOk, "Failed to release the region");
+  EXPECT(!memmgr.hasReservedRegion(), "Region should be released");
+}
+
+UNIT(base_vmem_threadcache) {
+  VMemMgr memmgr;
+
+  EXPECT(memmgr.setThreadCacheEnabled(true) == kErrorOk,
+    "Couldn't enable thread caches");
+
+  INFO("Reusing memory from the thread cache...");
+  void* a = memmgr.alloc(100);
+  void* b = memmgr.alloc(100);
+  EXPECT(a != nullptr && b != nullptr, "Couldn't allocate virtual memory");
+
+  size_t usedBytes = memmgr.getUsedBytes();
+  size_t allocatedBytes = memmgr.getAllocatedBytes();
+
+  EXPECT(memmgr.release(b) == kErrorOk, "Failed to free %p", b);
+  void* c = memmgr.alloc(100);
+  EXPECT(c == b, "Memory %p should be reused, got %p", b, c);
+  EXPECT(memmgr.getUsedBytes() == usedBytes && memmgr.getAllocatedBytes() == allocatedBytes,
+    "Thread cache shouldn't touch the shared nodes");
+
+  EXPECT(memmgr.release(a) == kErrorOk, "Failed to free %p", a);
+  EXPECT(memmgr.release(c) == kErrorOk, "Failed to free %p", c);
+
+  VMemTest_allocRelease(memmgr);
+
+  INFO("Releasing memory owned by another thread...");
+  enum { kRemoteCount = 1000 };
+  void* ptrs[kRemoteCount];
+
+  int i;
+  for (i = 0; i < kRemoteCount; i++) {
+    int r = (rand() % 1000) + 4;
+    ptrs[i] = memmgr.alloc(r);
+    EXPECT(ptrs[i] != nullptr,
+      "Couldn't allocate %d bytes of virtual memory", r);
+    ::memset(ptrs[i], 0, r);
+  }
+
+  VMemTestRemote remote = { &memmgr, ptrs, kRemoteCount, 0 };
+  VMemTest_runThread(VMemTest_remoteRelease, &remote);
+  EXPECT(remote.failed == 0, "Failed to release memory from another thread");
+
+  // Allocating again must reuse the blocks returned by the other thread.
+  for (i = 0; i < kRemoteCount; i += 2) {
+    int r = (rand() % 1000) + 4;
+    ptrs[i] = memmgr.alloc(r);
+    EXPECT(ptrs[i] != nullptr,
+      "Couldn't allocate %d bytes of virtual memory", r);
+    ::memset(ptrs[i], 0, r);
+  }
+  VMemTest_stats(memmgr);
+
+  for (i = 0; i < kRemoteCount; i++) {
+    EXPECT(memmgr.release(ptrs[i]) == kErrorOk,
+      "Failed to free %p", ptrs[i]);
+  }
+  VMemTest_stats(memmgr);
+
+  INFO("Flushing the cache of a terminated thread...");
+  usedBytes = memmgr.getUsedBytes();
+
+  VMemTestExit exitData = { &memmgr, nullptr, 0 };
+  VMemTest_runThread(VMemTest_threadExit, &exitData);
+  EXPECT(exitData.failed == 0, "Failed to allocate or free memory in another thread");
+
+  EXPECT(memmgr.getUsedBytes() == usedBytes + kCacheChunkSize,
+    "Empty chunks should be returned when the thread terminates");
+  EXPECT(memmgr.release(exitData.kept) == kErrorOk, "Failed to free %p", exitData.kept);
+  EXPECT(memmgr.getUsedBytes() == usedBytes,
+    "Chunk of a terminated thread should be returned when it's empty");
+
+  // Empty chunks kept by the cache of this thread don't count as used.
+  EXPECT(memmgr.setThreadCacheEnabled(false) == kErrorOk,
+    "Couldn't disable thread caches");
+  EXPECT(memmgr.getUsedBytes() == 0 && memmgr.getAllocatedBytes() == 0,
+    "All memory should be released");
+}
 #endif // ASMJIT_TEST
 
 } // asmjit namespace
@@ -71,6 +71,9 @@ public:
   ASMJIT_INLINE HANDLE getProcessHandle() const noexcept { return _hProcess; }
 #endif // ASMJIT_OS_WINDOWS
 
+  //! Get the default size of memory nodes (arenas).
+  ASMJIT_INLINE size_t getBlockSize() const noexcept { return _blockSize; }
+
   //! Get how many bytes are currently allocated.
   ASMJIT_INLINE size_t getAllocatedBytes() const noexcept { return _allocatedBytes; }
   //! Get how many bytes are currently used.
@@ -93,6 +96,92 @@ public:
   //! \sa \ref getKeepVirtualMemory.
   ASMJIT_INLINE void setKeepVirtualMemory(bool val) noexcept { _keepVirtualMemory = val; }
 
+  //! Get whether per-thread allocation caches are enabled.
+  //!
+  //! \sa \ref setThreadCacheEnabled.
+  ASMJIT_INLINE bool isThreadCacheEnabled() const noexcept { return _threadCacheEnabled; }
+  //! Enable or disable per-thread allocation caches.
+  //!
+  //! When enabled, small `kAllocFreeable` allocations are rounded up to a size
+  //! class and served from chunks that are carved from the shared memory nodes
+  //! and owned by the allocating thread, so `alloc()` and `release()` called by
+  //! the owner don't take the global lock. A `release()` of memory owned by
+  //! another thread is lock-free and is reclaimed by the owner when it runs out
+  //! of free slots. `shrink()` keeps cached allocations as is. Chunks owned by
+  //! caches are reported as used by `getUsedBytes()`. When a thread terminates
+  //! its empty chunks are returned and chunks that are still used are returned
+  //! as soon as all their allocations are released.
+  //!
+  //! The mode can only be changed while no memory is allocated, otherwise
+  //! `kErrorInvalidState` is returned. Empty chunks kept by the cache of the
+  //! calling thread don't count, empty chunks of other running threads do.
+  ASMJIT_API Error setThreadCacheEnabled(bool enabled) noexcept;
+
+  //! Get whether the memory is dual-mapped.
+  //!
+  //! \sa \ref setDualMappingEnabled.
+  ASMJIT_INLINE bool isDualMappingEnabled() const noexcept { return _dualMappingEnabled; }
+  //! Enable or disable dual mapping (W^X).
+  //!
+  //! When enabled, each memory node is mapped twice by \ref OSUtils::allocDualMapping()
+  //! - `alloc()` returns an address of the executable view, which is never
+  //! writable, and \ref getWritablePtr() translates it to the writable view.
+  //! Code is written through the writable view and executed through the other
+  //! one, so publishing code doesn't require changing page protection.
+  //!
+  //! The mode can only be changed while no memory is allocated, otherwise
+  //! `kErrorInvalidState` is returned (also if a region is reserved, see
+  //! \ref reserveRegion). If the host doesn't support such mappings
+  //! `kErrorFeatureNotEnabled` is returned and the mode is unchanged.
+  ASMJIT_API Error setDualMappingEnabled(bool enabled) noexcept;
+
+  //! Get whether memory nodes are allocated as large page arenas.
+  //!
+  //! \sa \ref setLargePagesEnabled.
+  ASMJIT_INLINE bool isLargePagesEnabled() const noexcept { return _largePagesEnabled; }
+  //! Enable or disable large page arenas.
+  //!
+  //! When enabled, the block size is set to `VMemInfo::largePageSize` (2MB on
+  //! X86) and each node is aligned to it and allocated by `OSUtils` with
+  //! `kVMLargePages` flag - it uses explicit huge pages if they are reserved,
+  //! and transparent huge pages or regular pages otherwise. An empty arena is
+  //! kept if it's the last one so repeated alloc/release doesn't remap it.
+  //! Dual-mapped memory (see \ref setDualMappingEnabled) uses the block size
+  //! only, it's never backed by large pages.
+  //!
+  //! The mode can only be changed while no memory is allocated, otherwise
+  //! `kErrorInvalidState` is returned. If the host doesn't have large pages
+  //! `kErrorFeatureNotEnabled` is returned and the mode is unchanged.
+  ASMJIT_API Error setLargePagesEnabled(bool enabled) noexcept;
+
+  //! Get whether memory nodes are allocated from a reserved region.
+  //!
+  //! \sa \ref reserveRegion.
+  ASMJIT_INLINE bool hasReservedRegion() const noexcept { return _regionStart != nullptr; }
+  //! Get the start of the reserved region (or null if there is none).
+  ASMJIT_INLINE uint8_t* getRegionStart() const noexcept { return _regionStart; }
+  //! Get the size of the reserved region (or zero if there is none).
+  ASMJIT_INLINE size_t getRegionSize() const noexcept { return _regionSize; }
+
+  //! Reserve a region of `size` bytes all memory nodes are allocated from.
+  //!
+  //! The region is only reserved by \ref OSUtils::reserveVirtualMemory() and
+  //! nodes are committed and decommitted inside it when they are created and
+  //! released. If `hint` is not null (for example an address of a function
+  //! in the main executable) the region is placed within +/-2GB of it, so any
+  //! code in the region can reach `hint` and any other code in the region by
+  //! a rel32 displacement. `kErrorNoVirtualMemory` is returned if the region
+  //! can't be reserved, and nodes can't be allocated once it's exhausted.
+  //!
+  //! The region can only be reserved while no memory is allocated, otherwise
+  //! `kErrorInvalidState` is returned, the same error is returned if dual
+  //! mapping is enabled. An existing region is released first.
+  ASMJIT_API Error reserveRegion(size_t size, const void* hint = nullptr) noexcept;
+  //! Release the reserved region, nodes are then allocated anywhere again.
+  //!
+  //! Returns `kErrorInvalidState` if memory is still allocated.
+  ASMJIT_API Error releaseRegion() noexcept;
+
   // --------------------------------------------------------------------------
   // [Alloc / Release]
   // --------------------------------------------------------------------------
@@ -108,6 +197,20 @@ public:
   //! Free extra memory allocated with `p`.
   ASMJIT_API Error shrink(void* p, size_t used) noexcept;
 
+  //! Split memory at `p` into two allocations at `offset`.
+  //!
+  //! Both `p` and `p + offset` must be inside the same `kAllocFreeable`
+  //! allocation and `offset` must be a multiple of 64. Each part can then be
+  //! shrunk and released separately. Memory served by a thread cache can't be
+  //! split, `kErrorInvalidState` is returned in such case.
+  ASMJIT_API Error split(void* p, size_t offset) noexcept;
+
+  //! Get a writable address of memory at `p` returned by `alloc()`.
+  //!
+  //! Returns `p` if dual mapping is not enabled, or null if `p` was not
+  //! allocated by this memory manager.
+  ASMJIT_API void* getWritablePtr(void* p) noexcept;
+
   // --------------------------------------------------------------------------
   // [Members]
   // --------------------------------------------------------------------------
@@ -120,6 +223,9 @@ public:
   size_t _blockSize;                     //!< Default block size.
   size_t _blockDensity;                  //!< Default block density.
   bool _keepVirtualMemory;               //!< Keep virtual memory after destroyed.
+  bool _threadCacheEnabled;              //!< Per-thread caches are enabled.
+  bool _dualMappingEnabled;              //!< Memory is mapped twice (RX and RW).
+  bool _largePagesEnabled;               //!< Nodes are large page arenas.
 
   size_t _allocatedBytes;                //!< How many bytes are currently allocated.
   size_t _usedBytes;                     //!< How many bytes are currently used.
@@ -130,6 +236,9 @@ public:
   struct RbNode;
   struct MemNode;
   struct PermanentNode;
+  struct FreeList;
+  struct CacheChunk;
+  struct ThreadCache;
 
   // Memory nodes root.
   MemNode* _root;
@@ -139,6 +248,18 @@ public:
   MemNode* _optimal;
   // Permanent memory.
   PermanentNode* _permanent;
+  // Recently released runs segregated by size class.
+  FreeList* _freeLists;
+
+  // Thread caches and a radix map of all chunks owned by them.
+  ThreadCache* _threadCaches;
+  size_t* _cacheMap;
+  size_t _cacheSerial;
+
+  // Reserved region and its bit-array of committed units (page granularity).
+  uint8_t* _regionStart;
+  size_t _regionSize;
+  size_t* _regionUsed;
 
   //! \}
 };
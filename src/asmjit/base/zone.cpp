@@ -818,6 +818,7 @@ ZoneHashNode* ZoneHashBase::_del(ZoneHashNode* node) noexcept {
   while (p) {
     if (p == node) {
       *pPrev = p->_hashNext;
+      _size--;
       return node;
     }
 
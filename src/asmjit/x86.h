@@ -15,9 +15,14 @@
 #include "./x86/x86builder.h"
 #include "./x86/x86compiler.h"
 #include "./x86/x86emitter.h"
+#include "./x86/x86hotcoldpass.h"
 #include "./x86/x86inst.h"
+#include "./x86/x86layoutpass.h"
+#include "./x86/x86loopalignpass.h"
 #include "./x86/x86misc.h"
 #include "./x86/x86operand.h"
+#include "./x86/x86peepholepass.h"
+#include "./x86/x86relaxpass.h"
 
 // [Guard]
 #endif // _ASMJIT_X86_H
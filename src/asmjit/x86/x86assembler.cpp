@@ -12,6 +12,7 @@
 #if defined(ASMJIT_BUILD_X86)
 
 // [Dependencies]
+#include "../base/codetemplate.h"
 #include "../base/cpuinfo.h"
 #include "../base/logging.h"
 #include "../base/misc_p.h"
@@ -296,6 +297,69 @@ static ASMJIT_INLINE bool x86IsJmpOrCall(uint32_t instId) noexcept {
          instId == X86Inst::kIdCall;
 }
 
+//! Get whether `instId` is a branch that is kept within 32-byte boundaries.
+static ASMJIT_INLINE bool x86IsAlignedBranch(uint32_t instId) noexcept {
+  return (instId >= X86Inst::kIdJa && instId <= X86Inst::kIdJz) ||
+         (instId >= X86Inst::kIdLoop && instId <= X86Inst::kIdLoopne) ||
+         instId == X86Inst::kIdCall ||
+         instId == X86Inst::kIdRet;
+}
+
+//! Get whether `instId` is a conditional jump that can be macro-fused with a
+//! preceding instruction.
+static ASMJIT_INLINE bool x86IsFusibleJcc(uint32_t instId) noexcept {
+  return instId >= X86Inst::kIdJa && instId <= X86Inst::kIdJz &&
+         instId != X86Inst::kIdJmp &&
+         instId != X86Inst::kIdJecxz;
+}
+
+//! Get whether `instId` can be macro-fused with a following conditional jump.
+static ASMJIT_INLINE bool x86IsFusible(uint32_t instId) noexcept {
+  return instId == X86Inst::kIdCmp ||
+         instId == X86Inst::kIdTest ||
+         instId == X86Inst::kIdAdd ||
+         instId == X86Inst::kIdSub ||
+         instId == X86Inst::kIdAnd ||
+         instId == X86Inst::kIdInc ||
+         instId == X86Inst::kIdDec;
+}
+
+//! Get whether the encoding of `op` doesn't depend on its position, so it can
+//! be moved after it was emitted.
+static ASMJIT_INLINE bool x86IsMovableOp(const Operand_& op) noexcept {
+  if (!op.isMem()) return true;
+
+  const X86Mem& m = op.as<X86Mem>();
+  return m.hasBaseReg() && m.getBaseType() != X86Reg::kRegRip && !m.isRel();
+}
+
+//! Write `n` bytes of multi-byte NOPs to `cursor`.
+static ASMJIT_INLINE uint8_t* x86WriteNops(uint8_t* cursor, uint32_t n) noexcept {
+  // Intel 64 and IA-32 Architectures Software Developer's Manual - Volume 2B (NOP).
+  enum { kMaxNopSize = 9 };
+
+  static const uint8_t nopData[kMaxNopSize][kMaxNopSize] = {
+    { 0x90 },
+    { 0x66, 0x90 },
+    { 0x0F, 0x1F, 0x00 },
+    { 0x0F, 0x1F, 0x40, 0x00 },
+    { 0x0F, 0x1F, 0x44, 0x00, 0x00 },
+    { 0x66, 0x0F, 0x1F, 0x44, 0x00, 0x00 },
+    { 0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00 },
+    { 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+    { 0x66, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 }
+  };
+
+  while (n) {
+    uint32_t i = std::min<uint32_t>(n, kMaxNopSize);
+    ::memcpy(cursor, nopData[i - 1], i);
+
+    cursor += i;
+    n -= i;
+  }
+  return cursor;
+}
+
 static ASMJIT_INLINE bool x86IsImplicitMem(const Operand_& op, uint32_t base) noexcept {
   return op.isMem() && op.as<X86Mem>().getBaseId() == base;
 }
@@ -355,7 +419,13 @@ static ASMJIT_INLINE uint32_t x86EncodeSib(uint32_t s, uint32_t i, uint32_t b) n
 // [asmjit::X86Assembler - Construction / Destruction]
 // ============================================================================
 
-X86Assembler::X86Assembler(CodeHolder* code) noexcept : Assembler() {
+X86Assembler::X86Assembler(CodeHolder* code) noexcept
+  : Assembler(),
+    _branchPaddingSize(0),
+    _branchPaddingCount(0),
+    _fusibleStart(0),
+    _fusibleEnd(Globals::kInvalidIndex),
+    _fusibleSectionId(SectionEntry::kInvalidId) {
   if (code)
     code->attach(this);
 }
@@ -385,6 +455,10 @@ Error X86Assembler::onAttach(CodeHolder* code) noexcept {
   }
 
   _nativeGpReg = _nativeGpArray[0];
+
+  _branchPaddingSize = 0;
+  _branchPaddingCount = 0;
+  _fusibleEnd = Globals::kInvalidIndex;
   return kErrorOk;
 }
 
@@ -498,6 +572,140 @@ Error X86Assembler::onDetach(CodeHolder* code) noexcept {
 #define ENC_OPS3(OP0, OP1, OP2)           ((Operand::kOp##OP0) + ((Operand::kOp##OP1) << 3) + ((Operand::kOp##OP2) << 6))
 #define ENC_OPS4(OP0, OP1, OP2, OP3)      ((Operand::kOp##OP0) + ((Operand::kOp##OP1) << 3) + ((Operand::kOp##OP2) << 6) + ((Operand::kOp##OP3) << 9))
 
+// ============================================================================
+// [asmjit::X86Assembler - Branch Padding]
+// ============================================================================
+
+//! \internal
+//!
+//! Insert `n` bytes of NOPs at `first` and move the code between `first` and
+//! `start` (a macro-fusible instruction) after them. The branch at `start`
+//! must have been removed.
+static Error X86Assembler_padBranch(X86Assembler* self, size_t first, size_t start, uint32_t n) noexcept {
+  if (self->getRemainingSpace() < n + 16) {
+    Error err = self->_code->growBuffer(&self->_section->_buffer, n + 16);
+    if (ASMJIT_UNLIKELY(err)) return err;
+  }
+
+  uint8_t* data = self->_bufferData;
+  ::memmove(data + first + n, data + first, start - first);
+  x86WriteNops(data + first, n);
+
+  self->_bufferPtr = data + start + n;
+  self->_branchPaddingSize += n;
+  self->_branchPaddingCount++;
+
+  if (first != start) {
+    self->_fusibleStart += n;
+    self->_fusibleEnd += n;
+  }
+
+#if !defined(ASMJIT_DISABLE_LOGGING)
+  if (self->_globalOptions & CodeEmitter::kOptionLoggingEnabled)
+    self->_code->_logger->logf("%s; %u bytes of branch padding\n", self->_code->_logger->getIndentation(), n);
+#endif // !ASMJIT_DISABLE_LOGGING
+
+  return kErrorOk;
+}
+
+// ============================================================================
+// [asmjit::X86Assembler - Holes]
+// ============================================================================
+
+//! \internal
+//!
+//! Get whether the immediate of `imLen` bytes of the instruction `opCode` is
+//! sign-extended to the size of the operation - imm8 of `83`, `6B`, and `6A`
+//! opcodes, and imm32 of 64-bit operations (including `push imm32`).
+static ASMJIT_INLINE bool X86Assembler_isSignExtendedImm(const X86Assembler* self, uint32_t opCode, uint32_t imLen) noexcept {
+  if (opCode & X86Inst::kOpCode_MM_Mask)
+    return false;
+
+  uint32_t op = opCode & 0xFF;
+  if (imLen == 1)
+    return op == 0x6A || op == 0x6B || op == 0x83;
+
+  if (imLen == 4)
+    return (opCode & X86Inst::kOpCode_W) != 0 || (op == 0x68 && self->is64Bit());
+
+  return false;
+}
+
+//! \internal
+//!
+//! Record the hole of the instruction that ends at `cursor` (see \ref
+//! CodeEmitter::setHole()). `re` is the relocation created by the instruction,
+//! if any, `opCode` is its opcode, and `imLen` is the size of its immediate.
+static Error X86Assembler_addHole(X86Assembler* self, RelocEntry* re, uint8_t* cursor, uint32_t opCode, int64_t imVal, uint32_t imLen,
+  const Operand_& o0, const Operand_& o1, const Operand_& o2, const Operand_& o3) noexcept {
+
+  CodeHolder* code = self->_code;
+  uint32_t type = self->getHoleType();
+  uint32_t id = self->getHoleId();
+
+  // The instruction can't be moved by branch padding as its hole would move.
+  self->_fusibleEnd = Globals::kInvalidIndex;
+
+  size_t end = (size_t)(cursor - self->_bufferData);
+  size_t offset;
+  uint32_t size;
+  uint32_t flags = 0;
+  uint64_t value;
+
+  switch (type) {
+    case HoleEntry::kTypeImm:
+      if (ASMJIT_UNLIKELY(imLen == 0))
+        return DebugUtils::errored(kErrorInvalidImmediate);
+
+      offset = end - imLen;
+      size = imLen;
+      value = static_cast<uint64_t>(imVal);
+
+      if (X86Assembler_isSignExtendedImm(self, opCode, imLen))
+        flags = HoleEntry::kFlagSigned;
+      break;
+
+    case HoleEntry::kTypeDisp: {
+      const Operand_* mem = o0.isMem() ? &o0 :
+                            o1.isMem() ? &o1 :
+                            o2.isMem() ? &o2 :
+                            o3.isMem() ? &o3 : nullptr;
+
+      // Only a 32-bit displacement of a memory operand not relative to RIP
+      // can be patched, it's followed by the immediate, if any.
+      if (ASMJIT_UNLIKELY(!mem || re || mem->as<X86Mem>().hasBaseLabel() || end < imLen + 4))
+        return DebugUtils::errored(kErrorInvalidDisplacement);
+
+      int32_t disp = mem->as<X86Mem>().getOffsetLo32();
+      offset = end - imLen - 4;
+
+      if (ASMJIT_UNLIKELY(static_cast<int32_t>(Utils::readU32u(self->_bufferData + offset)) != disp))
+        return DebugUtils::errored(kErrorInvalidDisplacement);
+
+      size = 4;
+      value = static_cast<uint64_t>(static_cast<int64_t>(disp));
+      break;
+    }
+
+    case HoleEntry::kTypeTarget:
+      if (ASMJIT_UNLIKELY(!re || (re->getType() != RelocEntry::kTypeAbsToRel &&
+                                  re->getType() != RelocEntry::kTypeTrampoline)))
+        return DebugUtils::errored(kErrorInvalidInstruction);
+      return code->addHoleEntry(id, type, re->getId());
+
+    default:
+      return DebugUtils::errored(kErrorInvalidArgument);
+  }
+
+  RelocEntry* holeRe;
+  ASMJIT_PROPAGATE(code->newRelocEntry(&holeRe, RelocEntry::kTypeAbsToAbs, size));
+
+  holeRe->_sourceSectionId = self->_section->getId();
+  holeRe->_sourceOffset = static_cast<uint64_t>(offset);
+  holeRe->_data = value;
+  return code->addHoleEntry(id, type, holeRe->getId(), flags);
+}
+
 // ============================================================================
 // [asmjit::X86Assembler - Emit]
 // ============================================================================
@@ -3765,8 +3973,9 @@ EmitModSib:
 
         // If we know the base address and the memory operand points to an
         // absolute address it's possible to calculate REL32 that can be
-        // be used as [RIP+REL32] in 64-bit mode.
-        if (baseAddress != Globals::kNoBaseAddress && !preferAbsolute) {
+        // be used as [RIP+REL32] in 64-bit mode. The base address is only
+        // the address of the first section.
+        if (baseAddress != Globals::kNoBaseAddress && !preferAbsolute && _section->getId() == 0) {
           const uint32_t kModRel32Size = 5;
           uint64_t rip64 = baseAddress +
             static_cast<uint64_t>((uintptr_t)(cursor - _bufferData)) + imLen + kModRel32Size;
@@ -3814,6 +4023,7 @@ EmitModSib_LabelRip_X86:
 
           if (label->isBound()) {
             // Bound label.
+            re->_targetSectionId = label->getSectionId();
             re->_data += static_cast<uint64_t>(label->getOffset());
             EMIT_32(0);
           }
@@ -3831,6 +4041,7 @@ EmitModSib_LabelRip_X86:
 
           re->_sourceSectionId = _section->getId();
           re->_sourceOffset = static_cast<uint64_t>((uintptr_t)(cursor - _bufferData));
+          re->_targetSectionId = _section->getId();
           re->_data = re->_sourceOffset + static_cast<uint64_t>(static_cast<int64_t>(relOffset));
           EMIT_32(0);
         }
@@ -3843,7 +4054,18 @@ EmitModSib_LabelRip_X86:
           if (!label) goto InvalidLabel;
 
           relOffset -= (4 + imLen);
-          if (label->isBound()) {
+          if (label->isBound() && label->getSectionId() != _section->getId()) {
+            // Bound label in another section, resolved by `relocate()`.
+            err = _code->newRelocEntry(&re, RelocEntry::kTypeRelToRel, 4);
+            if (ASMJIT_UNLIKELY(err)) goto Failed;
+
+            re->_sourceSectionId = _section->getId();
+            re->_targetSectionId = label->getSectionId();
+            re->_sourceOffset = static_cast<uint64_t>((uintptr_t)(cursor - _bufferData));
+            re->_data = static_cast<uint64_t>(static_cast<int64_t>(label->getOffset()) + relOffset);
+            EMIT_32(0);
+          }
+          else if (label->isBound()) {
             // Bound label.
             relOffset += label->getOffset() - static_cast<int32_t>((intptr_t)(cursor - _bufferData));
             EMIT_32(static_cast<int32_t>(relOffset));
@@ -4241,7 +4463,9 @@ EmitVexEvexM:
   // [Emit - Jmp/Jcc/Call]
   // --------------------------------------------------------------------------
 
-  // TODO: Should be adjusted after the support for multiple sections feature is added.
+  // NOTE: `ip` is an offset in the current section. Jumps to labels bound in
+  // other sections and absolute jumps from other than the first section use
+  // relocations, as their displacements are only known after the layout.
 EmitJmpCall:
   {
     // Emit REX prefix if asked for (64-bit only).
@@ -4273,7 +4497,24 @@ EmitJmpCall:
       label = _code->getLabelEntry(rmRel->as<Label>());
       if (!label) goto InvalidLabel;
 
-      if (label->isBound()) {
+      if (label->isBound() && label->getSectionId() != _section->getId()) {
+        // Bound label in another section, resolved by `relocate()`.
+        if (ASMJIT_UNLIKELY(!opCode || (options & X86Inst::kOptionShortForm) != 0))
+          goto InvalidDisplacement;
+
+        err = _code->newRelocEntry(&re, RelocEntry::kTypeRelToRel, 4);
+        if (ASMJIT_UNLIKELY(err)) goto Failed;
+
+        re->_sourceSectionId = _section->getId();
+        re->_targetSectionId = label->getSectionId();
+        re->_sourceOffset = ip + inst32Size - 4;
+        re->_data = static_cast<uint64_t>(static_cast<int64_t>(label->getOffset()) - 4);
+
+        rel32 = 0;
+        options |= X86Inst::kOptionLongForm;
+        goto EmitJmpCallRel;
+      }
+      else if (label->isBound()) {
         // Bound label.
         rel32 = static_cast<uint32_t>((static_cast<uint64_t>(label->getOffset()) - ip - inst32Size) & 0xFFFFFFFFU);
         goto EmitJmpCallRel;
@@ -4307,13 +4548,15 @@ EmitJmpCall:
     }
 
     if (rmRel->isImm()) {
-      uint64_t baseAddress = getCodeInfo().getBaseAddress();
+      const CodeInfo& codeInfo = getCodeInfo();
+      uint64_t baseAddress = codeInfo.getBaseAddress();
       uint64_t jumpAddress = rmRel->as<Imm>().getUInt64();
+      bool useTrampoline = getArchType() != ArchInfo::kTypeX86 && x86IsJmpOrCall(instId);
 
       // If the base-address is known calculate a relative displacement and
       // check if it fits in 32 bits (which is always true in 32-bit mode).
       // Emit relative displacement as it was a bound label if all checks ok.
-      if (baseAddress != Globals::kNoBaseAddress) {
+      if (baseAddress != Globals::kNoBaseAddress && _section->getId() == 0) {
         uint64_t rel64 = jumpAddress - (ip + baseAddress) - inst32Size;
         if (getArchType() == ArchInfo::kTypeX86 || Utils::isInt32(static_cast<int64_t>(rel64))) {
           rel32 = static_cast<uint32_t>(rel64 & 0xFFFFFFFFU);
@@ -4327,6 +4570,14 @@ EmitJmpCall:
         }
       }
 
+      else if (codeInfo.hasCodeRegion()) {
+        // The code will be placed somewhere in the region, a trampoline is
+        // not needed if the target is reachable from both of its ends.
+        if (Utils::isInt32(static_cast<int64_t>(jumpAddress - codeInfo.getCodeRegionStart())) &&
+            Utils::isInt32(static_cast<int64_t>(jumpAddress - codeInfo.getCodeRegionEnd())))
+          useTrampoline = false;
+      }
+
       if (ASMJIT_UNLIKELY(_code->_relocations.willGrow(&_code->_baseHeap) != kErrorOk))
         goto NoHeapMemory;
 
@@ -4344,7 +4595,7 @@ EmitJmpCall:
         re->_size = 4;
         re->_sourceOffset = ip + inst32Size - 4;
 
-        if (getArchType() != ArchInfo::kTypeX86 && x86IsJmpOrCall(instId)) {
+        if (useTrampoline) {
           if (!rex) {
             re->_sourceOffset++;
             EMIT_BYTE(kX86ByteRex);
@@ -4473,6 +4724,59 @@ EmitImm:
   // --------------------------------------------------------------------------
 
 EmitDone:
+  if (ASMJIT_UNLIKELY(_globalHints & CodeEmitter::kHintAlignBranches)) {
+    size_t start = (size_t)(_bufferPtr - _bufferData);
+    size_t end = (size_t)(cursor - _bufferData);
+
+    if (x86IsAlignedBranch(instId)) {
+      // A macro-fused pair is padded as a single instruction.
+      size_t first = start;
+      if (x86IsFusibleJcc(instId) && _fusibleEnd == start && _fusibleSectionId == _section->getId())
+        first = _fusibleStart;
+
+      // Crosses or ends on a 32-byte boundary.
+      if ((first >> 5) != (end >> 5)) {
+        // Remove the branch, it's emitted again after the padding, which can
+        // change its encoding (displacement to a bound label, for example).
+        if (relSize) {
+          LabelLink* link = label->_links;
+          label->_links = link->prev;
+          _code->_unresolvedLabelsCount--;
+          _code->_baseHeap.release(link, sizeof(LabelLink));
+        }
+
+        if (re) {
+          if (re->getType() == RelocEntry::kTypeTrampoline)
+            _code->_trampolinesSize -= 8;
+          _code->_relocations.truncate(re->getId());
+          _code->_baseHeap.release(re, sizeof(RelocEntry));
+        }
+
+        err = X86Assembler_padBranch(this, first, start, static_cast<uint32_t>(32 - (first & 31)));
+        if (ASMJIT_UNLIKELY(err)) goto Failed;
+
+        // The branch starts at a 32-byte boundary now, so it always fits.
+        return _emit(instId, o0, o1, o2, o3);
+      }
+    }
+
+    // Only instructions that can be moved are remembered.
+    if (x86IsFusible(instId) && !relSize && !re && x86IsMovableOp(o0) && x86IsMovableOp(o1)) {
+      _fusibleStart = start;
+      _fusibleEnd = end;
+      _fusibleSectionId = _section->getId();
+    }
+    else {
+      _fusibleEnd = Globals::kInvalidIndex;
+    }
+  }
+
+  if (ASMJIT_UNLIKELY(_holeType != HoleEntry::kTypeNone)) {
+    err = X86Assembler_addHole(this, re, cursor, opCode, imVal, imLen, o0, o1, o2, o3);
+    if (ASMJIT_UNLIKELY(err)) goto Failed;
+    resetHole();
+  }
+
 #if !defined(ASMJIT_DISABLE_LOGGING)
   // Logging is a performance hit anyway, so make it the unlikely case.
   if (ASMJIT_UNLIKELY(options & CodeEmitter::kOptionLoggingEnabled))
@@ -4530,6 +4834,9 @@ Error X86Assembler::align(uint32_t mode, uint32_t alignment) {
     _code->_logger->logf("%s.align %u\n", _code->_logger->getIndentation(), alignment);
 #endif // !ASMJIT_DISABLE_LOGGING
 
+  // Aligned code must not be moved by branch padding.
+  _fusibleEnd = Globals::kInvalidIndex;
+
   if (mode >= kAlignCount)
     return setLastError(DebugUtils::errored(kErrorInvalidArgument));
 
@@ -4554,30 +4861,8 @@ Error X86Assembler::align(uint32_t mode, uint32_t alignment) {
   switch (mode) {
     case kAlignCode: {
       if (_globalHints & kHintOptimizedAlign) {
-        // Intel 64 and IA-32 Architectures Software Developer's Manual - Volume 2B (NOP).
-        enum { kMaxNopSize = 9 };
-
-        static const uint8_t nopData[kMaxNopSize][kMaxNopSize] = {
-          { 0x90 },
-          { 0x66, 0x90 },
-          { 0x0F, 0x1F, 0x00 },
-          { 0x0F, 0x1F, 0x40, 0x00 },
-          { 0x0F, 0x1F, 0x44, 0x00, 0x00 },
-          { 0x66, 0x0F, 0x1F, 0x44, 0x00, 0x00 },
-          { 0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00 },
-          { 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
-          { 0x66, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 }
-        };
-
-        do {
-          uint32_t n = std::min<uint32_t>(i, kMaxNopSize);
-          const uint8_t* src = nopData[n - 1];
-
-          i -= n;
-          do {
-            EMIT_BYTE(*src++);
-          } while (--n);
-        } while (i);
+        cursor = x86WriteNops(cursor, i);
+        i = 0;
       }
 
       pattern = 0x90;
@@ -4602,6 +4887,217 @@ Error X86Assembler::align(uint32_t mode, uint32_t alignment) {
   return kErrorOk;
 }
 
+// ============================================================================
+// [asmjit::X86Assembler - Bind]
+// ============================================================================
+
+Error X86Assembler::bind(const Label& label) {
+  // Code before a label must not be moved by branch padding.
+  _fusibleEnd = Globals::kInvalidIndex;
+  return Base::bind(label);
+}
+
+// ============================================================================
+// [asmjit::X86Assembler - Test]
+// ============================================================================
+
+#if defined(ASMJIT_TEST)
+static void X86AssemblerTest_nops(X86Assembler& a, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++)
+    a.nop();
+}
+
+UNIT(x86_assembler_align_branches) {
+  CodeHolder code;
+  code.init(CodeInfo(ArchInfo::kTypeX64));
+  code.addGlobalHints(CodeEmitter::kHintAlignBranches);
+
+  X86Assembler a(&code);
+  Label L0 = a.newLabel();
+  Label L1 = a.newLabel();
+
+  INFO("Checking a jump that would cross a 32-byte boundary");
+  a.bind(L0);
+  X86AssemblerTest_nops(a, 29);
+  a.jz(L1);
+  EXPECT(a.getOffset() == 32 + 6, "Jump should start at 32, ends at %u", static_cast<unsigned int>(a.getOffset()));
+  EXPECT(a.getBranchPaddingSize() == 3);
+
+  INFO("Checking a backward jump that would end on a 32-byte boundary");
+  X86AssemblerTest_nops(a, 62 - 38);
+  a.jmp(L0);
+  EXPECT(a.getOffset() == 64 + 2, "Jump should start at 64, ends at %u", static_cast<unsigned int>(a.getOffset()));
+  EXPECT(a.getBranchPaddingSize() == 3 + 2);
+
+  INFO("Checking a macro-fused pair that would cross a 32-byte boundary");
+  X86AssemblerTest_nops(a, 94 - 66);
+  a.cmp(x86::eax, x86::ebx);
+  a.jnz(L1);
+  a.bind(L1);
+  EXPECT(a.getOffset() == 96 + 2 + 6, "Pair should start at 96, ends at %u", static_cast<unsigned int>(a.getOffset()));
+  EXPECT(a.getBranchPaddingSize() == 3 + 2 + 2);
+  EXPECT(a.getBranchPaddingCount() == 3);
+
+  const uint8_t* data = a.getBufferData();
+  EXPECT(data[96] == 0x3B || data[96] == 0x39, "Pair should start by cmp");
+  EXPECT(data[94] == 0x66 && data[95] == 0x90, "Pair should be preceded by a NOP");
+  EXPECT(data[32] == 0x0F && data[33] == 0x84 && data[34] == 104 - 38, "Padded jump should be linked to its label");
+  EXPECT(code.getUnresolvedLabelsCount() == 0);
+
+  INFO("Checking a branch that fits");
+  X86AssemblerTest_nops(a, 4);
+  a.ret();
+  EXPECT(a.getBranchPaddingCount() == 3);
+}
+
+UNIT(x86_assembler_batch) {
+  using namespace x86;
+
+  CodeHolder code0;
+  CodeHolder code1;
+  code0.init(CodeInfo(ArchInfo::kTypeX64));
+  code1.init(CodeInfo(ArchInfo::kTypeX64));
+
+  X86Assembler a0(&code0);
+  X86Assembler a1(&code1);
+  Label L0 = a0.newLabel();
+  Label L1 = a1.newLabel();
+
+  Inst::Record records[6];
+  records[0].init(X86Inst::kIdMov, eax, ebx);
+  records[1].init(X86Inst::kIdAdd, rcx, imm(1));
+  records[2].init(X86Inst::kIdMov, dword_ptr(rsi, 8), edx);
+  records[3].init(X86Inst::kIdJnz, L1);
+  records[3].detail.options = X86Inst::kOptionShortForm;
+  records[4].init(X86Inst::kIdVpermil2ps, xmm0, xmm1, xmm2, xmm3);
+  records[4].opArray[4].copyFrom(imm(0));
+  records[4].opCount = 5;
+  records[5].init(X86Inst::kIdRet);
+
+  INFO("Checking instructions emitted by emitBatch()");
+  a0.mov(eax, ebx);
+  a0.add(rcx, 1);
+  a0.mov(dword_ptr(rsi, 8), edx);
+  a0.short_().jnz(L0);
+  a0.vpermil2ps(xmm0, xmm1, xmm2, xmm3, 0);
+  a0.ret();
+  a0.bind(L0);
+
+  EXPECT(a1.emitBatch(records, 6) == kErrorOk);
+  a1.bind(L1);
+
+  EXPECT(a0.getOffset() == a1.getOffset());
+  EXPECT(::memcmp(a0.getBufferData(), a1.getBufferData(), a0.getOffset()) == 0);
+
+  INFO("Checking that emitBatch() stops at the first invalid instruction");
+  size_t offset = a1.getOffset();
+  records[1].init(X86Inst::kIdMov, eax, rbx);
+  EXPECT(a1.emitBatch(records, 6) == kErrorInvalidInstruction);
+  EXPECT(a1.getOffset() == offset + 2);
+}
+
+UNIT(x86_assembler_holes) {
+  using namespace x86;
+
+  CodeHolder code;
+  code.init(CodeInfo(ArchInfo::kTypeX64));
+  X86Assembler a(&code);
+
+  a.setHole(HoleEntry::kTypeImm, 0);
+  a.mov(eax, 0x7FFFFFFF);                                // [0..4]   B8 imm32
+  a.setHole(HoleEntry::kTypeDisp, 1);
+  a.add(eax, dword_ptr(rsi, 0x7FFFFFF0));                // [5..10]  03 86 disp32
+  a.setHole(HoleEntry::kTypeTarget, 2);
+  a.call(imm(0x1000));                                   // [11..16] 40 E8 rel32
+  a.ret();                                               // [17]
+
+  INFO("Checking holes of instructions that don't have them");
+  a.setHole(HoleEntry::kTypeImm, 3);
+  EXPECT(a.mov(eax, ebx) == kErrorInvalidImmediate);
+  a.resetLastError();
+  a.setHole(HoleEntry::kTypeDisp, 3);
+  EXPECT(a.add(eax, 1) == kErrorInvalidDisplacement);
+  a.resetLastError();
+  EXPECT(a.getOffset() == 18);
+  EXPECT(code.getHoleEntries().getLength() == 3);
+
+  CodeTemplate tmpl;
+  EXPECT(tmpl.init(&code) == kErrorOk);
+  EXPECT(tmpl.getHoleCount() == 3);
+
+  uint8_t dst0[64];
+  uint8_t dst1[64];
+  uint64_t base = 0x10000;
+  EXPECT(tmpl.getImageSize() <= sizeof(dst0));
+
+  INFO("Checking that placeholder values produce the same code as relocate()");
+  uint64_t values[3] = { 0x7FFFFFFF, 0x7FFFFFF0, 0x1000 };
+  size_t size = code.relocate(dst0, base);
+  EXPECT(tmpl.instantiate(dst1, values, 3, base) == kErrorOk);
+  EXPECT(size != 0 && ::memcmp(dst0, dst1, size) == 0);
+
+  INFO("Checking patched holes");
+  values[0] = 42;
+  values[1] = static_cast<uint64_t>(int64_t(-16));
+  values[2] = 0x20000;
+  EXPECT(tmpl.instantiate(dst1, values, 3, base) == kErrorOk);
+  EXPECT(Utils::readU32u(dst1 + 1) == 42);
+  EXPECT(Utils::readU32u(dst1 + 7) == 0xFFFFFFF0U);
+  EXPECT(dst1[12] == 0xE8 && Utils::readU32u(dst1 + 13) == 0x20000 - (base + 17));
+
+  INFO("Checking a target that requires a trampoline");
+  values[2] = base + (uint64_t(1) << 40);
+  EXPECT(tmpl.instantiate(dst1, values, 3, base) == kErrorOk);
+  EXPECT(dst1[11] == 0xFF && dst1[12] == 0x15);
+
+  INFO("Checking values that don't fit");
+  values[0] = uint64_t(1) << 32;
+  EXPECT(tmpl.instantiate(dst1, values, 3, base) == kErrorInvalidImmediate);
+
+  INFO("Checking immediates sign-extended by the CPU");
+  {
+    CodeHolder code2;
+    code2.init(CodeInfo(ArchInfo::kTypeX64));
+    X86Assembler a2(&code2);
+
+    a2.setHole(HoleEntry::kTypeImm, 0);
+    a2.add(ecx, 1);                                      // 83 C1 ib
+    a2.setHole(HoleEntry::kTypeImm, 1);
+    a2.add(rax, 0x1000);                                 // 48 05 id
+    a2.setHole(HoleEntry::kTypeImm, 2);
+    a2.mov(rcx, -1);                                     // 48 C7 C1 id
+    a2.setHole(HoleEntry::kTypeImm, 3);
+    a2.add(dl, 1);                                       // 80 C2 ib
+    a2.setHole(HoleEntry::kTypeImm, 4);
+    a2.mov(edx, 1);                                      // BA id
+    a2.ret();
+
+    const ZoneVector<HoleEntry>& holes = code2.getHoleEntries();
+    EXPECT(holes.getLength() == 5);
+    EXPECT(holes[0].hasFlag(HoleEntry::kFlagSigned) && holes[1].hasFlag(HoleEntry::kFlagSigned) && holes[2].hasFlag(HoleEntry::kFlagSigned));
+    EXPECT(!holes[3].hasFlag(HoleEntry::kFlagSigned) && !holes[4].hasFlag(HoleEntry::kFlagSigned));
+
+    CodeTemplate tmpl2;
+    EXPECT(tmpl2.init(&code2) == kErrorOk);
+
+    uint64_t minusOne = static_cast<uint64_t>(int64_t(-1));
+    uint64_t values2[5] = { 127, 0x7FFFFFFF, minusOne, 200, 0xFFFFFFFFU };
+    EXPECT(tmpl2.instantiate(dst1, values2, 5, base) == kErrorOk);
+
+    values2[0] = 200;
+    EXPECT(tmpl2.instantiate(dst1, values2, 5, base) == kErrorInvalidImmediate);
+
+    values2[0] = minusOne;
+    values2[1] = 0xFFFFFFFFU;
+    EXPECT(tmpl2.instantiate(dst1, values2, 5, base) == kErrorInvalidImmediate);
+
+    values2[1] = minusOne;
+    values2[2] = 0xFFFFFFFFU;
+    EXPECT(tmpl2.instantiate(dst1, values2, 5, base) == kErrorInvalidImmediate);
+  }
+}
+#endif // ASMJIT_TEST
+
 } // asmjit namespace
 
 // [Api-End]
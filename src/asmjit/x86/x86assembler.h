@@ -68,6 +68,12 @@ public:
   ASMJIT_INLINE uint32_t _getAddressOverrideMask() const noexcept { return _privateData; }
   ASMJIT_INLINE void _setAddressOverrideMask(uint32_t m) noexcept { _privateData = m; }
 
+  //! Get the count of bytes inserted to keep branches within 32-byte boundaries
+  //! (see \ref CodeEmitter::kHintAlignBranches).
+  ASMJIT_INLINE size_t getBranchPaddingSize() const noexcept { return _branchPaddingSize; }
+  //! Get the count of branches (or macro-fused pairs) padded.
+  ASMJIT_INLINE size_t getBranchPaddingCount() const noexcept { return _branchPaddingCount; }
+
   // --------------------------------------------------------------------------
   // [Events]
   // --------------------------------------------------------------------------
@@ -83,6 +89,18 @@ public:
 
   ASMJIT_API Error _emit(uint32_t instId, const Operand_& o0, const Operand_& o1, const Operand_& o2, const Operand_& o3) override;
   ASMJIT_API Error align(uint32_t mode, uint32_t alignment) override;
+  ASMJIT_API Error bind(const Label& label) override;
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  size_t _branchPaddingSize;             //!< Count of bytes inserted before branches.
+  size_t _branchPaddingCount;            //!< Count of branches padded.
+
+  size_t _fusibleStart;                  //!< Start of the last instruction if it can be macro-fused.
+  size_t _fusibleEnd;                    //!< End of the last instruction if it can be macro-fused.
+  uint32_t _fusibleSectionId;            //!< Section of the last instruction if it can be macro-fused.
 };
 
 //! \}
@@ -9,10 +9,14 @@
 
 // [Guard]
 #include "../asmjit_build.h"
-#if defined(ASMJIT_BUILD_X86) && !defined(ASMJIT_DISABLE_COMPILER)
+#if defined(ASMJIT_BUILD_X86) && !defined(ASMJIT_DISABLE_BUILDER)
 
 // [Dependencies]
+#include "../x86/x86assembler.h"
 #include "../x86/x86builder.h"
+#include "../x86/x86layoutpass.h"
+#include "../x86/x86loopalignpass.h"
+#include "../x86/x86peepholepass.h"
 
 // [Api-Begin]
 #include "../asmjit_apibegin.h"
@@ -48,19 +52,562 @@ Error X86Builder::onAttach(CodeHolder* code) noexcept {
   return kErrorOk;
 }
 
+// ============================================================================
+// [asmjit::X86Builder - Helpers]
+// ============================================================================
+
+#if !defined(ASMJIT_DISABLE_VALIDATION)
+//! \internal
+//!
+//! Validate an instruction and set the last error of `self` if it's invalid.
+static Error X86Builder_validate(X86Builder* self, const Inst::Detail& detail, const Operand_* opArray, uint32_t opCount) {
+  Error err = Inst::validate(self->getArchType(), detail, opArray, opCount);
+  if (!err) return kErrorOk;
+
+#if !defined(ASMJIT_DISABLE_LOGGING)
+  StringBuilderTmp<256> sb;
+  sb.appendString(DebugUtils::errorAsString(err));
+  sb.appendString(": ");
+  Logging::formatInstruction(sb, 0, self, self->getArchType(), detail, opArray, opCount);
+  return self->setLastError(err, sb.getData());
+#else
+  return self->setLastError(err);
+#endif
+}
+#endif // !ASMJIT_DISABLE_VALIDATION
+
+//! \internal
+//!
+//! Get whether `instId` is a jump, which is added as \ref CBJump.
+static ASMJIT_INLINE bool X86Builder_isJumpInst(uint32_t instId) noexcept {
+  return (instId >= X86Inst::kIdJa   && instId <= X86Inst::kIdJz    ) ||
+         (instId >= X86Inst::kIdLoop && instId <= X86Inst::kIdLoopne) ;
+}
+
+//! \internal
+//!
+//! Link the jump `node` to its target and set its flags as \ref X86Compiler
+//! does, so passes see the same IR.
+static Error X86Builder_initJump(X86Builder* self, CBJump* node) noexcept {
+  uint32_t instId = node->getInstId();
+  uint32_t options = node->getOptions();
+  CBLabel* target = nullptr;
+
+  if (!(options & CodeEmitter::kOptionUnfollow)) {
+    const Operand* opArray = node->getOpArray();
+    if (node->getOpCount() && opArray[0].isLabel())
+      ASMJIT_PROPAGATE(self->getCBLabel(&target, opArray[0].getId()));
+    else
+      options |= CodeEmitter::kOptionUnfollow;
+  }
+  node->setOptions(options);
+
+  node->orFlags(instId == X86Inst::kIdJmp ? CBNode::kFlagIsJmp | CBNode::kFlagIsTaken : CBNode::kFlagIsJcc);
+  if (options & X86Inst::kOptionTaken)
+    node->orFlags(CBNode::kFlagIsTaken);
+
+  node->_target = target;
+  node->_jumpNext = nullptr;
+
+  if (target) {
+    node->_jumpNext = static_cast<CBJump*>(target->_from);
+    target->_from = node;
+    target->addNumRefs();
+  }
+  return kErrorOk;
+}
+
 // ============================================================================
 // [asmjit::X86Builder - Inst]
 // ============================================================================
 
 Error X86Builder::_emit(uint32_t instId, const Operand_& o0, const Operand_& o1, const Operand_& o2, const Operand_& o3) {
-  // TODO:
+  return X86Builder::_emit(instId, o0, o1, o2, o3, _none, _none);
+}
+
+Error X86Builder::_emit(uint32_t instId, const Operand_& o0, const Operand_& o1, const Operand_& o2, const Operand_& o3, const Operand_& o4, const Operand_& o5) {
+  uint32_t options = getOptions() | getGlobalOptions();
+  const char* inlineComment = getInlineComment();
+
+  uint32_t opCount = static_cast<uint32_t>(!o0.isNone()) +
+                     static_cast<uint32_t>(!o1.isNone()) +
+                     static_cast<uint32_t>(!o2.isNone()) +
+                     static_cast<uint32_t>(!o3.isNone()) ;
+
+  // Count 5th and 6th operands.
+  if (!o4.isNone()) opCount = 5;
+  if (!o5.isNone()) opCount = 6;
+
+  // Handle failure and rare cases first.
+  const uint32_t kErrorsAndSpecialCases = kOptionMaybeFailureCase | // CodeEmitter in error state.
+                                          kOptionStrictValidation ; // Strict validation.
+
+  if (ASMJIT_UNLIKELY(options & kErrorsAndSpecialCases)) {
+    // Don't do anything if we are in error state.
+    if (_lastError) return _lastError;
+
+#if !defined(ASMJIT_DISABLE_VALIDATION)
+    // Strict validation.
+    if (options & kOptionStrictValidation) {
+      Operand_ opArray[] = { o0, o1, o2, o3, o4, o5 };
+      ASMJIT_PROPAGATE(X86Builder_validate(this, Inst::Detail(instId, options, _extraReg), opArray, opCount));
+
+      // Clear it as it must be enabled explicitly on assembler side.
+      options &= ~kOptionStrictValidation;
+    }
+#endif // ASMJIT_DISABLE_VALIDATION
+  }
+
+  resetOptions();
+  resetInlineComment();
+
+  bool isJump = X86Builder_isJumpInst(instId);
+  size_t nodeSize = isJump ? sizeof(CBJump) : sizeof(CBInst);
+
+  CBInst* node = _cbHeap.allocT<CBInst>(nodeSize + opCount * sizeof(Operand));
+  Operand* opArray = reinterpret_cast<Operand*>(reinterpret_cast<uint8_t*>(node) + nodeSize);
+
+  if (ASMJIT_UNLIKELY(!node))
+    return setLastError(DebugUtils::errored(kErrorNoHeapMemory));
+
+  if (opCount > 0) opArray[0].copyFrom(o0);
+  if (opCount > 1) opArray[1].copyFrom(o1);
+  if (opCount > 2) opArray[2].copyFrom(o2);
+  if (opCount > 3) opArray[3].copyFrom(o3);
+  if (opCount > 4) opArray[4].copyFrom(o4);
+  if (opCount > 5) opArray[5].copyFrom(o5);
+
+  if (isJump)
+    node = new(node) CBJump(this, instId, options, opArray, opCount);
+  else
+    node = new(node) CBInst(this, instId, options, opArray, opCount);
+
+  node->_instDetail.extraReg = _extraReg;
+  _extraReg.reset();
+  node->setHole(_holeType, _holeId);
+  resetHole();
+
+  if (isJump) {
+    Error err = X86Builder_initJump(this, node->as<CBJump>());
+    if (ASMJIT_UNLIKELY(err)) return setLastError(err);
+  }
+
+  if (inlineComment) {
+    inlineComment = static_cast<char*>(_cbDataZone.dup(inlineComment, ::strlen(inlineComment), true));
+    node->setInlineComment(inlineComment);
+  }
+
+  addNode(node);
   return kErrorOk;
 }
 
+Error X86Builder::_emitBatch(const Inst::Record* records, size_t count) {
+  if (_lastError) return _lastError;
+
+  uint32_t globalOptions = getGlobalOptions();
+  size_t i;
+  size_t size = 0;
+
+  // Validate all records first so either all or none of them is added.
+  for (i = 0; i < count; i++) {
+    const Inst::Record& record = records[i];
+    uint32_t opCount = record.opCount;
+
+    if (ASMJIT_UNLIKELY(opCount > 6))
+      return setLastError(DebugUtils::errored(kErrorInvalidArgument));
+
+#if !defined(ASMJIT_DISABLE_VALIDATION)
+    uint32_t options = record.detail.options | globalOptions;
+    if (options & kOptionStrictValidation)
+      ASMJIT_PROPAGATE(X86Builder_validate(this, Inst::Detail(record.detail.instId, options, record.detail.extraReg), record.opArray, opCount));
+#endif // ASMJIT_DISABLE_VALIDATION
+
+    // Create targets of jumps first, linking them can't fail then.
+    bool isJump = X86Builder_isJumpInst(record.detail.instId);
+    if (isJump && opCount && record.opArray[0].isLabel()) {
+      CBLabel* target;
+      Error err = getCBLabel(&target, record.opArray[0].getId());
+      if (ASMJIT_UNLIKELY(err)) return setLastError(err);
+    }
+
+    size += (isJump ? sizeof(CBJump) : sizeof(CBInst)) + opCount * sizeof(Operand);
+  }
+
+  if (!size) return kErrorOk;
+
+  // All nodes share a single allocation, nodes are never released.
+  uint8_t* p = static_cast<uint8_t*>(_cbHeap.alloc(size));
+  if (ASMJIT_UNLIKELY(!p))
+    return setLastError(DebugUtils::errored(kErrorNoHeapMemory));
+
+  resetOptions();
+  resetExtraReg();
+  resetInlineComment();
+
+  for (i = 0; i < count; i++) {
+    const Inst::Record& record = records[i];
+    uint32_t opCount = record.opCount;
+    uint32_t options = (record.detail.options | globalOptions) & ~kOptionStrictValidation;
+
+    bool isJump = X86Builder_isJumpInst(record.detail.instId);
+    size_t nodeSize = isJump ? sizeof(CBJump) : sizeof(CBInst);
+
+    Operand* opArray = reinterpret_cast<Operand*>(p + nodeSize);
+    for (uint32_t j = 0; j < opCount; j++)
+      opArray[j].copyFrom(record.opArray[j]);
+
+    CBInst* node;
+    if (isJump)
+      node = new(p) CBJump(this, record.detail.instId, options, opArray, opCount);
+    else
+      node = new(p) CBInst(this, record.detail.instId, options, opArray, opCount);
+    node->_instDetail.extraReg = record.detail.extraReg;
+
+    if (isJump)
+      X86Builder_initJump(this, node->as<CBJump>());
+
+    addNode(node);
+    p += nodeSize + opCount * sizeof(Operand);
+  }
+
+  return kErrorOk;
+}
+
+// ============================================================================
+// [asmjit::X86Builder - Test]
+// ============================================================================
+
+#if defined(ASMJIT_TEST)
+UNIT(x86_builder_batch) {
+  using namespace x86;
+
+  CodeHolder code0;
+  CodeHolder code1;
+  code0.init(CodeInfo(ArchInfo::kTypeX64));
+  code1.init(CodeInfo(ArchInfo::kTypeX64));
+
+  X86Assembler a(&code0);
+  X86Builder cb(&code1);
+
+  Inst::Record records[4];
+  records[0].init(X86Inst::kIdMov, eax, ebx);
+  records[1].init(X86Inst::kIdAdd, rcx, imm(1));
+  records[2].init(X86Inst::kIdMov, dword_ptr(rsi, 8), edx);
+  records[3].init(X86Inst::kIdRet);
+
+  INFO("Checking nodes added by emitBatch()");
+  cb.nop();
+  EXPECT(cb.emitBatch(records, 4) == kErrorOk);
+
+  uint32_t count = 0;
+  for (CBNode* node = cb.getFirstNode(); node; node = node->getNext())
+    count++;
+  EXPECT(count == 5);
+  EXPECT(cb.getLastNode()->as<CBInst>()->getInstId() == X86Inst::kIdRet);
+
+  EXPECT(cb.serialize(&a) == kErrorOk);
+  EXPECT(a.getOffset() == 1 + 2 + 4 + 3 + 1);
+  EXPECT(a.getBufferData()[0] == 0x90);
+  EXPECT(a.getBufferData()[a.getOffset() - 1] == 0xC3);
+
+#if !defined(ASMJIT_DISABLE_VALIDATION)
+  INFO("Checking that invalid records are not added by emitBatch()");
+  CBNode* last = cb.getLastNode();
+  records[2].init(X86Inst::kIdMov, eax, rbx);
+  records[2].detail.options = CodeEmitter::kOptionStrictValidation;
+  EXPECT(cb.emitBatch(records, 4) == kErrorInvalidInstruction);
+  EXPECT(cb.getLastNode() == last);
+  cb.resetLastError();
+#endif // !ASMJIT_DISABLE_VALIDATION
+
+  INFO("Checking that jumps are added as CBJump linked to their targets");
+  Label L = cb.newLabel();
+  CBLabel* target;
+  EXPECT(cb.getCBLabel(&target, L) == kErrorOk);
+
+  records[0].init(X86Inst::kIdJz, L);
+  records[1].init(X86Inst::kIdJmp, L);
+  EXPECT(cb.emitBatch(records, 2) == kErrorOk);
+  EXPECT(cb.jmp(L) == kErrorOk);
+
+  CBNode* node = cb.getLastNode();
+  for (uint32_t i = 0; i < 3; i++, node = node->getPrev()) {
+    EXPECT(node->isJmpOrJcc() && node->as<CBJump>()->getTarget() == target);
+    EXPECT(node->isJmp() == (i < 2));
+  }
+  EXPECT(target->getNumRefs() == 3);
+}
+
+UNIT(x86_builder_cfg) {
+  CodeHolder code;
+  code.init(CodeInfo(ArchInfo::kTypeX64));
+
+  X86Builder cb(&code);
+  Label L_Outer = cb.newLabel();
+  Label L_Inner = cb.newLabel();
+  Label L_Else = cb.newLabel();
+  Label L_Join = cb.newLabel();
+  Label L_Dead = cb.newLabel();
+
+  // #0: entry
+  cb.xor_(x86::eax, x86::eax);
+  // #1: outer loop header
+  cb.bind(L_Outer);
+  cb.mov(x86::ecx, 10);
+  // #2: inner loop header
+  cb.bind(L_Inner);
+  cb.dec(x86::ecx);
+  cb.jnz(L_Inner);
+  // #3: diamond
+  cb.test(x86::edx, x86::edx);
+  cb.jz(L_Else);
+  // #4
+  cb.inc(x86::eax);
+  cb.jmp(L_Join);
+  // #5
+  cb.bind(L_Else);
+  cb.dec(x86::eax);
+  // #6: outer loop latch
+  cb.bind(L_Join);
+  cb.cmp(x86::eax, 100);
+  cb.jb(L_Outer);
+  // #7
+  cb.ret();
+  // #8: unreachable
+  cb.bind(L_Dead);
+  cb.nop();
+
+  CBCfg* cfg;
+  EXPECT(cb.getCfg(&cfg) == kErrorOk, "Failed to build CFG");
+
+  const ZoneVector<CBBlock*>& blocks = cfg->getBlocks();
+  EXPECT(blocks.getLength() == 9, "Expected 9 blocks, got %u", unsigned(blocks.getLength()));
+  EXPECT(cfg->getRpo().getLength() == 8, "Expected 8 reachable blocks");
+  EXPECT(cfg->getRpo()[0] == blocks[0], "Entry must be first in reverse postorder");
+  EXPECT(cfg->getBlockByLabel(L_Join.getId()) == blocks[6], "Label maps to a wrong block");
+
+  INFO("Checking edges");
+  EXPECT(blocks[2]->getSuccessors().getLength() == 2 &&
+         blocks[2]->getSuccessors()[0] == blocks[3] &&
+         blocks[2]->getSuccessors()[1] == blocks[2], "Conditional jump must fall through first");
+  EXPECT(blocks[4]->getSuccessors().getLength() == 1 &&
+         blocks[4]->getSuccessors()[0] == blocks[6], "Unconditional jump must not fall through");
+  EXPECT(blocks[6]->getPredecessors().getLength() == 2, "Join must have 2 predecessors");
+  EXPECT(blocks[7]->isExit() && blocks[7]->getSuccessors().isEmpty(), "Return must end the flow");
+  EXPECT(!blocks[8]->isReachable() && blocks[8]->getIDom() == nullptr, "Block #8 must be unreachable");
+
+  INFO("Checking dominators");
+  EXPECT(blocks[0]->getIDom() == nullptr, "Entry has no dominator");
+  EXPECT(blocks[6]->getIDom() == blocks[3], "Join must be dominated by the branch");
+  EXPECT(blocks[1]->dominates(blocks[7]) && !blocks[4]->dominates(blocks[6]), "Wrong dominance");
+
+  INFO("Checking loops");
+  EXPECT(blocks[1]->isLoopHeader() && blocks[2]->isLoopHeader(), "Loop headers not detected");
+  EXPECT(blocks[2]->getLoopParent() == blocks[1], "Inner loop must be nested in the outer one");
+  EXPECT(blocks[2]->getLoopDepth() == 2 && blocks[5]->getLoopDepth() == 1 && blocks[7]->getLoopDepth() == 0,
+    "Wrong loop depth");
+  EXPECT(blocks[5]->getLoopHeader() == blocks[1], "Block #5 must be in the outer loop");
+
+  INFO("Checking that the CFG is rebuilt after a node is removed");
+  EXPECT(cfg->isValid(), "CFG must be valid");
+  cb.removeNode(blocks[8]->getFirst());
+  EXPECT(!cfg->isValid(), "CFG must be invalidated");
+  EXPECT(cb.getCfg(&cfg) == kErrorOk, "Failed to rebuild CFG");
+  EXPECT(cfg->getBlockCount() == 9 && cfg->getBlocks()[8]->getFirst()->getType() == CBNode::kNodeInst,
+    "Removed label must not start a block");
+}
+
+UNIT(x86_builder_layout) {
+  CodeHolder code;
+  code.init(CodeInfo(ArchInfo::kTypeX64));
+
+  X86Builder cb(&code);
+  X86LayoutPass* layout = cb.newPassT<X86LayoutPass>();
+  EXPECT(cb.addPass(layout) == kErrorOk);
+
+  Label L_Loop = cb.newLabel();
+  Label L_Rare = cb.newLabel();
+  Label L_Common = cb.newLabel();
+  Label L_Next = cb.newLabel();
+
+  cb.xor_(x86::eax, x86::eax);
+  cb.bind(L_Loop);
+  cb.test(x86::ecx, 7);
+  cb.jnz(L_Common);
+  cb.bind(L_Rare);
+  cb.add(x86::eax, 2);
+  cb.jmp(L_Next);
+  cb.bind(L_Common);
+  cb.inc(x86::eax);
+  cb.bind(L_Next);
+  cb.dec(x86::ecx);
+  cb.jnz(L_Loop);
+  cb.ret();
+
+  EXPECT(layout->setBlockWeight(L_Rare, 1) == kErrorOk);
+  EXPECT(layout->setBlockWeight(L_Common, 7) == kErrorOk);
+
+  Zone zone(4096 - Zone::kZoneOverhead);
+  EXPECT(layout->process(&zone) == kErrorOk);
+
+  INFO("Checking that the frequent successor falls through");
+  static const uint32_t expected[] = {
+    X86Inst::kIdXor, X86Inst::kIdTest, X86Inst::kIdJe, X86Inst::kIdInc,
+    X86Inst::kIdDec, X86Inst::kIdJnz, X86Inst::kIdRet, X86Inst::kIdAdd, X86Inst::kIdJmp
+  };
+
+  uint32_t count = 0;
+  uint32_t alignCount = 0;
+
+  for (CBNode* node = cb.getFirstNode(); node; node = node->getNext()) {
+    if (node->getType() == CBNode::kNodeAlign) {
+      EXPECT(node->getNext()->as<CBLabel>()->getId() == L_Loop.getId(), "Only the loop must be aligned");
+      alignCount++;
+    }
+
+    if (node->getType() != CBNode::kNodeInst)
+      continue;
+
+    CBInst* inst = node->as<CBInst>();
+    EXPECT(count < ASMJIT_ARRAY_SIZE(expected) && inst->getInstId() == expected[count],
+      "Unexpected instruction #%u", count);
+
+    if (inst->getInstId() == X86Inst::kIdJe)
+      EXPECT(inst->getOpArray()[0].getId() == L_Rare.getId(), "Inverted jump must target the rare block");
+    count++;
+  }
+
+  EXPECT(count == ASMJIT_ARRAY_SIZE(expected));
+  EXPECT(alignCount == 1 && layout->getAlignedCount() == 1);
+  EXPECT(layout->getInvertedCount() == 1 && layout->getAddedCount() == 0 && layout->getRemovedCount() == 0);
+
+  X86Assembler a(&code);
+  EXPECT(cb.serialize(&a) == kErrorOk);
+}
+
+static void X86Builder_generateLoops(X86Builder& cb, Label& L_Inner, Label& L_Cold) {
+  Label L_Outer = cb.newLabel();
+  L_Inner = cb.newLabel();
+  L_Cold = cb.newLabel();
+
+  cb.mov(x86::ecx, 10);                  // 5 bytes.
+  cb.bind(L_Outer);
+  cb.mov(x86::edx, 10);                  // 5 bytes.
+  cb.bind(L_Inner);                      // Offset 10.
+  cb.dec(x86::edx);
+  cb.jnz(L_Inner);
+  cb.dec(x86::ecx);
+  cb.jnz(L_Outer);
+
+  cb.test(x86::eax, x86::eax);
+  cb.notTaken().jnz(L_Cold);
+  cb.ret();
+
+  cb.bind(L_Cold);
+  cb.dec(x86::eax);
+  cb.jnz(L_Cold);
+  cb.ret();
+}
+
+UNIT(x86_builder_loop_align) {
+  Zone zone(4096 - Zone::kZoneOverhead);
+  Label L_Inner, L_Cold;
+
+  INFO("Checking that only innermost and hot loops are aligned");
+  {
+    CodeHolder code;
+    code.init(CodeInfo(ArchInfo::kTypeX64));
+
+    X86Builder cb(&code);
+    X86LoopAlignPass* pass = cb.newPassT<X86LoopAlignPass>();
+    EXPECT(cb.addPass(pass) == kErrorOk);
+
+    X86Builder_generateLoops(cb, L_Inner, L_Cold);
+    EXPECT(pass->process(&zone) == kErrorOk);
+    EXPECT(pass->getAlignedCount() == 1 && pass->getSkippedCount() == 0 && pass->getPaddingSize() == 6,
+      "Expected 1 loop aligned by 6 bytes, got %u by %u bytes",
+      unsigned(pass->getAlignedCount()), unsigned(pass->getPaddingSize()));
+
+    CBLabel* node;
+    EXPECT(cb.getCBLabel(&node, L_Inner) == kErrorOk);
+    EXPECT(node->getPrev()->getType() == CBNode::kNodeAlign, "Inner loop must be aligned");
+    EXPECT(node->getPrev()->as<CBAlign>()->getMaxSkip() == 10);
+
+    EXPECT(cb.getCBLabel(&node, L_Cold) == kErrorOk);
+    EXPECT(node->getPrev()->getType() != CBNode::kNodeAlign, "Cold loop must not be aligned");
+
+    X86Assembler a(&code);
+    EXPECT(cb.serialize(&a) == kErrorOk);
+    EXPECT(code.getLabelOffset(L_Inner) == 16);
+  }
+
+  INFO("Checking that loops needing more than max-skip padding are not aligned");
+  {
+    CodeHolder code;
+    code.init(CodeInfo(ArchInfo::kTypeX64));
+
+    X86Builder cb(&code);
+    X86LoopAlignPass* pass = cb.newPassT<X86LoopAlignPass>();
+    EXPECT(cb.addPass(pass) == kErrorOk);
+
+    X86Builder_generateLoops(cb, L_Inner, L_Cold);
+    pass->setMaxSkip(4);
+    EXPECT(pass->process(&zone) == kErrorOk);
+    EXPECT(pass->getAlignedCount() == 0 && pass->getSkippedCount() == 1);
+  }
+
+  INFO("Checking that CBAlign respects max-skip when serialized");
+  {
+    CodeHolder code;
+    code.init(CodeInfo(ArchInfo::kTypeX64));
+
+    X86Builder cb(&code);
+    cb.nop();
+    cb.addNode(cb.newAlignNode(kAlignCode, 16, 8));
+    cb.nop();
+    cb.addNode(cb.newAlignNode(kAlignCode, 16, 15));
+    cb.ret();
+
+    X86Assembler a(&code);
+    EXPECT(cb.serialize(&a) == kErrorOk);
+    EXPECT(a.getOffset() == 16 + 1);
+  }
+}
+
+UNIT(x86_builder_peephole) {
+  using namespace x86;
+  Zone zone(4096 - Zone::kZoneOverhead);
+
+  INFO("Checking that flags are followed across jumps");
+  for (uint32_t i = 0; i < 2; i++) {
+    CodeHolder code;
+    code.init(CodeInfo(ArchInfo::kTypeX64));
+
+    X86Builder cb(&code);
+    X86PeepholePass* pass = cb.newPassT<X86PeepholePass>();
+    EXPECT(cb.addPass(pass) == kErrorOk);
+
+    // `mov eax, 0` can't become `xor eax, eax` if the target reads ZF.
+    Label L = cb.newLabel();
+    cb.cmp(ecx, edx);
+    cb.mov(eax, 0);
+    cb.jmp(L);
+    cb.ret();
+    cb.bind(L);
+    if (i == 0) cb.setz(al);
+    cb.ret();
+
+    EXPECT(pass->process(&zone) == kErrorOk);
+    EXPECT(pass->getRewrittenCount() == i,
+      "Expected %u rewritten instructions, got %u", unsigned(i), unsigned(pass->getRewrittenCount()));
+  }
+}
+#endif // ASMJIT_TEST
+
 } // asmjit namespace
 
 // [Api-End]
 #include "../asmjit_apiend.h"
 
 // [Guard]
-#endif // ASMJIT_BUILD_X86 && !ASMJIT_DISABLE_COMPILER
+#endif // ASMJIT_BUILD_X86 && !ASMJIT_DISABLE_BUILDER
@@ -164,6 +164,8 @@ Error X86Compiler::_emit(uint32_t instId, const Operand_& o0, const Operand_& o1
     new(node) CBJump(this, instId, options, opArray, opCount);
     node->_instDetail.extraReg = _extraReg;
     _extraReg.reset();
+    node->setHole(_holeType, _holeId);
+    resetHole();
 
     CBLabel* jTarget = nullptr;
     if (!(options & kOptionUnfollow)) {
@@ -216,6 +218,8 @@ Error X86Compiler::_emit(uint32_t instId, const Operand_& o0, const Operand_& o1
     node = new(node) CBInst(this, instId, options, opArray, opCount);
     node->_instDetail.extraReg = _extraReg;
     _extraReg.reset();
+    node->setHole(_holeType, _holeId);
+    resetHole();
 
     if (inlineComment) {
       inlineComment = static_cast<char*>(_cbDataZone.dup(inlineComment, ::strlen(inlineComment), true));
@@ -302,6 +306,8 @@ Error X86Compiler::_emit(uint32_t instId, const Operand_& o0, const Operand_& o1
     new(node) CBJump(this, instId, options, opArray, opCount);
     node->_instDetail.extraReg = _extraReg;
     _extraReg.reset();
+    node->setHole(_holeType, _holeId);
+    resetHole();
 
     CBLabel* jTarget = nullptr;
     if (!(options & kOptionUnfollow)) {
@@ -356,6 +362,8 @@ Error X86Compiler::_emit(uint32_t instId, const Operand_& o0, const Operand_& o1
     node = new(node) CBInst(this, instId, options, opArray, opCount);
     node->_instDetail.extraReg = _extraReg;
     _extraReg.reset();
+    node->setHole(_holeType, _holeId);
+    resetHole();
 
     if (inlineComment) {
       inlineComment = static_cast<char*>(_cbDataZone.dup(inlineComment, ::strlen(inlineComment), true));
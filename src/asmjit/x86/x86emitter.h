@@ -350,9 +350,11 @@ public:
   //! Force long form of jmp/jcc instruction.
   ASMJIT_INLINE This& long_() noexcept { return _addOptions(X86Inst::kOptionLongForm); }
 
-  //! Condition is likely to be taken (has only benefit on P4).
+  //! Condition is likely to be taken (has only benefit on P4, also used by
+  //! \ref X86HotColdPass).
   ASMJIT_INLINE This& taken() noexcept { return _addOptions(X86Inst::kOptionTaken); }
-  //! Condition is unlikely to be taken (has only benefit on P4).
+  //! Condition is unlikely to be taken (has only benefit on P4, also used by
+  //! \ref X86HotColdPass).
   ASMJIT_INLINE This& notTaken() noexcept { return _addOptions(X86Inst::kOptionNotTaken); }
 
   //! Use LOCK prefix.
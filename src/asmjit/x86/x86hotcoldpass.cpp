@@ -0,0 +1,172 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Export]
+#define ASMJIT_EXPORTS
+
+// [Guard]
+#include "../asmjit_build.h"
+#if defined(ASMJIT_BUILD_X86) && !defined(ASMJIT_DISABLE_BUILDER)
+
+// [Dependencies]
+#include "../base/codecfg.h"
+#include "../x86/x86hotcoldpass.h"
+#include "../x86/x86inst.h"
+#include "../x86/x86internal_p.h"
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+// ============================================================================
+// [asmjit::X86HotColdPass - Construction / Destruction]
+// ============================================================================
+
+X86HotColdPass::X86HotColdPass() noexcept
+  : CBPass("X86HotColdPass"),
+    _movedCount(0),
+    _invertedCount(0) {}
+X86HotColdPass::~X86HotColdPass() noexcept {}
+
+// ============================================================================
+// [asmjit::X86HotColdPass - Interface]
+// ============================================================================
+
+Error X86HotColdPass::process(Zone* zone) noexcept {
+  _movedCount = 0;
+  _invertedCount = 0;
+
+  CodeBuilder* cb = _cb;
+  CBCfg* cfg;
+  ASMJIT_PROPAGATE(cb->getCfg(&cfg));
+
+  // Blocks are used after the CFG is invalidated by the first change, which
+  // is fine as it's not rebuilt until the next `getCfg()`.
+  const ZoneVector<CBBlock*>& blocks = cfg->getBlocks();
+  size_t numBlocks = blocks.getLength();
+  if (!numBlocks) return kErrorOk;
+
+  // `Zone` doesn't align allocations, so the array of pointers goes first.
+  CBBlock** stack = zone->allocT<CBBlock*>(numBlocks * sizeof(CBBlock*));
+  uint8_t* isHot = zone->allocZeroedT<uint8_t>(numBlocks);
+  if (ASMJIT_UNLIKELY(!isHot || !stack))
+    return DebugUtils::errored(kErrorNoHeapMemory);
+
+  // --------------------------------------------------------------------------
+  // [Hot Blocks]
+  // --------------------------------------------------------------------------
+
+  X86Internal::markHotBlocks(cfg, isHot, stack);
+
+  // --------------------------------------------------------------------------
+  // [Split]
+  // --------------------------------------------------------------------------
+
+  // Each function (or the whole code if there is no function) is processed
+  // separately, cold blocks are moved after its last hot block.
+  size_t i;
+  size_t start = 0;
+  while (start < numBlocks) {
+    size_t end = start + 1;
+    while (end < numBlocks && !blocks[end]->isEntry())
+      end++;
+
+    size_t lastHot = end - 1;
+    while (!isHot[lastHot])
+      lastHot--;
+
+    // The last hot block must not continue to the code that follows it.
+    CBNode* anchor = blocks[lastHot]->getLast();
+    if (blocks[lastHot]->fallsThrough() || anchor->getType() != CBNode::kNodeInst) {
+      start = end;
+      continue;
+    }
+
+    i = start + 1;
+    while (i < lastHot) {
+      if (isHot[i] || !blocks[i]->isReachable()) {
+        i++;
+        continue;
+      }
+
+      // Consecutive cold blocks `[first, i)` are moved together.
+      size_t first = i;
+      while (i < lastHot && !isHot[i] && blocks[i]->isReachable())
+        i++;
+
+      CBBlock* head = blocks[first];
+      CBBlock* tail = blocks[i - 1];
+      CBBlock* prev = blocks[first - 1];
+      CBBlock* next = blocks[i];
+
+      // If the code before falls through into the cold code and it ends by a
+      // conditional jump, the jump is inverted to jump to the cold code, thus
+      // its original target becomes the fall-through (if it's `next`).
+      bool isEntered = prev->isReachable() && prev->fallsThrough();
+      CBInst* jcc = nullptr;
+      uint32_t cond = x86::kCondCount;
+
+      if (isEntered && prev->getSuccessors().getLength() == 2) {
+        jcc = prev->getLast()->as<CBInst>();
+        cond = X86Inst::jccToCond(jcc->getInstId());
+
+        // Can't be inverted (jecxz, loop), keep the cold code in place.
+        if (cond == x86::kCondCount)
+          continue;
+      }
+
+      if (isEntered) {
+        Label headLabel;
+        ASMJIT_PROPAGATE(cb->getBlockLabel(head, headLabel));
+
+        CBNode* jmp;
+        if (jcc) {
+          Label target = jcc->getOpArray()[0].as<Label>();
+          ASMJIT_PROPAGATE(X86Internal::invertJcc(cb, jcc, cond, headLabel));
+          _invertedCount++;
+
+          if (prev->getSuccessors()[1] != next)
+            ASMJIT_PROPAGATE(X86Internal::addJmpAfter(cb, jcc, target, &jmp));
+        }
+        else {
+          ASMJIT_PROPAGATE(X86Internal::addJmpAfter(cb, prev->getLast(), headLabel, &jmp));
+        }
+      }
+      else if (prev->isReachable() && !prev->hasUnknownSuccessor() &&
+               prev->getSuccessors().getLength() == 1 && prev->getSuccessors()[0] == next &&
+               prev->getLast()->getType() == CBNode::kNodeInst &&
+               prev->getLast()->as<CBInst>()->getInstId() == X86Inst::kIdJmp) {
+        // The jump over the cold code is not needed anymore.
+        cb->removeNode(prev->getLast());
+      }
+
+      // If the cold code falls through into `next` it has to jump there.
+      CBNode* tailNode = tail->getLast();
+      if (tail->fallsThrough()) {
+        Label nextLabel;
+        ASMJIT_PROPAGATE(cb->getBlockLabel(next, nextLabel));
+        ASMJIT_PROPAGATE(X86Internal::addJmpAfter(cb, tailNode, nextLabel, &tailNode));
+      }
+
+      cb->moveNodes(head->getFirst(), tailNode, anchor);
+      anchor = tailNode;
+      _movedCount += i - first;
+    }
+
+    start = end;
+  }
+
+  return kErrorOk;
+}
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
+
+// [Guard]
+#endif // ASMJIT_BUILD_X86 && !ASMJIT_DISABLE_BUILDER
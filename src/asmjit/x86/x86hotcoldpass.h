@@ -0,0 +1,99 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Guard]
+#ifndef _ASMJIT_X86_X86HOTCOLDPASS_H
+#define _ASMJIT_X86_X86HOTCOLDPASS_H
+
+#include "../asmjit_build.h"
+#if !defined(ASMJIT_DISABLE_BUILDER)
+
+// [Dependencies]
+#include "../base/codebuilder.h"
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+//! \addtogroup asmjit_x86
+//! \{
+
+// ============================================================================
+// [asmjit::X86HotColdPass]
+// ============================================================================
+
+//! Hot/cold splitting pass.
+//!
+//! Moves code that is unlikely to be executed (cold) after the end of the
+//! function, so the likely path becomes a mostly straight fall-through. Cold
+//! code is described by hints:
+//!
+//!   - `notTaken()` makes the target of a conditional jump unlikely, and
+//!     `taken()` makes the code after it unlikely.
+//!   - \ref CodeBuilder::setLabelUnlikely() makes the code at the label
+//!     unlikely, \ref CodeBuilder::setLabelLikely() makes it likely even if
+//!     it's only reachable through unlikely jumps.
+//!
+//! Blocks reachable from the function entry without taking an unlikely edge
+//! are hot, other reachable blocks are cold. Consecutive cold blocks are moved
+//! together after the last hot block, which must end by `ret` or `jmp`. If a
+//! hot block falls through into cold code, its conditional jump is inverted
+//! (or a jump is added), and cold code that falls through into hot code gets
+//! a jump back.
+//!
+//! The pass relies on the function's epilog, so add it to \ref X86Compiler
+//! after it's attached (after \ref X86RAPass) and before \ref X86RelaxPass:
+//!
+//! ~~~
+//! X86Compiler cc(&code);
+//! cc.addPassT<X86HotColdPass>();
+//! cc.addPassT<X86RelaxPass>();
+//! ~~~
+class ASMJIT_VIRTAPI X86HotColdPass : public CBPass {
+public:
+  ASMJIT_NONCOPYABLE(X86HotColdPass)
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  ASMJIT_API X86HotColdPass() noexcept;
+  ASMJIT_API virtual ~X86HotColdPass() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Interface]
+  // --------------------------------------------------------------------------
+
+  ASMJIT_API virtual Error process(Zone* zone) noexcept override;
+
+  // --------------------------------------------------------------------------
+  // [Accessors]
+  // --------------------------------------------------------------------------
+
+  //! Get the count of blocks moved by the last `process()`.
+  ASMJIT_INLINE size_t getMovedCount() const noexcept { return _movedCount; }
+  //! Get the count of conditional jumps inverted by the last `process()`.
+  ASMJIT_INLINE size_t getInvertedCount() const noexcept { return _invertedCount; }
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  size_t _movedCount;                    //!< Count of blocks moved.
+  size_t _invertedCount;                 //!< Count of conditional jumps inverted.
+};
+
+//! \}
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
+
+// [Guard]
+#endif // !ASMJIT_DISABLE_BUILDER
+#endif // _ASMJIT_X86_X86HOTCOLDPASS_H
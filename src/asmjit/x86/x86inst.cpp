@@ -3098,6 +3098,272 @@ const X86Inst::OSignature X86InstDB::oSignatureData[] = {
   OSIGNATURE(FLAG(R) | FLAG(I32) | FLAG(I64) | FLAG(Rel32), 0, 0, 0x00)
 };
 #undef OSIGNATURE
+
+#define OCLASS_IMM(flags, index, immFlags) \
+  (uint64_t(((flags) & (immFlags)) != 0) << (X86Inst::kOpClassImm + index))
+#define OCLASS(flags, memFlags, extFlags, regId) ( \
+  (uint64_t((regId) == 0 ? (flags) & X86Inst::kOpAllRegs : 0) << X86Inst::kOpClassReg) | \
+  (uint64_t((flags) & X86Inst::kOpMem ? (memFlags) & 0x83FFU : 0) << X86Inst::kOpClassMem) | \
+  OCLASS_IMM(flags,  0, FLAG(U4) | FLAG(I8) | FLAG(U8) | FLAG(I16) | FLAG(U16) | FLAG(I32) | FLAG(U32) | FLAG(I64) | FLAG(U64)) | \
+  OCLASS_IMM(flags,  1, FLAG(I8) | FLAG(U8) | FLAG(I16) | FLAG(U16) | FLAG(I32) | FLAG(U32) | FLAG(I64) | FLAG(U64)) | \
+  OCLASS_IMM(flags,  2, FLAG(U8) | FLAG(I16) | FLAG(U16) | FLAG(I32) | FLAG(U32) | FLAG(I64) | FLAG(U64)) | \
+  OCLASS_IMM(flags,  3, FLAG(I16) | FLAG(U16) | FLAG(I32) | FLAG(U32) | FLAG(I64) | FLAG(U64)) | \
+  OCLASS_IMM(flags,  4, FLAG(U16) | FLAG(I32) | FLAG(U32) | FLAG(I64) | FLAG(U64)) | \
+  OCLASS_IMM(flags,  5, FLAG(I32) | FLAG(U32) | FLAG(I64) | FLAG(U64)) | \
+  OCLASS_IMM(flags,  6, FLAG(U32) | FLAG(I64) | FLAG(U64)) | \
+  OCLASS_IMM(flags,  7, FLAG(I64) | FLAG(U64)) | \
+  OCLASS_IMM(flags,  8, FLAG(U64)) | \
+  OCLASS_IMM(flags,  9, FLAG(I8) | FLAG(I16) | FLAG(I32) | FLAG(I64)) | \
+  OCLASS_IMM(flags, 10, FLAG(I16) | FLAG(I32) | FLAG(I64)) | \
+  OCLASS_IMM(flags, 11, FLAG(I32) | FLAG(I64)) | \
+  OCLASS_IMM(flags, 12, FLAG(I64)) | \
+  (uint64_t(((flags) & (FLAG(Rel8) | FLAG(Rel32))) != 0) << X86Inst::kOpClassLabel))
+const uint64_t X86InstDB::oSignatureClassData[] = {
+  OCLASS(0, 0, 0, 0xFF),
+  OCLASS(FLAG(W) | FLAG(GpbLo) | FLAG(GpbHi) | FLAG(Mem), MEM(Any) | MEM(M8), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(GpbLo) | FLAG(GpbHi), 0, 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Gpw) | FLAG(Mem), MEM(Any) | MEM(M16), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpw) | FLAG(Seg), 0, 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Gpd) | FLAG(Seg) | FLAG(Mem), MEM(Any) | MEM(M32), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpd), 0, 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Gpq) | FLAG(Mem), MEM(Any) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpq) | FLAG(Seg) | FLAG(I32), 0, 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(GpbLo) | FLAG(GpbHi), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(GpbLo) | FLAG(GpbHi) | FLAG(Mem) | FLAG(I8) | FLAG(U8), MEM(Any) | MEM(M8), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Gpw) | FLAG(Seg), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpw) | FLAG(Mem), MEM(Any) | MEM(M16), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Gpd), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpd) | FLAG(Seg) | FLAG(Mem) | FLAG(I32) | FLAG(U32), MEM(Any) | MEM(M32), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Gpq) | FLAG(Seg), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpq) | FLAG(Mem), MEM(Any) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Gpw) | FLAG(Mem), MEM(M16), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(I16) | FLAG(U16), 0, 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Gpq), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Cr) | FLAG(Dr) | FLAG(I64) | FLAG(U64), 0, 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(GpbLo) | FLAG(GpbHi) | FLAG(Mem), MEM(M8), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(I8) | FLAG(U8), 0, 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Gpd) | FLAG(Mem), MEM(M32), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(I32) | FLAG(U32), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Cr) | FLAG(Dr), 0, 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Cr) | FLAG(Dr), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpq), 0, 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(GpbLo) | FLAG(GpbHi) | FLAG(Mem), MEM(M8), 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Gpw) | FLAG(Mem), MEM(M16), 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Gpd) | FLAG(Mem), MEM(M32), 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Gpq) | FLAG(Mem), MEM(Any) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpq) | FLAG(I32), 0, 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Gpw) | FLAG(Gpd) | FLAG(Gpq) | FLAG(Mem), MEM(Any) | MEM(M16) | MEM(M32) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(I8), 0, 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(GpbLo) | FLAG(GpbHi) | FLAG(Mem), MEM(Any) | MEM(M8), 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Gpw) | FLAG(Mem), MEM(Any) | MEM(M16), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpw), 0, 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Gpd) | FLAG(Mem), MEM(Any) | MEM(M32), 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(GpbLo) | FLAG(GpbHi), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(GpbLo) | FLAG(GpbHi) | FLAG(Mem), MEM(Any) | MEM(M8), 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Gpw), 0, 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Gpd), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpd) | FLAG(Mem), MEM(Any) | MEM(M32), 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Gpq), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(GpbLo) | FLAG(GpbHi) | FLAG(Mem), MEM(M8), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpw) | FLAG(Mem), MEM(M16), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpd) | FLAG(Mem), MEM(M32), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpw) | FLAG(Gpd) | FLAG(Gpq) | FLAG(Mem), MEM(Any) | MEM(M16) | MEM(M32) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(GpbLo) | FLAG(GpbHi) | FLAG(Gpw) | FLAG(Gpd) | FLAG(Gpq) | FLAG(Mem), MEM(Any) | MEM(M8) | MEM(M16) | MEM(M32) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Implicit) | FLAG(Gpw), 0, 0, 0x01),
+  OCLASS(FLAG(W) | FLAG(Implicit) | FLAG(Gpw), 0, 0, 0x04),
+  OCLASS(FLAG(W) | FLAG(Implicit) | FLAG(Gpd), 0, 0, 0x04),
+  OCLASS(FLAG(X) | FLAG(Implicit) | FLAG(Gpd), 0, 0, 0x01),
+  OCLASS(FLAG(W) | FLAG(Implicit) | FLAG(Gpq), 0, 0, 0x04),
+  OCLASS(FLAG(X) | FLAG(Implicit) | FLAG(Gpq), 0, 0, 0x01),
+  OCLASS(FLAG(R) | FLAG(Gpw) | FLAG(Mem) | FLAG(I8) | FLAG(I16), MEM(Any) | MEM(M16), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpd) | FLAG(Mem) | FLAG(I8) | FLAG(I32), MEM(Any) | MEM(M32), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpq) | FLAG(Mem) | FLAG(I8) | FLAG(I32), MEM(Any) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Gpw), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(I8) | FLAG(I16) | FLAG(U16), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(I8) | FLAG(I32) | FLAG(U32), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(I8) | FLAG(I32), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Mem), MEM(Any) | MEM(M16), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Mem), MEM(Any) | MEM(M32), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Mem), MEM(Any) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Mem), MEM(Any) | MEM(M16), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Mem), MEM(Any) | MEM(M32), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Mem), MEM(Any) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Mm), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpq) | FLAG(Mm) | FLAG(Xmm) | FLAG(Mem), MEM(Any) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Gpq) | FLAG(Mm) | FLAG(Xmm) | FLAG(Mem), MEM(Any) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Mm), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Xmm), 0, 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Xmm), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Xmm) | FLAG(Mem), MEM(Any) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Xmm) | FLAG(Mem), MEM(Any) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Xmm) | FLAG(Mem), MEM(Any) | MEM(M128), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Xmm) | FLAG(Mem), MEM(Any) | MEM(M128), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Ymm), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Ymm) | FLAG(Mem), MEM(Any) | MEM(M256), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Ymm) | FLAG(Mem), MEM(Any) | MEM(M256), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Ymm), 0, 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Zmm), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Zmm) | FLAG(Mem), MEM(Any) | MEM(M512), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Zmm) | FLAG(Mem), MEM(Any) | MEM(M512), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Zmm), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(U8), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Xmm) | FLAG(Mem) | FLAG(U8), MEM(Any) | MEM(M128), 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Xmm), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Vm), MEM(Vm32x), 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Ymm), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Vm), MEM(Vm32y), 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Zmm), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Vm), MEM(Vm32z), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Vm), MEM(Vm64x), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Vm), MEM(Vm64y), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Vm), MEM(Vm64z), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpq) | FLAG(U8), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpw) | FLAG(Gpd) | FLAG(Mem), MEM(M16) | MEM(M32), 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Gpw) | FLAG(Gpd) | FLAG(Mem), MEM(M16) | MEM(M32), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Implicit) | FLAG(GpbLo), 0, 0, 0x01),
+  OCLASS(FLAG(R) | FLAG(Implicit) | FLAG(Gpw), 0, 0, 0x01),
+  OCLASS(FLAG(R) | FLAG(Implicit) | FLAG(Gpd), 0, 0, 0x01),
+  OCLASS(FLAG(R) | FLAG(Implicit) | FLAG(Gpq), 0, 0, 0x01),
+  OCLASS(FLAG(X) | FLAG(Implicit) | FLAG(Gpw), 0, 0, 0x04),
+  OCLASS(FLAG(X) | FLAG(Implicit) | FLAG(Gpd), 0, 0, 0x04),
+  OCLASS(FLAG(X) | FLAG(Implicit) | FLAG(Gpq), 0, 0, 0x04),
+  OCLASS(FLAG(W) | FLAG(Gpw) | FLAG(Gpq) | FLAG(Mem), MEM(Any) | MEM(M16) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Seg), 0, 0, 0x1A),
+  OCLASS(FLAG(W) | FLAG(Seg), 0, 0, 0x60),
+  OCLASS(FLAG(R) | FLAG(Gpw) | FLAG(Gpq) | FLAG(Mem) | FLAG(I8) | FLAG(I16) | FLAG(I32), MEM(Any) | MEM(M16) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Seg), 0, 0, 0x1E),
+  OCLASS(FLAG(R) | FLAG(Seg), 0, 0, 0x60),
+  OCLASS(FLAG(R) | FLAG(Vm), MEM(Vm64x) | MEM(Vm64y), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Mem), MEM(Any) | MEM(M128), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Mem), MEM(Any) | MEM(M256), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Mem), MEM(Any) | MEM(M128), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Mem), MEM(Any) | MEM(M256), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(U4), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Mem), MEM(M32) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Fp), 0, 0, 0x01),
+  OCLASS(FLAG(R) | FLAG(Fp), 0, 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Fp), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Fp), 0, 0, 0x01),
+  OCLASS(FLAG(X) | FLAG(Mem), MEM(M32) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Mem), MEM(Any) | MEM(M48), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Mem), MEM(Any) | MEM(M80), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(GpbLo) | FLAG(U8), 0, 0, 0x02),
+  OCLASS(FLAG(W) | FLAG(K) | FLAG(Xmm), 0, 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(K) | FLAG(Ymm), 0, 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(K), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Xmm) | FLAG(Ymm) | FLAG(Mem), MEM(M64) | MEM(M128) | MEM(M256), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Xmm) | FLAG(Mem), MEM(M128), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Ymm) | FLAG(Mem), MEM(M256), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Mem), MEM(Any) | MEM(M512), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Mem), MEM(Any) | MEM(M512), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpq) | FLAG(Xmm) | FLAG(Mem), MEM(Any) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Xmm) | FLAG(Mem), MEM(Any) | MEM(M32), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Xmm) | FLAG(Mem), MEM(Any) | MEM(M16), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Xmm) | FLAG(Mem), MEM(Any) | MEM(M32), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Xmm) | FLAG(Mem), MEM(Any) | MEM(M16), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Xmm) | FLAG(Mem), MEM(Any) | MEM(M256), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Vm), MEM(Vm32x), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Vm), MEM(Vm32y), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Vm), MEM(Vm32z), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Vm), MEM(Vm64x), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Vm), MEM(Vm64y), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Vm), MEM(Vm64z), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Bnd), 0, 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Bnd), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Bnd) | FLAG(Mem), MEM(Any), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Bnd) | FLAG(Mem), MEM(Any), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpq) | FLAG(Mem) | FLAG(I32) | FLAG(I64) | FLAG(Rel32), MEM(Any) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(GpbLo) | FLAG(GpbHi) | FLAG(Gpw) | FLAG(Gpd) | FLAG(Mem), MEM(M8) | MEM(M16) | MEM(M32), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(GpbLo) | FLAG(GpbHi) | FLAG(Gpq) | FLAG(Mem), MEM(M8) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Gpw) | FLAG(Gpd), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Fp) | FLAG(Mem), MEM(M32) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Implicit) | FLAG(Gpw) | FLAG(Gpd), 0, 0, 0x02),
+  OCLASS(FLAG(R) | FLAG(I32) | FLAG(I64) | FLAG(Rel8), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Implicit) | FLAG(Gpd) | FLAG(Gpq), 0, 0, 0x02),
+  OCLASS(FLAG(R) | FLAG(Gpq) | FLAG(Mem) | FLAG(I32) | FLAG(I64) | FLAG(Rel8) | FLAG(Rel32), MEM(Any) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(GpbLo) | FLAG(GpbHi) | FLAG(Gpw) | FLAG(Gpd) | FLAG(Gpq) | FLAG(K) | FLAG(Mem), MEM(Any) | MEM(M8), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(GpbLo) | FLAG(GpbHi) | FLAG(Gpw) | FLAG(Gpd) | FLAG(Gpq) | FLAG(Mem), MEM(Any) | MEM(M8), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(K), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpd) | FLAG(Gpq) | FLAG(K) | FLAG(Mem), MEM(Any) | MEM(M32), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Gpd) | FLAG(Gpq) | FLAG(Mem), MEM(Any) | MEM(M32), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpq) | FLAG(K) | FLAG(Mem), MEM(Any) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpw) | FLAG(Gpd) | FLAG(Gpq) | FLAG(K) | FLAG(Mem), MEM(Any) | MEM(M16), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Gpw) | FLAG(Gpd) | FLAG(Gpq) | FLAG(Mem), MEM(Any) | MEM(M16), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpw) | FLAG(Gpd) | FLAG(Mem), MEM(Any) | MEM(M16), 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Implicit) | FLAG(Gpw) | FLAG(Gpd), 0, 0, 0x02),
+  OCLASS(FLAG(X) | FLAG(Implicit) | FLAG(Gpd) | FLAG(Gpq), 0, 0, 0x02),
+  OCLASS(FLAG(W) | FLAG(Gpd) | FLAG(Gpq), 0, 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Mm) | FLAG(Xmm), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpd) | FLAG(Gpq) | FLAG(Mem), MEM(Any) | MEM(M32), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Mm) | FLAG(Xmm), 0, 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Gpw) | FLAG(Gpd) | FLAG(Gpq), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Implicit) | FLAG(Gpd), 0, 0, 0x04),
+  OCLASS(FLAG(R) | FLAG(Implicit) | FLAG(Gpq), 0, 0, 0x04),
+  OCLASS(FLAG(R) | FLAG(Mm) | FLAG(Mem), MEM(Any) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Mm), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Mm) | FLAG(Mem) | FLAG(U8), MEM(Any) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(U16), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Xmm) | FLAG(Ymm) | FLAG(Mem), MEM(M128) | MEM(M256), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Xmm) | FLAG(Ymm) | FLAG(Zmm), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Xmm) | FLAG(Mem), MEM(Any) | MEM(M8), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpd) | FLAG(Gpq), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(GpbLo) | FLAG(GpbHi) | FLAG(Gpw) | FLAG(Gpd) | FLAG(Gpq) | FLAG(Mem), MEM(Any) | MEM(M8), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Xmm) | FLAG(U8), 0, 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Vm), MEM(Vm64x) | MEM(Vm64y), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Xmm) | FLAG(Ymm), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Implicit) | FLAG(Xmm), 0, 0, 0x01),
+  OCLASS(FLAG(R) | FLAG(Mem), MEM(Mib), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Mem), MEM(Any), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Mem), MEM(Mib), 0, 0x00),
+  OCLASS(FLAG(X) | FLAG(Gpd) | FLAG(Gpq), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Implicit) | FLAG(Mem), MEM(BaseOnly) | MEM(Ds), 0, 0x01),
+  OCLASS(FLAG(X) | FLAG(Implicit) | FLAG(Mem), MEM(BaseOnly) | MEM(Ds), 0, 0x40),
+  OCLASS(FLAG(X) | FLAG(Implicit) | FLAG(Mem), MEM(BaseOnly) | MEM(Es), 0, 0x80),
+  OCLASS(FLAG(X) | FLAG(Mem), MEM(Any) | MEM(M128), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Implicit) | FLAG(Gpq), 0, 0, 0x02),
+  OCLASS(FLAG(R) | FLAG(Implicit) | FLAG(Gpq), 0, 0, 0x08),
+  OCLASS(FLAG(X) | FLAG(Mem), MEM(Any) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Implicit) | FLAG(Gpd), 0, 0, 0x02),
+  OCLASS(FLAG(R) | FLAG(Implicit) | FLAG(Gpd), 0, 0, 0x08),
+  OCLASS(FLAG(W) | FLAG(Implicit) | FLAG(Gpd), 0, 0, 0x08),
+  OCLASS(FLAG(X) | FLAG(Implicit) | FLAG(Gpd), 0, 0, 0x02),
+  OCLASS(FLAG(R) | FLAG(Gpd) | FLAG(Gpq) | FLAG(Mem), MEM(Any) | MEM(M32) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Mem), MEM(Any) | MEM(M80), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Mem), MEM(M16) | MEM(M32), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Mem), MEM(M16) | MEM(M32) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Mem), MEM(M16) | MEM(M32), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Mem), MEM(M16) | MEM(M32) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Fp) | FLAG(Mem), MEM(M32) | MEM(M64) | MEM(M80), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Mem), MEM(Any), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Gpw) | FLAG(Mem), MEM(Any) | MEM(M16), 0, 0x01),
+  OCLASS(FLAG(W) | FLAG(Fp) | FLAG(Mem), MEM(M32) | MEM(M64), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Fp) | FLAG(Mem), MEM(M32) | MEM(M64) | MEM(M80), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(GpbLo) | FLAG(Gpw) | FLAG(Gpd), 0, 0, 0x01),
+  OCLASS(FLAG(R) | FLAG(Gpw) | FLAG(U8), 0, 0, 0x04),
+  OCLASS(FLAG(W) | FLAG(Mem), MEM(BaseOnly) | MEM(Es), 0, 0x80),
+  OCLASS(FLAG(R) | FLAG(Gpw), 0, 0, 0x04),
+  OCLASS(FLAG(R) | FLAG(I32) | FLAG(I64) | FLAG(Rel8) | FLAG(Rel32), 0, 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Implicit) | FLAG(GpbHi), 0, 0, 0x01),
+  OCLASS(FLAG(R) | FLAG(Mem), MEM(Any) | MEM(M8) | MEM(M16) | MEM(M32) | MEM(M48) | MEM(M64) | MEM(M80) | MEM(M128) | MEM(M256) | MEM(M512) | MEM(M1024), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Gpw) | FLAG(Gpd) | FLAG(Gpq) | FLAG(Mem), MEM(Any) | MEM(M16), 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Implicit) | FLAG(GpbLo) | FLAG(Gpw) | FLAG(Gpd) | FLAG(Gpq), 0, 0, 0x01),
+  OCLASS(FLAG(R) | FLAG(Implicit) | FLAG(Mem), MEM(BaseOnly) | MEM(Ds), 0, 0x80),
+  OCLASS(FLAG(R) | FLAG(GpbLo) | FLAG(Gpw) | FLAG(Gpd), 0, 0, 0x01),
+  OCLASS(FLAG(R) | FLAG(Mem), MEM(BaseOnly) | MEM(Ds), 0, 0x40),
+  OCLASS(FLAG(W) | FLAG(Implicit) | FLAG(Gpd), 0, 0, 0x02),
+  OCLASS(FLAG(W) | FLAG(Implicit) | FLAG(Xmm), 0, 0, 0x01),
+  OCLASS(FLAG(X) | FLAG(Mm) | FLAG(Xmm), 0, 0, 0x00),
+  OCLASS(FLAG(W) | FLAG(Implicit) | FLAG(Gpd), 0, 0, 0x01),
+  OCLASS(FLAG(R) | FLAG(Implicit) | FLAG(GpbHi), 0, 0, 0x01),
+  OCLASS(FLAG(R) | FLAG(Implicit) | FLAG(GpbLo) | FLAG(Gpw) | FLAG(Gpd) | FLAG(Gpq), 0, 0, 0x01),
+  OCLASS(FLAG(W) | FLAG(Ymm) | FLAG(Zmm), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Ymm) | FLAG(Zmm), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Xmm) | FLAG(Ymm) | FLAG(Zmm) | FLAG(Mem), MEM(M128) | MEM(M256) | MEM(M512), 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(Xmm) | FLAG(Ymm) | FLAG(Zmm), 0, 0, 0x00),
+  OCLASS(FLAG(R) | FLAG(I32) | FLAG(I64) | FLAG(Rel32), 0, 0, 0x00)
+};
+#undef OCLASS
+#undef OCLASS_IMM
 #undef MEM
 #undef FLAG
 
@@ -2101,6 +2101,20 @@ struct X86Inst {
     kMemOpAny             = 0x8000U      //!< Operand can be any scalar memory pointer.
   };
 
+  //! Operand class, used by the validator.
+  //!
+  //! Each operand passed to the validator is assigned a class, which is an
+  //! index of a bit in `X86InstDB::oSignatureClassData[]`. The bit is set if
+  //! the `OSignature` accepts every operand of that class, so most operands
+  //! are matched by a single bit test.
+  ASMJIT_ENUM(OpClass) {
+    kOpClassReg           = 0,           //!< Register, plus index of its `kOp...` flag (0..14).
+    kOpClassMem           = 16,          //!< Memory, plus index of its size flag (`kMemOpM8..kMemOpM1024`, `kMemOpAny`).
+    kOpClassImm           = 32,          //!< Immediate, plus index of its value range (0..12).
+    kOpClassLabel         = 45,          //!< Label.
+    kOpClassNone          = 63           //!< Operand that has to be matched by a full check.
+  };
+
   //! Instruction signature.
   //!
   //! Contains a sequence of operands' combinations and other metadata that defines
@@ -2425,6 +2439,30 @@ struct X86Inst {
     return getMiscData().condToJcc[cond];
   }
 
+  //! Translate a "jcc" instruction id to a condition code, returns
+  //! `x86::kCondCount` if `instId` is not "jcc" (also "jecxz" and "loop").
+  static ASMJIT_INLINE uint32_t jccToCond(uint32_t instId) noexcept {
+    switch (instId) {
+      case kIdJo  : return x86::kCondO;
+      case kIdJno : return x86::kCondNO;
+      case kIdJb  : case kIdJc  : case kIdJnae: return x86::kCondB;
+      case kIdJae : case kIdJnb : case kIdJnc : return x86::kCondAE;
+      case kIdJe  : case kIdJz  : return x86::kCondE;
+      case kIdJne : case kIdJnz : return x86::kCondNE;
+      case kIdJbe : case kIdJna : return x86::kCondBE;
+      case kIdJa  : case kIdJnbe: return x86::kCondA;
+      case kIdJs  : return x86::kCondS;
+      case kIdJns : return x86::kCondNS;
+      case kIdJp  : case kIdJpe : return x86::kCondP;
+      case kIdJnp : case kIdJpo : return x86::kCondPO;
+      case kIdJl  : case kIdJnge: return x86::kCondL;
+      case kIdJge : case kIdJnl : return x86::kCondGE;
+      case kIdJle : case kIdJng : return x86::kCondLE;
+      case kIdJg  : case kIdJnle: return x86::kCondG;
+      default     : return x86::kCondCount;
+    }
+  }
+
   //! Translate a condition code `cc` to a "setcc" instruction id.
   static ASMJIT_INLINE uint32_t condToSetcc(uint32_t cond) noexcept {
     ASMJIT_ASSERT(cond < x86::kCondCount);
@@ -2483,6 +2521,7 @@ struct X86InstDB {
 #if !defined(ASMJIT_DISABLE_VALIDATION)
   ASMJIT_API static const X86Inst::ISignature iSignatureData[];
   ASMJIT_API static const X86Inst::OSignature oSignatureData[];
+  ASMJIT_API static const uint64_t oSignatureClassData[];
 #endif // ASMJIT_DISABLE_VALIDATION
 };
 
@@ -146,7 +146,7 @@ static ASMJIT_INLINE bool x86CheckOSig(const X86Inst::OSignature& op, const X86I
   return true;
 }
 
-ASMJIT_FAVOR_SIZE Error X86InstImpl::validate(uint32_t archType, const Inst::Detail& detail, const Operand_* operands, uint32_t count) noexcept {
+Error X86InstImpl::validate(uint32_t archType, const Inst::Detail& detail, const Operand_* operands, uint32_t count) noexcept {
   uint32_t i;
   uint32_t archMask;
   const X86ValidationData* vd;
@@ -211,8 +211,9 @@ ASMJIT_FAVOR_SIZE Error X86InstImpl::validate(uint32_t archType, const Inst::Det
     // TODO: Validate extraReg {cx|ecx|rcx}.
   }
 
-  // Translate the given operands to `X86Inst::OSignature`.
+  // Translate the given operands to `X86Inst::OSignature` and `X86Inst::OpClass`.
   X86Inst::OSignature oSigTranslated[6];
+  uint32_t opClassTranslated[6];
   uint32_t combinedOpFlags = 0;
   uint32_t combinedRegMask = 0;
 
@@ -225,6 +226,7 @@ ASMJIT_FAVOR_SIZE Error X86InstImpl::validate(uint32_t archType, const Inst::Det
     uint32_t opFlags = 0;
     uint32_t memFlags = 0;
     uint32_t regMask = 0;
+    uint32_t opClass = X86Inst::kOpClassNone;
 
     switch (op.getOp()) {
       case Operand::kOpReg: {
@@ -235,6 +237,7 @@ ASMJIT_FAVOR_SIZE Error X86InstImpl::validate(uint32_t archType, const Inst::Det
         opFlags = _x86OpFlagFromRegType[regType];
         if (ASMJIT_UNLIKELY(opFlags == 0))
           return DebugUtils::errored(kErrorInvalidRegType);
+        opClass = X86Inst::kOpClassReg + Utils::findFirstBit(opFlags);
 
         // If `regId` is equal or greater than Operand::kPackedIdMin it means
         // that the register is virtual and its index will be assigned later
@@ -360,55 +363,86 @@ ASMJIT_FAVOR_SIZE Error X86InstImpl::validate(uint32_t archType, const Inst::Det
             return DebugUtils::errored(kErrorInvalidOperandSize);
         }
 
+        if (opFlags == X86Inst::kOpMem)
+          opClass = X86Inst::kOpClassMem + Utils::findFirstBit(memFlags & 0x83FFU);
         break;
       }
 
       case Operand::kOpImm: {
         uint64_t immValue = op.as<Imm>().getUInt64();
         uint32_t immFlags = 0;
+        uint32_t immClass = 0;
 
         if (static_cast<int64_t>(immValue) >= 0) {
           const uint32_t k32AndMore = X86Inst::kOpI32 | X86Inst::kOpU32 |
                                       X86Inst::kOpI64 | X86Inst::kOpU64 ;
 
-          if (immValue <= 0xFU)
+          if (immValue <= 0xFU) {
             immFlags = X86Inst::kOpU4 | X86Inst::kOpI8 | X86Inst::kOpU8 | X86Inst::kOpI16 | X86Inst::kOpU16 | k32AndMore;
-          else if (immValue <= 0x7FU)
+            immClass = 0;
+          }
+          else if (immValue <= 0x7FU) {
             immFlags = X86Inst::kOpI8 | X86Inst::kOpU8 | X86Inst::kOpI16 | X86Inst::kOpU16 | k32AndMore;
-          else if (immValue <= 0xFFU)
+            immClass = 1;
+          }
+          else if (immValue <= 0xFFU) {
             immFlags = X86Inst::kOpU8 | X86Inst::kOpI16 | X86Inst::kOpU16 | k32AndMore;
-          else if (immValue <= 0x7FFFU)
+            immClass = 2;
+          }
+          else if (immValue <= 0x7FFFU) {
             immFlags = X86Inst::kOpI16 | X86Inst::kOpU16 | k32AndMore;
-          else if (immValue <= 0xFFFFU)
+            immClass = 3;
+          }
+          else if (immValue <= 0xFFFFU) {
             immFlags = X86Inst::kOpU16 | k32AndMore;
-          else if (immValue <= 0x7FFFFFFFU)
+            immClass = 4;
+          }
+          else if (immValue <= 0x7FFFFFFFU) {
             immFlags = k32AndMore;
-          else if (immValue <= 0xFFFFFFFFU)
+            immClass = 5;
+          }
+          else if (immValue <= 0xFFFFFFFFU) {
             immFlags = X86Inst::kOpU32 | X86Inst::kOpI64 | X86Inst::kOpU64;
-          else if (immValue <= ASMJIT_UINT64_C(0x7FFFFFFFFFFFFFFF))
+            immClass = 6;
+          }
+          else if (immValue <= ASMJIT_UINT64_C(0x7FFFFFFFFFFFFFFF)) {
             immFlags = X86Inst::kOpI64 | X86Inst::kOpU64;
-          else
+            immClass = 7;
+          }
+          else {
             immFlags = X86Inst::kOpU64;
+            immClass = 8;
+          }
         }
         else {
           // 2s complement negation, as our number is unsigned...
           immValue = (~immValue + 1);
 
-          if (immValue <= 0x80U)
+          if (immValue <= 0x80U) {
             immFlags = X86Inst::kOpI8 | X86Inst::kOpI16 | X86Inst::kOpI32 | X86Inst::kOpI64;
-          else if (immValue <= 0x8000U)
+            immClass = 9;
+          }
+          else if (immValue <= 0x8000U) {
             immFlags = X86Inst::kOpI16 | X86Inst::kOpI32 | X86Inst::kOpI64;
-          else if (immValue <= 0x80000000U)
+            immClass = 10;
+          }
+          else if (immValue <= 0x80000000U) {
             immFlags = X86Inst::kOpI32 | X86Inst::kOpI64;
-          else
+            immClass = 11;
+          }
+          else {
             immFlags = X86Inst::kOpI64;
+            immClass = 12;
+          }
         }
         opFlags |= immFlags;
+        opClass = X86Inst::kOpClassImm + immClass;
         break;
       }
 
       case Operand::kOpLabel: {
         opFlags |= X86Inst::kOpRel8 | X86Inst::kOpRel32;
+        opClass = X86Inst::kOpClassLabel;
         break;
       }
 
@@ -420,6 +454,7 @@ ASMJIT_FAVOR_SIZE Error X86InstImpl::validate(uint32_t archType, const Inst::Det
     tod.flags = opFlags;
     tod.memFlags = static_cast<uint16_t>(memFlags);
     tod.regMask = static_cast<uint8_t>(regMask & 0xFFU);
+    opClassTranslated[i] = opClass;
     combinedOpFlags |= opFlags;
   }
 
@@ -450,7 +485,31 @@ ASMJIT_FAVOR_SIZE Error X86InstImpl::validate(uint32_t archType, const Inst::Det
   const X86Inst::ISignature* iSig = X86InstDB::iSignatureData + commonData->_iSignatureIndex;
   const X86Inst::ISignature* iEnd = iSig                      + commonData->_iSignatureCount;
 
+  // Match operand classes first, each operand is checked by a single bit test.
+  // Operands that must be a specific register (like CL of shifts), vector memory
+  // operands, and signatures that have their implicit operands omitted fall back
+  // to the full check below, which also provides the exact error code.
+  bool matched = false;
   if (iSig != iEnd) {
+    const uint64_t* oClassData = X86InstDB::oSignatureClassData;
+    const X86Inst::ISignature* iCur = iSig;
+
+    do {
+      if ((iCur->archMask & archMask) == 0 || iCur->opCount != count)
+        continue;
+
+      uint32_t j = 0;
+      while (j < count && ((oClassData[iCur->operands[j]] >> opClassTranslated[j]) & 1))
+        j++;
+
+      if (j == count) {
+        matched = true;
+        break;
+      }
+    } while (++iCur != iEnd);
+  }
+
+  if (!matched && iSig != iEnd) {
     const X86Inst::OSignature* oSigData = X86InstDB::oSignatureData;
 
     // If set it means that we matched a signature where only immediate value
@@ -725,6 +784,49 @@ ASMJIT_FAVOR_SIZE Error X86InstImpl::checkFeatures(uint32_t archType, const Inst
 }
 #endif
 
+// ============================================================================
+// [asmjit::X86InstImpl - Test]
+// ============================================================================
+
+#if defined(ASMJIT_TEST) && !defined(ASMJIT_DISABLE_VALIDATION)
+static Error X86InstImpl_validate(uint32_t archType, uint32_t instId, const Operand_& o0, const Operand_& o1 = Operand(), const Operand_& o2 = Operand()) noexcept {
+  Operand_ opArray[6];
+  opArray[0].copyFrom(o0);
+  opArray[1].copyFrom(o1);
+  opArray[2].copyFrom(o2);
+  opArray[3].reset();
+  opArray[4].reset();
+  opArray[5].reset();
+  return X86InstImpl::validate(archType, Inst::Detail(instId), opArray, 6);
+}
+
+UNIT(x86_inst_validate) {
+  using namespace x86;
+  const uint32_t x64 = ArchInfo::kTypeX64;
+  const uint32_t x86 = ArchInfo::kTypeX86;
+
+  INFO("Checking operands matched by their classes");
+  EXPECT(X86InstImpl_validate(x64, X86Inst::kIdMov, eax, dword_ptr(rsi, 4)) == kErrorOk);
+  EXPECT(X86InstImpl_validate(x64, X86Inst::kIdMov, qword_ptr(rdi), rax) == kErrorOk);
+  EXPECT(X86InstImpl_validate(x64, X86Inst::kIdAdd, eax, imm(-1)) == kErrorOk);
+  EXPECT(X86InstImpl_validate(x64, X86Inst::kIdMov, rax, imm(ASMJIT_UINT64_C(0x123456789))) == kErrorOk);
+  EXPECT(X86InstImpl_validate(x64, X86Inst::kIdVpaddd, ymm0, ymm1, yword_ptr(rax)) == kErrorOk);
+  EXPECT(X86InstImpl_validate(x86, X86Inst::kIdJmp, Label(0)) == kErrorOk);
+
+  INFO("Checking operands matched by the full check");
+  EXPECT(X86InstImpl_validate(x64, X86Inst::kIdShl, eax, cl) == kErrorOk);
+  EXPECT(X86InstImpl_validate(x64, X86Inst::kIdDiv, ecx) == kErrorOk);
+  EXPECT(X86InstImpl_validate(x64, X86Inst::kIdVpgatherdd, xmm0, ptr(rax, xmm1), xmm2) == kErrorOk);
+
+  INFO("Checking errors of operands that don't match");
+  EXPECT(X86InstImpl_validate(x64, X86Inst::kIdMov, eax, rbx) == kErrorInvalidInstruction);
+  EXPECT(X86InstImpl_validate(x64, X86Inst::kIdShl, eax, dl) == kErrorInvalidInstruction);
+  EXPECT(X86InstImpl_validate(x64, X86Inst::kIdMov, eax, word_ptr(rsi)) == kErrorInvalidInstruction);
+  EXPECT(X86InstImpl_validate(x64, X86Inst::kIdAdd, al, imm(0x1234)) == kErrorInvalidImmediate);
+  EXPECT(X86InstImpl_validate(x86, X86Inst::kIdMov, eax, rbx) == kErrorInvalidUseOfGpq);
+}
+#endif // ASMJIT_TEST && !ASMJIT_DISABLE_VALIDATION
+
 } // asmjit namespace
 
 // [Api-End]
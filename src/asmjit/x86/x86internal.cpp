@@ -1023,9 +1023,28 @@ ASMJIT_FAVOR_SIZE Error X86Internal::emitArgMove(X86Emitter* emitter,
 // [asmjit::X86Internal - Emit Prolog & Epilog]
 // ============================================================================
 
+//! \internal
+//!
+//! Describe the frame at the current position by an \ref UnwindEntry, does
+//! nothing if the unwind information is not enabled by the \ref CodeHolder.
+static ASMJIT_INLINE Error X86Internal_addUnwind(X86Emitter* emitter, uint32_t type, uint32_t regId = 0, int32_t offset = 0, int32_t addend = 0) {
+  CodeHolder* code = emitter->getCode();
+  if (!code->isUnwindInfoEnabled())
+    return kErrorOk;
+
+  Label label = emitter->newLabel();
+  ASMJIT_PROPAGATE(emitter->bind(label));
+  return code->addUnwindEntry(label.getId(), type, regId, offset, addend);
+}
+
 ASMJIT_FAVOR_SIZE Error X86Internal::emitProlog(X86Emitter* emitter, const FuncFrameLayout& layout) {
+  int32_t gpSize = static_cast<int32_t>(emitter->getGpSize());
   uint32_t gpSaved = layout.getSavedRegs(X86Reg::kKindGp);
 
+  // Size of the frame above ESP|RSP, which starts with the return address.
+  int32_t frameSize = gpSize;
+  ASMJIT_PROPAGATE(X86Internal_addUnwind(emitter, UnwindEntry::kTypeFuncStart, 0, frameSize));
+
   X86Gp zsp = emitter->zsp();   // ESP|RSP register.
   X86Gp zbp = emitter->zsp();   // EBP|RBP register.
   zbp.setId(X86Gp::kIdBp);
@@ -1038,7 +1057,12 @@ ASMJIT_FAVOR_SIZE Error X86Internal::emitProlog(X86Emitter* emitter, const FuncF
   if (layout.hasPreservedFP()) {
     gpSaved &= ~Utils::mask(X86Gp::kIdBp);
     ASMJIT_PROPAGATE(emitter->push(zbp));
+    frameSize += gpSize;
+    ASMJIT_PROPAGATE(X86Internal_addUnwind(emitter, UnwindEntry::kTypeCfaOffset, 0, frameSize));
+    ASMJIT_PROPAGATE(X86Internal_addUnwind(emitter, UnwindEntry::kTypeSaveReg, X86Gp::kIdBp, -frameSize));
+
     ASMJIT_PROPAGATE(emitter->mov(zbp, zsp));
+    ASMJIT_PROPAGATE(X86Internal_addUnwind(emitter, UnwindEntry::kTypeCfaReg, X86Gp::kIdBp, frameSize));
   }
 
   // Emit: 'push gp' sequence.
@@ -1047,6 +1071,11 @@ ASMJIT_FAVOR_SIZE Error X86Internal::emitProlog(X86Emitter* emitter, const FuncF
       if (!(i & 0x1)) continue;
       gpReg.setId(regId);
       ASMJIT_PROPAGATE(emitter->push(gpReg));
+
+      frameSize += gpSize;
+      if (!layout.hasPreservedFP())
+        ASMJIT_PROPAGATE(X86Internal_addUnwind(emitter, UnwindEntry::kTypeCfaOffset, 0, frameSize));
+      ASMJIT_PROPAGATE(X86Internal_addUnwind(emitter, UnwindEntry::kTypeSaveReg, regId, -frameSize));
     }
   }
 
@@ -1059,17 +1088,27 @@ ASMJIT_FAVOR_SIZE Error X86Internal::emitProlog(X86Emitter* emitter, const FuncF
   }
 
   // Emit: 'and zsp, StackAlignment'.
-  if (layout.hasDynamicAlignment())
+  //
+  // The CFA can't be described relative to ESP|RSP after the stack has been
+  // aligned, use `saReg` (a copy of ESP|RSP) until it's stored to `dsaSlot`.
+  if (layout.hasDynamicAlignment()) {
     ASMJIT_PROPAGATE(emitter->and_(zsp, -static_cast<int32_t>(layout.getStackAlignment())));
+    if (!layout.hasPreservedFP() && saReg.getId() != X86Gp::kIdSp)
+      ASMJIT_PROPAGATE(X86Internal_addUnwind(emitter, UnwindEntry::kTypeCfaReg, saReg.getId(), frameSize));
+  }
 
   // Emit: 'sub zsp, StackAdjustment'.
-  if (layout.hasStackAdjustment())
+  if (layout.hasStackAdjustment()) {
     ASMJIT_PROPAGATE(emitter->sub(zsp, layout.getStackAdjustment()));
+    if (!layout.hasPreservedFP() && !layout.hasDynamicAlignment())
+      ASMJIT_PROPAGATE(X86Internal_addUnwind(emitter, UnwindEntry::kTypeCfaOffset, 0, frameSize + static_cast<int32_t>(layout.getStackAdjustment())));
+  }
 
   // Emit: 'mov [zsp + dsaSlot], saReg'.
   if (layout.hasDynamicAlignment() && layout.hasDsaSlotUsed()) {
     X86Mem saMem = x86::ptr(zsp, layout._dsaSlot);
     ASMJIT_PROPAGATE(emitter->mov(saMem, saReg));
+    ASMJIT_PROPAGATE(X86Internal_addUnwind(emitter, UnwindEntry::kTypeCfaDeref, X86Gp::kIdSp, static_cast<int32_t>(layout._dsaSlot), frameSize));
   }
 
   // Emit 'movaps|movups [zsp + X], xmm0..15'.
@@ -1108,6 +1147,13 @@ ASMJIT_FAVOR_SIZE Error X86Internal::emitEpilog(X86Emitter* emitter, const FuncF
   // Don't emit 'pop zbp' in the pop sequence, this case is handled separately.
   if (layout.hasPreservedFP()) gpSaved &= ~Utils::mask(X86Gp::kIdBp);
 
+  // Size of the frame above ESP|RSP after the stack has been restored to the
+  // point where the 'pop gp' sequence starts. The epilog can be followed by
+  // more code of the function, so the state of the frame is remembered here
+  // and restored after 'ret'.
+  int32_t frameSize = static_cast<int32_t>(gpSize * (Utils::bitCount(gpSaved) + 1));
+  ASMJIT_PROPAGATE(X86Internal_addUnwind(emitter, UnwindEntry::kTypeRememberState));
+
   // Emit 'movaps|movups xmm0..15, [zsp + X]'.
   uint32_t xmmSaved = layout.getSavedRegs(X86Reg::kKindVec);
   if (xmmSaved) {
@@ -1142,10 +1188,12 @@ ASMJIT_FAVOR_SIZE Error X86Internal::emitEpilog(X86Emitter* emitter, const FuncF
       // Emit 'mov zsp, [zsp + DsaSlot]'.
       X86Mem saMem = x86::ptr(zsp, layout._dsaSlot);
       ASMJIT_PROPAGATE(emitter->mov(zsp, saMem));
+      ASMJIT_PROPAGATE(X86Internal_addUnwind(emitter, UnwindEntry::kTypeCfaReg, X86Gp::kIdSp, frameSize));
     }
     else if (layout.hasStackAdjustment()) {
       // Emit 'add zsp, StackAdjustment'.
       ASMJIT_PROPAGATE(emitter->add(zsp, static_cast<int32_t>(layout.getStackAdjustment())));
+      ASMJIT_PROPAGATE(X86Internal_addUnwind(emitter, UnwindEntry::kTypeCfaOffset, 0, frameSize));
     }
   }
 
@@ -1159,13 +1207,20 @@ ASMJIT_FAVOR_SIZE Error X86Internal::emitEpilog(X86Emitter* emitter, const FuncF
       if (i & 0x8000) {
         gpReg.setId(regId);
         ASMJIT_PROPAGATE(emitter->pop(gpReg));
+
+        frameSize -= static_cast<int32_t>(gpSize);
+        if (!layout.hasPreservedFP())
+          ASMJIT_PROPAGATE(X86Internal_addUnwind(emitter, UnwindEntry::kTypeCfaOffset, 0, frameSize));
       }
       i <<= 1;
     } while (regId != 0);
   }
 
   // Emit 'pop zbp'.
-  if (layout.hasPreservedFP()) ASMJIT_PROPAGATE(emitter->pop(zbp));
+  if (layout.hasPreservedFP()) {
+    ASMJIT_PROPAGATE(emitter->pop(zbp));
+    ASMJIT_PROPAGATE(X86Internal_addUnwind(emitter, UnwindEntry::kTypeCfaReg, X86Gp::kIdSp, static_cast<int32_t>(gpSize)));
+  }
 
   // Emit 'ret' or 'ret x'.
   if (layout.hasCalleeStackCleanup())
@@ -1173,7 +1228,7 @@ ASMJIT_FAVOR_SIZE Error X86Internal::emitEpilog(X86Emitter* emitter, const FuncF
   else
     ASMJIT_PROPAGATE(emitter->emit(X86Inst::kIdRet));
 
-  return kErrorOk;
+  return X86Internal_addUnwind(emitter, UnwindEntry::kTypeRestoreState);
 }
 
 // ============================================================================
@@ -1351,6 +1406,115 @@ ASMJIT_FAVOR_SIZE Error X86Internal::allocArgs(X86Emitter* emitter, const FuncFr
   return kErrorOk;
 }
 
+// ============================================================================
+// [asmjit::X86Internal - Layout]
+// ============================================================================
+
+Error X86Internal::initLayoutCode(CodeHolder& code, const CodeHolder* origin) noexcept {
+  ASMJIT_PROPAGATE(code.init(origin->getCodeInfo()));
+
+  // Hints like `kHintAlignBranches` change the layout.
+  code.addGlobalHints(origin->getGlobalHints());
+
+  // Sections and labels must have the same ids as in the origin.
+  const ZoneVector<SectionEntry*>& sections = origin->getSections();
+  for (size_t i = 1; i < sections.getLength(); i++) {
+    const SectionEntry* se = sections[i];
+    SectionEntry* dummy;
+    ASMJIT_PROPAGATE(code.newSection(&dummy, se->getName(), Globals::kInvalidIndex, se->getFlags(), se->getAlignment()));
+  }
+  ASMJIT_PROPAGATE(code.setConstPoolSectionId(origin->getConstPoolSectionId()));
+
+  for (size_t i = 0, count = origin->getLabelsCount(); i < count; i++) {
+    uint32_t dummy;
+    ASMJIT_PROPAGATE(code.newLabelId(dummy));
+  }
+
+  return kErrorOk;
+}
+
+// ============================================================================
+// [asmjit::X86Internal - CFG Helpers]
+// ============================================================================
+
+#if !defined(ASMJIT_DISABLE_BUILDER)
+//! \internal
+//!
+//! Get whether the edge from `block` to `succ` is unlikely to be taken, which
+//! is decided by `taken()` and `notTaken()` hints of a conditional jump.
+static ASMJIT_INLINE bool X86Internal_isUnlikelyEdge(const CBBlock* block, const CBBlock* succ) noexcept {
+  const ZoneVector<CBBlock*>& succs = block->getSuccessors();
+  if (succs.getLength() != 2 || !block->fallsThrough())
+    return false;
+
+  uint32_t options = block->getLast()->as<CBInst>()->getOptions();
+  if (options & X86Inst::kOptionNotTaken)
+    return succ == succs[1];
+  if (options & X86Inst::kOptionTaken)
+    return succ == succs[0];
+  return false;
+}
+
+void X86Internal::markHotBlocks(const CBCfg* cfg, uint8_t* isHot, CBBlock** stack) noexcept {
+  size_t sp = 0;
+
+  const ZoneVector<CBBlock*>& entries = cfg->getEntries();
+  for (size_t i = 0; i < entries.getLength(); i++) {
+    isHot[entries[i]->getId()] = 1;
+    stack[sp++] = entries[i];
+  }
+
+  while (sp) {
+    CBBlock* block = stack[--sp];
+    const ZoneVector<CBBlock*>& succs = block->getSuccessors();
+
+    for (size_t j = 0; j < succs.getLength(); j++) {
+      CBBlock* succ = succs[j];
+      if (isHot[succ->getId()])
+        continue;
+
+      uint32_t hints = succ->getLabelFlags();
+      if (!(hints & CBNode::kFlagIsLikely) &&
+          ((hints & CBNode::kFlagIsUnlikely) || X86Internal_isUnlikelyEdge(block, succ)))
+        continue;
+
+      isHot[succ->getId()] = 1;
+      stack[sp++] = succ;
+    }
+  }
+}
+
+Error X86Internal::addJmpAfter(CodeBuilder* cb, CBNode* ref, const Label& label, CBNode** out) noexcept {
+  CBNode* prev = cb->setCursor(ref);
+  Error err = cb->emit(X86Inst::kIdJmp, label);
+
+  *out = cb->getCursor();
+  cb->_setCursor(prev);
+  return err;
+}
+
+Error X86Internal::invertJcc(CodeBuilder* cb, CBInst* node, uint32_t cond, const Label& target) noexcept {
+  uint32_t options = node->getOptions();
+  uint32_t hints = options & (X86Inst::kOptionTaken | X86Inst::kOptionNotTaken);
+
+  options &= ~(hints | X86Inst::kOptionShortForm);
+  if (hints & X86Inst::kOptionTaken) options |= X86Inst::kOptionNotTaken;
+  if (hints & X86Inst::kOptionNotTaken) options |= X86Inst::kOptionTaken;
+
+  node->setInstId(X86Inst::condToJcc(X86Inst::negateCond(cond)));
+  node->setOptions(options);
+
+  if (node->isJcc()) {
+    if (options & X86Inst::kOptionTaken)
+      node->orFlags(CBNode::kFlagIsTaken);
+    else
+      node->andNotFlags(CBNode::kFlagIsTaken);
+  }
+
+  return cb->setJumpTarget(node, target);
+}
+#endif // !ASMJIT_DISABLE_BUILDER
+
 } // asmjit namespace
 
 // [Api-End]
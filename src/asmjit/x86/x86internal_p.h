@@ -11,6 +11,7 @@
 #include "../asmjit_build.h"
 
 // [Dependencies]
+#include "../base/codebuilder.h"
 #include "../base/func.h"
 #include "../x86/x86emitter.h"
 #include "../x86/x86operand.h"
@@ -66,6 +67,24 @@ struct X86Internal {
     const Operand_& src_, uint32_t srcTypeId, bool avxEnabled, const char* comment = nullptr);
 
   static Error allocArgs(X86Emitter* emitter, const FuncFrameLayout& layout, const FuncArgsMapper& args);
+
+  //! Initialize `code` to lay out code of `origin` by a scratch assembler. It
+  //! gets the same code info, hints, sections, and labels (by id).
+  static Error initLayoutCode(CodeHolder& code, const CodeHolder* origin) noexcept;
+
+#if !defined(ASMJIT_DISABLE_BUILDER)
+  //! Mark hot blocks of `cfg` in `isHot`, which are blocks reachable from an
+  //! entry without taking an unlikely edge (see \ref X86HotColdPass). Both
+  //! `isHot` and `stack` must have a room for all blocks, `isHot` zeroed.
+  static void markHotBlocks(const CBCfg* cfg, uint8_t* isHot, CBBlock** stack) noexcept;
+
+  //! Add `jmp label` after `ref` and return the new node in `out`.
+  static Error addJmpAfter(CodeBuilder* cb, CBNode* ref, const Label& label, CBNode** out) noexcept;
+
+  //! Invert the condition of the jump `node` having `cond` and make it jump to
+  //! `target`. Hints are swapped and a forced short form is dropped.
+  static Error invertJcc(CodeBuilder* cb, CBInst* node, uint32_t cond, const Label& target) noexcept;
+#endif // !ASMJIT_DISABLE_BUILDER
 };
 
 //! \}
@@ -0,0 +1,468 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Export]
+#define ASMJIT_EXPORTS
+
+// [Guard]
+#include "../asmjit_build.h"
+#if defined(ASMJIT_BUILD_X86) && !defined(ASMJIT_DISABLE_BUILDER)
+
+// [Dependencies]
+#include "../base/codecfg.h"
+#include "../x86/x86inst.h"
+#include "../x86/x86internal_p.h"
+#include "../x86/x86layoutpass.h"
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+// ============================================================================
+// [asmjit::X86LayoutPass - Helpers]
+// ============================================================================
+
+//! \internal
+enum {
+  kX86LayoutProbScale    = 1024,        //!< Probability of an edge that is always taken.
+  kX86LayoutProbLikely   = 960,         //!< Probability of a hinted edge (15/16).
+  kX86LayoutProbBackEdge = 896,         //!< Probability of a loop back edge (7/8).
+  kX86LayoutMaxLoopDepth = 10           //!< Loop depth used to estimate the frequency.
+};
+
+//! \internal
+//!
+//! Edge considered by the chaining.
+struct X86LayoutEdge {
+  uint64_t weight;                       //!< Weight.
+  uint32_t from;                         //!< Id of the source block.
+  uint32_t to;                           //!< Id of the target block.
+};
+
+//! \internal
+//!
+//! Order edges from the heaviest, edges that fall through in the original
+//! code go first if weights are equal, so the code is not changed without a
+//! reason.
+static bool X86LayoutPass_compareEdges(const X86LayoutEdge& a, const X86LayoutEdge& b) noexcept {
+  if (a.weight != b.weight)
+    return a.weight > b.weight;
+
+  bool aFallsThrough = a.to == a.from + 1;
+  bool bFallsThrough = b.to == b.from + 1;
+  if (aFallsThrough != bFallsThrough)
+    return aFallsThrough;
+
+  return a.from != b.from ? a.from < b.from : a.to < b.to;
+}
+
+//! \internal
+//!
+//! Get whether `block` is in the loop having `header`.
+static ASMJIT_INLINE bool X86LayoutPass_isInLoop(const CBBlock* block, const CBBlock* header) noexcept {
+  for (const CBBlock* h = block->getLoopHeader(); h; h = h->getLoopParent())
+    if (h == header)
+      return true;
+  return false;
+}
+
+//! \internal
+//!
+//! Get the probability of the edge from `block` to its successor at `index`,
+//! in `kX86LayoutProbScale` units.
+static uint32_t X86LayoutPass_getProbability(const CBBlock* block, size_t index, const uint64_t* freq, const uint8_t* hasWeight) noexcept {
+  const ZoneVector<CBBlock*>& succs = block->getSuccessors();
+  if (succs.getLength() != 2 || !block->fallsThrough())
+    return kX86LayoutProbScale / static_cast<uint32_t>(succs.getLength());
+
+  const CBBlock* succ = succs[index];
+  const CBBlock* other = succs[index ^ 1];
+
+  // Weights of both successors are known.
+  if (hasWeight[succ->getId()] && hasWeight[other->getId()]) {
+    uint64_t sum = freq[succ->getId()] + freq[other->getId()];
+    if (!sum) return kX86LayoutProbScale / 2;
+    return static_cast<uint32_t>((freq[succ->getId()] * kX86LayoutProbScale) / sum);
+  }
+
+  // Hints of the conditional jump, the target is at index 1.
+  uint32_t options = block->getLast()->as<CBInst>()->getOptions();
+  if (options & (X86Inst::kOptionTaken | X86Inst::kOptionNotTaken)) {
+    bool isTaken = (options & X86Inst::kOptionTaken) != 0;
+    return (index == 1) == isTaken ? kX86LayoutProbLikely : kX86LayoutProbScale - kX86LayoutProbLikely;
+  }
+
+  // Hints of labels.
+  uint32_t succHints = succ->getLabelFlags();
+  uint32_t otherHints = other->getLabelFlags();
+
+  if ((succHints ^ otherHints) & CBNode::kFlagIsUnlikely)
+    return (succHints & CBNode::kFlagIsUnlikely) ? kX86LayoutProbScale - kX86LayoutProbLikely : kX86LayoutProbLikely;
+  if ((succHints ^ otherHints) & CBNode::kFlagIsLikely)
+    return (succHints & CBNode::kFlagIsLikely) ? kX86LayoutProbLikely : kX86LayoutProbScale - kX86LayoutProbLikely;
+
+  // Loops - going back to the header is likely, leaving the loop is not.
+  bool succIsBack = succ->isLoopHeader() && succ->dominates(block);
+  bool otherIsBack = other->isLoopHeader() && other->dominates(block);
+  if (succIsBack != otherIsBack)
+    return succIsBack ? kX86LayoutProbBackEdge : kX86LayoutProbScale - kX86LayoutProbBackEdge;
+
+  const CBBlock* header = block->getLoopHeader();
+  if (header) {
+    bool succExits = !X86LayoutPass_isInLoop(succ, header);
+    bool otherExits = !X86LayoutPass_isInLoop(other, header);
+    if (succExits != otherExits)
+      return succExits ? kX86LayoutProbScale - kX86LayoutProbBackEdge : kX86LayoutProbBackEdge;
+  }
+
+  return kX86LayoutProbScale / 2;
+}
+
+//! \internal
+//!
+//! Get whether blocks `[start, end)` can be reordered. The function's epilog
+//! must be already emitted and there must be no data or indirect jumps, which
+//! could make unreachable blocks reachable.
+static bool X86LayoutPass_canReorder(const ZoneVector<CBBlock*>& blocks, size_t start, size_t end) noexcept {
+  for (size_t i = start; i < end; i++) {
+    CBBlock* block = blocks[i];
+    if (block->hasUnknownSuccessor())
+      return false;
+
+    if (!block->isReachable())
+      continue;
+
+    for (CBNode* node = block->getFirst(); ; node = node->getNext()) {
+      switch (node->getType()) {
+        case CBNode::kNodeData:
+        case CBNode::kNodeLabelData:
+        case CBNode::kNodeConstPool:
+        case CBNode::kNodeSentinel:
+          return false;
+
+        case CBNode::kNodeFuncExit:
+          if (!node->isTranslated())
+            return false;
+          break;
+
+        default:
+          break;
+      }
+
+      if (node == block->getLast())
+        break;
+    }
+  }
+
+  return true;
+}
+
+// ============================================================================
+// [asmjit::X86LayoutPass - Construction / Destruction]
+// ============================================================================
+
+X86LayoutPass::X86LayoutPass() noexcept
+  : CBPass("X86LayoutPass"),
+    _blockWeights(),
+    _edgeWeights(),
+    _loopAlignment(16),
+    _movedCount(0),
+    _removedCount(0),
+    _addedCount(0),
+    _invertedCount(0),
+    _alignedCount(0) {}
+X86LayoutPass::~X86LayoutPass() noexcept {}
+
+// ============================================================================
+// [asmjit::X86LayoutPass - Weights]
+// ============================================================================
+
+Error X86LayoutPass::setBlockWeight(const Label& label, uint32_t weight) noexcept {
+  if (ASMJIT_UNLIKELY(!_cb))
+    return DebugUtils::errored(kErrorInvalidState);
+
+  for (size_t i = 0; i < _blockWeights.getLength(); i++) {
+    if (_blockWeights[i].labelId == label.getId()) {
+      _blockWeights[i].weight = weight;
+      return kErrorOk;
+    }
+  }
+
+  BlockWeight item;
+  item.labelId = label.getId();
+  item.weight = weight;
+  return _blockWeights.append(&_cb->_cbHeap, item);
+}
+
+Error X86LayoutPass::setEdgeWeight(const Label& from, const Label& to, uint32_t weight) noexcept {
+  if (ASMJIT_UNLIKELY(!_cb))
+    return DebugUtils::errored(kErrorInvalidState);
+
+  for (size_t i = 0; i < _edgeWeights.getLength(); i++) {
+    if (_edgeWeights[i].fromId == from.getId() && _edgeWeights[i].toId == to.getId()) {
+      _edgeWeights[i].weight = weight;
+      return kErrorOk;
+    }
+  }
+
+  EdgeWeight item;
+  item.fromId = from.getId();
+  item.toId = to.getId();
+  item.weight = weight;
+  return _edgeWeights.append(&_cb->_cbHeap, item);
+}
+
+// ============================================================================
+// [asmjit::X86LayoutPass - Interface]
+// ============================================================================
+
+Error X86LayoutPass::process(Zone* zone) noexcept {
+  _movedCount = 0;
+  _removedCount = 0;
+  _addedCount = 0;
+  _invertedCount = 0;
+  _alignedCount = 0;
+
+  CodeBuilder* cb = _cb;
+  CBCfg* cfg;
+  ASMJIT_PROPAGATE(cb->getCfg(&cfg));
+
+  // Blocks are used after the CFG is invalidated by the first change, which
+  // is fine as it's not rebuilt until the next `getCfg()`.
+  const ZoneVector<CBBlock*>& blocks = cfg->getBlocks();
+  size_t numBlocks = blocks.getLength();
+  if (!numBlocks) return kErrorOk;
+
+  size_t i, j;
+  size_t numEdges = 0;
+
+  for (i = 0; i < numBlocks; i++)
+    numEdges += blocks[i]->getSuccessors().getLength();
+
+  // `Zone` doesn't align allocations, so arrays of larger types go first.
+  uint64_t* freq = zone->allocT<uint64_t>(numBlocks * sizeof(uint64_t));
+  X86LayoutEdge* edges = zone->allocT<X86LayoutEdge>((numEdges + 1) * sizeof(X86LayoutEdge));
+  uint32_t* chainHead = zone->allocT<uint32_t>(numBlocks * sizeof(uint32_t));
+  uint32_t* chainTail = zone->allocT<uint32_t>(numBlocks * sizeof(uint32_t));
+  uint32_t* chainNext = zone->allocT<uint32_t>(numBlocks * sizeof(uint32_t));
+  uint32_t* order = zone->allocT<uint32_t>(numBlocks * sizeof(uint32_t));
+  uint8_t* hasWeight = zone->allocZeroedT<uint8_t>(numBlocks);
+  uint8_t* isAligned = zone->allocZeroedT<uint8_t>(numBlocks);
+
+  if (ASMJIT_UNLIKELY(!freq || !hasWeight || !isAligned || !chainHead || !chainTail || !chainNext || !order || !edges))
+    return DebugUtils::errored(kErrorNoHeapMemory);
+
+  // --------------------------------------------------------------------------
+  // [Frequencies]
+  // --------------------------------------------------------------------------
+
+  for (i = 0; i < numBlocks; i++) {
+    uint32_t depth = blocks[i]->getLoopDepth();
+    if (depth > kX86LayoutMaxLoopDepth) depth = kX86LayoutMaxLoopDepth;
+    freq[i] = static_cast<uint64_t>(1) << (depth * 3);
+  }
+
+  for (i = 0; i < _blockWeights.getLength(); i++) {
+    CBBlock* block = cfg->getBlockByLabel(_blockWeights[i].labelId);
+    if (!block) continue;
+
+    freq[block->getId()] = _blockWeights[i].weight;
+    hasWeight[block->getId()] = 1;
+  }
+
+  // --------------------------------------------------------------------------
+  // [Layout]
+  // --------------------------------------------------------------------------
+
+  // Each function (or the whole code if there is no function) is processed
+  // separately, its entry block always stays first.
+  size_t start = 0;
+  while (start < numBlocks) {
+    size_t end = start + 1;
+    while (end < numBlocks && !blocks[end]->isEntry())
+      end++;
+
+    if (!X86LayoutPass_canReorder(blocks, start, end)) {
+      start = end;
+      continue;
+    }
+
+    // Edges between reachable blocks.
+    numEdges = 0;
+    for (i = start; i < end; i++) {
+      CBBlock* block = blocks[i];
+      chainHead[i] = static_cast<uint32_t>(i);
+      chainTail[i] = static_cast<uint32_t>(i);
+      chainNext[i] = kInvalidValue;
+
+      if (!block->isReachable())
+        continue;
+
+      const ZoneVector<CBBlock*>& succs = block->getSuccessors();
+      for (j = 0; j < succs.getLength(); j++) {
+        CBBlock* succ = succs[j];
+        size_t succId = succ->getId();
+        if (succId <= start || succId >= end || succ == block)
+          continue;
+
+        X86LayoutEdge& edge = edges[numEdges++];
+        edge.from = static_cast<uint32_t>(i);
+        edge.to = static_cast<uint32_t>(succId);
+        edge.weight = freq[i] * X86LayoutPass_getProbability(block, j, freq, hasWeight);
+
+        for (size_t k = 0; k < _edgeWeights.getLength(); k++) {
+          const EdgeWeight& ew = _edgeWeights[k];
+          if (cfg->getBlockByLabel(ew.fromId) == block && cfg->getBlockByLabel(ew.toId) == succ) {
+            edge.weight = static_cast<uint64_t>(ew.weight) * kX86LayoutProbScale;
+            break;
+          }
+        }
+      }
+    }
+
+    // Chain blocks, from the heaviest edge.
+    std::sort(edges, edges + numEdges, X86LayoutPass_compareEdges);
+
+    for (i = 0; i < numEdges; i++) {
+      uint32_t from = edges[i].from;
+      uint32_t to = edges[i].to;
+      uint32_t head = chainHead[from];
+
+      if (chainTail[head] != from || chainHead[to] != to || head == to)
+        continue;
+
+      chainNext[from] = to;
+      chainTail[head] = chainTail[to];
+      for (uint32_t id = to; id != kInvalidValue; id = chainNext[id])
+        chainHead[id] = head;
+    }
+
+    // Order chains, the entry first, then from the heaviest. Weights of chains
+    // are stored in `edges`, which are not needed anymore.
+    size_t numChains = 0;
+    for (i = start + 1; i < end; i++) {
+      if (!blocks[i]->isReachable() || chainHead[i] != i)
+        continue;
+
+      uint64_t weight = 0;
+      for (uint32_t id = static_cast<uint32_t>(i); id != kInvalidValue; id = chainNext[id])
+        weight += freq[id];
+
+      X86LayoutEdge& chain = edges[numChains++];
+      chain.weight = weight;
+      chain.from = static_cast<uint32_t>(i);
+      chain.to = static_cast<uint32_t>(i);
+    }
+    std::sort(edges, edges + numChains, X86LayoutPass_compareEdges);
+
+    size_t numOrder = 0;
+    for (uint32_t id = static_cast<uint32_t>(start); id != kInvalidValue; id = chainNext[id])
+      order[numOrder++] = id;
+
+    for (i = 0; i < numChains; i++)
+      for (uint32_t id = edges[i].from; id != kInvalidValue; id = chainNext[id])
+        order[numOrder++] = id;
+
+    for (i = start + 1; i < end; i++)
+      if (!blocks[i]->isReachable())
+        order[numOrder++] = static_cast<uint32_t>(i);
+
+    ASMJIT_ASSERT(numOrder == end - start);
+
+    // Fix jumps of blocks that don't continue to the same block anymore.
+    for (i = 0; i < numOrder; i++) {
+      CBBlock* block = blocks[order[i]];
+      CBBlock* next = i + 1 < numOrder ? blocks[order[i + 1]] : end < numBlocks ? blocks[end] : static_cast<CBBlock*>(nullptr);
+
+      const ZoneVector<CBBlock*>& succs = block->getSuccessors();
+      CBNode* last = block->getLast();
+
+      if (block->fallsThrough()) {
+        if (!succs.getLength() || succs[0] == next)
+          continue;
+
+        // Unreachable data don't need a jump.
+        if (!block->isReachable() && last->getType() != CBNode::kNodeInst)
+          continue;
+
+        Label label;
+        ASMJIT_PROPAGATE(cb->getBlockLabel(succs[0], label));
+
+        if (succs.getLength() == 2 && succs[1] == next) {
+          CBInst* jcc = last->as<CBInst>();
+          uint32_t cond = X86Inst::jccToCond(jcc->getInstId());
+
+          if (cond != x86::kCondCount) {
+            ASMJIT_PROPAGATE(X86Internal::invertJcc(cb, jcc, cond, label));
+            _invertedCount++;
+            continue;
+          }
+        }
+
+        ASMJIT_PROPAGATE(X86Internal::addJmpAfter(cb, last, label, &block->_last));
+        _addedCount++;
+      }
+      else if (succs.getLength() == 1 && succs[0] == next && last != block->getFirst() &&
+               last->getType() == CBNode::kNodeInst &&
+               last->as<CBInst>()->getInstId() == X86Inst::kIdJmp) {
+        block->_last = last->getPrev();
+        cb->removeNode(last);
+        _removedCount++;
+      }
+    }
+
+    // Move blocks to their new positions.
+    CBNode* anchor = blocks[start]->getLast();
+    for (i = 1; i < numOrder; i++) {
+      CBBlock* block = blocks[order[i]];
+      if (anchor->getNext() != block->getFirst()) {
+        cb->moveNodes(block->getFirst(), block->getLast(), anchor);
+        _movedCount++;
+      }
+      anchor = block->getLast();
+    }
+
+    // Align the first block of each loop, enclosing loops that start by the
+    // same block are aligned by it as well.
+    if (_loopAlignment) {
+      for (i = 1; i < numOrder; i++) {
+        CBBlock* block = blocks[order[i]];
+        CBBlock* header = block->getLoopHeader();
+
+        if (!block->isReachable() || !header || isAligned[header->getId()])
+          continue;
+
+        for (CBBlock* h = header; h; h = h->getLoopParent())
+          isAligned[h->getId()] = 1;
+
+        CBNode* first = block->getFirst();
+        if (first->getType() == CBNode::kNodeAlign || (first->getPrev() && first->getPrev()->getType() == CBNode::kNodeAlign))
+          continue;
+
+        CBAlign* align = cb->newAlignNode(kAlignCode, _loopAlignment);
+        if (ASMJIT_UNLIKELY(!align))
+          return DebugUtils::errored(kErrorNoHeapMemory);
+
+        cb->addBefore(align, first);
+        block->_first = align;
+        _alignedCount++;
+      }
+    }
+
+    start = end;
+  }
+
+  return kErrorOk;
+}
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
+
+// [Guard]
+#endif // ASMJIT_BUILD_X86 && !ASMJIT_DISABLE_BUILDER
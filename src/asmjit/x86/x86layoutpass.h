@@ -0,0 +1,163 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Guard]
+#ifndef _ASMJIT_X86_X86LAYOUTPASS_H
+#define _ASMJIT_X86_X86LAYOUTPASS_H
+
+#include "../asmjit_build.h"
+#if !defined(ASMJIT_DISABLE_BUILDER)
+
+// [Dependencies]
+#include "../base/codebuilder.h"
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+//! \addtogroup asmjit_x86
+//! \{
+
+// ============================================================================
+// [asmjit::X86LayoutPass]
+// ============================================================================
+
+//! Basic block layout pass.
+//!
+//! Reorders blocks of each function so the most frequent successor of a block
+//! is placed right after it and reached by falling through, a variant of the
+//! Pettis-Hansen algorithm:
+//!
+//!   1. Each edge gets a weight, which is either set by `setEdgeWeight()` or
+//!      estimated as the frequency of its source block multiplied by the
+//!      probability of the edge.
+//!   2. Edges are visited from the heaviest and blocks are chained greedily,
+//!      an edge joins two chains if it connects the tail of the first with the
+//!      head of the other.
+//!   3. The chain that starts with the function entry is placed first and the
+//!      remaining chains follow from the heaviest, unreachable code is placed
+//!      at the end.
+//!
+//! Block frequencies are set by `setBlockWeight()`, blocks without a weight
+//! get `8^n`, where `n` is their loop depth. Probabilities are derived from
+//! weights of both successors (if set), `taken()` and `notTaken()` hints,
+//! \ref CodeBuilder::setLabelLikely() and \ref CodeBuilder::setLabelUnlikely()
+//! hints, and loops (jumping back to a loop header is likely, leaving a loop
+//! is unlikely). Blocks are referenced by labels bound at their beginning.
+//!
+//! Jumps are inverted, added, or removed to keep the original control flow,
+//! and the first block of each loop is aligned by \ref CBAlign (see
+//! `setLoopAlignment()`). Set it to zero and add \ref X86LoopAlignPass after
+//! this pass to align only innermost and hot loops within a padding budget.
+//!
+//! The pass relies on the function's epilog, so add it to \ref X86Compiler
+//! after it's attached (after \ref X86RAPass) and before \ref X86RelaxPass,
+//! it runs before the code is serialized:
+//!
+//! ~~~
+//! X86Compiler cc(&code);
+//! X86LayoutPass* layout = cc.newPassT<X86LayoutPass>();
+//! cc.addPass(layout);
+//! cc.addPassT<X86RelaxPass>();
+//!
+//! // ... Generate the code ...
+//! layout->setEdgeWeight(L_Dispatch, L_OpAdd, 1000);
+//! layout->setEdgeWeight(L_Dispatch, L_OpMul, 10);
+//!
+//! cc.finalize();
+//! ~~~
+class ASMJIT_VIRTAPI X86LayoutPass : public CBPass {
+public:
+  ASMJIT_NONCOPYABLE(X86LayoutPass)
+
+  //! Block weight set by `setBlockWeight()`.
+  struct BlockWeight {
+    uint32_t labelId;                    //!< Label of the block.
+    uint32_t weight;                     //!< Weight.
+  };
+
+  //! Edge weight set by `setEdgeWeight()`.
+  struct EdgeWeight {
+    uint32_t fromId;                     //!< Label of the source block.
+    uint32_t toId;                       //!< Label of the target block.
+    uint32_t weight;                     //!< Weight.
+  };
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  ASMJIT_API X86LayoutPass() noexcept;
+  ASMJIT_API virtual ~X86LayoutPass() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Interface]
+  // --------------------------------------------------------------------------
+
+  ASMJIT_API virtual Error process(Zone* zone) noexcept override;
+
+  // --------------------------------------------------------------------------
+  // [Weights]
+  // --------------------------------------------------------------------------
+
+  //! Set how many times the block at `label` is executed, relative to other
+  //! blocks. The pass must be added to \ref CodeBuilder first.
+  ASMJIT_API Error setBlockWeight(const Label& label, uint32_t weight) noexcept;
+  //! Set how many times the control goes from the block at `from` to the
+  //! block at `to`. The pass must be added to \ref CodeBuilder first.
+  ASMJIT_API Error setEdgeWeight(const Label& from, const Label& to, uint32_t weight) noexcept;
+  //! Remove all weights.
+  ASMJIT_INLINE void resetWeights() noexcept {
+    _blockWeights.clear();
+    _edgeWeights.clear();
+  }
+
+  // --------------------------------------------------------------------------
+  // [Accessors]
+  // --------------------------------------------------------------------------
+
+  //! Get the alignment of loops, zero if loops are not aligned.
+  ASMJIT_INLINE uint32_t getLoopAlignment() const noexcept { return _loopAlignment; }
+  //! Set the alignment of loops, zero disables it (16 by default).
+  ASMJIT_INLINE void setLoopAlignment(uint32_t alignment) noexcept { _loopAlignment = alignment; }
+
+  //! Get the count of blocks moved by the last `process()`.
+  ASMJIT_INLINE size_t getMovedCount() const noexcept { return _movedCount; }
+  //! Get the count of jumps removed by the last `process()`.
+  ASMJIT_INLINE size_t getRemovedCount() const noexcept { return _removedCount; }
+  //! Get the count of jumps added by the last `process()`.
+  ASMJIT_INLINE size_t getAddedCount() const noexcept { return _addedCount; }
+  //! Get the count of conditional jumps inverted by the last `process()`.
+  ASMJIT_INLINE size_t getInvertedCount() const noexcept { return _invertedCount; }
+  //! Get the count of loops aligned by the last `process()`.
+  ASMJIT_INLINE size_t getAlignedCount() const noexcept { return _alignedCount; }
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  ZoneVector<BlockWeight> _blockWeights; //!< Block weights.
+  ZoneVector<EdgeWeight> _edgeWeights;   //!< Edge weights.
+  uint32_t _loopAlignment;               //!< Alignment of loops.
+
+  size_t _movedCount;                    //!< Count of blocks moved.
+  size_t _removedCount;                  //!< Count of jumps removed.
+  size_t _addedCount;                    //!< Count of jumps added.
+  size_t _invertedCount;                 //!< Count of conditional jumps inverted.
+  size_t _alignedCount;                  //!< Count of loops aligned.
+};
+
+//! \}
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
+
+// [Guard]
+#endif // !ASMJIT_DISABLE_BUILDER
+#endif // _ASMJIT_X86_X86LAYOUTPASS_H
@@ -0,0 +1,196 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Export]
+#define ASMJIT_EXPORTS
+
+// [Guard]
+#include "../asmjit_build.h"
+#if defined(ASMJIT_BUILD_X86) && !defined(ASMJIT_DISABLE_BUILDER)
+
+// [Dependencies]
+#include "../base/codecfg.h"
+#include "../base/utils.h"
+#include "../x86/x86assembler.h"
+#include "../x86/x86internal_p.h"
+#include "../x86/x86loopalignpass.h"
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+// ============================================================================
+// [asmjit::X86LoopAlignPass - Helpers]
+// ============================================================================
+
+//! \internal
+//!
+//! Get whether `node` is already aligned by a preceding \ref CBAlign.
+static ASMJIT_INLINE bool X86LoopAlignPass_isAligned(CBNode* node) noexcept {
+  while (node->getType() == CBNode::kNodeLabel || node->getType() == CBNode::kNodeComment) {
+    node = node->getPrev();
+    if (!node) return false;
+  }
+  return node->getType() == CBNode::kNodeAlign;
+}
+
+//! \internal
+//!
+//! Clear marks of loops from `node` to the end, used on failure.
+static ASMJIT_INLINE void X86LoopAlignPass_resetMarks(CBNode* node) noexcept {
+  while (node) {
+    node->resetPassData();
+    node = node->getNext();
+  }
+}
+
+// ============================================================================
+// [asmjit::X86LoopAlignPass - Construction / Destruction]
+// ============================================================================
+
+X86LoopAlignPass::X86LoopAlignPass() noexcept
+  : CBPass("X86LoopAlignPass"),
+    _alignment(16),
+    _maxSkip(10),
+    _budget(32),
+    _alignedCount(0),
+    _skippedCount(0),
+    _paddingSize(0) {}
+X86LoopAlignPass::~X86LoopAlignPass() noexcept {}
+
+// ============================================================================
+// [asmjit::X86LoopAlignPass - Interface]
+// ============================================================================
+
+Error X86LoopAlignPass::process(Zone* zone) noexcept {
+  _alignedCount = 0;
+  _skippedCount = 0;
+  _paddingSize = 0;
+
+  if (_alignment <= 1)
+    return kErrorOk;
+
+  if (!Utils::isPowerOf2(_alignment) || _alignment > Globals::kMaxAlignment)
+    return DebugUtils::errored(kErrorInvalidArgument);
+
+  CodeBuilder* cb = _cb;
+  CBCfg* cfg;
+  ASMJIT_PROPAGATE(cb->getCfg(&cfg));
+
+  const ZoneVector<CBBlock*>& blocks = cfg->getBlocks();
+  size_t numBlocks = blocks.getLength();
+  if (!numBlocks) return kErrorOk;
+
+  // `Zone` doesn't align allocations, so the array of pointers goes first.
+  CBBlock** stack = zone->allocT<CBBlock*>(numBlocks * sizeof(CBBlock*));
+  uint8_t* isHot = zone->allocZeroedT<uint8_t>(numBlocks);
+  uint8_t* isDone = zone->allocZeroedT<uint8_t>(numBlocks);
+  if (ASMJIT_UNLIKELY(!isHot || !isDone || !stack))
+    return DebugUtils::errored(kErrorNoHeapMemory);
+
+  // --------------------------------------------------------------------------
+  // [Loops]
+  // --------------------------------------------------------------------------
+
+  // Data of previous passes is no longer valid.
+  for (CBNode* node = cb->getFirstNode(); node; node = node->getNext())
+    node->resetPassData();
+
+  X86Internal::markHotBlocks(cfg, isHot, stack);
+
+  // Loops that enclose other loops are not innermost.
+  size_t i;
+  for (i = 0; i < numBlocks; i++) {
+    CBBlock* parent = blocks[i]->isLoopHeader() ? blocks[i]->getLoopParent() : static_cast<CBBlock*>(nullptr);
+    if (parent) isDone[parent->getId()] = 1;
+  }
+
+  // Mark the first block of each candidate loop in code order, which is not
+  // always its header.
+  size_t numLoops = 0;
+  for (i = 0; i < numBlocks; i++) {
+    CBBlock* block = blocks[i];
+    CBBlock* header = block->getLoopHeader();
+
+    if (!block->isReachable() || !header || isDone[header->getId()])
+      continue;
+    isDone[header->getId()] = 1;
+
+    if (!isHot[header->getId()] || X86LoopAlignPass_isAligned(block->getFirst()))
+      continue;
+
+    block->getFirst()->setPassData<CBBlock>(block);
+    numLoops++;
+  }
+
+  if (!numLoops)
+    return kErrorOk;
+
+  // --------------------------------------------------------------------------
+  // [Align]
+  // --------------------------------------------------------------------------
+
+  // The code is laid out to know the padding of each loop, aligned loops are
+  // laid out as well so the padding of loops that follow is exact.
+  CodeHolder code;
+  Error err = X86Internal::initLayoutCode(code, cb->getCode());
+  if (ASMJIT_UNLIKELY(err)) {
+    X86LoopAlignPass_resetMarks(cb->getFirstNode());
+    return err;
+  }
+
+  X86Assembler a(&code);
+  uint32_t used = 0;
+
+  for (CBNode* node = cb->getFirstNode(); node; node = node->getNext()) {
+    if (node->getType() == CBNode::kNodeFunc)
+      used = 0;
+
+    if (node->hasPassData()) {
+      node->resetPassData();
+
+      uint32_t padding = static_cast<uint32_t>(Utils::alignDiff<size_t>(a.getOffset(), _alignment));
+      if (padding > _maxSkip || used + padding > _budget) {
+        _skippedCount++;
+      }
+      else {
+        CBAlign* align = cb->newAlignNode(kAlignCode, _alignment, _maxSkip);
+        if (ASMJIT_UNLIKELY(!align)) {
+          X86LoopAlignPass_resetMarks(node);
+          return DebugUtils::errored(kErrorNoHeapMemory);
+        }
+
+        cb->addBefore(align, node);
+        err = cb->serializeNode(&a, align);
+        if (ASMJIT_UNLIKELY(err)) {
+          X86LoopAlignPass_resetMarks(node);
+          return err;
+        }
+
+        used += padding;
+        _paddingSize += padding;
+        _alignedCount++;
+      }
+    }
+
+    err = cb->serializeNode(&a, node);
+    if (ASMJIT_UNLIKELY(err)) {
+      X86LoopAlignPass_resetMarks(node);
+      return err;
+    }
+  }
+
+  return kErrorOk;
+}
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
+
+// [Guard]
+#endif // ASMJIT_BUILD_X86 && !ASMJIT_DISABLE_BUILDER
@@ -0,0 +1,130 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Guard]
+#ifndef _ASMJIT_X86_X86LOOPALIGNPASS_H
+#define _ASMJIT_X86_X86LOOPALIGNPASS_H
+
+#include "../asmjit_build.h"
+#if !defined(ASMJIT_DISABLE_BUILDER)
+
+// [Dependencies]
+#include "../base/codebuilder.h"
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+//! \addtogroup asmjit_x86
+//! \{
+
+// ============================================================================
+// [asmjit::X86LoopAlignPass]
+// ============================================================================
+
+//! Loop alignment pass.
+//!
+//! Finds natural loops by \ref CBCfg and aligns the first block of each loop
+//! that is innermost and hot by \ref CBAlign, like `-falign-loops=N:M` of GCC:
+//!
+//!   - `setAlignment()` - The alignment `N` (16 by default).
+//!   - `setMaxSkip()` - The maximum padding `M`, loops that need more are not
+//!     aligned (10 by default). It's also set to each \ref CBAlign, so it's
+//!     respected if the code is changed by a later pass.
+//!   - `setBudget()` - The maximum padding of all loops of a function (32 by
+//!     default). Loops are aligned in code order until it's used.
+//!
+//! Loops reached only through unlikely edges (see \ref X86HotColdPass) are
+//! cold and not aligned. Loops that are already aligned are kept as is.
+//!
+//! Alignment matters mostly to decoders that fetch 16 bytes per cycle. Cores
+//! that run hot loops from a micro-op cache or a loop buffer are barely
+//! affected - `asmjit_bench_align` measures differences within noise for both
+//! 16:10 and 16:15 on such a core. The defaults therefore keep the padding
+//! small instead of aligning every loop.
+//!
+//! The padding is computed by laying out the code by a scratch \ref
+//! X86Assembler, so the pass must run after \ref X86RAPass and after passes
+//! that move code. Add it to \ref X86Compiler after it's attached and before
+//! \ref X86RelaxPass. Relaxation shrinks jumps and moves loops, so the budget
+//! is approximate - the final padding of each loop is still limited to the
+//! maximum padding, but the total may exceed the budget, and \ref
+//! getPaddingSize() reports the padding before relaxation:
+//!
+//! ~~~
+//! X86Compiler cc(&code);
+//! cc.addPassT<X86LoopAlignPass>();
+//! cc.addPassT<X86RelaxPass>();
+//! ~~~
+class ASMJIT_VIRTAPI X86LoopAlignPass : public CBPass {
+public:
+  ASMJIT_NONCOPYABLE(X86LoopAlignPass)
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  ASMJIT_API X86LoopAlignPass() noexcept;
+  ASMJIT_API virtual ~X86LoopAlignPass() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Interface]
+  // --------------------------------------------------------------------------
+
+  ASMJIT_API virtual Error process(Zone* zone) noexcept override;
+
+  // --------------------------------------------------------------------------
+  // [Accessors]
+  // --------------------------------------------------------------------------
+
+  //! Get the alignment of loops.
+  ASMJIT_INLINE uint32_t getAlignment() const noexcept { return _alignment; }
+  //! Set the alignment of loops, must be a power of 2 (1 disables the pass).
+  ASMJIT_INLINE void setAlignment(uint32_t alignment) noexcept { _alignment = alignment; }
+
+  //! Get the maximum padding of a loop.
+  ASMJIT_INLINE uint32_t getMaxSkip() const noexcept { return _maxSkip; }
+  //! Set the maximum padding of a loop.
+  ASMJIT_INLINE void setMaxSkip(uint32_t maxSkip) noexcept { _maxSkip = maxSkip; }
+
+  //! Get the maximum padding of all loops of a function.
+  ASMJIT_INLINE uint32_t getBudget() const noexcept { return _budget; }
+  //! Set the maximum padding of all loops of a function.
+  ASMJIT_INLINE void setBudget(uint32_t budget) noexcept { _budget = budget; }
+
+  //! Get the count of loops aligned by the last `process()`.
+  ASMJIT_INLINE size_t getAlignedCount() const noexcept { return _alignedCount; }
+  //! Get the count of loops not aligned because of the maximum padding or
+  //! the budget by the last `process()`.
+  ASMJIT_INLINE size_t getSkippedCount() const noexcept { return _skippedCount; }
+  //! Get the padding added by the last `process()`, in bytes, as laid out
+  //! before \ref X86RelaxPass.
+  ASMJIT_INLINE size_t getPaddingSize() const noexcept { return _paddingSize; }
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  uint32_t _alignment;                   //!< Alignment of loops.
+  uint32_t _maxSkip;                     //!< Maximum padding of a loop.
+  uint32_t _budget;                      //!< Maximum padding of a function.
+
+  size_t _alignedCount;                  //!< Count of loops aligned.
+  size_t _skippedCount;                  //!< Count of loops not aligned.
+  size_t _paddingSize;                   //!< Padding added (in bytes).
+};
+
+//! \}
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
+
+// [Guard]
+#endif // !ASMJIT_DISABLE_BUILDER
+#endif // _ASMJIT_X86_X86LOOPALIGNPASS_H
@@ -0,0 +1,345 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Export]
+#define ASMJIT_EXPORTS
+
+// [Guard]
+#include "../asmjit_build.h"
+#if defined(ASMJIT_BUILD_X86) && !defined(ASMJIT_DISABLE_BUILDER)
+
+// [Dependencies]
+#include "../base/utils.h"
+#include "../x86/x86inst.h"
+#include "../x86/x86operand.h"
+#include "../x86/x86peepholepass.h"
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+// ============================================================================
+// [asmjit::X86PeepholePass - Helpers]
+// ============================================================================
+
+//! \internal
+enum {
+  //! Status flags (CF, PF, AF, ZF, SF, and OF).
+  kX86PeepholeStatusFlags = x86::kSpecialReg_FLAGS_CF | x86::kSpecialReg_FLAGS_PF |
+                            x86::kSpecialReg_FLAGS_AF | x86::kSpecialReg_FLAGS_ZF |
+                            x86::kSpecialReg_FLAGS_SF | x86::kSpecialReg_FLAGS_OF,
+
+  //! Options of instructions that are never changed.
+  kX86PeepholeUnsafeOptions = X86Inst::kOptionLock | X86Inst::kOptionRep | X86Inst::kOptionRepnz |
+                              X86Inst::kOptionXAcquire | X86Inst::kOptionXRelease,
+
+  //! Count of nodes followed to check whether flags are dead.
+  kX86PeepholeMaxSteps = 32
+};
+
+//! \internal
+//!
+//! Get whether `node` is an instruction that can be changed by the pass.
+static ASMJIT_INLINE bool X86PeepholePass_isCandidate(CBNode* node_) noexcept {
+  if (node_->getType() != CBNode::kNodeInst)
+    return false;
+
+  CBInst* node = node_->as<CBInst>();
+  return (node->getOptions() & kX86PeepholeUnsafeOptions) == 0 && !node->hasExtraReg() && !node->hasHole();
+}
+
+//! \internal
+//!
+//! Get whether the instruction `node` overwrites the flags it's documented
+//! to write. Shifts and rotates don't change flags if the count is zero.
+static ASMJIT_INLINE bool X86PeepholePass_writesFlags(CBInst* node) noexcept {
+  switch (node->getInstId()) {
+    case X86Inst::kIdRcl: case X86Inst::kIdRcr:
+    case X86Inst::kIdRol: case X86Inst::kIdRor:
+    case X86Inst::kIdSal: case X86Inst::kIdSar:
+    case X86Inst::kIdShl: case X86Inst::kIdShr:
+    case X86Inst::kIdShld: case X86Inst::kIdShrd: {
+      const Operand& count = node->getOpArray()[node->getOpCount() - 1];
+      return count.isImm() && (count.as<Imm>().getUInt32() & 0x1F) != 0;
+    }
+
+    default:
+      return true;
+  }
+}
+
+//! \internal
+//!
+//! Get whether `flags` are overwritten (or the code returns) after `node`
+//! before any of them is read on all paths. Returns false if it can't be
+//! decided within `budget` nodes.
+static bool X86PeepholePass_areFlagsDead(CodeBuilder* cb, CBNode* node, uint32_t flags, uint32_t& budget) noexcept {
+  for (;;) {
+    node = node->getNext();
+    if (!node) return true;
+    if (budget == 0) return false;
+    budget--;
+
+    switch (node->getType()) {
+      case CBNode::kNodeInst: {
+        CBInst* inst = node->as<CBInst>();
+        uint32_t instId = inst->getInstId();
+
+        // Flags are not preserved across calls and returns.
+        if (instId == X86Inst::kIdRet || instId == X86Inst::kIdCall)
+          return true;
+
+        const X86Inst::OperationData& od = X86Inst::getInst(instId).getOperationData();
+        if (od.getSpecialRegsR() & flags)
+          return false;
+
+        if (X86PeepholePass_writesFlags(inst)) {
+          flags &= ~od.getSpecialRegsW();
+          if (!flags) return true;
+        }
+
+        // `CodeBuilder` emits jumps as `CBInst`, so they are not always `CBJump`.
+        uint32_t jumpType = Inst::getJumpType(cb->getArchType(), instId);
+        if (jumpType == Inst::kJumpTypeDirect || jumpType == Inst::kJumpTypeConditional) {
+          CBLabel* target;
+          if (!inst->getOpCount() || !inst->getOpArray()[0].isLabel() ||
+              cb->getCBLabel(&target, inst->getOpArray()[0].getId()) != kErrorOk)
+            return false;
+
+          // A conditional jump continues on both paths.
+          if (jumpType == Inst::kJumpTypeConditional && !X86PeepholePass_areFlagsDead(cb, target, flags, budget))
+            return false;
+
+          if (jumpType == Inst::kJumpTypeDirect)
+            node = target;
+        }
+        break;
+      }
+
+      case CBNode::kNodeFuncCall:
+      case CBNode::kNodeSentinel:
+        return true;
+
+      case CBNode::kNodeLabel:
+      case CBNode::kNodeFunc:
+      case CBNode::kNodeAlign:
+      case CBNode::kNodeComment:
+      case CBNode::kNodeHint:
+      case CBNode::kNodeFuncExit:
+        break;
+
+      default:
+        return false;
+    }
+  }
+}
+
+//! \internal
+static ASMJIT_INLINE bool X86PeepholePass_areFlagsDead(CodeBuilder* cb, CBNode* node, uint32_t flags) noexcept {
+  uint32_t budget = kX86PeepholeMaxSteps;
+  return X86PeepholePass_areFlagsDead(cb, node, flags, budget);
+}
+
+//! \internal
+//!
+//! Get the next instruction after `node` if there is nothing in between that
+//! could be reached from elsewhere (a label) or emits code.
+static ASMJIT_INLINE CBInst* X86PeepholePass_nextInst(CBNode* node) noexcept {
+  for (;;) {
+    node = node->getNext();
+    if (!node) return nullptr;
+
+    if (node->getType() == CBNode::kNodeInst)
+      return X86PeepholePass_isCandidate(node) ? node->as<CBInst>() : nullptr;
+
+    if (node->getType() != CBNode::kNodeComment && node->getType() != CBNode::kNodeHint)
+      return nullptr;
+  }
+}
+
+//! \internal
+//!
+//! Get whether `op` is a physical register that `mov r, r` doesn't change.
+static ASMJIT_INLINE bool X86PeepholePass_isNopMoveReg(const Operand& op, bool is64Bit) noexcept {
+  if (!op.isPhysReg()) return false;
+
+  const X86Reg& reg = op.as<X86Reg>();
+  if (reg.isGpd()) return !is64Bit;
+  return reg.isGpbLo() || reg.isGpbHi() || reg.isGpw() || reg.isGpq() || reg.isXmm();
+}
+
+// ============================================================================
+// [asmjit::X86PeepholePass - Construction / Destruction]
+// ============================================================================
+
+X86PeepholePass::X86PeepholePass() noexcept
+  : CBPass("X86PeepholePass"),
+    _removedCount(0),
+    _rewrittenCount(0) {}
+X86PeepholePass::~X86PeepholePass() noexcept {}
+
+// ============================================================================
+// [asmjit::X86PeepholePass - Interface]
+// ============================================================================
+
+Error X86PeepholePass::process(Zone* zone) noexcept {
+  ASMJIT_UNUSED(zone);
+
+  _removedCount = 0;
+  _rewrittenCount = 0;
+
+  CodeBuilder* cb = _cb;
+  bool is64Bit = cb->is64Bit();
+
+  CBNode* next;
+  for (CBNode* node_ = cb->getFirstNode(); node_; node_ = next) {
+    next = node_->getNext();
+    if (!X86PeepholePass_isCandidate(node_))
+      continue;
+
+    CBInst* node = node_->as<CBInst>();
+    uint32_t instId = node->getInstId();
+    uint32_t opCount = node->getOpCount();
+    Operand* opArray = node->getOpArray();
+
+    if (opCount != 2)
+      continue;
+
+    switch (instId) {
+      case X86Inst::kIdMov: {
+        // mov r, r -> (removed)
+        if (X86PeepholePass_isNopMoveReg(opArray[0], is64Bit) && opArray[0].as<Reg>().isSame(opArray[1].as<Reg>())) {
+          cb->removeNode(node);
+          _removedCount++;
+          break;
+        }
+
+        // mov r32|r64, 0 -> xor r32, r32
+        if (opArray[0].isPhysReg() && (opArray[0].as<X86Reg>().isGpd() || opArray[0].as<X86Reg>().isGpq()) &&
+            opArray[1].isImm() && opArray[1].as<Imm>().getInt64() == 0 &&
+            X86PeepholePass_areFlagsDead(cb, node, kX86PeepholeStatusFlags)) {
+          X86Gpd r = x86::gpd(opArray[0].getId());
+          node->setInstId(X86Inst::kIdXor);
+          opArray[0].copyFrom(r);
+          opArray[1].copyFrom(r);
+          _rewrittenCount++;
+          break;
+        }
+
+        // mov [m], r; mov r2, [m] -> mov [m], r; mov r2, r
+        if (opArray[0].isMem() && opArray[1].isPhysReg() && opArray[1].as<X86Reg>().isGp() &&
+            opArray[0].getSize() == opArray[1].getSize()) {
+          CBInst* load = X86PeepholePass_nextInst(node);
+          if (!load || load->getInstId() != X86Inst::kIdMov || load->getOpCount() != 2)
+            break;
+
+          Operand* loadOps = load->getOpArray();
+          if (!loadOps[1].isEqual(opArray[0]) || !loadOps[0].isPhysReg() ||
+              loadOps[0].as<X86Reg>().getSignature() != opArray[1].as<X86Reg>().getSignature())
+            break;
+
+          if (loadOps[0].getId() == opArray[1].getId()) {
+            // A 32-bit load in 64-bit mode also clears the upper half.
+            if (!X86PeepholePass_isNopMoveReg(loadOps[0], is64Bit))
+              break;
+
+            next = load->getNext();
+            cb->removeNode(load);
+            _removedCount++;
+          }
+          else {
+            loadOps[1].copyFrom(opArray[1]);
+            load->resetMemOpIndex();
+            _rewrittenCount++;
+          }
+        }
+        break;
+      }
+
+      case X86Inst::kIdMovaps:
+      case X86Inst::kIdMovapd:
+      case X86Inst::kIdMovups:
+      case X86Inst::kIdMovupd:
+      case X86Inst::kIdMovdqa:
+      case X86Inst::kIdMovdqu: {
+        // movaps xmm, xmm -> (removed)
+        if (opArray[0].isPhysReg() && opArray[0].as<X86Reg>().isXmm() && opArray[0].as<Reg>().isSame(opArray[1].as<Reg>())) {
+          cb->removeNode(node);
+          _removedCount++;
+        }
+        break;
+      }
+
+      case X86Inst::kIdAdd:
+      case X86Inst::kIdSub: {
+        // add|sub r, a; add|sub r, b -> add r, a + b
+        if (!opArray[0].isPhysReg() || !(opArray[0].as<X86Reg>().isGpd() || opArray[0].as<X86Reg>().isGpq()) || !opArray[1].isImm())
+          break;
+
+        int64_t value = opArray[1].as<Imm>().getInt64();
+        if (instId == X86Inst::kIdSub) value = -value;
+
+        bool changed = false;
+        for (;;) {
+          CBInst* other = X86PeepholePass_nextInst(node);
+          if (!other || (other->getInstId() != X86Inst::kIdAdd && other->getInstId() != X86Inst::kIdSub) || other->getOpCount() != 2)
+            break;
+
+          Operand* otherOps = other->getOpArray();
+          if (!otherOps[0].as<Reg>().isSame(opArray[0].as<Reg>()) || !otherOps[1].isImm())
+            break;
+
+          int64_t otherValue = otherOps[1].as<Imm>().getInt64();
+          if (other->getInstId() == X86Inst::kIdSub) otherValue = -otherValue;
+
+          // Carry and overflow of the merged instruction are different.
+          int64_t sum = value + otherValue;
+          if (!Utils::isInt32(sum) || !X86PeepholePass_areFlagsDead(cb, other, kX86PeepholeStatusFlags))
+            break;
+
+          value = sum;
+          next = other->getNext();
+          cb->removeNode(other);
+          _removedCount++;
+          changed = true;
+        }
+
+        if (changed) {
+          node->setInstId(X86Inst::kIdAdd);
+          opArray[1].as<Imm>().setInt64(value);
+          _rewrittenCount++;
+        }
+        break;
+      }
+
+      case X86Inst::kIdCmp: {
+        // cmp r, 0 -> test r, r (only AF differs)
+        if (opArray[0].isPhysReg() && opArray[0].as<X86Reg>().isGp() &&
+            opArray[1].isImm() && opArray[1].as<Imm>().getInt64() == 0 &&
+            X86PeepholePass_areFlagsDead(cb, node, x86::kSpecialReg_FLAGS_AF)) {
+          node->setInstId(X86Inst::kIdTest);
+          opArray[1].copyFrom(opArray[0]);
+          _rewrittenCount++;
+        }
+        break;
+      }
+
+      default:
+        break;
+    }
+  }
+
+  return kErrorOk;
+}
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
+
+// [Guard]
+#endif // ASMJIT_BUILD_X86 && !ASMJIT_DISABLE_BUILDER
@@ -0,0 +1,98 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Guard]
+#ifndef _ASMJIT_X86_X86PEEPHOLEPASS_H
+#define _ASMJIT_X86_X86PEEPHOLEPASS_H
+
+#include "../asmjit_build.h"
+#if !defined(ASMJIT_DISABLE_BUILDER)
+
+// [Dependencies]
+#include "../base/codebuilder.h"
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+//! \addtogroup asmjit_x86
+//! \{
+
+// ============================================================================
+// [asmjit::X86PeepholePass]
+// ============================================================================
+
+//! Peephole optimization pass.
+//!
+//! Rewrites short sequences of instructions that use physical registers into
+//! cheaper ones:
+//!
+//!   - `mov r, r` is removed (except 32-bit registers in 64-bit mode, which
+//!     clear the upper half), also `movaps` and similar SSE moves.
+//!   - `mov r32|r64, 0` becomes `xor r32, r32`.
+//!   - `add|sub r, imm` followed by `add|sub r, imm` becomes a single `add`.
+//!   - `mov [m], r` followed by `mov r2, [m]` becomes `mov r2, r`, or the load
+//!     is removed if `r2` is `r`.
+//!   - `cmp r, 0` becomes `test r, r`.
+//!
+//! Rewrites that change flags are only made if the flags are not read before
+//! they are overwritten, which is checked by following the code (including
+//! unconditional jumps) for a few instructions. Instructions that use a LOCK
+//! or REP prefix, an extra register, or a hole are never changed.
+//!
+//! The pass works on physical registers, so add it to \ref X86Compiler after
+//! it's attached (after \ref X86RAPass) and before \ref X86RelaxPass:
+//!
+//! ~~~
+//! X86Compiler cc(&code);
+//! cc.addPassT<X86PeepholePass>();
+//! cc.addPassT<X86RelaxPass>();
+//! ~~~
+class ASMJIT_VIRTAPI X86PeepholePass : public CBPass {
+public:
+  ASMJIT_NONCOPYABLE(X86PeepholePass)
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  ASMJIT_API X86PeepholePass() noexcept;
+  ASMJIT_API virtual ~X86PeepholePass() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Interface]
+  // --------------------------------------------------------------------------
+
+  ASMJIT_API virtual Error process(Zone* zone) noexcept override;
+
+  // --------------------------------------------------------------------------
+  // [Accessors]
+  // --------------------------------------------------------------------------
+
+  //! Get the count of instructions removed by the last `process()`.
+  ASMJIT_INLINE size_t getRemovedCount() const noexcept { return _removedCount; }
+  //! Get the count of instructions rewritten by the last `process()`.
+  ASMJIT_INLINE size_t getRewrittenCount() const noexcept { return _rewrittenCount; }
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  size_t _removedCount;                  //!< Count of instructions removed.
+  size_t _rewrittenCount;                //!< Count of instructions rewritten.
+};
+
+//! \}
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
+
+// [Guard]
+#endif // !ASMJIT_DISABLE_BUILDER
+#endif // _ASMJIT_X86_X86PEEPHOLEPASS_H
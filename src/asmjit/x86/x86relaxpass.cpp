@@ -0,0 +1,268 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Export]
+#define ASMJIT_EXPORTS
+
+// [Guard]
+#include "../asmjit_build.h"
+#if defined(ASMJIT_BUILD_X86) && !defined(ASMJIT_DISABLE_BUILDER)
+
+// [Dependencies]
+#include "../x86/x86assembler.h"
+#include "../x86/x86internal_p.h"
+#include "../x86/x86relaxpass.h"
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+// ============================================================================
+// [asmjit::X86RelaxPass - Helpers]
+// ============================================================================
+
+//! \internal
+//!
+//! Jump that can be relaxed, stored as pass data of its node.
+struct X86RelaxJump {
+  CBInst* node;                          // Jump node.
+  uint32_t labelId;                      // Target label.
+  uint32_t delta;                        // Size difference of rel32 and rel8 forms.
+  uint32_t start;                        // Offset of the jump in the last layout.
+  uint32_t end;                          // Offset after the jump in the last layout.
+  uint32_t target;                       // Offset of the target in the last layout.
+  bool isShortened;                      // Marked by `kOptionShortForm` by this pass.
+  bool isFixed;                          // Won't be changed anymore.
+};
+
+//! \internal
+//!
+//! Get whether `node` is a jump to a label that has both `rel8` and `rel32`
+//! forms and its form was not forced.
+static ASMJIT_INLINE bool X86RelaxPass_isCandidate(CBNode* node_) noexcept {
+  if (node_->getType() != CBNode::kNodeInst)
+    return false;
+
+  CBInst* node = node_->as<CBInst>();
+  uint32_t instId = node->getInstId();
+
+  if (instId < X86Inst::kIdJa || instId > X86Inst::kIdJz || instId == X86Inst::kIdJecxz)
+    return false;
+
+  if (node->getOptions() & (X86Inst::kOptionShortForm | X86Inst::kOptionLongForm))
+    return false;
+
+  return node->getOpCount() >= 1 && node->getOpArray()[0].isLabel();
+}
+
+//! \internal
+//!
+//! Make a shortened `jump` long again, it won't be changed anymore.
+static ASMJIT_INLINE void X86RelaxPass_fixLong(X86RelaxJump* jump) noexcept {
+  jump->node->setOptions(jump->node->getOptions() & ~X86Inst::kOptionShortForm);
+  jump->isShortened = false;
+  jump->isFixed = true;
+}
+
+//! \internal
+//!
+//! Lay out the code by a scratch assembler, store offsets of all jumps to
+//! their records and the size of the code to `sizeOut`.
+//!
+//! Code between a shortened jump and its target can grow because of alignment
+//! after other jumps were shortened. If a shortened jump doesn't fit anymore
+//! it's made long and `sizeOut` is set to zero, the layout must be repeated.
+static Error X86RelaxPass_layout(CodeBuilder* cb, size_t* sizeOut) noexcept {
+  CodeHolder code;
+  ASMJIT_PROPAGATE(X86Internal::initLayoutCode(code, cb->getCode()));
+
+  X86Assembler a(&code);
+  for (CBNode* node = cb->getFirstNode(); node; node = node->getNext()) {
+    X86RelaxJump* jump = node->getPassData<X86RelaxJump>();
+    size_t offset = a.getOffset();
+    if (jump) jump->start = static_cast<uint32_t>(offset);
+
+    Error err = cb->serializeNode(&a, node);
+    if (ASMJIT_UNLIKELY(err)) {
+      if (err != kErrorInvalidDisplacement)
+        return err;
+
+      // A shortened backward jump that doesn't fit.
+      if (jump && jump->isShortened) {
+        X86RelaxPass_fixLong(jump);
+        *sizeOut = 0;
+        return kErrorOk;
+      }
+
+      // Shortened forward jumps to a label being bound that don't fit.
+      if (node->getType() != CBNode::kNodeLabel && node->getType() != CBNode::kNodeFunc)
+        return err;
+
+      uint32_t labelId = node->as<CBLabel>()->getId();
+      bool fixed = false;
+
+      for (CBNode* prev = cb->getFirstNode(); prev != node; prev = prev->getNext()) {
+        X86RelaxJump* prevJump = prev->getPassData<X86RelaxJump>();
+        if (prevJump && prevJump->isShortened && prevJump->labelId == labelId &&
+            !Utils::isInt8(static_cast<int64_t>(offset) - static_cast<int64_t>(prevJump->end))) {
+          X86RelaxPass_fixLong(prevJump);
+          fixed = true;
+        }
+      }
+
+      if (!fixed)
+        return err;
+
+      *sizeOut = 0;
+      return kErrorOk;
+    }
+
+    if (jump) jump->end = static_cast<uint32_t>(a.getOffset());
+  }
+
+  // Resolve targets, jumps to other sections are never relaxed.
+  for (CBNode* node = cb->getFirstNode(); node; node = node->getNext()) {
+    X86RelaxJump* jump = node->getPassData<X86RelaxJump>();
+    if (!jump) continue;
+
+    LabelEntry* le = code.getLabelEntry(jump->labelId);
+    if (!le || le->getSectionId() != 0)
+      jump->isFixed = true;
+    else
+      jump->target = static_cast<uint32_t>(le->getOffset());
+  }
+
+  *sizeOut = a.getOffset();
+  return kErrorOk;
+}
+
+// ============================================================================
+// [asmjit::X86RelaxPass - Construction / Destruction]
+// ============================================================================
+
+X86RelaxPass::X86RelaxPass() noexcept
+  : CBPass("X86RelaxPass"),
+    _relaxedCount(0),
+    _savedSize(0),
+    _layoutsCount(0) {}
+X86RelaxPass::~X86RelaxPass() noexcept {}
+
+// ============================================================================
+// [asmjit::X86RelaxPass - Interface]
+// ============================================================================
+
+Error X86RelaxPass::process(Zone* zone) noexcept {
+  _relaxedCount = 0;
+  _savedSize = 0;
+  _layoutsCount = 0;
+
+  CodeBuilder* cb = _cb;
+  if (!cb->getFirstNode())
+    return kErrorOk;
+
+  size_t jumpsCount = 0;
+  for (CBNode* node = cb->getFirstNode(); node; node = node->getNext()) {
+    // Data of previous passes is no longer valid.
+    node->resetPassData();
+    if (!X86RelaxPass_isCandidate(node))
+      continue;
+
+    X86RelaxJump* jump = zone->allocT<X86RelaxJump>();
+    if (ASMJIT_UNLIKELY(!jump))
+      return DebugUtils::errored(kErrorNoHeapMemory);
+
+    CBInst* inst = node->as<CBInst>();
+    jump->node = inst;
+    jump->labelId = inst->getOpArray()[0].getId();
+    jump->delta = inst->getInstId() == X86Inst::kIdJmp ? 3 : 4;
+    jump->start = 0;
+    jump->end = 0;
+    jump->target = 0;
+    jump->isShortened = false;
+    jump->isFixed = false;
+
+    node->setPassData<X86RelaxJump>(jump);
+    jumpsCount++;
+  }
+
+  if (jumpsCount == 0)
+    return kErrorOk;
+
+  Error err = kErrorOk;
+  size_t initialSize = 0;
+  size_t size = 0;
+
+  // Every jump can only be shortened once and fixed once, so this converges.
+  for (;;) {
+    err = X86RelaxPass_layout(cb, &size);
+    if (ASMJIT_UNLIKELY(err)) break;
+
+    _layoutsCount++;
+    if (size == 0)
+      continue;
+
+    if (initialSize == 0)
+      initialSize = size;
+
+    bool changed = false;
+    for (CBNode* node = cb->getFirstNode(); node; node = node->getNext()) {
+      X86RelaxJump* jump = node->getPassData<X86RelaxJump>();
+      if (!jump || jump->isFixed)
+        continue;
+
+      int64_t start = static_cast<int64_t>(jump->start);
+      int64_t end = static_cast<int64_t>(jump->end);
+      int64_t target = static_cast<int64_t>(jump->target);
+
+      if (jump->isShortened) {
+        // Code between the jump and its target could have grown because of
+        // alignment, keep the jump long if it doesn't fit anymore.
+        if (!Utils::isInt8(target - end)) {
+          X86RelaxPass_fixLong(jump);
+          changed = true;
+        }
+        continue;
+      }
+
+      // Backward jumps are shortened by the assembler if they fit already.
+      if (end - start < static_cast<int64_t>(jump->delta + 2))
+        continue;
+
+      // A forward target moves together with the end of the jump.
+      int64_t disp = target > start ? target - end : target - (end - jump->delta);
+      if (Utils::isInt8(disp)) {
+        jump->node->addOptions(X86Inst::kOptionShortForm);
+        jump->isShortened = true;
+        changed = true;
+      }
+    }
+
+    if (!changed) break;
+  }
+
+  if (!err) {
+    for (CBNode* node = cb->getFirstNode(); node; node = node->getNext()) {
+      X86RelaxJump* jump = node->getPassData<X86RelaxJump>();
+      if (jump && jump->isShortened)
+        _relaxedCount++;
+    }
+    _savedSize = initialSize - size;
+  }
+
+  for (CBNode* node = cb->getFirstNode(); node; node = node->getNext())
+    node->resetPassData();
+
+  return err;
+}
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
+
+// [Guard]
+#endif // ASMJIT_BUILD_X86 && !ASMJIT_DISABLE_BUILDER
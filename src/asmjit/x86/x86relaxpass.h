@@ -0,0 +1,93 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Guard]
+#ifndef _ASMJIT_X86_X86RELAXPASS_H
+#define _ASMJIT_X86_X86RELAXPASS_H
+
+#include "../asmjit_build.h"
+#if !defined(ASMJIT_DISABLE_BUILDER)
+
+// [Dependencies]
+#include "../base/codebuilder.h"
+
+// [Api-Begin]
+#include "../asmjit_apibegin.h"
+
+namespace asmjit {
+
+//! \addtogroup asmjit_x86
+//! \{
+
+// ============================================================================
+// [asmjit::X86RelaxPass]
+// ============================================================================
+
+//! Branch relaxation pass.
+//!
+//! The assembler doesn't know the target of a forward jump when the jump is
+//! emitted, so it always uses `rel32` displacement, unless the short form is
+//! forced. This pass lays out the code by a scratch \ref X86Assembler and
+//! marks jumps that can use `rel8` displacement by `kOptionShortForm`. It's
+//! repeated until no jump can be shrunk, as shrinking one jump can bring
+//! targets of other jumps into range. Jumps that don't fit after shrinking
+//! others (possible because of alignment) are kept long.
+//!
+//! Jumps already having `kOptionShortForm` or `kOptionLongForm` are not
+//! changed. The pass must run after all passes that add or remove nodes, so
+//! add it to \ref X86Compiler after it's attached (after \ref X86RAPass):
+//!
+//! ~~~
+//! X86Compiler cc(&code);
+//! cc.addPassT<X86RelaxPass>();
+//! ~~~
+class ASMJIT_VIRTAPI X86RelaxPass : public CBPass {
+public:
+  ASMJIT_NONCOPYABLE(X86RelaxPass)
+
+  // --------------------------------------------------------------------------
+  // [Construction / Destruction]
+  // --------------------------------------------------------------------------
+
+  ASMJIT_API X86RelaxPass() noexcept;
+  ASMJIT_API virtual ~X86RelaxPass() noexcept;
+
+  // --------------------------------------------------------------------------
+  // [Interface]
+  // --------------------------------------------------------------------------
+
+  ASMJIT_API virtual Error process(Zone* zone) noexcept override;
+
+  // --------------------------------------------------------------------------
+  // [Accessors]
+  // --------------------------------------------------------------------------
+
+  //! Get the count of jumps shrunk by the last `process()`.
+  ASMJIT_INLINE size_t getRelaxedCount() const noexcept { return _relaxedCount; }
+  //! Get the count of bytes saved by the last `process()`.
+  ASMJIT_INLINE size_t getSavedSize() const noexcept { return _savedSize; }
+  //! Get the count of layouts made by the last `process()`.
+  ASMJIT_INLINE uint32_t getLayoutsCount() const noexcept { return _layoutsCount; }
+
+  // --------------------------------------------------------------------------
+  // [Members]
+  // --------------------------------------------------------------------------
+
+  size_t _relaxedCount;                  //!< Count of jumps shrunk.
+  size_t _savedSize;                     //!< Count of bytes saved.
+  uint32_t _layoutsCount;                //!< Count of layouts made.
+};
+
+//! \}
+
+} // asmjit namespace
+
+// [Api-End]
+#include "../asmjit_apiend.h"
+
+// [Guard]
+#endif // !ASMJIT_DISABLE_BUILDER
+#endif // _ASMJIT_X86_X86RELAXPASS_H
@@ -0,0 +1,154 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Dependencies]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./asmjit.h"
+#include "./asmjit_test_misc.h"
+
+using namespace asmjit;
+
+// ============================================================================
+// [Configuration]
+// ============================================================================
+
+static const uint32_t kNumRepeats = 3;
+static const uint32_t kNumCalls = 40000;
+static const uint32_t kNumPixels = 4096;
+
+// The kernel is shifted by these counts of bytes to get loops at different
+// offsets, as it would happen with other code generated before it.
+static const uint32_t kShifts[] = { 0, 3, 6, 9, 12 };
+
+// ============================================================================
+// [Bench]
+// ============================================================================
+
+typedef void (*AlphaBlendFunc)(void* dst, const void* src, size_t count);
+
+#if defined(ASMJIT_BUILD_X86)
+struct Variant {
+  const char* name;                      // Name of the variant.
+  bool alignLoops;                       // Add `X86LoopAlignPass`.
+  uint32_t maxSkip;                      // Maximum padding of a loop.
+};
+
+static AlphaBlendFunc generateKernel(JitRuntime& rt, const Variant& variant, uint32_t shift, size_t* paddingOut) {
+  CodeHolder code;
+  code.init(rt.getCodeInfo());
+
+  X86Compiler cc(&code);
+  X86LoopAlignPass* loopAlign = nullptr;
+
+  if (variant.alignLoops) {
+    loopAlign = cc.newPassT<X86LoopAlignPass>();
+    loopAlign->setMaxSkip(variant.maxSkip);
+    cc.addPass(loopAlign);
+  }
+  cc.addPassT<X86RelaxPass>();
+
+  for (uint32_t i = 0; i < shift; i++)
+    cc.nop();
+  asmtest::generateAlphaBlend(cc);
+
+  AlphaBlendFunc func;
+  if (cc.finalize() != kErrorOk || rt.add(&func, &code) != kErrorOk)
+    return nullptr;
+
+  *paddingOut = loopAlign ? loopAlign->getPaddingSize() : 0;
+  return func;
+}
+
+static uint32_t benchKernel(AlphaBlendFunc func, uint32_t* dst, const uint32_t* src) {
+  uint32_t best = 0xFFFFFFFFU;
+
+  for (uint32_t r = 0; r < kNumRepeats; r++) {
+    uint32_t start = OSUtils::getTickCount();
+    for (uint32_t i = 0; i < kNumCalls; i++)
+      func(dst, src, kNumPixels);
+    uint32_t time = OSUtils::getTickCount() - start;
+
+    if (best > time) best = time;
+  }
+
+  return best;
+}
+#endif // ASMJIT_BUILD_X86
+
+// ============================================================================
+// [Main]
+// ============================================================================
+
+int main() {
+#if defined(ASMJIT_BUILD_X86)
+  static const Variant variants[] = {
+    { "NoAlign"    , false, 0  },
+    { "Align 16:10", true , 10 },
+    { "Align 16:15", true , 15 }
+  };
+
+  // 16-byte aligned buffers, the large loop of the kernel uses `movaps`.
+  uint8_t* mem = static_cast<uint8_t*>(::malloc(kNumPixels * 4 * 3 + 16));
+  if (!mem) {
+    printf("Failed to allocate buffers\n");
+    return 1;
+  }
+
+  uint32_t* src = reinterpret_cast<uint32_t*>(Utils::alignTo<uintptr_t>((uintptr_t)mem, 16));
+  uint32_t* dst = src + kNumPixels;
+  uint32_t* ref = dst + kNumPixels;
+
+  uint32_t seed = 1;
+  for (uint32_t i = 0; i < kNumPixels; i++) {
+    seed = seed * 1103515245U + 12345U;
+    src[i] = seed;
+  }
+
+  JitRuntime rt;
+  uint32_t total[ASMJIT_ARRAY_SIZE(variants)] = { 0 };
+
+  for (uint32_t s = 0; s < ASMJIT_ARRAY_SIZE(kShifts); s++) {
+    for (uint32_t v = 0; v < ASMJIT_ARRAY_SIZE(variants); v++) {
+      size_t padding;
+      AlphaBlendFunc func = generateKernel(rt, variants[v], kShifts[s], &padding);
+
+      if (!func) {
+        printf("%-12s | Shift: %-2u | Failed to generate the kernel\n", variants[v].name, kShifts[s]);
+        continue;
+      }
+
+      // All variants must produce the same output.
+      ::memset(dst, 0x80, kNumPixels * 4);
+      func(dst, src, kNumPixels);
+
+      if (v == 0)
+        ::memcpy(ref, dst, kNumPixels * 4);
+      else if (::memcmp(ref, dst, kNumPixels * 4) != 0)
+        printf("%-12s | Shift: %-2u | Output mismatch\n", variants[v].name, kShifts[s]);
+
+      uint32_t time = benchKernel(func, dst, src);
+      total[v] += time;
+
+      printf("%-12s | Shift: %-2u | Padding: %-2u [B] | Time: %-6u [ms]\n",
+        variants[v].name, kShifts[s], static_cast<unsigned int>(padding), time);
+      rt.release(func);
+    }
+  }
+
+  printf("\n");
+  for (uint32_t v = 0; v < ASMJIT_ARRAY_SIZE(variants); v++) {
+    double gain = total[0] ? 100.0 * (static_cast<double>(total[0]) - static_cast<double>(total[v])) / static_cast<double>(total[0]) : 0.0;
+    printf("%-12s | Total: %-6u [ms] | Gain: %5.1f%%\n", variants[v].name, total[v], gain);
+  }
+
+  ::free(mem);
+#endif // ASMJIT_BUILD_X86
+
+  return 0;
+}
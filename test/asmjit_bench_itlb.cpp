@@ -0,0 +1,116 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Dependencies]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./asmjit.h"
+
+using namespace asmjit;
+
+// ============================================================================
+// [Configuration]
+// ============================================================================
+
+static const uint32_t kNumRepeats = 5;
+static const uint32_t kNumFuncs = 8192;
+static const uint32_t kNumCalls = 4000000;
+
+// Padding after each function, so every function is on a different page.
+static const uint32_t kFuncPadding = 4032;
+
+// ============================================================================
+// [Bench]
+// ============================================================================
+
+typedef uint32_t (*Func)(void);
+
+#if defined(ASMJIT_BUILD_X86)
+static bool generateFuncs(JitRuntime& rt, Func* funcs) {
+  static const uint8_t padding[kFuncPadding] = { 0 };
+
+  for (uint32_t i = 0; i < kNumFuncs; i++) {
+    CodeHolder code;
+    code.init(rt.getCodeInfo());
+
+    X86Assembler a(&code);
+    a.mov(x86::eax, i);
+    a.ret();
+    a.embed(padding, kFuncPadding);
+
+    if (rt.add(&funcs[i], &code) != kErrorOk)
+      return false;
+  }
+
+  return true;
+}
+
+static uint32_t benchCalls(const char* name, JitRuntime& rt) {
+  Func* funcs = static_cast<Func*>(::malloc(sizeof(Func) * kNumFuncs));
+  uint32_t* order = static_cast<uint32_t*>(::malloc(sizeof(uint32_t) * kNumFuncs));
+
+  if (!funcs || !order || !generateFuncs(rt, funcs)) {
+    printf("%-12s | Failed to generate functions\n", name);
+    ::free(funcs);
+    ::free(order);
+    return 0;
+  }
+
+  // Call functions in a scattered, but predictable order.
+  uint32_t seed = 1;
+  for (uint32_t i = 0; i < kNumFuncs; i++) {
+    seed = seed * 1103515245U + 12345U;
+    order[i] = (seed >> 8) % kNumFuncs;
+  }
+
+  uint32_t best = 0xFFFFFFFFU;
+  uint32_t checksum = 0;
+
+  for (uint32_t r = 0; r < kNumRepeats; r++) {
+    uint32_t start = OSUtils::getTickCount();
+    for (uint32_t i = 0; i < kNumCalls; i++)
+      checksum += funcs[order[i % kNumFuncs]]();
+    uint32_t time = OSUtils::getTickCount() - start;
+
+    if (best > time) best = time;
+  }
+
+  printf("%-12s | Arena: %-8u [KB] | Time: %-6u [ms] | Checksum: %08X\n",
+    name, static_cast<unsigned int>(rt.getArenaSize() / 1024), best, checksum);
+
+  for (uint32_t i = 0; i < kNumFuncs; i++)
+    rt.release(funcs[i]);
+
+  ::free(funcs);
+  ::free(order);
+  return best;
+}
+#endif // ASMJIT_BUILD_X86
+
+// ============================================================================
+// [Main]
+// ============================================================================
+
+int main() {
+#if defined(ASMJIT_BUILD_X86)
+  {
+    JitRuntime rt;
+    benchCalls("RegularPages", rt);
+  }
+
+  {
+    JitRuntime rt;
+    if (rt.setLargePagesEnabled(true) == kErrorOk)
+      benchCalls("LargePages", rt);
+    else
+      printf("%-12s | Not supported by the host\n", "LargePages");
+  }
+#endif // ASMJIT_BUILD_X86
+
+  return 0;
+}
@@ -0,0 +1,213 @@
+// [AsmJit]
+// Complete x86/x64 JIT and Remote Assembler for C++.
+//
+// [License]
+// Zlib - See LICENSE.md file in the package.
+
+// [Dependencies]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./asmjit.h"
+
+#if ASMJIT_OS_WINDOWS
+# include <windows.h>
+#else
+# include <pthread.h>
+#endif
+
+using namespace asmjit;
+
+// ============================================================================
+// [Configuration]
+// ============================================================================
+
+static const uint32_t kNumRepeats = 5;
+static const uint32_t kNumIterations = 200000;
+static const uint32_t kNumLive = 256;
+static const uint32_t kMaxThreads = 8;
+
+// ============================================================================
+// [Worker]
+// ============================================================================
+
+struct Worker {
+  VMemMgr* memmgr;
+  uint32_t seed;
+  uint32_t mode;
+  void** live;
+  void** peer;
+};
+
+enum WorkerMode {
+  kModeChurn   = 0,                      // Alloc and release own memory.
+  kModeProduce = 1,                      // Alloc memory released by a peer.
+  kModeConsume = 2                       // Release memory allocated by a peer.
+};
+
+static uint32_t nextSize(uint32_t& seed) {
+  seed = seed * 1103515245U + 12345U;
+  // Sizes of typical small functions (64..1087 bytes).
+  return 64U + ((seed >> 16) & 0x3FFU);
+}
+
+static void runWorker(Worker* w) {
+  VMemMgr* memmgr = w->memmgr;
+  uint32_t seed = w->seed;
+  uint32_t i;
+
+  switch (w->mode) {
+    case kModeChurn:
+      for (i = 0; i < kNumLive; i++)
+        w->live[i] = memmgr->alloc(nextSize(seed));
+
+      for (i = 0; i < kNumIterations; i++) {
+        uint32_t index = i % kNumLive;
+        memmgr->release(w->live[index]);
+        w->live[index] = memmgr->alloc(nextSize(seed));
+      }
+
+      for (i = 0; i < kNumLive; i++)
+        memmgr->release(w->live[i]);
+      break;
+
+    case kModeProduce:
+      for (i = 0; i < kNumIterations / 16; i++)
+        w->live[i] = memmgr->alloc(nextSize(seed));
+      break;
+
+    case kModeConsume:
+      for (i = 0; i < kNumIterations / 16; i++)
+        memmgr->release(w->peer[i]);
+      break;
+  }
+
+  w->seed = seed;
+}
+
+#if ASMJIT_OS_WINDOWS
+static DWORD WINAPI workerEntry(LPVOID arg) {
+  runWorker(static_cast<Worker*>(arg));
+  return 0;
+}
+#else
+static void* workerEntry(void* arg) {
+  runWorker(static_cast<Worker*>(arg));
+  return nullptr;
+}
+#endif
+
+static void runWorkers(Worker* workers, uint32_t n) {
+#if ASMJIT_OS_WINDOWS
+  HANDLE handles[kMaxThreads];
+  for (uint32_t i = 0; i < n; i++)
+    handles[i] = CreateThread(nullptr, 0, workerEntry, &workers[i], 0, nullptr);
+  WaitForMultipleObjects(n, handles, TRUE, INFINITE);
+  for (uint32_t i = 0; i < n; i++)
+    CloseHandle(handles[i]);
+#else
+  pthread_t handles[kMaxThreads];
+  for (uint32_t i = 0; i < n; i++)
+    pthread_create(&handles[i], nullptr, workerEntry, &workers[i]);
+  for (uint32_t i = 0; i < n; i++)
+    pthread_join(handles[i], nullptr);
+#endif
+}
+
+// ============================================================================
+// [Bench]
+// ============================================================================
+
+static uint32_t benchChurn(uint32_t numThreads, bool cached) {
+  uint32_t best = 0xFFFFFFFFU;
+
+  for (uint32_t r = 0; r < kNumRepeats; r++) {
+    VMemMgr memmgr;
+    memmgr.setThreadCacheEnabled(cached);
+
+    Worker workers[kMaxThreads];
+    void* live[kMaxThreads][kNumLive];
+
+    for (uint32_t i = 0; i < numThreads; i++) {
+      workers[i].memmgr = &memmgr;
+      workers[i].seed = i + 1;
+      workers[i].mode = kModeChurn;
+      workers[i].live = live[i];
+      workers[i].peer = nullptr;
+    }
+
+    uint32_t start = OSUtils::getTickCount();
+    runWorkers(workers, numThreads);
+    uint32_t time = OSUtils::getTickCount() - start;
+
+    if (best > time) best = time;
+  }
+
+  return best;
+}
+
+static uint32_t benchRemote(uint32_t numThreads, bool cached) {
+  uint32_t best = 0xFFFFFFFFU;
+  const uint32_t kCount = kNumIterations / 16;
+
+  void** storage = static_cast<void**>(::malloc(sizeof(void*) * kCount * kMaxThreads));
+  if (!storage) return 0;
+
+  for (uint32_t r = 0; r < kNumRepeats; r++) {
+    VMemMgr memmgr;
+    memmgr.setThreadCacheEnabled(cached);
+
+    Worker workers[kMaxThreads];
+    uint32_t i;
+
+    for (i = 0; i < numThreads; i++) {
+      workers[i].memmgr = &memmgr;
+      workers[i].seed = i + 1;
+      workers[i].mode = kModeProduce;
+      workers[i].live = storage + i * kCount;
+      workers[i].peer = storage + ((i + 1) % numThreads) * kCount;
+    }
+
+    uint32_t start = OSUtils::getTickCount();
+    for (uint32_t round = 0; round < 4; round++) {
+      // Each thread releases memory allocated by its neighbour and allocates
+      // memory its other neighbour releases in the next round.
+      for (i = 0; i < numThreads; i++) workers[i].mode = kModeProduce;
+      runWorkers(workers, numThreads);
+
+      for (i = 0; i < numThreads; i++) workers[i].mode = kModeConsume;
+      runWorkers(workers, numThreads);
+    }
+    uint32_t time = OSUtils::getTickCount() - start;
+
+    if (best > time) best = time;
+  }
+
+  ::free(storage);
+  return best;
+}
+
+// ============================================================================
+// [Main]
+// ============================================================================
+
+int main() {
+  for (uint32_t numThreads = 1; numThreads <= kMaxThreads; numThreads *= 2) {
+    uint32_t churnLocked = benchChurn(numThreads, false);
+    uint32_t churnCached = benchChurn(numThreads, true);
+
+    printf("VMemMgr Churn  (%u threads) | Locked: %-6u [ms] | Cached: %-6u [ms]\n",
+      numThreads, churnLocked, churnCached);
+  }
+
+  for (uint32_t numThreads = 2; numThreads <= kMaxThreads; numThreads *= 2) {
+    uint32_t remoteLocked = benchRemote(numThreads, false);
+    uint32_t remoteCached = benchRemote(numThreads, true);
+
+    printf("VMemMgr Remote (%u threads) | Locked: %-6u [ms] | Cached: %-6u [ms]\n",
+      numThreads, remoteLocked, remoteCached);
+  }
+
+  return 0;
+}
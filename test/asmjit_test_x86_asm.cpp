@@ -61,6 +61,45 @@ static void makeFunc(X86Emitter* emitter) {
   FuncUtils::emitEpilog(emitter, layout);
 }
 
+// Host function called by the generated code.
+typedef int (*IncFunc)(int x);
+static int hostInc(int x) { return x + 1; }
+
+#if ASMJIT_ARCH_X64 && ASMJIT_OS_LINUX
+// Host function that throws through the generated code.
+typedef void (*ThrowFunc)(int x);
+static void hostThrow(int x) { throw x + 1; }
+
+// Generate a function that saves RBX and calls `hostThrow()`, its unwind
+// information is registered by `JitRuntime`, so the exception can pass it.
+static void makeThrowFunc(X86Emitter* emitter) {
+  X86Gp arg = x86::ebx;
+
+  FuncDetail func;
+  func.init(FuncSignature1<void, int>(CallConv::kIdHost));
+
+  FuncFrameInfo ffi;
+  ffi.enableCalls();
+  ffi.setStackFrameSize(24);
+  ffi.setDirtyRegs(X86Reg::kKindGp, Utils::mask(X86Gp::kIdBx, X86Gp::kIdDi));
+
+  FuncArgsMapper args(&func);
+  args.assignAll(arg);
+  args.updateFrameInfo(ffi);
+
+  FuncFrameLayout layout;
+  layout.init(func, ffi);
+
+  FuncUtils::emitProlog(emitter, layout);
+  FuncUtils::allocArgs(emitter, layout, args);
+
+  emitter->mov(x86::edi, arg);
+  emitter->call(imm_ptr(hostThrow));
+
+  FuncUtils::emitEpilog(emitter, layout);
+}
+#endif
+
 int main(int argc, char* argv[]) {
   JitRuntime rt;                          // Create JIT Runtime
 
@@ -88,8 +127,196 @@ int main(int argc, char* argv[]) {
 
   rt.release(fn);
 
-  if (out[0] == 5 && out[1] == 8 && out[2] == 4 && out[3] == 9)
-    return 0;
-  else
+  if (out[0] != 5 || out[1] != 8 || out[2] != 4 || out[3] != 9)
+    return 1;
+
+  // Add the same function multiple times by using a single allocation.
+  enum { kBatchSize = 4 };
+  CodeHolder batch[kBatchSize];
+  CodeHolder* holders[kBatchSize];
+  SumIntsFunc fns[kBatchSize];
+
+  for (int i = 0; i < kBatchSize; i++) {
+    batch[i].init(rt.getCodeInfo());
+    X86Assembler ba(&batch[i]);
+    makeFunc(ba.asEmitter());
+    holders[i] = &batch[i];
+  }
+
+  err = rt.addBatch(holders, kBatchSize, Internal::ptr_cast<void**, SumIntsFunc*>(fns));
+  if (err) return 1;
+
+  for (int i = 0; i < kBatchSize; i++) {
+    if (((uintptr_t)fns[i] & 63) != 0)
+      return 1;
+
+    ::memset(out, 0, sizeof(out));
+    fns[i](out, inA, inB);
+    if (out[0] != 5 || out[1] != 8 || out[2] != 4 || out[3] != 9)
+      return 1;
+  }
+
+  // Functions of a batch are released separately.
+  for (int i = 0; i < kBatchSize; i++)
+    if (rt.release(fns[i]) != kErrorOk)
+      return 1;
+
+  // Serialize the function and add the deserialized code to the runtime.
+  StringBuilder cached;
+  if (CodeCache::save(&batch[0], cached) != kErrorOk)
+    return 1;
+
+  CodeHolder restored;
+  if (CodeCache::load(&restored, cached.getData(), cached.getLength()) != kErrorOk)
+    return 1;
+
+  err = rt.add(&fn, &restored);
+  if (err) return 1;
+
+  ::memset(out, 0, sizeof(out));
+  fn(out, inA, inB);
+  rt.release(fn);
+
+  if (out[0] != 5 || out[1] != 8 || out[2] != 4 || out[3] != 9)
+    return 1;
+
+  // Emit the function directly into executable memory, it's not copied.
+  CodeHolder streamCode;
+  streamCode.init(rt.getCodeInfo());
+  if (rt.beginStream(&streamCode, 4096) != kErrorOk)
+    return 1;
+
+  X86Assembler sa(&streamCode);
+  makeFunc(sa.asEmitter());
+
+  err = rt.add(&fn, &streamCode);
+  if (err) return 1;
+
+  if (streamCode.getSectionEntry(0)->getBuffer().getData() != rt.getMemMgr()->getWritablePtr((void*)fn))
+    return 1;
+
+  ::memset(out, 0, sizeof(out));
+  fn(out, inA, inB);
+  rt.release(fn);
+
+  if (out[0] != 5 || out[1] != 8 || out[2] != 4 || out[3] != 9)
+    return 1;
+
+  // Code that doesn't fit the stream is moved to the heap and copied.
+  CodeHolder overflowCode;
+  overflowCode.init(rt.getCodeInfo());
+  if (rt.beginStream(&overflowCode, 8) != kErrorOk)
+    return 1;
+
+  X86Assembler oa(&overflowCode);
+  makeFunc(oa.asEmitter());
+
+  err = rt.add(&fn, &overflowCode);
+  if (err) return 1;
+
+  ::memset(out, 0, sizeof(out));
+  fn(out, inA, inB);
+  rt.release(fn);
+
+  if (out[0] != 5 || out[1] != 8 || out[2] != 4 || out[3] != 9)
     return 1;
+
+  // Reserve a code region near the host code, calls to it need no trampolines.
+  JitRuntime nearRt;
+  if (nearRt.reserveCodeRegion(64 * 1024 * 1024, (const void*)(uintptr_t)&hostInc) == kErrorOk) {
+    CodeHolder nearCode;
+    nearCode.init(nearRt.getCodeInfo());
+
+    X86Assembler na(&nearCode);
+    na.jmp(imm_ptr(hostInc));
+
+    if (nearCode.getTrampolinesSize() != 0)
+      return 1;
+
+    IncFunc incFn;
+    err = nearRt.add(&incFn, &nearCode);
+    if (err) return 1;
+
+    int result = incFn(41);
+    nearRt.release(incFn);
+
+    if (result != 42)
+      return 1;
+  }
+
+  // Read a constant from a read-only section and a counter from a writable
+  // one, both are placed to their own pages after the code.
+  CodeHolder dataCode;
+  dataCode.init(rt.getCodeInfo());
+
+  SectionEntry* rodata;
+  SectionEntry* data;
+  if (dataCode.newSection(&rodata, ".rodata", Globals::kInvalidIndex, SectionEntry::kFlagConst, 16) != kErrorOk ||
+      dataCode.newSection(&data, ".data", Globals::kInvalidIndex, 0, 8) != kErrorOk ||
+      dataCode.setConstPoolSectionId(rodata->getId()) != kErrorOk)
+    return 1;
+
+  X86Assembler da(&dataCode);
+  Zone poolZone(1024);
+  ConstPool pool(&poolZone);
+
+  int32_t constValue = 41;
+  size_t constOffset;
+  pool.add(&constValue, sizeof(constValue), constOffset);
+
+  Label poolLabel = da.newLabel();
+  Label counterLabel = da.newLabel();
+
+  da.mov(x86::eax, x86::dword_ptr(counterLabel));
+  da.inc(x86::eax);
+  da.mov(x86::dword_ptr(counterLabel), x86::eax);
+  da.add(x86::eax, x86::dword_ptr(poolLabel, static_cast<int32_t>(constOffset)));
+  da.ret();
+  da.embedConstPool(poolLabel, pool);
+
+  int32_t counterValue = 0;
+  da.section(data);
+  da.bind(counterLabel);
+  da.embed(&counterValue, sizeof(counterValue));
+
+  typedef int (*CounterFunc)(void);
+  CounterFunc counterFn;
+
+  err = rt.add(&counterFn, &dataCode);
+  if (err) return 1;
+
+  int first = counterFn();
+  int second = counterFn();
+  rt.release(counterFn);
+
+  if (rodata->getOffset() == 0 || data->getOffset() <= rodata->getOffset() || first != 42 || second != 43)
+    return 1;
+
+#if ASMJIT_ARCH_X64 && ASMJIT_OS_LINUX
+  // Throw a C++ exception through the generated code.
+  CodeHolder throwCode;
+  throwCode.init(rt.getCodeInfo());
+  throwCode.setUnwindInfoEnabled(true);
+
+  X86Assembler ta(&throwCode);
+  makeThrowFunc(ta.asEmitter());
+
+  ThrowFunc throwFn;
+  err = rt.add(&throwFn, &throwCode);
+  if (err) return 1;
+
+  int thrown = 0;
+  try {
+    throwFn(41);
+  }
+  catch (int x) {
+    thrown = x;
+  }
+  rt.release(throwFn);
+
+  if (thrown != 42)
+    return 1;
+#endif
+
+  return 0;
 }
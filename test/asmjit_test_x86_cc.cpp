@@ -75,7 +75,19 @@ public:
   ZoneVector<X86Test*> _tests;
 
   int _returnCode;
-  int _binSize;
+  size_t _binSize;
+  size_t _relaxedBinSize;
+  size_t _peepholeBinSize;
+  size_t _peepholeRemovedCount;
+  size_t _peepholeRewrittenCount;
+  size_t _hotColdBinSize;
+  size_t _hotColdMovedCount;
+  size_t _hotColdInvertedCount;
+  size_t _layoutBinSize;
+  size_t _layoutMovedCount;
+  size_t _layoutRemovedCount;
+  size_t _loopAlignedCount;
+  size_t _loopPaddingSize;
   bool _verbose;
   StringBuilder _output;
 };
@@ -85,6 +97,18 @@ X86TestManager::X86TestManager() :
   _zoneHeap(&_zone),
   _returnCode(0),
   _binSize(0),
+  _relaxedBinSize(0),
+  _peepholeBinSize(0),
+  _peepholeRemovedCount(0),
+  _peepholeRewrittenCount(0),
+  _hotColdBinSize(0),
+  _hotColdMovedCount(0),
+  _hotColdInvertedCount(0),
+  _layoutBinSize(0),
+  _layoutMovedCount(0),
+  _layoutRemovedCount(0),
+  _loopAlignedCount(0),
+  _loopPaddingSize(0),
   _verbose(false) {}
 
 X86TestManager::~X86TestManager() {
@@ -113,8 +137,14 @@ int X86TestManager::run() {
 
   MyErrorHandler errorHandler;
 
-  for (i = 0; i < count; i++) {
+  // Every test is compiled five times, the second time with branch relaxation,
+  // the third time with peephole optimization, the fourth time with hot/cold
+  // splitting, and the fifth time with block layout and loop alignment.
+  static const char* modeNames[] = { "", " (relaxed)", " (peephole)", " (hot/cold)", " (layout)" };
+
+  for (i = 0; i < count * 5; i++) {
     JitRuntime runtime;
+    uint32_t mode = static_cast<uint32_t>(i % 5);
 
     CodeHolder code;
     code.init(runtime.getCodeInfo());
@@ -132,14 +162,65 @@ int X86TestManager::run() {
 #endif // ASMJIT_DISABLE_LOGGING
 
     X86Compiler cc(&code);
-    X86Test* test = _tests[i];
+    X86PeepholePass* peephole = nullptr;
+    X86HotColdPass* hotCold = nullptr;
+    X86LayoutPass* layout = nullptr;
+    X86LoopAlignPass* loopAlign = nullptr;
+
+    if (mode == 1)
+      cc.addPassT<X86RelaxPass>();
+
+    if (mode == 2) {
+      peephole = cc.newPassT<X86PeepholePass>();
+      cc.addPass(peephole);
+    }
+
+    if (mode == 3) {
+      hotCold = cc.newPassT<X86HotColdPass>();
+      cc.addPass(hotCold);
+    }
+
+    if (mode == 4) {
+      layout = cc.newPassT<X86LayoutPass>();
+      layout->setLoopAlignment(0);
+      cc.addPass(layout);
+
+      loopAlign = cc.newPassT<X86LoopAlignPass>();
+      cc.addPass(loopAlign);
+    }
+
+    X86Test* test = _tests[i / 5];
     test->compile(cc);
 
     Error err = cc.finalize();
     void* func;
 
-    if (err == kErrorOk)
+    if (err == kErrorOk) {
+      if (mode == 0) {
+        _binSize += code.getCodeSize();
+      }
+      else if (mode == 1) {
+        _relaxedBinSize += code.getCodeSize();
+      }
+      else if (mode == 2) {
+        _peepholeBinSize += code.getCodeSize();
+        _peepholeRemovedCount += peephole->getRemovedCount();
+        _peepholeRewrittenCount += peephole->getRewrittenCount();
+      }
+      else if (mode == 3) {
+        _hotColdBinSize += code.getCodeSize();
+        _hotColdMovedCount += hotCold->getMovedCount();
+        _hotColdInvertedCount += hotCold->getInvertedCount();
+      }
+      else {
+        _layoutBinSize += code.getCodeSize();
+        _layoutMovedCount += layout->getMovedCount();
+        _layoutRemovedCount += layout->getRemovedCount();
+        _loopAlignedCount += loopAlign->getAlignedCount();
+        _loopPaddingSize += loopAlign->getPaddingSize();
+      }
       err = runtime.add(&func, &code);
+    }
     if (_verbose) fflush(file);
 
     if (err == kErrorOk) {
@@ -147,7 +228,8 @@ int X86TestManager::run() {
       StringBuilder expect;
 
       if (test->run(func, result, expect)) {
-        fprintf(file, "[Success] %s.\n", test->getName());
+        if (mode == 4)
+          fprintf(file, "[Success] %s.\n", test->getName());
       }
       else {
 #if !defined(ASMJIT_DISABLE_LOGGING)
@@ -156,7 +238,7 @@ int X86TestManager::run() {
 #endif // ASMJIT_DISABLE_LOGGING
 
         fprintf(file, "-------------------------------------------------------------------------------\n");
-        fprintf(file, "[Failure] %s.\n", test->getName());
+        fprintf(file, "[Failure] %s%s.\n", test->getName(), modeNames[mode]);
         fprintf(file, "-------------------------------------------------------------------------------\n");
         fprintf(file, "Result  : %s\n", result.getData());
         fprintf(file, "Expected: %s\n", expect.getData());
@@ -174,7 +256,7 @@ int X86TestManager::run() {
 #endif // ASMJIT_DISABLE_LOGGING
 
       fprintf(file, "-------------------------------------------------------------------------------\n");
-      fprintf(file, "[Failure] %s (%s).\n", test->getName(), DebugUtils::errorAsString(err));
+      fprintf(file, "[Failure] %s%s (%s).\n", test->getName(), modeNames[mode], DebugUtils::errorAsString(err));
       fprintf(file, "===============================================================================\n");
 
       _returnCode = 1;
@@ -183,6 +265,29 @@ int X86TestManager::run() {
     fflush(file);
   }
 
+  if (_binSize) {
+    fprintf(file, "\nCode size: %u bytes, %u bytes with branch relaxation (-%.1f%%).\n",
+      static_cast<unsigned int>(_binSize),
+      static_cast<unsigned int>(_relaxedBinSize),
+      100.0 * static_cast<double>(_binSize - _relaxedBinSize) / static_cast<double>(_binSize));
+    fprintf(file, "Code size: %u bytes with peephole optimization (-%.1f%%), %u instructions removed, %u rewritten.\n",
+      static_cast<unsigned int>(_peepholeBinSize),
+      100.0 * static_cast<double>(_binSize - _peepholeBinSize) / static_cast<double>(_binSize),
+      static_cast<unsigned int>(_peepholeRemovedCount),
+      static_cast<unsigned int>(_peepholeRewrittenCount));
+    fprintf(file, "Code size: %u bytes with hot/cold splitting, %u blocks moved, %u jumps inverted.\n",
+      static_cast<unsigned int>(_hotColdBinSize),
+      static_cast<unsigned int>(_hotColdMovedCount),
+      static_cast<unsigned int>(_hotColdInvertedCount));
+    fprintf(file, "Code size: %u bytes with block layout, %u blocks moved, %u jumps removed.\n",
+      static_cast<unsigned int>(_layoutBinSize),
+      static_cast<unsigned int>(_layoutMovedCount),
+      static_cast<unsigned int>(_layoutRemovedCount));
+    fprintf(file, "Loop alignment: %u loops aligned, %u bytes of padding.\n",
+      static_cast<unsigned int>(_loopAlignedCount),
+      static_cast<unsigned int>(_loopPaddingSize));
+  }
+
   fputs("\n", file);
   fputs(_output.getData(), file);
   fflush(file);
@@ -1091,6 +1196,211 @@ public:
   }
 };
 
+// ============================================================================
+// [X86Test_AllocPeephole]
+// ============================================================================
+
+class X86Test_AllocPeephole : public X86Test {
+public:
+  X86Test_AllocPeephole() : X86Test("[Alloc] Peephole") {}
+
+  static void add(X86TestManager& mgr) {
+    mgr.add(new X86Test_AllocPeephole());
+  }
+
+  virtual void compile(X86Compiler& cc) {
+    cc.addFunc(FuncSignature2<int, int, int>(CallConv::kIdHost));
+
+    X86Gp a = cc.newInt32("a");
+    X86Gp b = cc.newInt32("b");
+    X86Gp r = cc.newInt32("r");
+    Label L_NonZero = cc.newLabel();
+
+    cc.setArg(0, a);
+    cc.setArg(1, b);
+
+    // Flags are live, so `mov r, 0` must not become `xor r, r`.
+    cc.cmp(a, b);
+    cc.mov(r, 0);
+    cc.setg(r.r8());
+
+    // Merged into a single `add a, 2`.
+    cc.add(a, 1);
+    cc.add(a, 2);
+    cc.sub(a, 1);
+
+    // Becomes `test a, a`.
+    cc.cmp(a, 0);
+    cc.jne(L_NonZero);
+    cc.add(r, 10);
+
+    cc.bind(L_NonZero);
+    cc.add(r, a);
+    cc.ret(r);
+    cc.endFunc();
+  }
+
+  virtual bool run(void* _func, StringBuilder& result, StringBuilder& expect) {
+    typedef int (*Func)(int, int);
+    Func func = ptr_as_func<Func>(_func);
+
+    int resultRet[3] = { func(1, 0), func(-2, 5), func(0, 0) };
+    int expectRet[3] = { 4, 10, 2 };
+
+    result.setFormat("ret={%d, %d, %d}", resultRet[0], resultRet[1], resultRet[2]);
+    expect.setFormat("ret={%d, %d, %d}", expectRet[0], expectRet[1], expectRet[2]);
+
+    return resultRet[0] == expectRet[0] &&
+           resultRet[1] == expectRet[1] &&
+           resultRet[2] == expectRet[2] ;
+  }
+};
+
+// ============================================================================
+// [X86Test_AllocHotCold]
+// ============================================================================
+
+class X86Test_AllocHotCold : public X86Test {
+public:
+  X86Test_AllocHotCold() : X86Test("[Alloc] Hot/Cold") {}
+
+  static void add(X86TestManager& mgr) {
+    mgr.add(new X86Test_AllocHotCold());
+  }
+
+  virtual void compile(X86Compiler& cc) {
+    cc.addFunc(FuncSignature2<int, int, int>(CallConv::kIdHost));
+
+    X86Gp a = cc.newInt32("a");
+    X86Gp b = cc.newInt32("b");
+    Label L_Error = cc.newLabel();
+    Label L_Positive = cc.newLabel();
+    Label L_Big = cc.newLabel();
+    Label L_Sum = cc.newLabel();
+
+    cc.setArg(0, a);
+    cc.setArg(1, b);
+
+    // The jump target is cold.
+    cc.test(b, b);
+    cc.notTaken().jz(L_Error);
+
+    // The fall-through is cold, the jump is inverted.
+    cc.test(a, a);
+    cc.taken().jns(L_Positive);
+    cc.neg(a);
+    cc.add(a, 1000);
+
+    // The label is cold.
+    cc.bind(L_Positive);
+    cc.setLabelUnlikely(L_Big);
+    cc.cmp(b, 100);
+    cc.jg(L_Big);
+
+    cc.bind(L_Sum);
+    cc.add(a, b);
+    cc.ret(a);
+
+    cc.bind(L_Big);
+    cc.mov(b, 100);
+    cc.jmp(L_Sum);
+
+    cc.bind(L_Error);
+    cc.mov(a, -1);
+    cc.ret(a);
+    cc.endFunc();
+  }
+
+  virtual bool run(void* _func, StringBuilder& result, StringBuilder& expect) {
+    typedef int (*Func)(int, int);
+    Func func = ptr_as_func<Func>(_func);
+
+    int resultRet[4] = { func(5, 3), func(-5, 3), func(5, 0), func(5, 200) };
+    int expectRet[4] = { 8, 1008, -1, 105 };
+
+    result.setFormat("ret={%d, %d, %d, %d}", resultRet[0], resultRet[1], resultRet[2], resultRet[3]);
+    expect.setFormat("ret={%d, %d, %d, %d}", expectRet[0], expectRet[1], expectRet[2], expectRet[3]);
+
+    return resultRet[0] == expectRet[0] &&
+           resultRet[1] == expectRet[1] &&
+           resultRet[2] == expectRet[2] &&
+           resultRet[3] == expectRet[3] ;
+  }
+};
+
+// ============================================================================
+// [X86Test_AllocLayout]
+// ============================================================================
+
+class X86Test_AllocLayout : public X86Test {
+public:
+  X86Test_AllocLayout() : X86Test("[Alloc] Layout") {}
+
+  static void add(X86TestManager& mgr) {
+    mgr.add(new X86Test_AllocLayout());
+  }
+
+  virtual void compile(X86Compiler& cc) {
+    cc.addFunc(FuncSignature1<int, int>(CallConv::kIdHost));
+
+    X86Gp n = cc.newInt32("n");
+    X86Gp i = cc.newInt32("i");
+    X86Gp t = cc.newInt32("t");
+    X86Gp sum = cc.newInt32("sum");
+
+    Label L_Loop = cc.newLabel();
+    Label L_Rare = cc.newLabel();
+    Label L_Common = cc.newLabel();
+    Label L_Next = cc.newLabel();
+
+    cc.setArg(0, n);
+    cc.xor_(i, i);
+    cc.xor_(sum, sum);
+
+    // The common path is the jump target, the layout makes it fall through.
+    cc.bind(L_Loop);
+    cc.mov(t, i);
+    cc.and_(t, 7);
+    cc.jnz(L_Common);
+
+    cc.bind(L_Rare);
+    cc.add(sum, i);
+    cc.add(sum, i);
+    cc.jmp(L_Next);
+
+    cc.bind(L_Common);
+    cc.add(sum, i);
+
+    cc.bind(L_Next);
+    cc.inc(i);
+    cc.cmp(i, n);
+    cc.jb(L_Loop);
+
+    cc.ret(sum);
+    cc.endFunc();
+
+    X86LayoutPass* layout = static_cast<X86LayoutPass*>(cc.getPassByName("X86LayoutPass"));
+    if (layout) {
+      layout->setBlockWeight(L_Rare, 1);
+      layout->setBlockWeight(L_Common, 7);
+    }
+  }
+
+  virtual bool run(void* _func, StringBuilder& result, StringBuilder& expect) {
+    typedef int (*Func)(int);
+    Func func = ptr_as_func<Func>(_func);
+
+    int resultRet[2] = { func(1), func(100) };
+    int expectRet[2] = { 0, 5574 };
+
+    result.setFormat("ret={%d, %d}", resultRet[0], resultRet[1]);
+    expect.setFormat("ret={%d, %d}", expectRet[0], expectRet[1]);
+
+    return resultRet[0] == expectRet[0] &&
+           resultRet[1] == expectRet[1] ;
+  }
+};
+
 // ============================================================================
 // [X86Test_AllocShlRor]
 // ============================================================================
@@ -3614,6 +3924,9 @@ int main(int argc, char* argv[]) {
   ADD_TEST(X86Test_AllocImul2);
   ADD_TEST(X86Test_AllocIdiv1);
   ADD_TEST(X86Test_AllocSetz);
+  ADD_TEST(X86Test_AllocPeephole);
+  ADD_TEST(X86Test_AllocHotCold);
+  ADD_TEST(X86Test_AllocLayout);
   ADD_TEST(X86Test_AllocShlRor);
   ADD_TEST(X86Test_AllocGpLo);
   ADD_TEST(X86Test_AllocRepMovsb);
@@ -1597,6 +1597,30 @@ class X86Generator extends base.BaseGenerator {
             "  { uint32_t(flags), uint16_t(memFlags), uint8_t(extFlags), uint8_t(regId) }\n" +
                 StringUtils.makeCxxArray(opArr, "const X86Inst::OSignature X86InstDB::oSignatureData[]") +
             "#undef OSIGNATURE\n" +
+            "\n" +
+            "#define OCLASS_IMM(flags, index, immFlags) \\\n" +
+            "  (uint64_t(((flags) & (immFlags)) != 0) << (X86Inst::kOpClassImm + index))\n" +
+            "#define OCLASS(flags, memFlags, extFlags, regId) ( \\\n" +
+            "  (uint64_t((regId) == 0 ? (flags) & X86Inst::kOpAllRegs : 0) << X86Inst::kOpClassReg) | \\\n" +
+            "  (uint64_t((flags) & X86Inst::kOpMem ? (memFlags) & 0x83FFU : 0) << X86Inst::kOpClassMem) | \\\n" +
+            "  OCLASS_IMM(flags,  0, FLAG(U4) | FLAG(I8) | FLAG(U8) | FLAG(I16) | FLAG(U16) | FLAG(I32) | FLAG(U32) | FLAG(I64) | FLAG(U64)) | \\\n" +
+            "  OCLASS_IMM(flags,  1, FLAG(I8) | FLAG(U8) | FLAG(I16) | FLAG(U16) | FLAG(I32) | FLAG(U32) | FLAG(I64) | FLAG(U64)) | \\\n" +
+            "  OCLASS_IMM(flags,  2, FLAG(U8) | FLAG(I16) | FLAG(U16) | FLAG(I32) | FLAG(U32) | FLAG(I64) | FLAG(U64)) | \\\n" +
+            "  OCLASS_IMM(flags,  3, FLAG(I16) | FLAG(U16) | FLAG(I32) | FLAG(U32) | FLAG(I64) | FLAG(U64)) | \\\n" +
+            "  OCLASS_IMM(flags,  4, FLAG(U16) | FLAG(I32) | FLAG(U32) | FLAG(I64) | FLAG(U64)) | \\\n" +
+            "  OCLASS_IMM(flags,  5, FLAG(I32) | FLAG(U32) | FLAG(I64) | FLAG(U64)) | \\\n" +
+            "  OCLASS_IMM(flags,  6, FLAG(U32) | FLAG(I64) | FLAG(U64)) | \\\n" +
+            "  OCLASS_IMM(flags,  7, FLAG(I64) | FLAG(U64)) | \\\n" +
+            "  OCLASS_IMM(flags,  8, FLAG(U64)) | \\\n" +
+            "  OCLASS_IMM(flags,  9, FLAG(I8) | FLAG(I16) | FLAG(I32) | FLAG(I64)) | \\\n" +
+            "  OCLASS_IMM(flags, 10, FLAG(I16) | FLAG(I32) | FLAG(I64)) | \\\n" +
+            "  OCLASS_IMM(flags, 11, FLAG(I32) | FLAG(I64)) | \\\n" +
+            "  OCLASS_IMM(flags, 12, FLAG(I64)) | \\\n" +
+            "  (uint64_t(((flags) & (FLAG(Rel8) | FLAG(Rel32))) != 0) << X86Inst::kOpClassLabel))\n" +
+                StringUtils.makeCxxArray(opArr.map(function(s) { return s.replace("OSIGNATURE", "OCLASS"); }),
+                                         "const uint64_t X86InstDB::oSignatureClassData[]") +
+            "#undef OCLASS\n" +
+            "#undef OCLASS_IMM\n" +
             "#undef MEM\n" +
             "#undef FLAG\n" +
             "\n" +
@@ -1609,7 +1633,7 @@ class X86Generator extends base.BaseGenerator {
             "  }\n" +
             StringUtils.makeCxxArrayWithComment(signatureArr, "const X86Inst::ISignature X86InstDB::iSignatureData[]") +
             "#undef ISIGNATURE\n";
-    return this.inject("signatureData", StringUtils.disclaimer(s), opArr.length * 8 + signatureArr.length * 8);
+    return this.inject("signatureData", StringUtils.disclaimer(s), opArr.length * 16 + signatureArr.length * 8);
   }
 
   // --------------------------------------------------------------------------